@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <libavformat/avformat.h>
+#include <libavutil/time.h>
+#include "fingerprint.h"    // GOP指纹，识别重复文件
 
 int main(int argc, char **argv)
 {
@@ -19,6 +21,11 @@ int main(int argc, char **argv)
         in_filename = argv[1];
     }
     printf("in_filename = %s\n", in_filename);
+    // 第二个参数是指纹索引文件，指定后边demux边计算GOP指纹，重复文件读完前几个GOP就结束
+    const char *fp_index_name = argc > 2 ? argv[2] : NULL;
+    gop_fp_index_t *fp_index = NULL;
+    gop_fp_t *fp = NULL;
+    int is_duplicate = 0;
 
     //AVFormatContext是描述一个媒体文件或媒体流的构成和基本信息的结构体
     AVFormatContext *ifmt_ctx = NULL;           // 输入文件的demux
@@ -162,11 +169,27 @@ int main(int argc, char **argv)
         }
     }
 
+    if (fp_index_name)
+    {
+        fp_index = gop_fp_index_load(fp_index_name);
+        // 有视频流用视频关键帧分GOP，否则用音频
+        int fp_stream = videoindex >= 0 ? videoindex : audioindex;
+        if (fp_index && fp_stream >= 0)
+        {
+            fp = gop_fp_alloc(fp_index, ifmt_ctx->streams[fp_stream]->codecpar, fp_stream, 0, 0);
+        }
+        if (!fp)
+        {
+            printf("fingerprint disabled, index:%s\n", fp_index_name);
+        }
+    }
+
     AVPacket *pkt = av_packet_alloc();
 
     int pkt_count = 0;
     int print_max_count = 10;
     printf("\n-----av_read_frame start\n");
+    int64_t loop_start = av_gettime_relative();
     while (1)
     {
         ret = av_read_frame(ifmt_ctx, pkt);
@@ -176,6 +199,14 @@ int main(int argc, char **argv)
             break;
         }
 
+        if (fp && gop_fp_feed(fp, pkt) == 1)
+        {
+            is_duplicate = 1;  // 前几个GOP已经命中索引，不用再读了
+            av_packet_unref(pkt);
+            printf("duplicate detected after %d gops, stop demux\n", fp->nb_gops);
+            break;
+        }
+
         if(pkt_count++ < print_max_count)
         {
             if (pkt->stream_index == audioindex)
@@ -204,12 +235,33 @@ int main(int argc, char **argv)
 
         av_packet_unref(pkt);
     }
+    int64_t loop_time = av_gettime_relative() - loop_start;
+
+    if (fp)
+    {
+        if (!is_duplicate)
+            is_duplicate = gop_fp_finish(fp) == 1;
+        gop_fp_dump_stats(fp, loop_time);
+        // 新文件加入索引，下次上传相同文件时可以识别
+        if (!is_duplicate && fp->nb_gops > 0)
+        {
+            if (gop_fp_index_add(fp_index, in_filename, fp->hashes, fp->nb_gops) >= 0 &&
+                gop_fp_index_save(fp_index, fp_index_name) == 0)
+            {
+                printf("add %s to fingerprint index %s\n", in_filename, fp_index_name);
+            }
+        }
+    }
 
     if(pkt)
         av_packet_free(&pkt);
 failed:
     if(ifmt_ctx)
         avformat_close_input(&ifmt_ctx);
+    if (fp)
+        gop_fp_free(fp);
+    if (fp_index)
+        gop_fp_index_free(fp_index);
 
 
     getchar(); //加上这一句，防止程序打印完信息马上退出
@@ -2,6 +2,8 @@
 #include <libavutil/log.h>        // FFmpeg日志功能
 #include <libavformat/avio.h>     // FFmpeg I/O操作
 #include <libavformat/avformat.h> // FFmpeg格式处理
+#include "packetpool.h"           // 包回收池
+#include "bsfchain.h"             // 比特流过滤器链
 
 static char err_buf[128] = {0};
 // 自定义错误信息获取函数
@@ -26,13 +28,16 @@ int main(int argc, char **argv)
     AVFormatContext *ifmt_ctx = NULL; // 输入文件上下文
     int videoindex = -1;              // 视频流索引
     AVPacket *pkt = NULL;             // 数据包
+    AVPacket *out_pkt = NULL;         // 过滤器输出的数据包
+    packet_pool_t *pkt_pool = NULL;   // demux、bsf 共用的包回收池
+    bsf_chain_t *bsf_chain = NULL;    // 比特流过滤器链
     int ret = -1;                     // 函数调用返回值
     int file_end = 0;                 // 文件结束标志
 
     // 参数检查
     if (argc < 3)
     {
-        printf("Usage: %s <inputfile> <outfile>\n", argv[0]);
+        printf("Usage: %s <inputfile> <outfile> [bsf1,bsf2,...]\n", argv[0]);
         return -1;
     }
     FILE *outfp = fopen(argv[2], "wb"); // 打开输出文件（H264裸流）
@@ -72,25 +77,40 @@ int main(int argc, char **argv)
         return -1;
     }
 
-    // ===== 5. 初始化数据包 =====
-    pkt = av_packet_alloc(); // 分配AVPacket内存
-    av_init_packet(pkt);     // 初始化包字段
-
-    // ===== 6. 配置比特流过滤器 =====
-    // 关键作用：转换MP4格式H.264为Annex B格式
-    const AVBitStreamFilter *bsfilter = av_bsf_get_by_name("h264_mp4toannexb");
-    AVBSFContext *bsf_ctx = NULL;
-    av_bsf_alloc(bsfilter, &bsf_ctx); // 创建过滤器上下文
+    // ===== 5. 初始化包回收池 =====
+    // 数据包从池中获取，用完归还，稳定运行后不再分配AVPacket
+    pkt_pool = packet_pool_alloc(0);
+    if (!pkt_pool)
+    {
+        printf("[Error] Could not allocate packet pool.\n");
+        avformat_close_input(&ifmt_ctx);
+        return -1;
+    }
 
-    // 复制视频编解码参数到过滤器
-    avcodec_parameters_copy(bsf_ctx->par_in, ifmt_ctx->streams[videoindex]->codecpar);
-    av_bsf_init(bsf_ctx); // 初始化过滤器
+    // ===== 6. 配置比特流过滤器链 =====
+    // 关键作用：转换MP4格式H.264为Annex B格式，可以通过第3个参数追加其他过滤器
+    const char *filters = argc > 3 ? argv[3] : "h264_mp4toannexb";
+    bsf_chain = bsf_chain_alloc(filters, ifmt_ctx->streams[videoindex]->codecpar,
+                                ifmt_ctx->streams[videoindex]->time_base, videoindex, pkt_pool);
+    if (!bsf_chain)
+    {
+        printf("[Error] Could not init bsf chain: %s\n", filters);
+        packet_pool_free(pkt_pool);
+        avformat_close_input(&ifmt_ctx);
+        return -1;
+    }
 
     // ===== 7. 数据处理主循环 =====
     file_end = 0;
     while (0 == file_end)
     {
         // 读取数据包
+        pkt = packet_pool_get(pkt_pool);
+        if (!pkt)
+        {
+            printf("[Error] Could not allocate packet.\n");
+            break;
+        }
         ret = av_read_frame(ifmt_ctx, pkt);
         if (ret < 0)
         {
@@ -103,15 +123,17 @@ int main(int argc, char **argv)
         {
 #if 1 // 被禁用的比特流处理路径（演示用）
       // 此路径使用过滤器处理MP4格式
-            if (av_bsf_send_packet(bsf_ctx, pkt) != 0) {
-                av_packet_unref(pkt);  
+            if (bsf_chain_send_packet(bsf_chain, pkt) != 0) {
+                packet_pool_put(pkt_pool, pkt);
                 continue;
             }
-            av_packet_unref(pkt);
-            while(av_bsf_receive_packet(bsf_ctx, pkt) == 0) {
-                fwrite(pkt->data, 1, pkt->size, outfp); // 写入处理后的数据
-                av_packet_unref(pkt);
+            packet_pool_put(pkt_pool, pkt);
+            out_pkt = packet_pool_get(pkt_pool);
+            while(out_pkt && bsf_chain_receive_packet(bsf_chain, out_pkt) == 0) {
+                fwrite(out_pkt->data, 1, out_pkt->size, outfp); // 写入处理后的数据
+                av_packet_unref(out_pkt);
             }
+            packet_pool_put(pkt_pool, out_pkt);
 #else // 当前启用的直接写入路径（仅适用于TS流）
       // TS流已包含起始码，可直接写入
             size_t size = fwrite(pkt->data, 1, pkt->size, outfp);
@@ -119,22 +141,35 @@ int main(int argc, char **argv)
             {
                 printf("fwrite failed-> write:%u, pkt_size:%u\n", size, pkt->size);
             }
-            av_packet_unref(pkt); // 释放包内存
+            packet_pool_put(pkt_pool, pkt); // 释放包内存，归还到池
 #endif
         }
-        else if (ret == 0)
+        else
+        {
+            packet_pool_put(pkt_pool, pkt); // 非视频流或读取结束，归还包
+        }
+    }
+    // 冲刷过滤器链
+    if (bsf_chain_send_packet(bsf_chain, NULL) == 0)
+    {
+        out_pkt = packet_pool_get(pkt_pool);
+        while (out_pkt && bsf_chain_receive_packet(bsf_chain, out_pkt) == 0)
         {
-            av_packet_unref(pkt); // 非视频流释放包
+            fwrite(out_pkt->data, 1, out_pkt->size, outfp);
+            av_packet_unref(out_pkt);
         }
+        packet_pool_put(pkt_pool, out_pkt);
     }
+    bsf_chain_dump_stats(bsf_chain, "extract_h264");
+    packet_pool_dump_stats(pkt_pool, "extract_h264");
 
     // ===== 8. 资源清理 =====
     if (outfp)
         fclose(outfp);
-    if (bsf_ctx)
-        av_bsf_free(&bsf_ctx);
-    if (pkt)
-        av_packet_free(&pkt);
+    if (bsf_chain)
+        bsf_chain_free(bsf_chain);
+    if (pkt_pool)
+        packet_pool_free(pkt_pool);
     if (ifmt_ctx)
         avformat_close_input(&ifmt_ctx);
 
@@ -6,12 +6,17 @@
 #include <libavutil/frame.h>
 #include <libavutil/mem.h>
 #include <libavcodec/avcodec.h>
+#include "pcmconv.h"                 // 平面 -> 交错转换
+#include "decodeguard.h"             // 容错解码
 
 // 音频输入缓冲区大小和重填充阈值
 #define AUDIO_INBUF_SIZE 20480       // 输入缓冲区大小（20KB）
 #define AUDIO_REFILL_THRESH 4096     // 当剩余数据小于此值时重新填充缓冲区
 
 static char err_buf[128] = {0};      // 存储FFmpeg错误信息的缓冲区
+static uint8_t *s_pcm_buf = NULL;    // 交错格式的一帧PCM，整帧一次写入
+static unsigned int s_pcm_buf_size = 0;
+static decode_guard_t s_guard;       // 容错模式下跳过损坏的包继续解码
 
 /**
  * @brief 获取FFmpeg错误信息的可读字符串
@@ -46,12 +51,13 @@ static void print_sample_format(const AVFrame *frame)
 static void decode(AVCodecContext *dec_ctx, AVPacket *pkt, AVFrame *frame,
                    FILE *outfile)
 {
-    int i, ch;
     int ret, data_size;
     
-    /* 将压缩数据包发送给解码器 */
-    ret = avcodec_send_packet(dec_ctx, pkt);
-    if(ret == AVERROR(EAGAIN)) {
+    /* 将压缩数据包发送给解码器，容错模式下损坏的包被丢弃(返回1) */
+    ret = decode_guard_send_packet(&s_guard, dec_ctx, pkt);
+    if (ret == 1) {
+        return;
+    } else if(ret == AVERROR(EAGAIN)) {
         // API使用错误：应在接收帧后重新发送
         fprintf(stderr, "Receive_frame and send_packet both returned EAGAIN, which is an API violation.\n");
     } else if (ret < 0) {
@@ -64,13 +70,13 @@ static void decode(AVCodecContext *dec_ctx, AVPacket *pkt, AVFrame *frame,
     /* 读取所有输出帧（可能包含多个帧） */
     while (ret >= 0) {
         // 从解码器接收解码后的帧
-        ret = avcodec_receive_frame(dec_ctx, frame);
+        ret = decode_guard_receive_frame(&s_guard, dec_ctx, frame);
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
             // 需要更多数据或已结束
             return;
         } else if (ret < 0) {
-            // 解码过程中发生致命错误
-            fprintf(stderr, "Error during decoding\n");
+            // 非容错模式第一次出错，或容错模式连续出错太多
+            fprintf(stderr, "Error during decoding, err:%s\n", av_get_err(ret));
             exit(1);
         }
         
@@ -94,13 +100,14 @@ static void decode(AVCodecContext *dec_ctx, AVPacket *pkt, AVFrame *frame,
          * 注意：解码器输出可能是平面格式，这里转换为交错格式写入文件
          * 
          * 播放示例：ffplay -ar 48000 -ac 2 -f f32le output.pcm
+         * 整帧转换成交错格式后一次写入，不再每个采样调用一次 fwrite
          */
-        for (i = 0; i < frame->nb_samples; i++) {
-            for (ch = 0; ch < dec_ctx->channels; ch++) {
-                // 将每个声道的每个采样写入文件（转换为交错格式）
-                fwrite(frame->data[ch] + data_size * i, 1, data_size, outfile);
-            }
+        data_size = pcm_frame_to_interleaved(frame, &s_pcm_buf, &s_pcm_buf_size);
+        if (data_size < 0) {
+            fprintf(stderr, "Failed to interleave frame\n");
+            exit(1);
         }
+        fwrite(s_pcm_buf, 1, data_size, outfile);
     }
 }
 
@@ -121,11 +128,13 @@ int main(int argc, char **argv)
 
     // 参数检查
     if (argc <= 2) {
-        fprintf(stderr, "Usage: %s <input file> <output file>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <input file> <output file> [resilient]\n", argv[0]);
         exit(0);
     }
     filename = argv[1];
     outfilename = argv[2];
+    // 第3个参数为 resilient 时容错解码，损坏的包不会让整个任务退出
+    decode_guard_init(&s_guard, argc > 3 && strcmp(argv[3], "resilient") == 0);
 
     // 根据文件扩展名确定解码器类型
     enum AVCodecID audio_codec_id;
@@ -166,6 +175,8 @@ int main(int argc, char **argv)
         exit(1);
     }
 
+    decode_guard_setup(&s_guard, codec_ctx);
+
     // 打开解码器
     if (avcodec_open2(codec_ctx, codec, NULL) < 0) {
         fprintf(stderr, "Could not open codec\n");
@@ -236,6 +247,7 @@ int main(int argc, char **argv)
     pkt->data = NULL;   // 空包触发drain模式
     pkt->size = 0;
     decode(codec_ctx, pkt, decoded_frame, outfile);
+    decode_guard_dump_stats(&s_guard, "decode_audio");
 
     // 清理资源
     fclose(outfile);
@@ -244,6 +256,7 @@ int main(int argc, char **argv)
     av_parser_close(parser);
     av_frame_free(&decoded_frame);
     av_packet_free(&pkt);
+    av_freep(&s_pcm_buf);
 
     printf("Decoding completed successfully.\n");
     printf("Play with: ffplay -ar <samplerate> -ac <channels> -f f32le %s\n", outfilename);
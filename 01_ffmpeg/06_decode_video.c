@@ -1,14 +1,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
 #include <libavutil/frame.h>
 #include <libavutil/mem.h>
+#include <libavutil/time.h>
 
 #include <libavcodec/avcodec.h>
 
+#include "packetpool.h"     // 包回收池
+#include "boundedqueue.h"   // 线程之间传递包和帧
+#include "yuvwriter.h"      // 原始帧写文件
+#include "framepool.h"      // 解码帧内存池
+#include "decodeguard.h"    // 容错解码
+
 #define VIDEO_INBUF_SIZE 20480      // 输入缓冲区大小
 #define VIDEO_REFILL_THRESH 4096    // 当剩余数据低于此阈值时重新填充缓冲区
+#define PACKET_QUEUE_SIZE 64        // 解析线程 -> 解码线程 最多缓存的包
+#define FRAME_QUEUE_SIZE 8          // 解码线程 -> 写线程 最多缓存的帧(4K一帧12MB，不宜太多)
 
 static char err_buf[128] = {0};     // 存储FFmpeg错误信息的缓冲区
 
@@ -28,68 +38,241 @@ static void print_video_format(const AVFrame *frame)
 }
 
 /**
- * @brief 解码视频帧并将YUV数据写入文件
+ * 解析、解码、写文件分别在三个线程中并行：
+ *   解析线程 --pkt_queue--> 解码线程(主线程) --frame_queue--> 写线程
+ *                                    ^-------free_frames(空帧回收)-----|
+ * 队列有界，某一级慢时前一级会阻塞，内存不会无限增长。
+ */
+typedef struct decode_pipeline {
+    FILE *infile;
+    yuv_writer_t *writer;       // 输出原始帧
+    const AVCodec *codec;
+    AVCodecParserContext *parser;
+    AVCodecContext *parser_ctx;     // 解析器单独使用的上下文，解析器会写入宽高等字段，不和解码器共用
+    packet_pool_t *pkt_pool;
+    decode_guard_t guard;           // 容错模式下跳过损坏的包，在关键帧处恢复
+
+    bounded_queue_t *pkt_queue;
+    bounded_queue_t *frame_queue;
+    bounded_queue_t *free_frames;
+
+    // 各阶段统计
+    int64_t in_bytes;
+    int64_t out_bytes;
+    int64_t nb_packets;
+    int64_t nb_frames;
+    int64_t frame_allocs;           // 真正 av_frame_alloc 的次数
+    int64_t parse_us;
+    int64_t decode_us;
+    int64_t write_us;
+} decode_pipeline_t;
+
+// 解析线程：读文件，把裸流切分成一个个包，拷贝到池内存后交给解码线程
+static void *parse_thread(void *arg)
+{
+    decode_pipeline_t *p = (decode_pipeline_t *)arg;
+    uint8_t *inbuf = (uint8_t *)av_mallocz(VIDEO_INBUF_SIZE + AV_INPUT_BUFFER_PADDING_SIZE);
+    uint8_t *data = inbuf;
+    size_t data_size = 0;
+    uint8_t *out_data = NULL;
+    int out_size = 0;
+    int eof = 0;
+    int ret = 0;
+
+    if (!inbuf) {
+        bounded_queue_abort(p->pkt_queue);
+        return NULL;
+    }
+    int64_t start = av_gettime_relative();
+    data_size = fread(inbuf, 1, VIDEO_INBUF_SIZE, p->infile);
+    p->in_bytes += data_size;
+
+    while (1) {
+        // 文件读完后再用空数据调用一次，把解析器中缓存的最后一个包取出来
+        ret = av_parser_parse2(p->parser, p->parser_ctx, &out_data, &out_size,
+                               data, eof ? 0 : data_size,
+                               AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+        if (ret < 0) {
+            fprintf(stderr, "Error while parsing\n");
+            bounded_queue_abort(p->pkt_queue);
+            break;
+        }
+        data      += ret;
+        data_size -= ret;
+
+        if (out_size > 0) {
+            // 解析器输出指向内部缓存，必须拷贝一份再交给其他线程
+            AVPacket *pkt = packet_pool_get(p->pkt_pool);
+            if (!pkt || packet_pool_new_data(p->pkt_pool, pkt, out_size) < 0) {
+                packet_pool_put(p->pkt_pool, pkt);
+                bounded_queue_abort(p->pkt_queue);
+                break;
+            }
+            memcpy(pkt->data, out_data, out_size);
+            // 容错模式出错后从关键帧恢复，裸流没有封装层的关键帧标记，用解析器的结果
+            if (p->parser->key_frame == 1 || p->parser->pict_type == AV_PICTURE_TYPE_I)
+                pkt->flags |= AV_PKT_FLAG_KEY;
+            p->nb_packets++;
+            p->parse_us += av_gettime_relative() - start;
+            ret = bounded_queue_push(p->pkt_queue, pkt);     // 队列满时在这里等待解码线程
+            start = av_gettime_relative();
+            if (ret < 0) {
+                packet_pool_put(p->pkt_pool, pkt);
+                break;
+            }
+        }
+        if (eof && out_size == 0) {
+            break;
+        }
+
+        // 当剩余数据不足时，重新填充缓冲区
+        if (!eof && data_size < VIDEO_REFILL_THRESH) {
+            memmove(inbuf, data, data_size);
+            data = inbuf;
+            size_t len = fread(data + data_size, 1, VIDEO_INBUF_SIZE - data_size, p->infile);
+            data_size += len;
+            p->in_bytes += len;
+            if (data_size == 0) {
+                eof = 1;
+            }
+        }
+    }
+    p->parse_us += av_gettime_relative() - start;
+    bounded_queue_finish(p->pkt_queue);
+    av_free(inbuf);
+    return NULL;
+}
+
+// 写线程：取出解码好的帧写入文件，写完把空帧还给解码线程
+static void *write_thread(void *arg)
+{
+    decode_pipeline_t *p = (decode_pipeline_t *)arg;
+    AVFrame *frame = NULL;
+    while (bounded_queue_pop(p->frame_queue, (void **)&frame) == 0) {
+        int64_t start = av_gettime_relative();
+        // 首次解码成功时打印视频格式
+        if (p->out_bytes == 0) {
+            print_video_format(frame);
+        }
+        /**
+         * 各平面紧凑排列写入，像素格式不限于YUV420P(NV12、10bit、422、444都可以)
+         * linesize 等于行宽时整平面一段，否则每行一段，一帧一次 writev
+         */
+        int ret = yuv_writer_write_frame(p->writer, frame);
+        if (ret > 0)
+            p->out_bytes += ret;
+        p->write_us += av_gettime_relative() - start;
+
+        av_frame_unref(frame);
+        if (bounded_queue_push(p->free_frames, frame) < 0) {
+            av_frame_free(&frame);
+        }
+    }
+    return NULL;
+}
+
+// 从回收队列取一个空帧，没有就分配
+static AVFrame *get_free_frame(decode_pipeline_t *p)
+{
+    AVFrame *frame = NULL;
+    if (bounded_queue_try_pop(p->free_frames, (void **)&frame) == 0) {
+        return frame;
+    }
+    p->frame_allocs++;
+    return av_frame_alloc();
+}
+
+/**
+ * @brief 解码一个包，解码出的帧交给写线程
  * @param dec_ctx 解码器上下文
- * @param pkt 包含压缩数据的包
- * @param frame 存储解码后的帧
- * @param outfile 输出文件句柄
+ * @param pkt 包含压缩数据的包，NULL表示冲刷
+ * @param p 流水线上下文
  */
-static void decode(AVCodecContext *dec_ctx, AVPacket *pkt, AVFrame *frame,
-                   FILE *outfile)
+static void decode(AVCodecContext *dec_ctx, AVPacket *pkt, decode_pipeline_t *p)
 {
     int ret;
-    
-    // 发送压缩数据包给解码器
-    ret = avcodec_send_packet(dec_ctx, pkt);
-    if(ret == AVERROR(EAGAIN))
+    int64_t start = av_gettime_relative();
+
+    // 发送压缩数据包给解码器，容错模式下损坏的包被丢弃(返回1)
+    ret = decode_guard_send_packet(&p->guard, dec_ctx, pkt);
+    if (ret == 1)
+    {
+        p->decode_us += av_gettime_relative() - start;
+        return;
+    }
+    else if(ret == AVERROR(EAGAIN))
     {
         fprintf(stderr, "Receive_frame and send_packet both returned EAGAIN, which is an API violation.\n");
     }
     else if (ret < 0)
     {
         fprintf(stderr, "Error submitting the packet to the decoder, err:%s, pkt_size:%d\n",
-                av_get_err(ret), pkt->size);
+                av_get_err(ret), pkt ? pkt->size : 0);
+        p->decode_us += av_gettime_relative() - start;
         return;
     }
 
     // 循环获取所有解码完成的帧
     while (ret >= 0)
     {
-        ret = avcodec_receive_frame(dec_ctx, frame);
+        AVFrame *frame = get_free_frame(p);
+        if (!frame) {
+            fprintf(stderr, "Could not allocate video frame\n");
+            exit(1);
+        }
+        ret = decode_guard_receive_frame(&p->guard, dec_ctx, frame);
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
-            return;
+        {
+            if (bounded_queue_push(p->free_frames, frame) < 0)
+                av_frame_free(&frame);
+            break;
+        }
         else if (ret < 0)
         {
-            fprintf(stderr, "Error during decoding\n");
+            // 非容错模式第一次出错，或容错模式连续出错太多
+            fprintf(stderr, "Error during decoding, err:%s\n", av_get_err(ret));
             exit(1);
         }
-        
-        // 首次解码成功时打印视频格式
-        static int s_print_format = 0;
-        if(s_print_format == 0)
-        {
-            s_print_format = 1;
-            print_video_format(frame);
+        p->nb_frames++;
+        p->decode_us += av_gettime_relative() - start;
+        // 队列满时在这里等待写线程
+        if (bounded_queue_push(p->frame_queue, frame) < 0) {
+            av_frame_free(&frame);
         }
-
-        /**
-         * 正确写入YUV420P数据的方法：
-         * - Y平面：全尺寸，高度=frame->height
-         * - U/V平面：1/4尺寸（宽高各减半）
-         * 使用linesize处理行对齐问题（可能包含填充字节）
-         */
-        // 写入Y分量（亮度）
-        for(int j=0; j<frame->height; j++)
-            fwrite(frame->data[0] + j * frame->linesize[0], 1, frame->width, outfile);
-        
-        // 写入U分量（色度）
-        for(int j=0; j<frame->height/2; j++)
-            fwrite(frame->data[1] + j * frame->linesize[1], 1, frame->width/2, outfile);
-        
-        // 写入V分量（色度）
-        for(int j=0; j<frame->height/2; j++)
-            fwrite(frame->data[2] + j * frame->linesize[2], 1, frame->width/2, outfile);
+        start = av_gettime_relative();
     }
+    p->decode_us += av_gettime_relative() - start;
+}
+
+// 解析线程类型参数: frame / slice / both
+static int parse_thread_type(const char *str)
+{
+    if (!str || strcmp(str, "both") == 0)
+        return FF_THREAD_FRAME | FF_THREAD_SLICE;
+    if (strcmp(str, "frame") == 0)
+        return FF_THREAD_FRAME;
+    if (strcmp(str, "slice") == 0)
+        return FF_THREAD_SLICE;
+    return -1;
+}
+
+static const char *thread_type_name(int type)
+{
+    if (type == (FF_THREAD_FRAME | FF_THREAD_SLICE))
+        return "frame+slice";
+    if (type == FF_THREAD_FRAME)
+        return "frame";
+    if (type == FF_THREAD_SLICE)
+        return "slice";
+    return "none";
+}
+
+static void dump_queue_stats(bounded_queue_t *q, const char *name)
+{
+    bounded_queue_stats_t s;
+    bounded_queue_get_stats(q, &s);
+    printf("[decode] %s max depth:%d/%d push waits:%lld pop waits:%lld\n", name, s.max_depth,
+           q->capacity, (long long)s.push_waits, (long long)s.pop_waits);
 }
 
 /**
@@ -97,6 +280,8 @@ static void decode(AVCodecContext *dec_ctx, AVPacket *pkt, AVFrame *frame,
  * 提取H264: ffmpeg -i input.flv -vcodec libx264 -an -f h264 output.h264
  * 提取MPEG2: ffmpeg -i input.flv -vcodec mpeg2video -an -f mpeg2video output.mpeg2
  * 播放YUV: ffplay -pixel_format yuv420p -video_size 768x320 -framerate 25 output.yuv
+ * 多线程解码: 06_decode_video in.h264 out.yuv 8 frame   (线程数为0时自动按CPU核数)
+ * 容错解码: 06_decode_video in.h264 out.yuv 1 both resilient   (跳过损坏的包，在关键帧处恢复)
  */
 int main(int argc, char **argv)
 {
@@ -104,26 +289,46 @@ int main(int argc, char **argv)
     const char *filename;       // 输入视频文件（H.264/MPEG2）
     const AVCodec *codec;       // 解码器
     AVCodecContext *codec_ctx= NULL; // 解码器上下文
-    AVCodecParserContext *parser = NULL; // 解析器上下文
-    FILE *infile = NULL, *outfile = NULL;
-    uint8_t inbuf[VIDEO_INBUF_SIZE + AV_INPUT_BUFFER_PADDING_SIZE]; // 输入缓冲区（带填充）
-    uint8_t *data = NULL;       // 当前处理的数据指针
-    size_t   data_size = 0;     // 当前缓冲区有效数据大小
+    decode_pipeline_t pipeline;
+    pthread_t parse_tid, write_tid;
     AVPacket *pkt = NULL;       // 存储压缩数据包
-    AVFrame *decoded_frame = NULL; // 存储解码帧
-    int len = 0;
-    int ret = 0;
-    
+    AVFrame *frame = NULL;
+    frame_pool_t *frame_pool = NULL;    // 解码器输出帧的内存池
+    int thread_count = 1;       // 解码线程数，FFmpeg 默认是1
+    int thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
     if (argc <= 2)
     {
-        fprintf(stderr, "Usage: %s <input file> <output file>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <input file> <output file> [threads] [frame|slice|both]"
+                " [mmap] [resilient]\n", argv[0]);
         exit(0);
     }
     filename    = argv[1];  // 输入文件路径
     outfilename = argv[2];  // 输出文件路径
+    if (argc > 3)
+        thread_count = atoi(argv[3]);
+    if (argc > 4 && (thread_type = parse_thread_type(argv[4])) < 0) {
+        fprintf(stderr, "Unknown thread type: %s\n", argv[4]);
+        exit(1);
+    }
+
+    // 第5个参数之后的选项：mmap 用内存映射方式写入，resilient 容错解码
+    int use_mmap = 0;
+    int resilient = 0;
+    for (int i = 5; i < argc; i++) {
+        if (strcmp(argv[i], "mmap") == 0) {
+            use_mmap = 1;
+        } else if (strcmp(argv[i], "resilient") == 0) {
+            resilient = 1;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            exit(1);
+        }
+    }
+
+    memset(&pipeline, 0, sizeof(pipeline));
+    decode_guard_init(&pipeline.guard, resilient);
 
-    pkt = av_packet_alloc(); // 分配AVPacket
-    
     // 根据文件扩展名确定解码器类型
     enum AVCodecID video_codec_id = AV_CODEC_ID_H264;
     if(strstr(filename, "264") != NULL) {
@@ -142,18 +347,37 @@ int main(int argc, char **argv)
         fprintf(stderr, "Codec not found\n");
         exit(1);
     }
-    
+    pipeline.codec = codec;
+
     // 初始化解析器（用于分割裸流为NALU）
-    parser = av_parser_init(codec->id);
-    if (!parser) {
+    pipeline.parser = av_parser_init(codec->id);
+    if (!pipeline.parser) {
         fprintf(stderr, "Parser not found\n");
         exit(1);
     }
-    
+    pipeline.parser_ctx = avcodec_alloc_context3(codec);
+
     // 创建解码器上下文
     codec_ctx = avcodec_alloc_context3(codec);
-    if (!codec_ctx) {
-        fprintf(stderr, "Could not allocate audio codec context\n");
+    if (!codec_ctx || !pipeline.parser_ctx) {
+        fprintf(stderr, "Could not allocate video codec context\n");
+        exit(1);
+    }
+
+    /**
+     * 多线程解码，必须在 avcodec_open2 之前设置：
+     * - FF_THREAD_FRAME 帧级并行，多帧同时解码，吞吐高但会增加 thread_count-1 帧延迟
+     * - FF_THREAD_SLICE 片级并行，同一帧的多个slice同时解码，无额外延迟，但要求码流有多个slice
+     * 两者都设置时解码器优先使用帧级并行
+     */
+    codec_ctx->thread_count = thread_count;
+    codec_ctx->thread_type = thread_type;
+    decode_guard_setup(&pipeline.guard, codec_ctx);
+
+    // 解码器从池中分配帧内存，写线程释放帧后内存回到池中，稳定后不再分配大块内存
+    frame_pool = frame_pool_alloc();
+    if (!frame_pool || frame_pool_attach(frame_pool, codec_ctx) < 0) {
+        fprintf(stderr, "Could not allocate frame pool\n");
         exit(1);
     }
 
@@ -164,78 +388,85 @@ int main(int argc, char **argv)
     }
 
     // 打开输入文件（视频裸流）
-    infile = fopen(filename, "rb");
-    if (!infile) {
+    pipeline.infile = fopen(filename, "rb");
+    if (!pipeline.infile) {
         fprintf(stderr, "Could not open %s\n", filename);
         exit(1);
     }
-    
+
     // 打开输出文件（YUV原始数据）
-    outfile = fopen(outfilename, "wb");
-    if (!outfile) {
-        av_free(codec_ctx);
+    pipeline.writer = yuv_writer_open(outfilename, use_mmap);
+    if (!pipeline.writer) {
+        avcodec_free_context(&codec_ctx);
         exit(1);
     }
 
-    // 初始化数据指针和大小
-    data = inbuf;
-    data_size = fread(inbuf, 1, VIDEO_INBUF_SIZE, infile);
-
-    // 主解码循环
-    while (data_size > 0)
-    {
-        // 首次进入时分配帧内存
-        if (!decoded_frame) {
-            if (!(decoded_frame = av_frame_alloc())) {
-                fprintf(stderr, "Could not allocate audio frame\n");
-                exit(1);
-            }
-        }
+    pipeline.pkt_pool = packet_pool_alloc(PACKET_QUEUE_SIZE + 8);
+    pipeline.pkt_queue = bounded_queue_alloc(PACKET_QUEUE_SIZE);
+    pipeline.frame_queue = bounded_queue_alloc(FRAME_QUEUE_SIZE);
+    // 在途的帧最多是 frame_queue 容量 + 解码线程和写线程手上各一帧，回收队列不会满
+    pipeline.free_frames = bounded_queue_alloc(FRAME_QUEUE_SIZE * 2 + 4);
+    if (!pipeline.pkt_pool || !pipeline.pkt_queue || !pipeline.frame_queue || !pipeline.free_frames) {
+        fprintf(stderr, "Could not allocate pipeline\n");
+        exit(1);
+    }
 
-        // 使用解析器分割数据包
-        ret = av_parser_parse2(parser, codec_ctx, &pkt->data, &pkt->size,
-                               data, data_size,
-                               AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
-        if (ret < 0) {
-            fprintf(stderr, "Error while parsing\n");
-            exit(1);
-        }
-        
-        // 移动数据指针
-        data      += ret;   // 跳过已解析数据
-        data_size -= ret;   // 更新剩余数据大小
-
-        // 如果解析出完整数据包，进行解码
-        if (pkt->size) {
-            decode(codec_ctx, pkt, decoded_frame, outfile);
-        }
+    int64_t start_time = av_gettime_relative();
+    if (pthread_create(&parse_tid, NULL, parse_thread, &pipeline) != 0 ||
+        pthread_create(&write_tid, NULL, write_thread, &pipeline) != 0) {
+        fprintf(stderr, "Could not create thread\n");
+        exit(1);
+    }
 
-        // 当剩余数据不足时，重新填充缓冲区
-        if (data_size < VIDEO_REFILL_THRESH) {
-            // 将剩余数据移到缓冲区头部
-            memmove(inbuf, data, data_size);
-            data = inbuf;
-            // 读取新数据到缓冲区剩余空间
-            len = fread(data + data_size, 1, VIDEO_INBUF_SIZE - data_size, infile);
-            if (len > 0) {
-                data_size += len;
-            }
-        }
+    // 主线程解码
+    while (bounded_queue_pop(pipeline.pkt_queue, (void **)&pkt) == 0)
+    {
+        decode(codec_ctx, pkt, &pipeline);
+        packet_pool_put(pipeline.pkt_pool, pkt);
     }
 
     /* 冲刷解码器（处理缓存帧） */
-    pkt->data = NULL;   // 发送空包触发drain mode
-    pkt->size = 0;
-    decode(codec_ctx, pkt, decoded_frame, outfile);
+    decode(codec_ctx, NULL, &pipeline);   // 发送空包触发drain mode
+    bounded_queue_finish(pipeline.frame_queue);
+
+    pthread_join(parse_tid, NULL);
+    pthread_join(write_tid, NULL);
+    int64_t total_us = av_gettime_relative() - start_time;
+
+    // 吞吐统计
+    double seconds = total_us / 1000000.0;
+    printf("[decode] threads:%d type:%s(active:%s) frames:%lld packets:%lld time:%.3fs fps:%.1f\n",
+           codec_ctx->thread_count, thread_type_name(thread_type),
+           thread_type_name(codec_ctx->active_thread_type), (long long)pipeline.nb_frames,
+           (long long)pipeline.nb_packets, seconds,
+           seconds > 0 ? pipeline.nb_frames / seconds : 0.0);
+    printf("[decode] in:%.2fMB/s out:%.2fMB/s busy parse:%.1fms decode:%.1fms write:%.1fms"
+           " frame allocs:%lld\n",
+           seconds > 0 ? pipeline.in_bytes / seconds / (1 << 20) : 0.0,
+           seconds > 0 ? pipeline.out_bytes / seconds / (1 << 20) : 0.0,
+           pipeline.parse_us / 1000.0, pipeline.decode_us / 1000.0, pipeline.write_us / 1000.0,
+           (long long)pipeline.frame_allocs);
+    dump_queue_stats(pipeline.pkt_queue, "packet queue");
+    dump_queue_stats(pipeline.frame_queue, "frame queue");
+    packet_pool_dump_stats(pipeline.pkt_pool, "decode_video");
+    yuv_writer_dump_stats(pipeline.writer, "decode_video");
+    frame_pool_dump_stats(frame_pool, "decode_video");
+    decode_guard_dump_stats(&pipeline.guard, "decode_video");
 
     // 清理资源
-    fclose(outfile);
-    fclose(infile);
+    while (bounded_queue_try_pop(pipeline.free_frames, (void **)&frame) == 0)
+        av_frame_free(&frame);
+    bounded_queue_free(pipeline.free_frames);
+    bounded_queue_free(pipeline.frame_queue);
+    bounded_queue_free(pipeline.pkt_queue);
+    packet_pool_free(pipeline.pkt_pool);
+    yuv_writer_close(pipeline.writer);
+    fclose(pipeline.infile);
     avcodec_free_context(&codec_ctx);
-    av_parser_close(parser);
-    av_frame_free(&decoded_frame);
-    av_packet_free(&pkt);
+    avcodec_free_context(&pipeline.parser_ctx);
+    av_parser_close(pipeline.parser);
+    frame_pool_free(frame_pool);    // 帧和解码器都释放后，池中的内存全部归还
 
     printf("Decoding completed successfully\n");
     return 0;
-}
\ No newline at end of file
+}
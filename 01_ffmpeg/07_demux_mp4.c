@@ -4,9 +4,13 @@
 #include "libavutil/log.h"   // FFmpeg日志模块
 #include "libavformat/avformat.h" // FFmpeg格式处理模块
 #include "libavcodec/avcodec.h"   // FFmpeg编解码模块(bsf需要)
+#include "packetpool.h"           // 包回收池
+#include "bsfchain.h"             // 比特流过滤器链
 
 #define ERROR_STRING_SIZE 1024 // 错误信息缓冲区大小
 #define ADTS_HEADER_LEN 7      // ADTS头部固定长度
+#define BSF_BATCH_SIZE 16      // 视频包攒够一批再送入过滤器链
+#define DEFAULT_VIDEO_BSF "h264_mp4toannexb"
 
 // AAC采样率索引表 (参考ISO/IEC 14496-3标准)
 const int sampling_frequencies[] = {
@@ -77,22 +81,50 @@ int adts_header(char * const p_adts_header, const int data_length,
     return 0;
 }
 
+/**
+ * 把一批视频包送入过滤器链，并把输出写入文件
+ * @param pkts 包数组，为NULL表示冲刷过滤器链
+ * @return 成功返回0
+ */
+static int filter_video_batch(bsf_chain_t *bsf_chain, packet_pool_t *pkt_pool, AVPacket **pkts,
+                              int nb_pkts, FILE *h264_fd)
+{
+    int ret = bsf_chain_send_packets(bsf_chain, pkts, nb_pkts);
+    for (int i = 0; i < nb_pkts; i++) {
+        packet_pool_put(pkt_pool, pkts[i]); // 数据已经交给过滤器链
+        pkts[i] = NULL;
+    }
+    if (ret < 0) {
+        return ret;
+    }
+    // 接收处理后的数据包
+    AVPacket *out_pkt = packet_pool_get(pkt_pool);
+    while (out_pkt && bsf_chain_receive_packet(bsf_chain, out_pkt) == 0) {
+        fwrite(out_pkt->data, 1, out_pkt->size, h264_fd);
+        av_packet_unref(out_pkt);
+    }
+    packet_pool_put(pkt_pool, out_pkt);
+    return 0;
+}
+
 /**
  * 主函数：从MP4提取H.264和AAC裸流
  * @param argc 参数个数
- * @param argv 参数数组 [程序名, 输入文件, 输出H264, 输出AAC]
+ * @param argv 参数数组 [程序名, 输入文件, 输出H264, 输出AAC, 视频过滤器链(可选)]
+ * 过滤器链示例: h264_mp4toannexb,h264_metadata=level=4.1,dump_extra
  */
 int main(int argc, char **argv)
 {
     // 参数验证
-    if(argc != 4) {
-        printf("用法: %s input.mp4 out.h264 out.aac\n", argv[0]);
+    if(argc != 4 && argc != 5) {
+        printf("用法: %s input.mp4 out.h264 out.aac [bsf1,bsf2,...]\n", argv[0]);
         return -1;
     }
 
     char *in_filename = argv[1];    // 输入MP4文件
     char *h264_filename = argv[2];  // H.264输出文件
     char *aac_filename = argv[3];   // AAC输出文件
+    const char *video_bsf = argc == 5 ? argv[4] : DEFAULT_VIDEO_BSF; // 视频过滤器链
     
     // 打开输出文件
     FILE *h264_fd = fopen(h264_filename, "wb");
@@ -109,8 +141,11 @@ int main(int argc, char **argv)
 
     // FFmpeg相关变量
     AVFormatContext *ifmt_ctx = NULL; // 输入格式上下文
-    AVBSFContext *bsf_ctx = NULL;     // 比特流过滤器上下文
+    bsf_chain_t *bsf_chain = NULL;    // 视频比特流过滤器链
     AVPacket *pkt = NULL;             // 数据包
+    AVPacket *video_batch[BSF_BATCH_SIZE] = {NULL}; // 等待送入过滤器链的视频包
+    int nb_video_batch = 0;
+    packet_pool_t *pkt_pool = NULL;   // demux、bsf 共用的包回收池
     char errors[ERROR_STRING_SIZE];   // 错误缓冲区
     int ret = 0;
     int video_index = -1, audio_index = -1;
@@ -144,43 +179,42 @@ int main(int argc, char **argv)
         goto cleanup;
     }
 
-    // 初始化H.264比特流过滤器 (MP4转AnnexB)
-    const AVBitStreamFilter *bsfilter = av_bsf_get_by_name("h264_mp4toannexb");
-    if (!bsfilter) {
-        printf("获取H264过滤器失败\n");
-        goto cleanup;
-    }
-    if ((ret = av_bsf_alloc(bsfilter, &bsf_ctx)) < 0 ||
-        (ret = avcodec_parameters_copy(bsf_ctx->par_in, ifmt_ctx->streams[video_index]->codecpar)) < 0 ||
-        (ret = av_bsf_init(bsf_ctx)) < 0) {
-        av_strerror(ret, errors, sizeof(errors));
-        printf("初始化过滤器失败: %s\n", errors);
+    // 分配包回收池
+    pkt_pool = packet_pool_alloc(0);
+    if (!pkt_pool) {
+        printf("分配包回收池失败\n");
         goto cleanup;
     }
 
-    // 分配数据包
-    pkt = av_packet_alloc();
-    if (!pkt) {
-        printf("分配数据包失败\n");
+    // 初始化视频比特流过滤器链 (默认只有 MP4转AnnexB)
+    bsf_chain = bsf_chain_alloc(video_bsf, ifmt_ctx->streams[video_index]->codecpar,
+                                ifmt_ctx->streams[video_index]->time_base, video_index, pkt_pool);
+    if (!bsf_chain) {
+        printf("初始化过滤器链失败: %s\n", video_bsf);
         goto cleanup;
     }
 
-    // 主处理循环：读取并处理数据包
-    while (av_read_frame(ifmt_ctx, pkt) >= 0) {
-        // 视频流处理 (H.264)
+    // 主处理循环：读取并处理数据包，包从回收池获取，用完归还
+    while (1) {
+        pkt = packet_pool_get(pkt_pool);
+        if (!pkt) {
+            printf("分配数据包失败\n");
+            goto cleanup;
+        }
+        if (av_read_frame(ifmt_ctx, pkt) < 0) {
+            break;
+        }
+        // 视频流处理 (H.264)，攒够一批再送入过滤器链
         if (pkt->stream_index == video_index) {
-            // 发送原始数据包到过滤器
-            if ((ret = av_bsf_send_packet(bsf_ctx, pkt)) < 0) {
-                av_strerror(ret, errors, sizeof(errors));
-                printf("发送视频包失败: %s\n", errors);
-                av_packet_unref(pkt);
-                continue;
-            }
-
-            // 接收处理后的数据包
-            while (av_bsf_receive_packet(bsf_ctx, pkt) == 0) {
-                fwrite(pkt->data, 1, pkt->size, h264_fd);
-                av_packet_unref(pkt);
+            video_batch[nb_video_batch++] = pkt;
+            pkt = NULL;
+            if (nb_video_batch == BSF_BATCH_SIZE) {
+                if ((ret = filter_video_batch(bsf_chain, pkt_pool, video_batch, nb_video_batch,
+                                              h264_fd)) < 0) {
+                    av_strerror(ret, errors, sizeof(errors));
+                    printf("过滤视频包失败: %s\n", errors);
+                }
+                nb_video_batch = 0;
             }
         } 
         // 音频流处理 (AAC)
@@ -196,22 +230,36 @@ int main(int argc, char **argv)
             
             // 写入AAC原始数据
             fwrite(pkt->data, 1, pkt->size, aac_fd);
-            av_packet_unref(pkt);
+            packet_pool_put(pkt_pool, pkt);
+            pkt = NULL;
         } 
         // 其他流忽略
         else {
-            av_packet_unref(pkt);
+            packet_pool_put(pkt_pool, pkt);
+            pkt = NULL;
         }
     }
 
+    // 剩余的视频包，然后冲刷过滤器链
+    if (nb_video_batch > 0) {
+        filter_video_batch(bsf_chain, pkt_pool, video_batch, nb_video_batch, h264_fd);
+        nb_video_batch = 0;
+    }
+    filter_video_batch(bsf_chain, pkt_pool, NULL, 0, h264_fd);
+
     printf("处理完成\n");
+    bsf_chain_dump_stats(bsf_chain, "demux_mp4");
+    // 稳定运行后 alloc 次数不再增长
+    packet_pool_dump_stats(pkt_pool, "demux_mp4");
 
 cleanup:
     // 资源清理
     if (h264_fd) fclose(h264_fd);
     if (aac_fd) fclose(aac_fd);
-    if (pkt) av_packet_free(&pkt);
-    if (bsf_ctx) av_bsf_free(&bsf_ctx);
+    if (pkt) packet_pool_put(pkt_pool, pkt);
+    for (int i = 0; i < nb_video_batch; i++) packet_pool_put(pkt_pool, video_batch[i]);
+    if (bsf_chain) bsf_chain_free(bsf_chain);
+    if (pkt_pool) packet_pool_free(pkt_pool);
     if (ifmt_ctx) avformat_close_input(&ifmt_ctx);
 
     return 0;
@@ -7,9 +7,13 @@
 
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
+#include "pcmconv.h"    // 平面 -> 交错转换
 
 #define BUF_SIZE 20480  // 自定义IO缓冲区大小
 
+static uint8_t *s_pcm_buf = NULL;   // 交错格式的一帧PCM，整帧一次写入
+static unsigned int s_pcm_buf_size = 0;
+
 // 获取FFmpeg错误码对应的可读字符串
 static char* av_get_err(int errnum)
 {
@@ -60,20 +64,17 @@ static void decode(AVCodecContext *dec_ctx, AVPacket *packet, AVFrame *frame, FI
             exit(1);
         }
 
-        // 计算每个样本的字节大小
-        int data_size = av_get_bytes_per_sample(dec_ctx->sample_fmt);
-        
         /* 处理Planar音频格式（平面存储）：
          * Planar格式存储：LLLLLLRRRRRR（每个声道数据连续存储）
          * 交错格式存储：LRLRLRLR...（左右声道数据交替存储）
-         * 本函数将Planar格式转换为交错格式写入PCM文件
+         * 整帧转换为交错格式后一次写入PCM文件
          */
-        for(int i = 0; i < frame->nb_samples; i++) {          // 遍历所有样本
-            for(int ch = 0; ch < dec_ctx->channels; ch++) {   // 遍历所有声道
-                // 将单个样本写入文件（实现Planar到交错的转换）
-                fwrite(frame->data[ch] + data_size * i, 1, data_size, outfile);
-            }
+        int data_size = pcm_frame_to_interleaved(frame, &s_pcm_buf, &s_pcm_buf_size);
+        if (data_size < 0) {
+            printf("Failed to interleave frame\n");
+            exit(1);
         }
+        fwrite(s_pcm_buf, 1, data_size, outfile);
     }
 }
 
@@ -165,6 +166,7 @@ int main(int argc, char **argv)
     fclose(out_file);
 
     av_free(io_buffer);  // 释放IO缓冲区
+    av_freep(&s_pcm_buf);
     av_frame_free(&frame);
     av_packet_free(&packet);
 
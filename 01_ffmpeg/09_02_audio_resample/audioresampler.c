@@ -1,4 +1,48 @@
 ﻿#include "audioresampler.h"
+#include <pthread.h>
+#include <math.h>
+
+#define DRIFT_DEFAULT_HORIZON 10.0   // 实际的时钟漂移变化很慢，时间常数长一些，pts 抖动对调整比例的影响小
+#define DRIFT_DEFAULT_MAX_PPM 1000.0
+#define DRIFT_COMPENSATION_DISTANCE (1 << 20)   // swr_set_compensation 的距离(输出采样点)，调整比例的分辨率约 1ppm
+
+// 时钟漂移补偿的状态，误差的单位都是输出采样点
+struct audio_resampler_drift {
+    audio_resampler_drift_params_t params;
+    int64_t first_pts;          // 第一次 send 的 pts
+    int64_t nb_out;             // 重采样已经输出的采样点
+    double err;                 // 低通滤波后的误差，正数表示输出多了
+    double integral;            // PI 控制的积分项
+    double ppm;                 // 当前的调整比例
+};
+
+// 一组通道：自己的 SwrContext，输入输出是整帧的第 first_channel 个平面开始的 nb_channels 个平面
+typedef struct resample_group {
+    struct SwrContext *swr_ctx;     // 第0组就是 audio_resampler_t 的 swr_ctx
+    int first_channel;
+    int nb_channels;
+    int ret;                        // 这次任务 swr_convert 的返回值
+    pthread_t tid;
+    int has_thread;
+    struct audio_resampler_workers *workers;
+} resample_group_t;
+
+// 工作线程：主线程发布一次 swr_convert 任务，各组并行处理，全部完成后主线程返回
+struct audio_resampler_workers {
+    pthread_mutex_t mutex;
+    pthread_cond_t job_cond;        // 有新任务或者退出
+    pthread_cond_t done_cond;       // 工作线程都完成了
+    int64_t job_id;                 // 每发布一次任务加1
+    int nb_pending;                 // 还没完成的工作线程
+    int quit;
+    // 当前任务，平面指针是整帧的
+    uint8_t **out;
+    int out_count;
+    const uint8_t **in;
+    int in_count;
+    int nb_groups;
+    resample_group_t groups[AUDIO_RESAMPLER_MAX_GROUPS];
+};
 
 static AVFrame *alloc_out_frame(const int nb_samples, const audio_resampler_params_t *resampler_params)
 {
@@ -16,6 +60,7 @@ static AVFrame *alloc_out_frame(const int nb_samples, const audio_resampler_para
     if (ret < 0)
     {
         printf("cannot allocate audio data buffer\n");
+        av_frame_free(&frame);
         return NULL;
     }
     return frame;
@@ -24,9 +69,10 @@ static AVFrame *alloc_out_frame(const int nb_samples, const audio_resampler_para
 static AVFrame *get_one_frame(audio_resampler_t *resampler, const int nb_samples)
 {
     AVFrame * frame = alloc_out_frame(nb_samples, &resampler->resampler_params);
+    resampler->nb_allocs += 2;      // av_frame_alloc + av_frame_get_buffer
     if (frame)
     {
-        av_audio_fifo_read(resampler->audio_fifo, (void **)frame->data, nb_samples);
+        audio_ring_read(resampler->fifo, frame->extended_data, nb_samples);
         frame->pts = resampler->cur_pts;
         resampler->cur_pts += nb_samples;
         resampler->total_resampled_num += nb_samples;
@@ -44,29 +90,80 @@ static int  init_resampled_data(audio_resampler_t *resampler)
                                                  resampler->resampled_data_size, resampler->resampler_params.dst_sample_fmt, 0);
     if (ret < 0)
         printf("fail accocate audio resampled data buffer\n");
+    resampler->nb_send_allocs++;
     return ret;
 }
 
+// 保证 fifo 能放下 nb_samples：单线程模式扩容(记一次分配)，SPSC 模式容量固定，放不下返回 AVERROR(EAGAIN)
+static int fifo_reserve(audio_resampler_t *resampler, int nb_samples)
+{
+    if (audio_ring_space(resampler->fifo) >= nb_samples)
+        return 0;
+    if (resampler->thread_safe) {
+        if (nb_samples > audio_ring_capacity(resampler->fifo)) {
+            printf("fifo capacity %d is too small for %d samples\n",
+                   audio_ring_capacity(resampler->fifo), nb_samples);
+            return AVERROR(ENOSPC);
+        }
+        return AVERROR(EAGAIN);
+    }
+    resampler->nb_send_allocs++;
+    return audio_ring_grow(resampler->fifo, audio_ring_size(resampler->fifo) + nb_samples);
+}
+
+static struct SwrContext *create_swr(const audio_resampler_params_t *params,
+                                     uint64_t src_channel_layout, uint64_t dst_channel_layout)
+{
+    struct SwrContext *swr_ctx = swr_alloc();
+    if(!swr_ctx)  {
+        printf("swr_alloc failed\n");
+        return NULL;
+    }
+    /* set options */
+    av_opt_set_sample_fmt(swr_ctx, "in_sample_fmt",      params->src_sample_fmt, 0);
+    av_opt_set_int(swr_ctx,        "in_channel_layout",  src_channel_layout, 0);
+    av_opt_set_int(swr_ctx,        "in_sample_rate",     params->src_sample_rate, 0);
+    av_opt_set_sample_fmt(swr_ctx, "out_sample_fmt",     params->dst_sample_fmt, 0);
+    av_opt_set_int(swr_ctx,        "out_channel_layout", dst_channel_layout, 0);
+    av_opt_set_int(swr_ctx,        "out_sample_rate",    params->dst_sample_rate, 0);
+    /* initialize the resampling context */
+    if (swr_init(swr_ctx) < 0) {
+        printf("failed to initialize the resampling context.\n");
+        swr_free(&swr_ctx);
+        return NULL;
+    }
+    return swr_ctx;
+}
+
 audio_resampler_t *audio_resampler_alloc(const audio_resampler_params_t resampler_params)
 {
-    int ret = 0;
+    return audio_resampler_alloc2(resampler_params, AUDIO_RESAMPLER_FIFO_CAPACITY, 0);
+}
+
+audio_resampler_t *audio_resampler_alloc2(const audio_resampler_params_t resampler_params,
+                                          int fifo_capacity, int flags)
+{
+    const int thread_safe = (flags & AUDIO_RESAMPLER_FLAG_THREAD_SAFE) != 0;
     audio_resampler_t *audio_resampler = (audio_resampler_t *)av_malloc(sizeof(audio_resampler_t));
     if(!audio_resampler) {
         return NULL;
     }
     memset(audio_resampler, 0, sizeof(audio_resampler_t));
     audio_resampler->resampler_params = resampler_params;   // 设置参数
+    audio_resampler->thread_safe = thread_safe;
     // 设置通道数量
     audio_resampler->src_channels = av_get_channel_layout_nb_channels(resampler_params.src_channel_layout);
     audio_resampler->dst_channels = av_get_channel_layout_nb_channels(resampler_params.dst_channel_layout);
     audio_resampler->cur_pts = AV_NOPTS_VALUE;
     audio_resampler->start_pts = AV_NOPTS_VALUE;
-    // 分配audio fifo，单位其实为samples  我们在av_audio_fifo_write时候如果buffer不足能自动扩充
-    audio_resampler->audio_fifo = av_audio_fifo_alloc(resampler_params.dst_sample_fmt,
-                                                      audio_resampler->dst_channels, 1);
-    if(!audio_resampler->audio_fifo) {
-        printf("av_audio_fifo_alloc failed\n");
-        av_freep(audio_resampler);
+    // 分配 fifo，单位为采样点，容量固定，不再随写入自动扩充
+    if (fifo_capacity <= 0)
+        fifo_capacity = AUDIO_RESAMPLER_FIFO_CAPACITY;
+    audio_resampler->fifo = audio_ring_alloc(resampler_params.dst_sample_fmt,
+                                             audio_resampler->dst_channels, fifo_capacity, thread_safe);
+    if(!audio_resampler->fifo) {
+        printf("audio_ring_alloc failed\n");
+        audio_resampler_free(audio_resampler);
         return NULL;
     }
     if (resampler_params.src_sample_fmt == resampler_params.dst_sample_fmt &&
@@ -78,33 +175,29 @@ audio_resampler_t *audio_resampler_alloc(const audio_resampler_params_t resample
         return audio_resampler;
     }
 
-    // 初始化重采样
-    audio_resampler->swr_ctx = swr_alloc();
-    if(!audio_resampler->swr_ctx)  {
-        printf("swr_alloc failed\n");
-        return NULL;
+    // 常用的定比重采样走快速路径，其他情况用 swresample
+    if (!(flags & AUDIO_RESAMPLER_FLAG_NO_FAST_PATH) &&
+            resampler_params.src_channel_layout == resampler_params.dst_channel_layout) {
+        audio_resampler->fixed = fixed_resampler_alloc(resampler_params.src_sample_rate,
+                                                       resampler_params.dst_sample_rate,
+                                                       audio_resampler->dst_channels,
+                                                       resampler_params.src_sample_fmt,
+                                                       resampler_params.dst_sample_fmt);
+        if (audio_resampler->fixed)
+            printf("use fixed ratio resampler, simd:%s\n", fixed_resampler_simd_name());
     }
-    /* set options */
-    av_opt_set_sample_fmt(audio_resampler->swr_ctx, "in_sample_fmt",      resampler_params.src_sample_fmt, 0);
-    av_opt_set_int(audio_resampler->swr_ctx,        "in_channel_layout",  resampler_params.src_channel_layout, 0);
-    av_opt_set_int(audio_resampler->swr_ctx,        "in_sample_rate",     resampler_params.src_sample_rate, 0);
-    av_opt_set_sample_fmt(audio_resampler->swr_ctx, "out_sample_fmt",     resampler_params.dst_sample_fmt, 0);
-    av_opt_set_int(audio_resampler->swr_ctx,        "out_channel_layout", resampler_params.dst_channel_layout, 0);
-    av_opt_set_int(audio_resampler->swr_ctx,        "out_sample_rate",    resampler_params.dst_sample_rate, 0);
-    /* initialize the resampling context */
-    ret = swr_init(audio_resampler->swr_ctx);
-    if (ret < 0) {
-        printf("failed to initialize the resampling context.\n");
-        av_fifo_freep((AVFifoBuffer **)&audio_resampler->audio_fifo);
-        swr_free(&audio_resampler->swr_ctx);
-        av_freep(audio_resampler);
+    // 初始化重采样
+    if (!audio_resampler->fixed)
+        audio_resampler->swr_ctx = create_swr(&resampler_params, resampler_params.src_channel_layout,
+                                              resampler_params.dst_channel_layout);
+    if (!audio_resampler->swr_ctx && !audio_resampler->fixed) {
+        audio_resampler_free(audio_resampler);
         return NULL;
     }
+    // fifo 连续空间不够时先重采样到这里再写入 fifo
     audio_resampler->resampled_data_size = 2048;
     if (init_resampled_data(audio_resampler) < 0) {
-        swr_free(&audio_resampler->swr_ctx);
-        av_fifo_freep((AVFifoBuffer **)&audio_resampler->audio_fifo);
-        av_freep(audio_resampler);
+        audio_resampler_free(audio_resampler);
         return NULL;
     }
 
@@ -112,75 +205,316 @@ audio_resampler_t *audio_resampler_alloc(const audio_resampler_params_t resample
     return audio_resampler;
 }
 
-void audio_resampler_free(audio_resampler_t *resampler)
+static void run_group(struct audio_resampler_workers *w, resample_group_t *g)
 {
-    if(!resampler) {
+    g->ret = swr_convert(g->swr_ctx, w->out + g->first_channel, w->out_count,
+                         w->in ? w->in + g->first_channel : NULL, w->in_count);
+}
+
+static void *group_thread(void *arg)
+{
+    resample_group_t *g = (resample_group_t *)arg;
+    struct audio_resampler_workers *w = g->workers;
+    int64_t job_id = 0;
+    pthread_mutex_lock(&w->mutex);
+    for (;;) {
+        while (!w->quit && w->job_id == job_id)
+            pthread_cond_wait(&w->job_cond, &w->mutex);
+        if (w->quit)
+            break;
+        job_id = w->job_id;
+        pthread_mutex_unlock(&w->mutex);
+        run_group(w, g);
+        pthread_mutex_lock(&w->mutex);
+        if (--w->nb_pending == 0)
+            pthread_cond_signal(&w->done_cond);
+    }
+    pthread_mutex_unlock(&w->mutex);
+    return NULL;
+}
+
+static void free_workers(audio_resampler_t *resampler)
+{
+    struct audio_resampler_workers *w = resampler->workers;
+    if (!w) {
         return;
     }
-    if (resampler->swr_ctx)
-        swr_free(&resampler->swr_ctx);
-    if (resampler->audio_fifo) {
-        av_fifo_freep((AVFifoBuffer **)&resampler->audio_fifo);
+    pthread_mutex_lock(&w->mutex);
+    w->quit = 1;
+    pthread_cond_broadcast(&w->job_cond);
+    pthread_mutex_unlock(&w->mutex);
+    for (int i = 1; i < w->nb_groups; i++) {
+        if (w->groups[i].has_thread)
+            pthread_join(w->groups[i].tid, NULL);
+        swr_free(&w->groups[i].swr_ctx);    // 第0组的 SwrContext 由 resampler->swr_ctx 释放
     }
-    if (resampler->resampled_data)
-        av_freep(&resampler->resampled_data[0]);
-    av_freep(&resampler->resampled_data);
-    av_freep(resampler);
-    resampler = NULL;
+    pthread_cond_destroy(&w->done_cond);
+    pthread_cond_destroy(&w->job_cond);
+    pthread_mutex_destroy(&w->mutex);
+    av_freep(&resampler->workers);
 }
 
-int audio_resampler_send_frame(audio_resampler_t *resampler, AVFrame *frame)
+int audio_resampler_set_threads(audio_resampler_t *resampler, int nb_threads)
 {
-    if(!resampler) {
+    if (!resampler) {
+        return AVERROR(EINVAL);
+    }
+    const audio_resampler_params_t *params = &resampler->resampler_params;
+    int channels = resampler->dst_channels;
+    if (nb_threads > channels)
+        nb_threads = channels;
+    if (nb_threads > AUDIO_RESAMPLER_MAX_GROUPS)
+        nb_threads = AUDIO_RESAMPLER_MAX_GROUPS;
+    if (resampler->is_fifo_only || resampler->fixed || resampler->workers || nb_threads < 2 ||
+        params->src_channel_layout != params->dst_channel_layout ||
+        !av_sample_fmt_is_planar(params->src_sample_fmt) ||
+        !av_sample_fmt_is_planar(params->dst_sample_fmt)) {
+        return resampler->workers ? resampler->workers->nb_groups : 1;
+    }
+    if (resampler->start_pts != AV_NOPTS_VALUE || audio_ring_size(resampler->fifo) > 0) {
+        printf("audio_resampler_set_threads must be called before the first send\n");
+        return AVERROR(EINVAL);
+    }
+
+    struct audio_resampler_workers *w = (struct audio_resampler_workers *)av_mallocz(sizeof(*w));
+    if (!w) {
+        return AVERROR(ENOMEM);
+    }
+    pthread_mutex_init(&w->mutex, NULL);
+    pthread_cond_init(&w->job_cond, NULL);
+    pthread_cond_init(&w->done_cond, NULL);
+    resampler->workers = w;
+
+    // 通道尽量平均分组，每组用自己通道数的默认布局，输入输出布局相同，不会做混音
+    int first = 0;
+    for (int i = 0; i < nb_threads; i++) {
+        resample_group_t *g = &w->groups[i];
+        g->workers = w;
+        g->first_channel = first;
+        g->nb_channels = channels / nb_threads + (i < channels % nb_threads);
+        first += g->nb_channels;
+        uint64_t layout = av_get_default_channel_layout(g->nb_channels);
+        g->swr_ctx = create_swr(params, layout, layout);
+        w->nb_groups++;
+        if (!g->swr_ctx)
+            goto fail;
+        if (resampler->drift)
+            swr_set_compensation(g->swr_ctx, 0, 0);     // 同 audio_resampler_enable_drift_compensation
+        if (i > 0) {
+            if (pthread_create(&g->tid, NULL, group_thread, g) != 0) {
+                printf("pthread_create failed\n");
+                goto fail;
+            }
+            g->has_thread = 1;
+        }
+    }
+    // 第0组替换掉整帧的 SwrContext，swr_get_delay 仍然从 resampler->swr_ctx 取
+    swr_free(&resampler->swr_ctx);
+    resampler->swr_ctx = w->groups[0].swr_ctx;
+    return w->nb_groups;
+
+fail:
+    swr_free(&w->groups[0].swr_ctx);
+    free_workers(resampler);
+    return AVERROR(ENOMEM);
+}
+
+int audio_resampler_enable_drift_compensation(audio_resampler_t *resampler,
+                                              const audio_resampler_drift_params_t *params)
+{
+    if (!resampler) {
+        return AVERROR(EINVAL);
+    }
+    if (resampler->drift) {
         return 0;
     }
-    int src_nb_samples = 0;
-    uint8_t **src_data = NULL;
-    if (frame)
-    {
-        src_nb_samples = frame->nb_samples; // 输入源采样点数量
-        src_data = frame->extended_data;    // 输入源的buffer
-        if (resampler->start_pts == AV_NOPTS_VALUE && frame->pts != AV_NOPTS_VALUE)
-        {
-            resampler->start_pts = frame->pts;
-            resampler->cur_pts = frame->pts;
+    if (resampler->start_pts != AV_NOPTS_VALUE || audio_ring_size(resampler->fifo) > 0) {
+        printf("audio_resampler_enable_drift_compensation must be called before the first send\n");
+        return AVERROR(EINVAL);
+    }
+    struct audio_resampler_drift *d = (struct audio_resampler_drift *)av_mallocz(sizeof(*d));
+    if (!d) {
+        return AVERROR(ENOMEM);
+    }
+    if (params)
+        d->params = *params;
+    if (d->params.horizon <= 0)
+        d->params.horizon = DRIFT_DEFAULT_HORIZON;
+    if (d->params.max_ppm <= 0)
+        d->params.max_ppm = DRIFT_DEFAULT_MAX_PPM;
+    if (d->params.jitter_time <= 0)
+        d->params.jitter_time = d->params.horizon / 4;
+    d->first_pts = AV_NOPTS_VALUE;
+
+    // 快速路径和直通 fifo 都不能调整采样率，换成 SwrContext
+    if (!resampler->swr_ctx) {
+        const audio_resampler_params_t *p = &resampler->resampler_params;
+        resampler->swr_ctx = create_swr(p, p->src_channel_layout, p->dst_channel_layout);
+        if (!resampler->swr_ctx) {
+            av_free(d);
+            return AVERROR(ENOMEM);
+        }
+        fixed_resampler_free(resampler->fixed);
+        resampler->fixed = NULL;
+        resampler->is_fifo_only = 0;
+        if (!resampler->resampled_data) {
+            resampler->resampled_data_size = 2048;
+            if (init_resampled_data(resampler) < 0) {
+                av_free(d);
+                return AVERROR(ENOMEM);
+            }
         }
     }
+    // 输入输出采样率相同时 swr 默认不做重采样，第一次 swr_set_compensation 会重新 swr_init，
+    // 在送入数据之前先打开，之后的调整只改变采样率比例
+    int ret = swr_set_compensation(resampler->swr_ctx, 0, 0);
+    for (int i = 1; ret >= 0 && resampler->workers && i < resampler->workers->nb_groups; i++)
+        ret = swr_set_compensation(resampler->workers->groups[i].swr_ctx, 0, 0);
+    if (ret < 0) {
+        printf("swr_set_compensation failed\n");
+        av_free(d);
+        return ret;
+    }
+    resampler->drift = d;
+    return 0;
+}
+
+double audio_resampler_get_drift_ppm(audio_resampler_t *resampler)
+{
+    if (!resampler || !resampler->drift) {
+        return 0;
+    }
+    return resampler->drift->ppm;
+}
+
+// 比较本地时钟(输入 pts)经过的时间和已经产生的输出，更新采样率的调整比例
+static int drift_update(audio_resampler_t *resampler, int64_t pts, int nb_in)
+{
+    struct audio_resampler_drift *d = resampler->drift;
+    const audio_resampler_params_t *params = &resampler->resampler_params;
+    if (pts == AV_NOPTS_VALUE) {
+        return 0;
+    }
+    if (d->first_pts == AV_NOPTS_VALUE) {
+        d->first_pts = pts;
+        return 0;
+    }
+    // 已经产生的输出(含 swr 内部还没有输出的部分，精确到 1/1000 个采样点)减去经过的时间
+    int64_t delay = swr_get_delay(resampler->swr_ctx, params->dst_sample_rate * 1000LL);
+    double err = d->nb_out + delay / 1000.0 - (double)(pts - d->first_pts);
+    double dt = (double)nb_in / params->src_sample_rate;
+    double horizon = d->params.horizon;
+    // pts 有抖动，先低通滤波
+    d->err += (err - d->err) * (1 - exp(-dt / d->params.jitter_time));
+    // PI 控制，积分时间取 4 倍 horizon 时为临界阻尼，不会来回振荡
+    double integral = d->integral + d->err * dt / (4 * horizon);
+    double ratio = -(d->err + integral) / (horizon * params->dst_sample_rate);
+    double max_ratio = d->params.max_ppm * 1e-6;
+    if (ratio > max_ratio)
+        ratio = max_ratio;
+    else if (ratio < -max_ratio)
+        ratio = -max_ratio;
     else
-    {
-        resampler->is_flushed = 1;
+        d->integral = integral;     // 饱和时不积分
+    d->ppm = ratio * 1e6;
+
+    // 在接下来 DRIFT_COMPENSATION_DISTANCE 个输出采样点里多(少)输出 delta 个，每次 send 都会重新设置
+    int delta = (int)lrint(ratio * DRIFT_COMPENSATION_DISTANCE);
+    int ret = swr_set_compensation(resampler->swr_ctx, delta, DRIFT_COMPENSATION_DISTANCE);
+    for (int i = 1; ret >= 0 && resampler->workers && i < resampler->workers->nb_groups; i++)
+        ret = swr_set_compensation(resampler->workers->groups[i].swr_ctx, delta, DRIFT_COMPENSATION_DISTANCE);
+    if (ret < 0)
+        printf("swr_set_compensation failed:%d\n", ret);
+    return ret;
+}
+
+// 这次输入 in_count 个采样点最多输出多少采样点(输出采样率下的点数，延迟也要换算到输出采样率)
+static int get_out_samples(audio_resampler_t *resampler, int in_count)
+{
+    if (resampler->fixed) {
+        return fixed_resampler_get_out_samples(resampler->fixed, in_count, resampler->is_flushed);
     }
+    const audio_resampler_params_t *params = &resampler->resampler_params;
+    int64_t nb_samples = av_rescale_rnd(swr_get_delay(resampler->swr_ctx, params->src_sample_rate) + in_count,
+                                        params->dst_sample_rate, params->src_sample_rate, AV_ROUND_UP);
+    if (resampler->drift)   // 漂移补偿时输出最多多出 max_ppm
+        nb_samples += (int64_t)(nb_samples * resampler->drift->params.max_ppm * 1e-6) + 1;
+    return (int)nb_samples;
+}
 
-    if (resampler->is_fifo_only) {
-        // 如果不需要做重采样，原封不动写入fifo
-        return src_data ? av_audio_fifo_write(resampler->audio_fifo, (void **)src_data, src_nb_samples) : 0;
+// 重采样一次：快速路径或者单线程直接转换，多线程时各组并行，返回各组一致的输出采样数
+static int convert(audio_resampler_t *resampler, uint8_t **out, int out_count,
+                   const uint8_t **in, int in_count)
+{
+    struct audio_resampler_workers *w = resampler->workers;
+    if (resampler->fixed) {
+        int64_t nb_allocs = resampler->fixed->nb_allocs;
+        int ret = fixed_resampler_convert(resampler->fixed, out, out_count, in, in_count);
+        resampler->nb_send_allocs += resampler->fixed->nb_allocs - nb_allocs;
+        return ret;
     }
-    // 计算这次做重采样能够获取到的重采样后的点数
-    const int dst_nb_samples = av_rescale_rnd(swr_get_delay(resampler->swr_ctx, resampler->resampler_params.src_sample_rate) + src_nb_samples,
-                                              resampler->resampler_params.src_sample_rate, resampler->resampler_params.dst_sample_rate, AV_ROUND_UP);
-    if (dst_nb_samples > resampler->resampled_data_size)
-    {
-        //resampled_data
-        resampler->resampled_data_size = dst_nb_samples;
-        if (init_resampled_data(resampler) < 0) {
-            return AVERROR(ENOMEM);
+    if (!w) {
+        return swr_convert(resampler->swr_ctx, out, out_count, in, in_count);
+    }
+    pthread_mutex_lock(&w->mutex);
+    w->out = out;
+    w->out_count = out_count;
+    w->in = in;
+    w->in_count = in_count;
+    w->nb_pending = w->nb_groups - 1;
+    w->job_id++;
+    pthread_cond_broadcast(&w->job_cond);
+    pthread_mutex_unlock(&w->mutex);
+
+    run_group(w, &w->groups[0]);    // 调用线程处理第0组
+
+    pthread_mutex_lock(&w->mutex);
+    while (w->nb_pending > 0)
+        pthread_cond_wait(&w->done_cond, &w->mutex);
+    pthread_mutex_unlock(&w->mutex);
+
+    int ret = w->groups[0].ret;
+    for (int i = 1; i < w->nb_groups; i++) {
+        if (w->groups[i].ret != ret) {
+            // 各组参数相同，输出采样数不一致说明出错了
+            printf("resample group %d returned %d, group 0 returned %d\n", i, w->groups[i].ret, ret);
+            return w->groups[i].ret < 0 ? w->groups[i].ret : AVERROR_BUG;
         }
     }
-    int nb_samples = swr_convert(resampler->swr_ctx, resampler->resampled_data, dst_nb_samples,
-                                 (const uint8_t **)src_data, src_nb_samples);
-    // 返回实际写入的采样点数量
-//    return av_audio_fifo_write(resampler->audio_fifo, (void **)resampler->resampled_data, nb_samples);
-    int ret_size = av_audio_fifo_write(resampler->audio_fifo, (void **)resampler->resampled_data, nb_samples);
-    if(ret_size != nb_samples) {
-        printf("Warn：av_audio_fifo_write failed, expected_write:%d, actual_write:%d\n", nb_samples, ret_size);
+    return ret;
+}
+
+void audio_resampler_free(audio_resampler_t *resampler)
+{
+    if(!resampler) {
+        return;
+    }
+    free_workers(resampler);
+    if (resampler->swr_ctx)
+        swr_free(&resampler->swr_ctx);
+    fixed_resampler_free(resampler->fixed);
+    av_free(resampler->drift);
+    audio_ring_free(resampler->fifo);
+    if (resampler->resampled_data)
+        av_freep(&resampler->resampled_data[0]);
+    av_freep(&resampler->resampled_data);
+    for (int i = 0; i < resampler->nb_free_frames; i++)
+        av_frame_free(&resampler->free_frames[i]);
+    av_free(resampler);
+}
+
+int audio_resampler_send_frame(audio_resampler_t *resampler, AVFrame *frame)
+{
+    if (!frame) {
+        return audio_resampler_send_frame2(resampler, NULL, 0, AV_NOPTS_VALUE);   // flush
     }
-    return ret_size;
+    return audio_resampler_send_frame2(resampler, frame->extended_data, frame->nb_samples, frame->pts);
 }
 
 AVFrame *audio_resampler_receive_frame(audio_resampler_t *resampler, int nb_samples)
 {
-    nb_samples = nb_samples == 0 ? av_audio_fifo_size(resampler->audio_fifo) : nb_samples;
-    if (av_audio_fifo_size(resampler->audio_fifo) < nb_samples || nb_samples == 0)
+    nb_samples = nb_samples == 0 ? audio_ring_size(resampler->fifo) : nb_samples;
+    if (audio_ring_size(resampler->fifo) < nb_samples || nb_samples == 0)
         return NULL;
     // 采样点数满足条件
     return get_one_frame(resampler, nb_samples);
@@ -208,12 +542,34 @@ int audio_resampler_send_frame2(audio_resampler_t *resampler, uint8_t **in_data,
         resampler->is_flushed = 1;
     }
 
+    int ret = 0;
     if (resampler->is_fifo_only) {
-        return src_data ? av_audio_fifo_write(resampler->audio_fifo, (void **)src_data, src_nb_samples) : 0;
+        // 如果不需要做重采样，原封不动写入fifo
+        if (!src_data)
+            return 0;
+        if ((ret = fifo_reserve(resampler, src_nb_samples)) < 0)
+            return ret;
+        return audio_ring_write(resampler->fifo, src_data, src_nb_samples);
     }
 
-    const int dst_nb_samples = av_rescale_rnd(swr_get_delay(resampler->swr_ctx, resampler->resampler_params.src_sample_rate) + src_nb_samples,
-                                              resampler->resampler_params.src_sample_rate, resampler->resampler_params.dst_sample_rate, AV_ROUND_UP);
+    // 计算这次做重采样能够获取到的重采样后的点数(上限)，先确认 fifo 放得下，放不下时不消耗输入
+    const int dst_nb_samples = get_out_samples(resampler, src_nb_samples);
+    if ((ret = fifo_reserve(resampler, dst_nb_samples)) < 0)
+        return ret;
+    if (resampler->drift && src_data && (ret = drift_update(resampler, pts, src_nb_samples)) < 0)
+        return ret;
+    int nb_samples = 0;
+    if (audio_ring_contiguous_space(resampler->fifo) >= dst_nb_samples) {
+        // 环上有足够的连续空间，直接重采样到 fifo 里，省掉一次拷贝
+        nb_samples = convert(resampler, audio_ring_write_ptrs(resampler->fifo), dst_nb_samples,
+                             (const uint8_t **)src_data, src_nb_samples);
+        if (nb_samples > 0)
+            audio_ring_commit(resampler->fifo, nb_samples);
+        if (nb_samples > 0 && resampler->drift)
+            resampler->drift->nb_out += nb_samples;
+        return nb_samples;
+    }
+    // 快到环尾，输出要分成两段，先重采样到 resampled_data
     if (dst_nb_samples > resampler->resampled_data_size)
     {
         //resampled_data
@@ -221,10 +577,14 @@ int audio_resampler_send_frame2(audio_resampler_t *resampler, uint8_t **in_data,
         if (init_resampled_data(resampler) < 0)
             return AVERROR(ENOMEM);
     }
-    int nb_samples = swr_convert(resampler->swr_ctx, resampler->resampled_data, dst_nb_samples,
-                                 (const uint8_t **)src_data, src_nb_samples);
+    nb_samples = convert(resampler, resampler->resampled_data, dst_nb_samples,
+                         (const uint8_t **)src_data, src_nb_samples);
+    if (nb_samples <= 0)
+        return nb_samples;
+    if (resampler->drift)
+        resampler->drift->nb_out += nb_samples;
     // 返回实际写入的采样点数量
-    return av_audio_fifo_write(resampler->audio_fifo, (void **)resampler->resampled_data, nb_samples);
+    return audio_ring_write(resampler->fifo, resampler->resampled_data, nb_samples);
 }
 
 int audio_resampler_send_frame3(audio_resampler_t *resampler, uint8_t *in_data, int in_bytes, int64_t pts)
@@ -233,32 +593,32 @@ int audio_resampler_send_frame3(audio_resampler_t *resampler, uint8_t *in_data,
         return 0;
     }
 
-    AVFrame *frame = NULL;
-    if(in_data)
-    {
-        frame = av_frame_alloc();
-        frame->format = resampler->resampler_params.src_sample_fmt;
-        frame->channel_layout = resampler->resampler_params.src_channel_layout;
-        int ch = av_get_channel_layout_nb_channels(resampler->resampler_params.src_channel_layout);
-        frame->nb_samples = in_bytes/ av_get_bytes_per_sample(resampler->resampler_params.src_sample_fmt) /ch;
-        avcodec_fill_audio_frame(frame, ch, resampler->resampler_params.src_sample_fmt, in_data, in_bytes, 0);
-        frame->pts = pts;
+    if(!in_data) {
+        return audio_resampler_send_frame2(resampler, NULL, 0, pts);  // flush
     }
-
-    int ret = audio_resampler_send_frame(resampler, frame);
-    if(frame) {
-        av_frame_free(&frame);      // 释放内存
+    // 直接在输入数据上构造各通道指针，不再每次分配临时 AVFrame
+    uint8_t *planes[AUDIO_RESAMPLER_MAX_CHANNELS];
+    enum AVSampleFormat fmt = resampler->resampler_params.src_sample_fmt;
+    int ch = resampler->src_channels;
+    if (ch <= 0 || ch > AUDIO_RESAMPLER_MAX_CHANNELS) {
+        return AVERROR(EINVAL);
     }
-    return ret;
+    int nb_samples = in_bytes / av_get_bytes_per_sample(fmt) / ch;
+    // 和 avcodec_fill_audio_frame(align = 0) 的平面布局一致
+    int ret = av_samples_fill_arrays(planes, NULL, in_data, ch, nb_samples, fmt, 0);
+    if (ret < 0) {
+        return ret;
+    }
+    return audio_resampler_send_frame2(resampler, planes, nb_samples, pts);
 }
 
 
 int  audio_resampler_receive_frame2(audio_resampler_t *resampler, uint8_t **out_data, int nb_samples, int64_t *pts)
 {
-    nb_samples = nb_samples == 0 ? av_audio_fifo_size(resampler->audio_fifo) : nb_samples;
-    if (av_audio_fifo_size(resampler->audio_fifo) < nb_samples || nb_samples == 0)
+    nb_samples = nb_samples == 0 ? audio_ring_size(resampler->fifo) : nb_samples;
+    if (audio_ring_size(resampler->fifo) < nb_samples || nb_samples == 0)
         return 0;
-    int ret = av_audio_fifo_read(resampler->audio_fifo, (void **)out_data, nb_samples);
+    int ret = audio_ring_read(resampler->fifo, out_data, nb_samples);
     *pts = resampler->cur_pts;
     resampler->cur_pts += nb_samples;
     resampler->total_resampled_num += nb_samples;
@@ -266,12 +626,94 @@ int  audio_resampler_receive_frame2(audio_resampler_t *resampler, uint8_t **out_
 }
 
 
+// 帧内存可写、格式一致且容量够 nb_samples 时复用，否则重新分配
+static int prepare_out_frame(audio_resampler_t *resampler, AVFrame *frame, int nb_samples)
+{
+    const audio_resampler_params_t *params = &resampler->resampler_params;
+    int linesize = 0;
+    if (av_samples_get_buffer_size(&linesize, resampler->dst_channels, nb_samples,
+                                   params->dst_sample_fmt, 0) < 0)
+        return AVERROR(EINVAL);
+    if (frame->buf[0] && av_frame_is_writable(frame) && frame->format == params->dst_sample_fmt &&
+        frame->channel_layout == params->dst_channel_layout && frame->linesize[0] >= linesize) {
+        frame->nb_samples = nb_samples;
+        return 0;
+    }
+    av_frame_unref(frame);
+    frame->nb_samples = nb_samples;
+    frame->channel_layout = params->dst_channel_layout;
+    frame->format = params->dst_sample_fmt;
+    frame->sample_rate = params->dst_sample_rate;
+    resampler->nb_allocs++;
+    return av_frame_get_buffer(frame, 0);
+}
+
+int audio_resampler_receive_frame_into(audio_resampler_t *resampler, AVFrame *frame, int nb_samples)
+{
+    nb_samples = nb_samples == 0 ? audio_ring_size(resampler->fifo) : nb_samples;
+    if (audio_ring_size(resampler->fifo) < nb_samples || nb_samples == 0)
+        return 0;
+    int ret = prepare_out_frame(resampler, frame, nb_samples);
+    if (ret < 0) {
+        printf("cannot allocate audio data buffer\n");
+        return ret;
+    }
+    audio_ring_read(resampler->fifo, frame->extended_data, nb_samples);
+    frame->sample_rate = resampler->resampler_params.dst_sample_rate;
+    frame->pts = resampler->cur_pts;
+    resampler->cur_pts += nb_samples;
+    resampler->total_resampled_num += nb_samples;
+    return nb_samples;
+}
+
+AVFrame *audio_resampler_receive_pooled_frame(audio_resampler_t *resampler, int nb_samples)
+{
+    nb_samples = nb_samples == 0 ? audio_ring_size(resampler->fifo) : nb_samples;
+    if (audio_ring_size(resampler->fifo) < nb_samples || nb_samples == 0)
+        return NULL;
+    AVFrame *frame = NULL;
+    if (resampler->nb_free_frames > 0) {
+        frame = resampler->free_frames[--resampler->nb_free_frames];
+    } else {
+        frame = av_frame_alloc();
+        resampler->nb_allocs++;
+        if (!frame)
+            return NULL;
+    }
+    if (audio_resampler_receive_frame_into(resampler, frame, nb_samples) <= 0) {
+        audio_resampler_recycle_frame(resampler, frame);
+        return NULL;
+    }
+    return frame;
+}
+
+void audio_resampler_recycle_frame(audio_resampler_t *resampler, AVFrame *frame)
+{
+    if (!frame) {
+        return;
+    }
+    if (!resampler || resampler->nb_free_frames >= AUDIO_RESAMPLER_POOL_SIZE) {
+        av_frame_free(&frame);
+        return;
+    }
+    // 保留帧内存，下次 prepare_out_frame 时如果没有其他引用就直接复用
+    resampler->free_frames[resampler->nb_free_frames++] = frame;
+}
+
+int64_t audio_resampler_get_alloc_count(audio_resampler_t *resampler)
+{
+    if(!resampler) {
+        return 0;
+    }
+    return resampler->nb_allocs + resampler->nb_send_allocs;
+}
+
 int audio_resampler_get_fifo_size(audio_resampler_t *resampler)
 {
     if(!resampler) {
         return 0;
     }
-    return av_audio_fifo_size(resampler->audio_fifo);   // 获取fifo的采样点数量
+    return audio_ring_size(resampler->fifo);   // 获取fifo的采样点数量
 }
 
 int64_t audio_resampler_get_start_pts(audio_resampler_t *resampler)
@@ -1,6 +1,7 @@
 ﻿#ifndef AUDIORESAMPLER_H
 #define AUDIORESAMPLER_H
-#include "libavutil/audio_fifo.h"
+#include "audioringbuffer.h"
+#include "fixedresampler.h"
 #include "libavutil/opt.h"
 #include "libavutil/avutil.h"
 #include "libswresample/swresample.h"
@@ -20,13 +21,33 @@ typedef struct audio_resampler_params {
     uint64_t dst_channel_layout;
 }audio_resampler_params_t;
 
+#define AUDIO_RESAMPLER_POOL_SIZE 8     // 帧池最多缓存的空闲帧
+#define AUDIO_RESAMPLER_MAX_CHANNELS 64 // 同 libswresample 支持的最大通道数
+#define AUDIO_RESAMPLER_FIFO_CAPACITY 8192  // fifo 默认容量(采样点)
+#define AUDIO_RESAMPLER_MAX_GROUPS 16   // 多线程重采样最多分成几组通道
+
+// audio_resampler_alloc2 的 flags
+#define AUDIO_RESAMPLER_FLAG_THREAD_SAFE 1   // 见 audio_resampler_alloc2
+#define AUDIO_RESAMPLER_FLAG_NO_FAST_PATH 2  // 不使用 fixed_resampler_t，总是用 swresample(对比测试用)
+
+struct audio_resampler_workers;
+struct audio_resampler_drift;
+
+// 时钟漂移补偿的参数，见 audio_resampler_enable_drift_compensation
+typedef struct audio_resampler_drift_params {
+    double horizon;         // 误差修正的时间常数(秒)，越大调整越慢越平滑，<=0 使用默认 10 秒
+    double max_ppm;         // 采样率最大调整比例(百万分之一)，<=0 使用默认 1000(0.1%，听不出音调变化)
+    double jitter_time;     // 输入 pts 抖动的低通滤波时间常数(秒)，<=0 使用 horizon / 4
+} audio_resampler_drift_params_t;
+
 // 封装的重采样器
 typedef struct audio_resampler {
     struct SwrContext *swr_ctx;     // 重采样的核心
     audio_resampler_params_t resampler_params;  // 重采样的设置参数
-    int is_fifo_only;       // 不需要进行重采样，只需要缓存到 audio_fifo
+    int is_fifo_only;       // 不需要进行重采样，只需要缓存到 fifo
     int is_flushed;         // flush的时候使用
-    AVAudioFifo *audio_fifo;    // 采样点的缓存
+    int thread_safe;        // send 和 receive 可以在两个线程中调用(fifo 为 SPSC 无锁模式)
+    audio_ring_t *fifo;     // 采样点的缓存，固定容量的环形缓冲
     int64_t start_pts;          // 起始pts
     int64_t cur_pts;            // 当前pts
 
@@ -35,6 +56,14 @@ typedef struct audio_resampler {
     int src_channels;           // 输入的通道数
     int dst_channels;           // 输出通道数
     int64_t total_resampled_num;    // 统计总共的重采样点数，目前只是统计
+
+    AVFrame *free_frames[AUDIO_RESAMPLER_POOL_SIZE];   // 帧池：回收的帧，保留内存下次直接复用
+    int nb_free_frames;
+    int64_t nb_allocs;          // receive 一侧的堆分配次数(帧、帧内存)，稳态下应该不再增长
+    int64_t nb_send_allocs;     // send 一侧的堆分配次数(重采样缓存、fifo扩容)，分开统计避免两个线程写同一个变量
+    struct audio_resampler_workers *workers;    // 按通道分组多线程重采样，NULL 为单线程
+    fixed_resampler_t *fixed;   // 常用采样率的定比快速路径，非NULL时不使用 swr_ctx
+    struct audio_resampler_drift *drift;    // 时钟漂移补偿，NULL 为不补偿
 }audio_resampler_t;
 
 /**
@@ -44,6 +73,56 @@ typedef struct audio_resampler {
  */
 audio_resampler_t *audio_resampler_alloc(const audio_resampler_params_t resampler_params);
 
+/**
+ * @brief 分配重采样器，可以指定 fifo 容量和线程模式。
+ *        44100<->48000、48000->16000、8000->48000 且声道布局不变、格式为 S16/S16P/FLT/FLTP 时
+ *        使用 fixed_resampler_t 快速路径，其他情况使用 swresample
+ * @param resampler_params 重采样的设置参数
+ * @param fifo_capacity fifo 容量(采样点)，<=0 使用 AUDIO_RESAMPLER_FIFO_CAPACITY
+ * @param flags 0: 和 audio_resampler_alloc 相同，fifo 放不下时扩容;
+ *              AUDIO_RESAMPLER_FLAG_THREAD_SAFE: 一个线程调用 send_*，另一个线程调用 receive_* / get_fifo_size / 帧池，
+ *                  不需要加锁。fifo 容量固定，放不下这次重采样的输出时 send_* 返回 AVERROR(EAGAIN)，
+ *                  输入没有被消耗，等消费者取走数据后用同样的参数再调用一次;
+ *              AUDIO_RESAMPLER_FLAG_NO_FAST_PATH: 不使用快速路径
+ * @return 成功返回重采样器；失败返回NULL
+ */
+audio_resampler_t *audio_resampler_alloc2(const audio_resampler_params_t resampler_params,
+                                          int fifo_capacity, int flags);
+
+/**
+ * @brief 按通道分组多线程重采样：平面格式的通道分成 nb_threads 组，每组一个 SwrContext，
+ *        send_* 时各组在自己的工作线程中重采样(第0组在调用线程)，结果直接写到 fifo 中各自的平面，全部完成后才返回。
+ *        各通道的重采样互相独立，输出和单线程逐采样一致。
+ *        只支持输入输出都是平面格式、声道布局相同(不做混音)的情况，不满足条件或者使用快速路径时保持单线程。
+ *        必须在分配之后、第一次 send 之前调用
+ * @param resampler
+ * @param nb_threads 线程数(分组数)，超过通道数时按通道数
+ * @return 实际的分组数，1 表示仍然单线程；失败返回负数
+ */
+int audio_resampler_set_threads(audio_resampler_t *resampler, int nb_threads);
+
+/**
+ * @brief 打开时钟漂移补偿(时钟恢复)：用于直播采集，发送端的采样时钟和本地时钟有偏差时，
+ *        按本地时钟的 pts 消耗输出会让 fifo 越来越满或者被取空。
+ *        打开后每次 send 比较输入 pts(本地时钟，时间基为 1/输出采样率)经过的时间和已经产生的输出采样点数
+ *        (含 swr 内部缓存)，误差低通滤波后经 PI 控制得到采样率的调整比例，用 swr_set_compensation 平滑地调整，
+ *        不会插入或丢弃单个采样点，稳定后 fifo 深度(延迟)保持不变。
+ *        打开后总是使用 swresample(快速路径、直通 fifo 都换成 SwrContext)，多线程分组时每组同样调整。
+ *        必须在分配之后、第一次 send 之前调用，之后 send 需要传入有效的 pts
+ * @param resampler
+ * @param params 为 NULL 时全部使用默认值
+ * @return 0 成功，<0 失败
+ */
+int audio_resampler_enable_drift_compensation(audio_resampler_t *resampler,
+                                              const audio_resampler_drift_params_t *params);
+
+/**
+ * @brief 当前的采样率调整比例(百万分之一)，正数表示多产生输出采样点(发送端时钟偏慢)
+ * @param resampler
+ * @return 没有打开漂移补偿时返回0
+ */
+double audio_resampler_get_drift_ppm(audio_resampler_t *resampler);
+
 /**
  * @brief 释放重采样器
  * @param resampler
@@ -54,7 +133,7 @@ void audio_resampler_free(audio_resampler_t *resampler);
  * @brief 发送要进行重采样的帧
  * @param resampler
  * @param frame
- * @return 这次重采样后得到的采样点数
+ * @return 这次重采样后得到的采样点数；thread_safe 模式下 fifo 放不下时返回 AVERROR(EAGAIN)
  */
 int audio_resampler_send_frame(audio_resampler_t *resampler, AVFrame *frame);
 
@@ -64,17 +143,17 @@ int audio_resampler_send_frame(audio_resampler_t *resampler, AVFrame *frame);
  * @param in_data 二级指针
  * @param in_nb_samples 输入的采样点数量(单个通道)
  * @param pts       pts
- * @return
+ * @return 同 audio_resampler_send_frame
  */
 int audio_resampler_send_frame2(audio_resampler_t *resampler, uint8_t **in_data,int in_nb_samples, int64_t pts);
 
 /**
- * @brief 发送要进行重采样的帧
+ * @brief 发送要进行重采样的帧，直接在 in_data 上构造各通道指针，不分配临时帧
  * @param resampler
- * @param in_data 一级指针
+ * @param in_data 一级指针，平面格式时各通道依次存放(同 avcodec_fill_audio_frame 的默认对齐)
  * @param in_bytes 传入数据的字节大小
  * @param pts
- * @return
+ * @return 同 audio_resampler_send_frame
  */
 int audio_resampler_send_frame3(audio_resampler_t *resampler, uint8_t *in_data,int in_bytes, int64_t pts);
 
@@ -98,6 +177,39 @@ AVFrame *audio_resampler_receive_frame(audio_resampler_t *resampler, int nb_samp
  */
 int  audio_resampler_receive_frame2(audio_resampler_t *resampler, uint8_t **out_data, int nb_samples, int64_t *pts);
 
+/**
+ * @brief 获取重采样后的数据，写入调用者提供的帧：
+ *        帧内存可写且容量足够时直接复用，否则重新分配，循环使用同一个帧时稳态下没有堆分配
+ * @param resampler
+ * @param frame 输出帧
+ * @param nb_samples 同 audio_resampler_receive_frame
+ * @return 获取到的采样点数量，数据不够返回0，失败返回负数
+ */
+int audio_resampler_receive_frame_into(audio_resampler_t *resampler, AVFrame *frame, int nb_samples);
+
+/**
+ * @brief 从重采样器的帧池取帧，用完后调用 audio_resampler_recycle_frame 还回池中。
+ *        帧池不是线程安全的，跨线程使用时由调用者把帧送回重采样所在的线程再回收
+ * @param resampler
+ * @param nb_samples 同 audio_resampler_receive_frame
+ * @return 如果获取到采样点数则非NULL
+ */
+AVFrame *audio_resampler_receive_pooled_frame(audio_resampler_t *resampler, int nb_samples);
+
+/**
+ * @brief 把 audio_resampler_receive_pooled_frame 取出的帧还回池中，池满时释放
+ * @param resampler
+ * @param frame
+ */
+void audio_resampler_recycle_frame(audio_resampler_t *resampler, AVFrame *frame);
+
+/**
+ * @brief audio_resampler_get_alloc_count
+ * @param resampler
+ * @return 重采样器内部堆分配的次数
+ */
+int64_t audio_resampler_get_alloc_count(audio_resampler_t *resampler);
+
 /**
  * @brief audio_resampler_get_fifo_size
  * @param resampler
@@ -0,0 +1,308 @@
+#include "audioringbuffer.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "libavutil/error.h"
+#include "libavutil/macros.h"
+#include "libavutil/mem.h"
+
+#define AUDIO_RING_MAX_PLANES 64    // 同 libswresample 支持的最大通道数
+
+struct audio_ring {
+    enum AVSampleFormat sample_fmt;
+    int channels;
+    int nb_planes;              // 平面格式为通道数，交错格式为1
+    int block_align;            // 每个平面一个采样点的字节数
+    int capacity;               // 容量(采样点)，2 的幂
+    size_t mask;                // capacity - 1
+    int thread_safe;
+    memory_order load_order;    // SPSC 模式为 acquire/release，单线程模式用 relaxed
+    memory_order store_order;
+    uint8_t *buffer;            // 分配的内存，planes 指向其中按缓存行对齐的位置
+    uint8_t *planes[AUDIO_RING_MAX_PLANES];
+
+    // 生产者使用
+    char pad0[AUDIO_RING_CACHE_LINE];
+    atomic_size_t write_pos;    // 已写入的采样点总数，只有生产者修改
+    uint8_t *write_ptrs[AUDIO_RING_MAX_PLANES];
+    int64_t nb_written;
+    int64_t nb_full;
+    int64_t nb_grows;
+    int peak_size;
+
+    // 消费者使用
+    char pad1[AUDIO_RING_CACHE_LINE];
+    atomic_size_t read_pos;     // 已读出的采样点总数，只有消费者修改
+    uint8_t *span_ptrs[2][AUDIO_RING_MAX_PLANES];
+    int64_t nb_read;
+    int64_t nb_wraps;
+    char pad2[AUDIO_RING_CACHE_LINE];
+};
+
+static int round_up_pow2(int v)
+{
+    int n = 1;
+    while (n < v)
+        n <<= 1;
+    return n;
+}
+
+// 分配 capacity 个采样点的平面内存，每个平面的起始地址按缓存行对齐
+static int alloc_planes(audio_ring_t *ring, int capacity)
+{
+    size_t plane_size = FFALIGN((size_t)capacity * ring->block_align, AUDIO_RING_CACHE_LINE);
+    uint8_t *buffer = (uint8_t *)av_malloc(plane_size * ring->nb_planes + AUDIO_RING_CACHE_LINE);
+    if (!buffer) {
+        return AVERROR(ENOMEM);
+    }
+    uint8_t *base = (uint8_t *)FFALIGN((uintptr_t)buffer, AUDIO_RING_CACHE_LINE);
+    ring->buffer = buffer;
+    for (int i = 0; i < ring->nb_planes; i++)
+        ring->planes[i] = base + plane_size * i;
+    ring->capacity = capacity;
+    ring->mask = (size_t)capacity - 1;
+    return 0;
+}
+
+audio_ring_t *audio_ring_alloc(enum AVSampleFormat sample_fmt, int channels, int capacity,
+                               int thread_safe)
+{
+    int bps = av_get_bytes_per_sample(sample_fmt);
+    if (bps <= 0 || channels <= 0 || channels > AUDIO_RING_MAX_PLANES || capacity <= 0 ||
+        capacity > (1 << 30)) {
+        printf("audio_ring_alloc: invalid parameters\n");
+        return NULL;
+    }
+    audio_ring_t *ring = (audio_ring_t *)av_mallocz(sizeof(audio_ring_t));
+    if (!ring) {
+        return NULL;
+    }
+    ring->sample_fmt = sample_fmt;
+    ring->channels = channels;
+    if (av_sample_fmt_is_planar(sample_fmt)) {
+        ring->nb_planes = channels;
+        ring->block_align = bps;
+    } else {
+        ring->nb_planes = 1;
+        ring->block_align = bps * channels;
+    }
+    ring->thread_safe = thread_safe;
+    ring->load_order = thread_safe ? memory_order_acquire : memory_order_relaxed;
+    ring->store_order = thread_safe ? memory_order_release : memory_order_relaxed;
+    atomic_init(&ring->write_pos, 0);
+    atomic_init(&ring->read_pos, 0);
+    if (alloc_planes(ring, round_up_pow2(capacity)) < 0) {
+        av_free(ring);
+        return NULL;
+    }
+    return ring;
+}
+
+void audio_ring_free(audio_ring_t *ring)
+{
+    if (!ring) {
+        return;
+    }
+    av_free(ring->buffer);
+    av_free(ring);
+}
+
+int audio_ring_capacity(audio_ring_t *ring)
+{
+    return ring->capacity;
+}
+
+int audio_ring_size(audio_ring_t *ring)
+{
+    // 消费者自己的位置用 relaxed 即可，对方的位置用 acquire
+    size_t r = atomic_load_explicit(&ring->read_pos, memory_order_relaxed);
+    size_t w = atomic_load_explicit(&ring->write_pos, ring->load_order);
+    return (int)(w - r);
+}
+
+int audio_ring_space(audio_ring_t *ring)
+{
+    size_t w = atomic_load_explicit(&ring->write_pos, memory_order_relaxed);
+    size_t r = atomic_load_explicit(&ring->read_pos, ring->load_order);
+    return ring->capacity - (int)(w - r);
+}
+
+int audio_ring_contiguous_space(audio_ring_t *ring)
+{
+    size_t w = atomic_load_explicit(&ring->write_pos, memory_order_relaxed);
+    int to_end = ring->capacity - (int)(w & ring->mask);
+    int space = audio_ring_space(ring);
+    return space < to_end ? space : to_end;
+}
+
+uint8_t **audio_ring_write_ptrs(audio_ring_t *ring)
+{
+    size_t w = atomic_load_explicit(&ring->write_pos, memory_order_relaxed);
+    size_t offset = (w & ring->mask) * ring->block_align;
+    for (int i = 0; i < ring->nb_planes; i++)
+        ring->write_ptrs[i] = ring->planes[i] + offset;
+    return ring->write_ptrs;
+}
+
+void audio_ring_commit(audio_ring_t *ring, int nb_samples)
+{
+    size_t w = atomic_load_explicit(&ring->write_pos, memory_order_relaxed);
+    // release：数据写完之后消费者才能看到新的位置
+    atomic_store_explicit(&ring->write_pos, w + nb_samples, ring->store_order);
+    ring->nb_written += nb_samples;
+    size_t r = atomic_load_explicit(&ring->read_pos, memory_order_relaxed);
+    int size = (int)(w + nb_samples - r);
+    if (size > ring->peak_size)
+        ring->peak_size = size;
+}
+
+int audio_ring_write(audio_ring_t *ring, uint8_t *const *data, int nb_samples)
+{
+    int space = audio_ring_space(ring);
+    if (nb_samples > space) {
+        ring->nb_full++;
+        nb_samples = space;
+    }
+    if (nb_samples <= 0) {
+        return 0;
+    }
+    size_t w = atomic_load_explicit(&ring->write_pos, memory_order_relaxed);
+    int offset = (int)(w & ring->mask);
+    int first = ring->capacity - offset;    // 写到环尾的部分，剩下的从头开始
+    if (first > nb_samples)
+        first = nb_samples;
+    size_t first_bytes = (size_t)first * ring->block_align;
+    size_t second_bytes = (size_t)(nb_samples - first) * ring->block_align;
+    for (int i = 0; i < ring->nb_planes; i++) {
+        memcpy(ring->planes[i] + (size_t)offset * ring->block_align, data[i], first_bytes);
+        if (second_bytes > 0)
+            memcpy(ring->planes[i], data[i] + first_bytes, second_bytes);
+    }
+    audio_ring_commit(ring, nb_samples);
+    return nb_samples;
+}
+
+int audio_ring_grow(audio_ring_t *ring, int min_capacity)
+{
+    if (ring->thread_safe) {
+        return AVERROR(EINVAL);
+    }
+    if (min_capacity <= ring->capacity) {
+        return 0;
+    }
+    if (min_capacity > (1 << 30)) {
+        return AVERROR(EINVAL);
+    }
+    // 在新内存中把数据排成从 0 开始的一段
+    uint8_t *old_buffer = ring->buffer;
+    uint8_t *old_planes[AUDIO_RING_MAX_PLANES];
+    memcpy(old_planes, ring->planes, sizeof(uint8_t *) * ring->nb_planes);
+    int old_capacity = ring->capacity;
+    int size = audio_ring_size(ring);
+    int offset = (int)(atomic_load_explicit(&ring->read_pos, memory_order_relaxed) & ring->mask);
+    int ret = alloc_planes(ring, round_up_pow2(min_capacity));
+    if (ret < 0) {
+        return ret;
+    }
+    int first = old_capacity - offset;
+    if (first > size)
+        first = size;
+    size_t first_bytes = (size_t)first * ring->block_align;
+    size_t second_bytes = (size_t)(size - first) * ring->block_align;
+    for (int i = 0; i < ring->nb_planes; i++) {
+        memcpy(ring->planes[i], old_planes[i] + (size_t)offset * ring->block_align, first_bytes);
+        if (second_bytes > 0)
+            memcpy(ring->planes[i] + first_bytes, old_planes[i], second_bytes);
+    }
+    av_free(old_buffer);
+    atomic_store_explicit(&ring->read_pos, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->write_pos, (size_t)size, memory_order_relaxed);
+    ring->nb_grows++;
+    return 0;
+}
+
+int audio_ring_peek(audio_ring_t *ring, int nb_samples, audio_ring_span_t spans[2])
+{
+    int size = audio_ring_size(ring);
+    if (nb_samples > size)
+        nb_samples = size;
+    if (nb_samples <= 0) {
+        return 0;
+    }
+    size_t r = atomic_load_explicit(&ring->read_pos, memory_order_relaxed);
+    int offset = (int)(r & ring->mask);
+    int first = ring->capacity - offset;
+    if (first > nb_samples)
+        first = nb_samples;
+    for (int i = 0; i < ring->nb_planes; i++) {
+        ring->span_ptrs[0][i] = ring->planes[i] + (size_t)offset * ring->block_align;
+        ring->span_ptrs[1][i] = ring->planes[i];
+    }
+    spans[0].data = ring->span_ptrs[0];
+    spans[0].nb_samples = first;
+    if (first == nb_samples) {
+        return 1;
+    }
+    spans[1].data = ring->span_ptrs[1];
+    spans[1].nb_samples = nb_samples - first;
+    return 2;
+}
+
+void audio_ring_drain(audio_ring_t *ring, int nb_samples)
+{
+    int size = audio_ring_size(ring);
+    if (nb_samples > size)
+        nb_samples = size;
+    if (nb_samples <= 0) {
+        return;
+    }
+    size_t r = atomic_load_explicit(&ring->read_pos, memory_order_relaxed);
+    if ((int)(r & ring->mask) + nb_samples > ring->capacity)
+        ring->nb_wraps++;
+    // release：数据读完之后生产者才能覆盖这段内存
+    atomic_store_explicit(&ring->read_pos, r + nb_samples, ring->store_order);
+    ring->nb_read += nb_samples;
+}
+
+int audio_ring_read(audio_ring_t *ring, uint8_t *const *data, int nb_samples)
+{
+    audio_ring_span_t spans[2];
+    int nb_spans = audio_ring_peek(ring, nb_samples, spans);
+    int pos = 0;
+    for (int s = 0; s < nb_spans; s++) {
+        size_t bytes = (size_t)spans[s].nb_samples * ring->block_align;
+        for (int i = 0; i < ring->nb_planes; i++)
+            memcpy(data[i] + (size_t)pos * ring->block_align, spans[s].data[i], bytes);
+        pos += spans[s].nb_samples;
+    }
+    audio_ring_drain(ring, pos);
+    return pos;
+}
+
+void audio_ring_reset(audio_ring_t *ring)
+{
+    atomic_store_explicit(&ring->read_pos, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->write_pos, 0, memory_order_relaxed);
+}
+
+void audio_ring_get_stats(audio_ring_t *ring, audio_ring_stats_t *stats)
+{
+    stats->nb_written = ring->nb_written;
+    stats->nb_full = ring->nb_full;
+    stats->nb_grows = ring->nb_grows;
+    stats->peak_size = ring->peak_size;
+    stats->nb_read = ring->nb_read;
+    stats->nb_wraps = ring->nb_wraps;
+}
+
+void audio_ring_dump_stats(audio_ring_t *ring, const char *name)
+{
+    audio_ring_stats_t s;
+    audio_ring_get_stats(ring, &s);
+    printf("[%s] audio ring(%s) capacity:%d written:%lld read:%lld peak:%d full:%lld"
+           " grows:%lld wraps:%lld\n",
+           name ? name : "audio_ring", ring->thread_safe ? "spsc" : "single", ring->capacity,
+           (long long)s.nb_written, (long long)s.nb_read, s.peak_size, (long long)s.nb_full,
+           (long long)s.nb_grows, (long long)s.nb_wraps);
+}
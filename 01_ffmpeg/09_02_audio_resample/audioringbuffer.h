@@ -0,0 +1,148 @@
+#ifndef AUDIORINGBUFFER_H
+#define AUDIORINGBUFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "libavutil/samplefmt.h"
+
+/**
+* 音频采样环形缓冲，替代重采样器中的 AVAudioFifo：
+* (1) 容量固定(向上取 2 的幂)，分配后不再扩容，AVAudioFifo 容量不够时会 realloc;
+* (2) 读指针前进即可，读走的数据不需要像 av_audio_fifo_read 那样把剩余数据 memmove 到头部;
+* (3) 每个平面按缓存行对齐，读写位置放在不同的缓存行，生产者和消费者不会互相踩缓存行;
+* (4) audio_ring_peek 返回最多两段连续内存(绕回时分成两段)，调用者可以直接在环上读写，不用多拷贝一次;
+* (5) thread_safe 为 1 时是单生产者单消费者(SPSC)无锁队列：一个线程写，另一个线程读，不需要互斥锁。
+*     读写位置是单调递增的计数，生产者只修改 write_pos，消费者只修改 read_pos，通过 acquire/release 同步。
+* 非线程安全模式下可以调用 audio_ring_grow 扩容，线程安全模式下容量固定，写满后由调用者等待消费者。
+*/
+
+#define AUDIO_RING_CACHE_LINE 64    // 缓存行大小，平面内存和读写位置都按它对齐
+
+// 环上一段连续的采样：平面 i 的数据从 data[i] 开始
+typedef struct audio_ring_span {
+    uint8_t **data;             // 各平面的地址，指向 audio_ring_t 内部的数组，下次 peek 前有效
+    int nb_samples;
+} audio_ring_span_t;
+
+typedef struct audio_ring_stats {
+    // 生产者更新
+    int64_t nb_written;         // 写入的采样点
+    int64_t nb_full;            // 空间不够、只写入了一部分或没写入的次数
+    int64_t nb_grows;           // 扩容次数(只有非线程安全模式)
+    int peak_size;              // 缓存采样点数的峰值
+    // 消费者更新
+    int64_t nb_read;            // 读出的采样点
+    int64_t nb_wraps;           // 读的数据跨过环尾、分成两段的次数
+} audio_ring_stats_t;
+
+// 结构体定义在 audioringbuffer.c 中：读写位置是 C11 原子变量，C++ 代码也可以包含这个头文件
+typedef struct audio_ring audio_ring_t;
+
+/**
+ * @brief 分配环形缓冲
+ * @param sample_fmt
+ * @param channels
+ * @param capacity 最少能缓存的采样点数，向上取 2 的幂
+ * @param thread_safe 1 为 SPSC 无锁模式，容量固定
+ * @return 失败返回NULL
+ */
+audio_ring_t *audio_ring_alloc(enum AVSampleFormat sample_fmt, int channels, int capacity,
+                               int thread_safe);
+
+/**
+ * @brief 释放环形缓冲
+ * @param ring
+ */
+void audio_ring_free(audio_ring_t *ring);
+
+/**
+ * @brief 容量(采样点)
+ */
+int audio_ring_capacity(audio_ring_t *ring);
+
+/**
+ * @brief 缓存的采样点数，SPSC 模式下由消费者调用，生产者同时在写时只会偏小
+ */
+int audio_ring_size(audio_ring_t *ring);
+
+/**
+ * @brief 剩余可写的采样点数，SPSC 模式下由生产者调用，消费者同时在读时只会偏小
+ */
+int audio_ring_space(audio_ring_t *ring);
+
+/**
+ * @brief 生产者：第一段可以连续写入的采样点数(不绕回)，配合 audio_ring_write_ptrs 直接写到环上
+ */
+int audio_ring_contiguous_space(audio_ring_t *ring);
+
+/**
+ * @brief 生产者：当前写位置在各平面上的地址，指向 audio_ring_t 内部的数组
+ */
+uint8_t **audio_ring_write_ptrs(audio_ring_t *ring);
+
+/**
+ * @brief 生产者：直接写到环上之后提交 nb_samples 个采样点，不能超过 audio_ring_contiguous_space
+ */
+void audio_ring_commit(audio_ring_t *ring, int nb_samples);
+
+/**
+ * @brief 生产者：写入采样，空间不够时只写入能放下的部分
+ * @param ring
+ * @param data 各平面的数据
+ * @param nb_samples
+ * @return 实际写入的采样点数
+ */
+int audio_ring_write(audio_ring_t *ring, uint8_t *const *data, int nb_samples);
+
+/**
+ * @brief 扩容到至少 min_capacity，保留已缓存的数据。只有非线程安全模式可以调用
+ * @return 成功返回0，线程安全模式返回 AVERROR(EINVAL)，内存不够返回 AVERROR(ENOMEM)
+ */
+int audio_ring_grow(audio_ring_t *ring, int min_capacity);
+
+/**
+ * @brief 消费者：查看最前面的 nb_samples 个采样点(不超过缓存的数量)，不移动读位置
+ * @param ring
+ * @param nb_samples
+ * @param spans 输出最多两段
+ * @return 段数 0~2
+ */
+int audio_ring_peek(audio_ring_t *ring, int nb_samples, audio_ring_span_t spans[2]);
+
+/**
+ * @brief 消费者：丢掉最前面的 nb_samples 个采样点，通常在 audio_ring_peek 处理完之后调用
+ */
+void audio_ring_drain(audio_ring_t *ring, int nb_samples);
+
+/**
+ * @brief 消费者：读出采样到 data，数据不够时只读出缓存的部分
+ * @return 实际读出的采样点数
+ */
+int audio_ring_read(audio_ring_t *ring, uint8_t *const *data, int nb_samples);
+
+/**
+ * @brief 清空，只能在没有其他线程访问时调用
+ */
+void audio_ring_reset(audio_ring_t *ring);
+
+/**
+ * @brief 获取统计信息，SPSC 模式下由任意一方在另一方暂停时调用才准确
+ */
+void audio_ring_get_stats(audio_ring_t *ring, audio_ring_stats_t *stats);
+
+/**
+ * @brief 打印统计信息
+ */
+void audio_ring_dump_stats(audio_ring_t *ring, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIORINGBUFFER_H
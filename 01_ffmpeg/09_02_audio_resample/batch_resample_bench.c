@@ -0,0 +1,247 @@
+/**
+ * @brief         批量重采样和每路一个 SwrContext 的对比：N 路单声道 float 16k -> 48k，每块 20ms(320 个采样点)
+ *                1. swr：每路一个 SwrContext(audio_resampler_t 的核心，不含 fifo 的开销)，逐路 swr_convert;
+ *                2. batch：一个 batch_resampler_t，一次调用处理所有流的一个块。
+ *                输出每块耗时和单核能实时处理的路数(音频时长 * 路数 / 耗时)，
+ *                以及批量重采样输出相对理想正弦波的信噪比。
+ *                最后做下采样的混叠检查：输出奈奎斯特频率以上的单音(例如 48k -> 16k 时 10kHz，
+ *                会混叠到 6kHz)至少衰减 ALIAS_MIN_DB，否则输出 FAIL 并返回非0。
+ *
+ *                用法: 09_02_batch_resample_bench [路数列表] [秒数] [输入采样率] [输出采样率]
+ *                默认 16,256,1024,4096 路，2 秒，16000 -> 48000
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "libavutil/time.h"
+#include "libavutil/opt.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/mem.h"
+#include "libswresample/swresample.h"
+#include "batchresampler.h"
+
+#define BLOCK_MS 20
+#define MAX_STREAM_CASES 16
+#define TONE_HZ 1000.0
+#define ALIAS_MIN_DB 80.0       // 阻带单音最少的衰减
+#define ALIAS_SECONDS 2
+
+// 混叠检查的用例：tone_hz 高于输出奈奎斯特频率，并且在滤波器的阻带内
+typedef struct alias_case {
+    int src_rate;
+    int dst_rate;
+    double tone_hz;
+} alias_case_t;
+
+static const alias_case_t alias_cases[] = {
+    {48000, 16000, 10000},  // 混叠到 6kHz
+    {48000, 8000, 6000},    // 混叠到 2kHz
+    {44100, 8000, 5000},    // 混叠到 3kHz
+};
+
+// 每路不同相位的正弦波
+static void fill_input(float *in, int nb_streams, int block, int64_t offset, int rate)
+{
+    for (int s = 0; s < nb_streams; s++) {
+        float *p = in + (size_t)s * block;
+        for (int i = 0; i < block; i++)
+            p[i] = 0.5f * (float)sin(2 * M_PI * TONE_HZ * (offset + i) / rate + s * 0.1);
+    }
+}
+
+static int64_t bench_swr(int nb_streams, int nb_blocks, int block, int src_rate, int dst_rate,
+                         float *in, float *out, int max_out)
+{
+    struct SwrContext **ctxs = (struct SwrContext **)av_mallocz(sizeof(*ctxs) * nb_streams);
+    if (!ctxs) {
+        return -1;
+    }
+    int64_t elapsed = -1;
+    for (int s = 0; s < nb_streams; s++) {
+        ctxs[s] = swr_alloc_set_opts(NULL, AV_CH_LAYOUT_MONO, AV_SAMPLE_FMT_FLT, dst_rate,
+                                     AV_CH_LAYOUT_MONO, AV_SAMPLE_FMT_FLT, src_rate, 0, NULL);
+        if (!ctxs[s] || swr_init(ctxs[s]) < 0) {
+            printf("swr init failed\n");
+            goto end;
+        }
+    }
+    fill_input(in, nb_streams, block, 0, src_rate);
+    int64_t start = av_gettime_relative();
+    for (int b = 0; b < nb_blocks; b++) {
+        for (int s = 0; s < nb_streams; s++) {
+            const uint8_t *src = (const uint8_t *)(in + (size_t)s * block);
+            uint8_t *dst = (uint8_t *)(out + (size_t)s * max_out);
+            swr_convert(ctxs[s], &dst, max_out, &src, block);
+        }
+    }
+    elapsed = av_gettime_relative() - start;
+end:
+    for (int s = 0; s < nb_streams; s++)
+        swr_free(&ctxs[s]);
+    av_free(ctxs);
+    return elapsed;
+}
+
+static int64_t bench_batch(int nb_streams, int nb_blocks, int block, int src_rate, int dst_rate,
+                           float *in, float *out, int max_out, double *snr)
+{
+    batch_resampler_t *r = batch_resampler_alloc(src_rate, dst_rate, nb_streams, block, 0);
+    const float **in_ptrs = (const float **)av_malloc(sizeof(float *) * nb_streams);
+    float **out_ptrs = (float **)av_malloc(sizeof(float *) * nb_streams);
+    int64_t elapsed = -1;
+    if (!r || !in_ptrs || !out_ptrs || r->max_out > max_out) {
+        printf("batch_resampler_alloc failed\n");
+        goto end;
+    }
+    for (int s = 0; s < nb_streams; s++) {
+        in_ptrs[s] = in + (size_t)s * block;
+        out_ptrs[s] = out + (size_t)s * max_out;
+    }
+    fill_input(in, nb_streams, block, 0, src_rate);
+    int64_t start = av_gettime_relative();
+    for (int b = 0; b < nb_blocks; b++)
+        batch_resampler_process(r, in_ptrs, block, out_ptrs);
+    elapsed = av_gettime_relative() - start;
+    batch_resampler_dump_stats(r, "batch");
+
+    // 第0路连续输入正弦波，和延迟对齐后的理想输出比较
+    batch_resampler_free(r);
+    r = batch_resampler_alloc(src_rate, dst_rate, 1, block, 0);
+    if (!r) {
+        goto end;
+    }
+    double delay = batch_resampler_get_delay(r);
+    double sig = 0, noise = 0;
+    int64_t out_pos = 0;
+    for (int b = 0; b < nb_blocks; b++) {
+        fill_input(in, 1, block, (int64_t)b * block, src_rate);
+        int nb_out = batch_resampler_process(r, in_ptrs, block, out_ptrs);
+        for (int j = 0; j < nb_out; j++, out_pos++) {
+            if (out_pos < 4 * delay)
+                continue;   // 跳过开始时滤波器的建立过程
+            double ideal = 0.5 * sin(2 * M_PI * TONE_HZ * (out_pos - delay) / dst_rate);
+            sig += ideal * ideal;
+            noise += (out[j] - ideal) * (out[j] - ideal);
+        }
+    }
+    *snr = noise > 0 ? 10 * log10(sig / noise) : 999;
+end:
+    batch_resampler_free(r);
+    av_free(in_ptrs);
+    av_free(out_ptrs);
+    return elapsed;
+}
+
+/**
+ * 单路输入阻带内的单音，输出(跳过滤波器建立过程)的有效值相对输入的衰减
+ * @return 衰减的 dB 数，失败返回负数
+ */
+static double measure_alias(const alias_case_t *c)
+{
+    int block = c->src_rate * BLOCK_MS / 1000;
+    batch_resampler_t *r = batch_resampler_alloc(c->src_rate, c->dst_rate, 1, block, 0);
+    float *in = (float *)av_malloc(sizeof(float) * block);
+    float *out = r ? (float *)av_malloc(sizeof(float) * r->max_out) : NULL;
+    double atten = -1;
+    if (!r || !in || !out) {
+        printf("alias check alloc failed\n");
+        goto end;
+    }
+    const float *in_ptrs[1] = {in};
+    float *out_ptrs[1] = {out};
+    double delay = batch_resampler_get_delay(r);
+    double energy = 0;
+    int64_t nb_energy = 0;
+    int64_t out_pos = 0;
+    int nb_blocks = ALIAS_SECONDS * 1000 / BLOCK_MS;
+    for (int b = 0; b < nb_blocks; b++) {
+        for (int i = 0; i < block; i++)
+            in[i] = 0.5f * (float)sin(2 * M_PI * c->tone_hz * ((int64_t)b * block + i) / c->src_rate);
+        int nb_out = batch_resampler_process(r, in_ptrs, block, out_ptrs);
+        for (int j = 0; j < nb_out; j++, out_pos++) {
+            if (out_pos < 4 * delay)
+                continue;
+            energy += (double)out[j] * out[j];
+            nb_energy++;
+        }
+    }
+    double in_rms = 0.5 / sqrt(2.0);
+    double out_rms = nb_energy > 0 ? sqrt(energy / nb_energy) : 0;
+    atten = out_rms > 0 ? 20 * log10(in_rms / out_rms) : 999;
+    printf("alias %5d -> %5d tone %5.0fHz taps:%3d | attenuation %6.1f dB (min %.0f) | %s\n", c->src_rate,
+           c->dst_rate, c->tone_hz, r->taps, atten, ALIAS_MIN_DB, atten >= ALIAS_MIN_DB ? "PASS" : "FAIL");
+end:
+    batch_resampler_free(r);
+    av_free(in);
+    av_free(out);
+    return atten;
+}
+
+int main(int argc, char **argv)
+{
+    int streams[MAX_STREAM_CASES] = {16, 256, 1024, 4096};
+    int nb_cases = 4;
+    if (argc > 1) {
+        nb_cases = 0;
+        char *list = argv[1];
+        char *end = NULL;
+        while (*list && nb_cases < MAX_STREAM_CASES) {
+            int n = (int)strtol(list, &end, 10);
+            if (end == list || n <= 0) {
+                printf("invalid streams list:%s\n", argv[1]);
+                return -1;
+            }
+            streams[nb_cases++] = n;
+            list = *end == ',' ? end + 1 : end;
+        }
+    }
+    double seconds = argc > 2 ? atof(argv[2]) : 2.0;
+    int src_rate = argc > 3 ? atoi(argv[3]) : 16000;
+    int dst_rate = argc > 4 ? atoi(argv[4]) : 48000;
+    if (seconds <= 0 || src_rate <= 0 || dst_rate <= 0) {
+        printf("invalid parameters\n");
+        return -1;
+    }
+    int block = src_rate * BLOCK_MS / 1000;
+    int nb_blocks = (int)(seconds * 1000 / BLOCK_MS);
+    int max_out = (int)((int64_t)block * dst_rate / src_rate) + 64;   // swr 第一次输出可能多出几个采样
+
+    int max_streams = 0;
+    for (int i = 0; i < nb_cases; i++)
+        max_streams = streams[i] > max_streams ? streams[i] : max_streams;
+    float *in = (float *)av_malloc(sizeof(float) * block * max_streams);
+    float *out = (float *)av_malloc(sizeof(float) * max_out * max_streams);
+    if (!in || !out) {
+        printf("alloc buffers failed\n");
+        av_free(in);
+        av_free(out);
+        return -1;
+    }
+
+    printf("%d -> %d mono float, %d ms blocks, %.1f s of audio per stream\n", src_rate, dst_rate,
+           BLOCK_MS, seconds);
+    double audio_us = nb_blocks * BLOCK_MS * 1000.0;
+    for (int i = 0; i < nb_cases; i++) {
+        int n = streams[i];
+        double snr = 0;
+        int64_t swr_us = bench_swr(n, nb_blocks, block, src_rate, dst_rate, in, out, max_out);
+        int64_t batch_us = bench_batch(n, nb_blocks, block, src_rate, dst_rate, in, out, max_out, &snr);
+        if (swr_us <= 0 || batch_us <= 0)
+            continue;
+        printf("%5d streams | swr %8.1f us/block %7.0f streams/core | batch %8.1f us/block %7.0f streams/core"
+               " | x%.2f | batch snr %.1f dB\n",
+               n, swr_us / (double)nb_blocks, audio_us * n / swr_us, batch_us / (double)nb_blocks,
+               audio_us * n / batch_us, (double)swr_us / batch_us, snr);
+    }
+    av_free(in);
+    av_free(out);
+
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(alias_cases) / sizeof(alias_cases[0]); i++) {
+        if (measure_alias(&alias_cases[i]) < ALIAS_MIN_DB)
+            failed = 1;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,300 @@
+#include "batchresampler.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "libavutil/error.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define BATCH_RESAMPLER_AVX 1
+#endif
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define BATCH_RESAMPLER_SSE 1
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BATCH_RESAMPLER_NEON 1
+#endif
+
+#define KAISER_BETA 9.0     // 同 libswresample 默认的 kaiser_beta
+#define MAX_UP 1024         // 上采样倍数上限，系数表为 up * taps 个 float
+
+// ===== 滤波器设计 =====
+
+// 第一类零阶修正贝塞尔函数，Kaiser 窗用
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 50; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+// 原型低通长度 up * taps，拆成 up 个相位，每个相位 taps 个系数，各相位归一化到直流增益为1
+// 下采样时截止频率按 1/down 缩小，taps 已经按 down/up 放大，过渡带宽度相对输出采样率不变
+static int design_filter(float *coefs, int up, int down, int taps)
+{
+    int len = up * taps;
+    double fc = 0.5 * BATCH_RESAMPLER_CUTOFF / (up > down ? up : down);    // 上采样域的截止频率
+    double center = (len - 1) / 2.0;
+    double i0_beta = bessel_i0(KAISER_BETA);
+    double *phase = (double *)av_malloc(sizeof(double) * taps);
+    if (!phase) {
+        return AVERROR(ENOMEM);
+    }
+    for (int p = 0; p < up; p++) {
+        double sum = 0;
+        for (int k = 0; k < taps; k++) {
+            double t = k * up + p - center;
+            double sinc = t == 0 ? 2 * fc : sin(2 * M_PI * fc * t) / (M_PI * t);
+            double x = len > 1 ? 2 * t / (len - 1) : 0;
+            double w = bessel_i0(KAISER_BETA * sqrt(x * x < 1 ? 1 - x * x : 0)) / i0_beta;
+            phase[k] = sinc * w;
+            sum += phase[k];
+        }
+        for (int k = 0; k < taps; k++)
+            coefs[p * taps + k] = (float)(phase[k] / sum);
+    }
+    av_free(phase);
+    return 0;
+}
+
+// ===== 一组流的 FIR =====
+// out[s] = sum_k coefs[k] * x[-k * TILE + s]，x 指向最新的一行(一个时刻 TILE 路)，往前是更早的采样
+
+#if !BATCH_RESAMPLER_AVX && !BATCH_RESAMPLER_SSE && !BATCH_RESAMPLER_NEON
+static void fir_tile_c(float *out, const float *x, const float *coefs, int taps)
+{
+    float acc[BATCH_RESAMPLER_TILE] = {0};
+    for (int k = 0; k < taps; k++) {
+        const float c = coefs[k];
+        const float *row = x - k * BATCH_RESAMPLER_TILE;
+        for (int s = 0; s < BATCH_RESAMPLER_TILE; s++)
+            acc[s] += c * row[s];
+    }
+    memcpy(out, acc, sizeof(acc));
+}
+#endif
+
+#if BATCH_RESAMPLER_AVX
+static void fir_tile_avx(float *out, const float *x, const float *coefs, int taps)
+{
+    __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+    __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+    for (int k = 0; k < taps; k++) {
+        const __m256 c = _mm256_broadcast_ss(coefs + k);
+        const float *row = x - k * BATCH_RESAMPLER_TILE;
+        a0 = _mm256_add_ps(a0, _mm256_mul_ps(c, _mm256_loadu_ps(row)));
+        a1 = _mm256_add_ps(a1, _mm256_mul_ps(c, _mm256_loadu_ps(row + 8)));
+        a2 = _mm256_add_ps(a2, _mm256_mul_ps(c, _mm256_loadu_ps(row + 16)));
+        a3 = _mm256_add_ps(a3, _mm256_mul_ps(c, _mm256_loadu_ps(row + 24)));
+    }
+    _mm256_storeu_ps(out, a0);
+    _mm256_storeu_ps(out + 8, a1);
+    _mm256_storeu_ps(out + 16, a2);
+    _mm256_storeu_ps(out + 24, a3);
+}
+#elif BATCH_RESAMPLER_SSE
+static void fir_tile_sse(float *out, const float *x, const float *coefs, int taps)
+{
+    __m128 a[8];
+    for (int i = 0; i < 8; i++)
+        a[i] = _mm_setzero_ps();
+    for (int k = 0; k < taps; k++) {
+        const __m128 c = _mm_set1_ps(coefs[k]);
+        const float *row = x - k * BATCH_RESAMPLER_TILE;
+        for (int i = 0; i < 8; i++)
+            a[i] = _mm_add_ps(a[i], _mm_mul_ps(c, _mm_loadu_ps(row + 4 * i)));
+    }
+    for (int i = 0; i < 8; i++)
+        _mm_storeu_ps(out + 4 * i, a[i]);
+}
+#elif BATCH_RESAMPLER_NEON
+static void fir_tile_neon(float *out, const float *x, const float *coefs, int taps)
+{
+    float32x4_t a[8];
+    for (int i = 0; i < 8; i++)
+        a[i] = vdupq_n_f32(0);
+    for (int k = 0; k < taps; k++) {
+        const float c = coefs[k];
+        const float *row = x - k * BATCH_RESAMPLER_TILE;
+        for (int i = 0; i < 8; i++)
+            a[i] = vmlaq_n_f32(a[i], vld1q_f32(row + 4 * i), c);
+    }
+    for (int i = 0; i < 8; i++)
+        vst1q_f32(out + 4 * i, a[i]);
+}
+#endif
+
+static void fir_tile(float *out, const float *x, const float *coefs, int taps)
+{
+#if BATCH_RESAMPLER_AVX
+    fir_tile_avx(out, x, coefs, taps);
+#elif BATCH_RESAMPLER_SSE
+    fir_tile_sse(out, x, coefs, taps);
+#elif BATCH_RESAMPLER_NEON
+    fir_tile_neon(out, x, coefs, taps);
+#else
+    fir_tile_c(out, x, coefs, taps);
+#endif
+}
+
+// ===== 接口 =====
+
+batch_resampler_t *batch_resampler_alloc(int src_rate, int dst_rate, int nb_streams, int max_block,
+                                         int taps)
+{
+    if (src_rate <= 0 || dst_rate <= 0 || nb_streams <= 0 || max_block <= 0) {
+        printf("batch_resampler_alloc: invalid parameters\n");
+        return NULL;
+    }
+    if (taps <= 0)
+        taps = BATCH_RESAMPLER_DEFAULT_TAPS;
+    int64_t g = av_gcd(src_rate, dst_rate);
+    int up = (int)(dst_rate / g);
+    int down = (int)(src_rate / g);
+    // 同 swr：下采样时滤波器长度按 down/up 放大(ceil(filter_size / factor))，否则过渡带太宽，
+    // 输出奈奎斯特频率以上的成分混叠进来
+    if (down > up)
+        taps = (int)(((int64_t)taps * down + up - 1) / up);
+    if (up > MAX_UP || (int64_t)max_block * up > INT32_MAX / 2 || (int64_t)up * taps > INT32_MAX / 8) {
+        printf("batch_resampler_alloc: unsupported ratio %d/%d\n", dst_rate, src_rate);
+        return NULL;
+    }
+
+    batch_resampler_t *r = (batch_resampler_t *)av_mallocz(sizeof(batch_resampler_t));
+    if (!r) {
+        return NULL;
+    }
+    r->src_rate = src_rate;
+    r->dst_rate = dst_rate;
+    r->up = up;
+    r->down = down;
+    r->taps = taps;
+    r->nb_streams = nb_streams;
+    r->nb_tiles = (nb_streams + BATCH_RESAMPLER_TILE - 1) / BATCH_RESAMPLER_TILE;
+    r->max_block = max_block;
+    r->max_out = ((int64_t)max_block * up + down - 1) / down + 1;
+    int hist = taps - 1;
+    r->coefs = (float *)av_malloc(sizeof(float) * up * taps);
+    r->history = (float *)av_mallocz(sizeof(float) * r->nb_tiles * hist * BATCH_RESAMPLER_TILE);
+    r->work = (float *)av_mallocz(sizeof(float) * (hist + max_block) * BATCH_RESAMPLER_TILE);
+    r->out_work = (float *)av_mallocz(sizeof(float) * r->max_out * BATCH_RESAMPLER_TILE);
+    if (!r->coefs || !r->history || !r->work || !r->out_work ||
+        design_filter(r->coefs, up, down, taps) < 0) {
+        batch_resampler_free(r);
+        return NULL;
+    }
+    return r;
+}
+
+void batch_resampler_free(batch_resampler_t *r)
+{
+    if (!r) {
+        return;
+    }
+    av_free(r->coefs);
+    av_free(r->history);
+    av_free(r->work);
+    av_free(r->out_work);
+    av_free(r);
+}
+
+int batch_resampler_get_out_samples(batch_resampler_t *r, int nb_in)
+{
+    int end = nb_in * r->up;    // 这个块在上采样域的长度
+    if (r->pos >= end)
+        return 0;
+    return (end - r->pos + r->down - 1) / r->down;
+}
+
+int batch_resampler_process(batch_resampler_t *r, const float *const *in, int nb_in,
+                            float *const *out)
+{
+    if (nb_in < 0 || nb_in > r->max_block) {
+        return AVERROR(EINVAL);
+    }
+    const int tile = BATCH_RESAMPLER_TILE;
+    const int hist = r->taps - 1;
+    const size_t hist_size = sizeof(float) * hist * tile;
+    int nb_out = batch_resampler_get_out_samples(r, nb_in);
+    float *rows = r->work + hist * tile;    // 这次输入的第一行
+
+    for (int t = 0; t < r->nb_tiles; t++) {
+        int s0 = t * tile;
+        int w = r->nb_streams - s0 < tile ? r->nb_streams - s0 : tile;
+        float *state = r->history + (size_t)t * hist * tile;
+
+        // 历史 + 这次的输入排成连续的行，每行是同一时刻这一组的 TILE 路
+        memcpy(r->work, state, hist_size);
+        for (int s = 0; s < w; s++) {
+            const float *src = in[s0 + s];
+            if (src) {
+                for (int i = 0; i < nb_in; i++)
+                    rows[i * tile + s] = src[i];
+            } else {
+                for (int i = 0; i < nb_in; i++)
+                    rows[i * tile + s] = 0;
+            }
+        }
+        // 最后一组不满 TILE 路时多出来的列不输出，算了也没有影响
+
+        int pos = r->pos;
+        for (int j = 0; j < nb_out; j++, pos += r->down) {
+            int n = pos / r->up;    // 最新的输入
+            int p = pos % r->up;    // 相位
+            fir_tile(r->out_work + j * tile, rows + n * tile, r->coefs + p * r->taps, r->taps);
+        }
+
+        for (int s = 0; s < w; s++) {
+            float *dst = out[s0 + s];
+            if (!dst)
+                continue;
+            for (int j = 0; j < nb_out; j++)
+                dst[j] = r->out_work[j * tile + s];
+        }
+        // 最后 taps-1 行是下次的历史
+        memcpy(state, r->work + (size_t)nb_in * tile, hist_size);
+    }
+
+    r->pos += nb_out * r->down - nb_in * r->up;
+    r->nb_calls++;
+    r->nb_in_samples += nb_in;
+    r->nb_out_samples += nb_out;
+    return nb_out;
+}
+
+void batch_resampler_reset_stream(batch_resampler_t *r, int stream)
+{
+    if (stream < 0 || stream >= r->nb_streams) {
+        return;
+    }
+    const int tile = BATCH_RESAMPLER_TILE;
+    float *state = r->history + (size_t)(stream / tile) * (r->taps - 1) * tile;
+    for (int k = 0; k < r->taps - 1; k++)
+        state[k * tile + stream % tile] = 0;
+}
+
+double batch_resampler_get_delay(batch_resampler_t *r)
+{
+    // 滤波器中心在上采样域的 (up * taps - 1) / 2 处，输出采样间隔为 down
+    return (r->up * r->taps - 1) / 2.0 / r->down;
+}
+
+void batch_resampler_dump_stats(batch_resampler_t *r, const char *name)
+{
+    printf("[%s] batch resampler %d -> %d (L=%d M=%d) streams:%d taps:%d coefs:%d bytes"
+           " state:%d bytes/stream calls:%lld in:%lld out:%lld delay:%.1f\n",
+           name ? name : "batch_resampler", r->src_rate, r->dst_rate, r->up, r->down, r->nb_streams,
+           r->taps, (int)sizeof(float) * r->up * r->taps, (int)sizeof(float) * (r->taps - 1),
+           (long long)r->nb_calls, (long long)r->nb_in_samples, (long long)r->nb_out_samples,
+           batch_resampler_get_delay(r));
+}
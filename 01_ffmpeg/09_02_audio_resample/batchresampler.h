@@ -0,0 +1,100 @@
+#ifndef BATCHRESAMPLER_H
+#define BATCHRESAMPLER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+* 批量重采样：大量参数相同的单声道流(例如会议中上千路 16k -> 48k)一起处理。
+* 每路流一个 audio_resampler_t 时每路都有自己的 SwrContext、滤波器系数、fifo 和 resampled_data，
+* 流一多缓存命中率很差。这里：
+* (1) 多相 FIR 滤波器(Kaiser 窗 sinc)的系数只有一份，所有流共享;
+* (2) 每路的状态只有 taps-1 个历史采样点，按 BATCH_RESAMPLER_TILE 路一组交错存放(struct-of-arrays)，
+*     同一时刻各路的采样连续，内层循环对多路同时做乘加，SIMD 沿着流的方向展开;
+* (3) 一次调用处理所有流的一个块，所有流的相位相同，输出采样数也相同;
+* (4) 以 TILE 路为单位处理，一组的工作数据在 L1/L2 中，处理完再换下一组。
+* 只支持 float 单声道(每路一个平面)，输入输出由调用者按块提供，没有 fifo。
+*/
+
+#define BATCH_RESAMPLER_TILE 32         // 一组交错存放的流数
+#define BATCH_RESAMPLER_DEFAULT_TAPS 32 // 每个相位的抽头数，同 libswresample 默认的 filter_size(下采样时放大)
+#define BATCH_RESAMPLER_CUTOFF 0.97     // 截止频率相对奈奎斯特频率，同 libswresample 默认的 cutoff
+
+typedef struct batch_resampler {
+    int src_rate;
+    int dst_rate;
+    int up;                     // 上采样倍数 L = dst_rate / gcd
+    int down;                   // 下采样倍数 M = src_rate / gcd
+    int taps;                   // 每个相位实际的抽头数(下采样时已经按 down/up 放大)
+    int nb_streams;
+    int nb_tiles;
+    int max_block;              // 每次最多输入的采样点
+    int max_out;                // 每次最多输出的采样点
+    int pos;                    // 下一个输出在上采样域中相对当前块开头的位置，所有流相同
+    float *coefs;               // [up][taps] 各相位的系数，所有流共享
+    float *history;             // [nb_tiles][taps-1][TILE] 每路的历史采样
+    float *work;                // [taps-1+max_block][TILE] 一组流的历史+这次的输入
+    float *out_work;            // [max_out][TILE] 一组流的输出
+    int64_t nb_calls;
+    int64_t nb_in_samples;      // 每路输入的采样点
+    int64_t nb_out_samples;
+} batch_resampler_t;
+
+/**
+ * @brief 分配批量重采样器
+ * @param src_rate
+ * @param dst_rate
+ * @param nb_streams 流数
+ * @param max_block 每次 batch_resampler_process 最多输入的采样点
+ * @param taps 每个相位的抽头数，<=0 使用 BATCH_RESAMPLER_DEFAULT_TAPS;
+ *        下采样(src_rate > dst_rate)时同 swr 按 src_rate/dst_rate 放大，例如 48k -> 16k 默认为 96
+ * @return 失败返回NULL
+ */
+batch_resampler_t *batch_resampler_alloc(int src_rate, int dst_rate, int nb_streams, int max_block,
+                                         int taps);
+
+/**
+ * @brief 释放
+ */
+void batch_resampler_free(batch_resampler_t *r);
+
+/**
+ * @brief 下一次输入 nb_in 个采样点时每路会输出多少采样点
+ */
+int batch_resampler_get_out_samples(batch_resampler_t *r, int nb_in);
+
+/**
+ * @brief 所有流处理一个块
+ * @param r
+ * @param in 每路的输入，in[i] 为 NULL 时按静音处理
+ * @param nb_in 每路输入的采样点，不超过 max_block
+ * @param out 每路的输出，至少 batch_resampler_get_out_samples(nb_in) 个采样点，out[i] 为 NULL 时丢弃
+ * @return 每路输出的采样点数，失败返回负数
+ */
+int batch_resampler_process(batch_resampler_t *r, const float *const *in, int nb_in,
+                            float *const *out);
+
+/**
+ * @brief 清空一路的历史，用于这一路换成新的流
+ */
+void batch_resampler_reset_stream(batch_resampler_t *r, int stream);
+
+/**
+ * @brief 滤波器带来的延迟(输出采样点)，输出第 j 个采样对应输入时刻 (j - delay) / dst_rate
+ */
+double batch_resampler_get_delay(batch_resampler_t *r);
+
+/**
+ * @brief 打印统计信息
+ */
+void batch_resampler_dump_stats(batch_resampler_t *r, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BATCHRESAMPLER_H
@@ -0,0 +1,215 @@
+/**
+ * @brief         时钟漂移补偿的模拟测试
+ *                模拟一个采样时钟有偏差的直播采集源：发送端每 10ms 送来一块 S16 立体声 440Hz 正弦波，
+ *                按本地时钟它的真实采样率是 src_rate * (1 + drift)，每块的 pts 是本地时钟的到达时间加上随机抖动;
+ *                消费端(相当于按本地时钟播放或编码)每 1024 个输出采样点的时间取一帧 FLTP。
+ *                1. 打开 audio_resampler_enable_drift_compensation，分别模拟 +drift 和 -drift;
+ *                2. 不打开补偿作为对比(fifo 一直变大或者被取空)。
+ *                输出每分钟的 fifo 深度(延迟)和调整比例，稳定后每 10 秒的平均延迟相对第一个 10 秒的最大变化，
+ *                取空次数，以及输出正弦波的最大突变(检测插入/丢弃采样带来的毛刺)。
+ *                打开补偿的情况下延迟变化超过 2ms、出现取空、估计的漂移误差超过 5ppm 或者有毛刺时输出 FAIL 并返回非0。
+ *
+ *                用法: 09_02_drift_resample_sim [秒数] [漂移ppm] [输入采样率] [输出采样率]，
+ *                默认 600 秒，150ppm，48000 -> 48000
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "libavutil/channel_layout.h"
+#include "libavutil/mem.h"
+#include "audioresampler.h"
+
+#define CHUNK_MS 10
+#define OUT_FRAME_SAMPLES 1024
+#define TONE_HZ 440.0
+#define TONE_AMP 0.5
+#define JITTER_MS 2.0           // pts 抖动 ±2ms
+#define START_LATENCY_MS 100    // 消费端在第一块到达后多久开始取数据
+#define SETTLE_SECONDS 120      // 前 120 秒是补偿的收敛过程，不计入延迟变化和取空
+#define WINDOW_SECONDS 10
+#define MAX_LATENCY_CHANGE_MS 2.0
+#define MAX_PPM_ERROR 5.0
+#define MAX_GLITCH 1e-3
+
+typedef struct sim_result {
+    double first_window_ms;     // 稳定后第一个窗口的平均延迟
+    double max_change_ms;       // 之后各窗口平均延迟相对第一个窗口的最大变化
+    double last_ms;             // 最后一个窗口的平均延迟
+    int underruns;              // 稳定后消费端取不到一整帧的次数
+    double ppm;                 // 稳定后调整比例的平均值
+    double max_glitch;          // 输出正弦波二阶差分残差的最大值
+} sim_result_t;
+
+// 确定性的伪随机数，[-1, 1)
+static double next_random(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return (*state >> 8) / (double)(1 << 24) * 2 - 1;
+}
+
+static int simulate(int seconds, double drift_ppm, int src_rate, int dst_rate, int compensate,
+                    sim_result_t *result)
+{
+    audio_resampler_params_t params;
+    params.src_sample_fmt = AV_SAMPLE_FMT_S16;
+    params.src_sample_rate = src_rate;
+    params.src_channel_layout = AV_CH_LAYOUT_STEREO;
+    params.dst_sample_fmt = AV_SAMPLE_FMT_FLTP;
+    params.dst_sample_rate = dst_rate;
+    params.dst_channel_layout = AV_CH_LAYOUT_STEREO;
+    audio_resampler_t *resampler = audio_resampler_alloc(params);
+    const int chunk = src_rate * CHUNK_MS / 1000;
+    int16_t *in = (int16_t *)av_malloc(sizeof(int16_t) * 2 * chunk);
+    float *out[2] = {(float *)av_malloc(sizeof(float) * OUT_FRAME_SAMPLES),
+                     (float *)av_malloc(sizeof(float) * OUT_FRAME_SAMPLES)};
+    int ret = -1;
+    if (!resampler || !in || !out[0] || !out[1]) {
+        printf("alloc failed\n");
+        goto end;
+    }
+    if (compensate && audio_resampler_enable_drift_compensation(resampler, NULL) < 0) {
+        printf("audio_resampler_enable_drift_compensation failed\n");
+        goto end;
+    }
+
+    memset(result, 0, sizeof(*result));
+    const double src_actual = src_rate * (1 + drift_ppm * 1e-6);    // 本地时钟下发送端真实的采样率
+    const double tone_step = 2 * M_PI * TONE_HZ / src_rate;         // 按发送端自己的时钟生成正弦波
+    const double c = cos(2 * M_PI * TONE_HZ / dst_rate);
+    uint32_t seed = 12345;
+    int64_t chunk_index = 0;
+    int64_t frame_index = 0;
+    int64_t in_pos = 0;
+    double y1 = 0, y2 = 0;      // 上两个输出采样，用来检测毛刺
+    int64_t nb_checked = 0;
+    double window_sum = 0;
+    int window_count = 0;
+    int64_t window_end = (int64_t)(SETTLE_SECONDS + WINDOW_SECONDS) * dst_rate;
+    int has_first_window = 0;
+    double ppm_sum = 0;
+    int64_t ppm_count = 0;
+
+    while (1) {
+        double t_chunk = (chunk_index + 1) * chunk / src_actual;    // 一块采集完成(到达)的时刻
+        double t_frame = START_LATENCY_MS / 1000.0 + chunk / src_actual +
+                         (double)frame_index * OUT_FRAME_SAMPLES / dst_rate;
+        if (t_chunk > seconds && t_frame > seconds)
+            break;
+        if (t_chunk <= t_frame) {
+            for (int i = 0; i < chunk; i++, in_pos++) {
+                int16_t v = (int16_t)lrint(TONE_AMP * 32767 * sin(tone_step * in_pos));
+                in[2 * i] = v;
+                in[2 * i + 1] = v;
+            }
+            // 第一个采样点的本地时间，时间基为 1/dst_rate，加上抖动
+            double t_start = chunk_index * chunk / src_actual + next_random(&seed) * JITTER_MS / 1000.0;
+            int64_t pts = (int64_t)llrint(t_start * dst_rate);
+            ret = audio_resampler_send_frame3(resampler, (uint8_t *)in, chunk * 4, pts);
+            if (ret < 0) {
+                printf("audio_resampler_send_frame3 failed:%d\n", ret);
+                goto end;
+            }
+            chunk_index++;
+            continue;
+        }
+        // 消费端取一帧
+        int64_t now = (int64_t)(t_frame * dst_rate);
+        int64_t frame_pts = 0;
+        int settled = t_frame >= SETTLE_SECONDS;
+        if (audio_resampler_receive_frame2(resampler, (uint8_t **)out, OUT_FRAME_SAMPLES, &frame_pts) <= 0) {
+            if (settled)
+                result->underruns++;
+        } else {
+            for (int i = 0; i < OUT_FRAME_SAMPLES; i++, nb_checked++) {
+                double y = out[0][i];
+                // 纯正弦波满足 y[n] = 2cos(w)y[n-1] - y[n-2]，插入或丢弃采样会出现尖峰
+                if (nb_checked > 64 && settled) {
+                    double r = fabs(y - 2 * c * y1 + y2);
+                    if (r > result->max_glitch)
+                        result->max_glitch = r;
+                }
+                y2 = y1;
+                y1 = y;
+            }
+        }
+        frame_index++;
+        double latency_ms = audio_resampler_get_fifo_size(resampler) * 1000.0 / dst_rate;
+        if (frame_index % (60 * dst_rate / OUT_FRAME_SAMPLES) == 0)
+            printf("  %5.0f s  latency %7.2f ms  ppm %+8.2f\n", t_frame, latency_ms,
+                   audio_resampler_get_drift_ppm(resampler));
+        if (!settled)
+            continue;
+        window_sum += latency_ms;
+        window_count++;
+        ppm_sum += audio_resampler_get_drift_ppm(resampler);
+        ppm_count++;
+        if (now >= window_end) {
+            double avg = window_sum / window_count;
+            if (!has_first_window) {
+                result->first_window_ms = avg;
+                has_first_window = 1;
+            } else if (fabs(avg - result->first_window_ms) > result->max_change_ms) {
+                result->max_change_ms = fabs(avg - result->first_window_ms);
+            }
+            result->last_ms = avg;
+            window_sum = 0;
+            window_count = 0;
+            window_end += (int64_t)WINDOW_SECONDS * dst_rate;
+        }
+    }
+    result->ppm = ppm_count > 0 ? ppm_sum / ppm_count : 0;
+    ret = 0;
+end:
+    audio_resampler_free(resampler);
+    av_free(in);
+    av_free(out[0]);
+    av_free(out[1]);
+    return ret;
+}
+
+static void print_result(const char *name, double drift_ppm, const sim_result_t *r)
+{
+    printf("%-14s drift %+7.1f ppm | latency %7.2f -> %7.2f ms, max change %7.2f ms | underruns %d"
+           " | ppm %+8.2f | max glitch %.2e\n",
+           name, drift_ppm, r->first_window_ms, r->last_ms, r->max_change_ms, r->underruns, r->ppm,
+           r->max_glitch);
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 600;
+    double drift_ppm = argc > 2 ? atof(argv[2]) : 150;
+    int src_rate = argc > 3 ? atoi(argv[3]) : 48000;
+    int dst_rate = argc > 4 ? atoi(argv[4]) : 48000;
+    if (seconds < SETTLE_SECONDS + 2 * WINDOW_SECONDS || src_rate <= 0 || dst_rate <= 0 ||
+        fabs(drift_ppm) >= 1000) {
+        printf("invalid parameters, seconds >= %d, |drift| < 1000ppm\n", SETTLE_SECONDS + 2 * WINDOW_SECONDS);
+        return -1;
+    }
+    printf("%d -> %d, %d s, jitter +-%.1f ms\n", src_rate, dst_rate, seconds, JITTER_MS);
+
+    int failed = 0;
+    double drifts[2] = {drift_ppm, -drift_ppm};
+    for (int i = 0; i < 2; i++) {
+        sim_result_t r;
+        printf("compensated, drift %+.1f ppm\n", drifts[i]);
+        if (simulate(seconds, drifts[i], src_rate, dst_rate, 1, &r) < 0)
+            return -1;
+        // 发送端快 drift 时输出要少产生 drift
+        int ok = r.max_change_ms < MAX_LATENCY_CHANGE_MS && r.underruns == 0 &&
+                 fabs(r.ppm + drifts[i]) < MAX_PPM_ERROR && r.max_glitch < MAX_GLITCH;
+        failed |= !ok;
+        print_result("compensated", drifts[i], &r);
+        printf("%s\n", ok ? "PASS" : "FAIL");
+    }
+    for (int i = 0; i < 2; i++) {
+        sim_result_t r;
+        printf("uncompensated, drift %+.1f ppm\n", drifts[i]);
+        if (simulate(seconds, drifts[i], src_rate, dst_rate, 0, &r) < 0)
+            return -1;
+        print_result("uncompensated", drifts[i], &r);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,234 @@
+/**
+ * @brief         定比快速路径(fixed_resampler_t)和 swresample 的对比
+ *                44100->48000、48000->44100、48000->16000、8000->48000，立体声 FLTP 和 S16 两种格式，
+ *                每帧 1024 个采样点，都通过 audio_resampler_t(swresample 用 AUDIO_RESAMPLER_FLAG_NO_FAST_PATH)：
+ *                1. 速度：每帧耗时、加速比;
+ *                2. 质量：输入 1kHz 正弦波，快速路径输出相对 swr 输出的 THD+N(两者对齐后的差值能量 / 信号能量)，
+ *                   以及两者各自的 THD+N(去掉拟合出的 1kHz 正弦后剩余的能量 / 信号能量)。
+ *                   输入循环使用时接缝处的正弦不连续，质量只统计第一次接缝之前的输出。
+ *                快速路径相对 swr 的 THD+N 高于 -70dB 时输出 FAIL 并返回非0。
+ *
+ *                用法: 09_02_fixed_resample_bench [帧数]，默认 2000 帧
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "libavutil/time.h"
+#include "libavutil/channel_layout.h"
+#include "audioresampler.h"
+
+#define FRAME_SAMPLES 1024
+#define TONE_HZ 1000.0
+#define TONE_AMP 0.5
+#define MAX_LAG 8               // 对齐两个输出时搜索的最大偏移
+#define SKIP_SAMPLES 256        // 计算质量时跳过开头和结尾，避开滤波器的建立、flush 和输入循环的接缝
+#define QUALITY_SECONDS 2       // 只保存前几秒的输出用来计算质量
+#define MAX_THDN_VS_SWR -70.0
+
+typedef struct rate_case {
+    int src_rate;
+    int dst_rate;
+} rate_case_t;
+
+static const rate_case_t rates[] = {
+    {44100, 48000},
+    {48000, 44100},
+    {48000, 16000},
+    {8000, 48000},
+};
+
+static const enum AVSampleFormat formats[] = {
+    AV_SAMPLE_FMT_FLTP,
+    AV_SAMPLE_FMT_S16,
+};
+
+// 第0通道的输出，转成 double 保存
+typedef struct capture {
+    double *samples;
+    int capacity;
+    int nb_samples;
+} capture_t;
+
+static void capture_frame(capture_t *cap, const AVFrame *frame)
+{
+    int n = FFMIN(frame->nb_samples, cap->capacity - cap->nb_samples);
+    for (int i = 0; i < n; i++) {
+        double v = frame->format == AV_SAMPLE_FMT_S16
+                ? ((const int16_t *)frame->data[0])[i * frame->channels] / 32768.0
+                : ((const float *)frame->data[0])[i];
+        cap->samples[cap->nb_samples++] = v;
+    }
+}
+
+// 输入：两个通道同一个正弦波，第1通道幅度减半
+static int fill_input(uint8_t **in_data, enum AVSampleFormat fmt, int nb_samples, int rate)
+{
+    if (av_samples_alloc(in_data, NULL, 2, nb_samples, fmt, 0) < 0) {
+        return AVERROR(ENOMEM);
+    }
+    for (int i = 0; i < nb_samples; i++) {
+        double v = TONE_AMP * sin(2 * M_PI * TONE_HZ * i / rate);
+        if (fmt == AV_SAMPLE_FMT_S16) {
+            int16_t *p = (int16_t *)in_data[0];
+            p[2 * i] = (int16_t)lrint(v * 32767);
+            p[2 * i + 1] = (int16_t)lrint(v * 0.5 * 32767);
+        } else {
+            ((float *)in_data[0])[i] = (float)v;
+            ((float *)in_data[1])[i] = (float)(v * 0.5);
+        }
+    }
+    return 0;
+}
+
+// 连续送入 nb_frames 帧(每帧都是输入缓存中对应的一段，超出部分循环使用)，返回耗时(us)，失败返回 -1
+static int64_t run(const rate_case_t *rate, enum AVSampleFormat fmt, int flags, uint8_t **in_data,
+                   int in_samples, int nb_frames, capture_t *cap, int *is_fast)
+{
+    audio_resampler_params_t params;
+    params.src_sample_fmt = fmt;
+    params.src_sample_rate = rate->src_rate;
+    params.src_channel_layout = AV_CH_LAYOUT_STEREO;
+    params.dst_sample_fmt = fmt;
+    params.dst_sample_rate = rate->dst_rate;
+    params.dst_channel_layout = AV_CH_LAYOUT_STEREO;
+    audio_resampler_t *resampler = audio_resampler_alloc2(params, 0, flags);
+    AVFrame *out = av_frame_alloc();
+    if (!resampler || !out) {
+        printf("alloc resampler failed\n");
+        audio_resampler_free(resampler);
+        av_frame_free(&out);
+        return -1;
+    }
+    *is_fast = resampler->fixed != NULL;
+    const int planar = av_sample_fmt_is_planar(fmt);
+    const int bps = av_get_bytes_per_sample(fmt);
+    const int nb_chunks = in_samples / FRAME_SAMPLES;
+    int64_t elapsed = -1;
+    int64_t start = av_gettime_relative();
+    for (int i = 0; i <= nb_frames; i++) {
+        // 最后一次 flush
+        uint8_t *src[2] = {NULL, NULL};
+        int offset = (i % nb_chunks) * FRAME_SAMPLES;
+        src[0] = in_data[0] + (size_t)offset * bps * (planar ? 1 : 2);
+        if (planar)
+            src[1] = in_data[1] + (size_t)offset * bps;
+        int ret = audio_resampler_send_frame2(resampler, i < nb_frames ? src : NULL, FRAME_SAMPLES,
+                                              (int64_t)i * FRAME_SAMPLES);
+        if (ret < 0) {
+            printf("audio_resampler_send_frame2 failed:%d\n", ret);
+            goto end;
+        }
+        while (audio_resampler_receive_frame_into(resampler, out, FRAME_SAMPLES) > 0)
+            capture_frame(cap, out);
+    }
+    if (audio_resampler_receive_frame_into(resampler, out, 0) > 0)   // 不足一帧的剩余采样
+        capture_frame(cap, out);
+    elapsed = av_gettime_relative() - start;
+end:
+    av_frame_free(&out);
+    audio_resampler_free(resampler);
+    return elapsed;
+}
+
+// 去掉最小二乘拟合出的 TONE_HZ 正弦后剩余能量相对信号能量(dB)，统计 [SKIP_SAMPLES, end)
+static double thdn_vs_tone(const capture_t *cap, int rate, int end)
+{
+    int begin = SKIP_SAMPLES;
+    double ss = 0, cc = 0, sc = 0, xs = 0, xc = 0;
+    for (int j = begin; j < end; j++) {
+        double s = sin(2 * M_PI * TONE_HZ * j / rate), c = cos(2 * M_PI * TONE_HZ * j / rate);
+        ss += s * s;
+        cc += c * c;
+        sc += s * c;
+        xs += cap->samples[j] * s;
+        xc += cap->samples[j] * c;
+    }
+    double det = ss * cc - sc * sc;
+    double a = (xs * cc - xc * sc) / det, b = (xc * ss - xs * sc) / det;
+    double sig = 0, noise = 0;
+    for (int j = begin; j < end; j++) {
+        double fit = a * sin(2 * M_PI * TONE_HZ * j / rate) + b * cos(2 * M_PI * TONE_HZ * j / rate);
+        sig += fit * fit;
+        noise += (cap->samples[j] - fit) * (cap->samples[j] - fit);
+    }
+    return 10 * log10(noise / sig + 1e-30);
+}
+
+// x 相对参考 ref 的差值能量 / ref 的能量(dB)，在 ±MAX_LAG 内找差值最小的对齐位置，统计 [SKIP_SAMPLES, end)
+static double thdn_vs_ref(const capture_t *x, const capture_t *ref, int end, int *best_lag)
+{
+    double best = 1e300;
+    for (int lag = -MAX_LAG; lag <= MAX_LAG; lag++) {
+        double sig = 0, noise = 0;
+        for (int j = SKIP_SAMPLES; j < end; j++) {
+            double r = ref->samples[j + lag];
+            sig += r * r;
+            noise += (x->samples[j] - r) * (x->samples[j] - r);
+        }
+        double db = 10 * log10(noise / sig + 1e-30);
+        if (db < best) {
+            best = db;
+            *best_lag = lag;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    int nb_frames = argc > 1 ? atoi(argv[1]) : 2000;
+    if (nb_frames <= 0) {
+        printf("invalid frames\n");
+        return -1;
+    }
+    int failed = 0;
+    printf("fixed resampler simd: %s, %d frames of %d samples, stereo\n", fixed_resampler_simd_name(),
+           nb_frames, FRAME_SAMPLES);
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+        const rate_case_t *rate = &rates[r];
+        for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+            enum AVSampleFormat fmt = formats[f];
+            // 输入 QUALITY_SECONDS 秒的正弦波，帧数更多时循环使用(只影响速度测试，质量只看前几秒)
+            int in_samples = rate->src_rate * QUALITY_SECONDS / FRAME_SAMPLES * FRAME_SAMPLES;
+            uint8_t *in_data[2] = {NULL, NULL};
+            capture_t fast = {0}, swr = {0};
+            fast.capacity = swr.capacity = rate->dst_rate * QUALITY_SECONDS;
+            fast.samples = (double *)av_malloc(sizeof(double) * fast.capacity);
+            swr.samples = (double *)av_malloc(sizeof(double) * swr.capacity);
+            if (!fast.samples || !swr.samples || fill_input(in_data, fmt, in_samples, rate->src_rate) < 0) {
+                printf("alloc buffers failed\n");
+                av_free(fast.samples);
+                av_free(swr.samples);
+                return -1;
+            }
+            int is_fast = 0, is_swr_fast = 0;
+            int64_t swr_us = run(rate, fmt, AUDIO_RESAMPLER_FLAG_NO_FAST_PATH, in_data, in_samples,
+                                 nb_frames, &swr, &is_swr_fast);
+            int64_t fast_us = run(rate, fmt, 0, in_data, in_samples, nb_frames, &fast, &is_fast);
+            if (swr_us > 0 && fast_us > 0) {
+                // 输入第一次回到开头的位置(输出采样)，前后 SKIP_SAMPLES 内受接缝影响，
+                // 没有循环时就是输出的结尾(flush)
+                int wrap = (int)((int64_t)in_samples * rate->dst_rate / rate->src_rate);
+                int end = FFMIN(wrap, FFMIN(fast.nb_samples, swr.nb_samples)) - SKIP_SAMPLES;
+                int lag = 0;
+                double vs_swr = thdn_vs_ref(&fast, &swr, end, &lag);
+                int ok = is_fast && lag == 0 && vs_swr < MAX_THDN_VS_SWR;
+                failed |= !ok;
+                printf("%5d -> %5d %-4s | swr %7.1f us/frame | fast %7.1f us/frame | x%.2f"
+                       " | thd+n fast vs swr %6.1f dB (lag %d) | fast %6.1f dB swr %6.1f dB | %s\n",
+                       rate->src_rate, rate->dst_rate, av_get_sample_fmt_name(fmt),
+                       swr_us / (double)nb_frames, fast_us / (double)nb_frames,
+                       (double)swr_us / fast_us, vs_swr, lag, thdn_vs_tone(&fast, rate->dst_rate, end),
+                       thdn_vs_tone(&swr, rate->dst_rate, end), ok ? "PASS" : "FAIL");
+            } else {
+                failed = 1;
+            }
+            av_freep(&in_data[0]);
+            av_free(fast.samples);
+            av_free(swr.samples);
+        }
+    }
+    return failed ? 1 : 0;
+}
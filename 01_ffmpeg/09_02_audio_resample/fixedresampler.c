@@ -0,0 +1,437 @@
+#include "fixedresampler.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FIXED_RESAMPLER_AVX2 1      // 函数级 target 属性编译，运行时检测 CPU 后再用
+#endif
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FIXED_RESAMPLER_SSE 1
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FIXED_RESAMPLER_NEON 1
+#endif
+
+// 和 libswresample 的默认参数一致
+#define FILTER_SIZE 32
+#define CUTOFF 0.97
+#define KAISER_BETA 9.0
+#define TAPS_ALIGN 8        // 每个相位的系数补0到 8 的倍数，SIMD 不需要处理尾巴
+
+struct fixed_ratio {
+    int src_rate;
+    int dst_rate;
+    int up;                 // L
+    int down;               // M
+    int taps;               // 每个相位的抽头数(已补齐)
+    int center;             // 第 i 个系数乘的是输入 x[n - center + i]
+    float *coefs;           // [up][taps]
+};
+
+static fixed_ratio_t s_ratios[] = {
+    {.src_rate = 44100, .dst_rate = 48000},
+    {.src_rate = 48000, .dst_rate = 44100},
+    {.src_rate = 48000, .dst_rate = 16000},
+    {.src_rate = 8000, .dst_rate = 48000},
+};
+#define NB_RATIOS ((int)(sizeof(s_ratios) / sizeof(s_ratios[0])))
+
+typedef float (*dot_func)(const float *coefs, const float *x, int taps);
+static dot_func s_dot;
+static const char *s_dot_name = "c";
+static pthread_once_t s_once = PTHREAD_ONCE_INIT;
+static int s_init_ret = 0;
+
+// ===== 点积 =====
+
+static float dot_c(const float *coefs, const float *x, int taps)
+{
+    float sum = 0;
+    for (int i = 0; i < taps; i++)
+        sum += coefs[i] * x[i];
+    return sum;
+}
+
+#if FIXED_RESAMPLER_AVX2
+__attribute__((target("avx2,fma")))
+static float dot_avx2(const float *coefs, const float *x, int taps)
+{
+    __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= taps; i += 16) {
+        a0 = _mm256_fmadd_ps(_mm256_load_ps(coefs + i), _mm256_loadu_ps(x + i), a0);
+        a1 = _mm256_fmadd_ps(_mm256_load_ps(coefs + i + 8), _mm256_loadu_ps(x + i + 8), a1);
+    }
+    if (i < taps)   // taps 是 8 的倍数，最多剩 8 个
+        a0 = _mm256_fmadd_ps(_mm256_load_ps(coefs + i), _mm256_loadu_ps(x + i), a0);
+    a0 = _mm256_add_ps(a0, a1);
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(a0), _mm256_extractf128_ps(a0, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+#endif
+
+#if FIXED_RESAMPLER_SSE
+static float dot_sse(const float *coefs, const float *x, int taps)
+{
+    __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps();
+    for (int i = 0; i < taps; i += 8) {
+        a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_load_ps(coefs + i), _mm_loadu_ps(x + i)));
+        a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_load_ps(coefs + i + 4), _mm_loadu_ps(x + i + 4)));
+    }
+    a0 = _mm_add_ps(a0, a1);
+    a0 = _mm_add_ps(a0, _mm_movehl_ps(a0, a0));
+    a0 = _mm_add_ss(a0, _mm_shuffle_ps(a0, a0, 1));
+    return _mm_cvtss_f32(a0);
+}
+#endif
+
+#if FIXED_RESAMPLER_NEON
+static float dot_neon(const float *coefs, const float *x, int taps)
+{
+    float32x4_t a0 = vdupq_n_f32(0), a1 = vdupq_n_f32(0);
+    for (int i = 0; i < taps; i += 8) {
+        a0 = vmlaq_f32(a0, vld1q_f32(coefs + i), vld1q_f32(x + i));
+        a1 = vmlaq_f32(a1, vld1q_f32(coefs + i + 4), vld1q_f32(x + i + 4));
+    }
+    a0 = vaddq_f32(a0, a1);
+    float32x2_t s = vadd_f32(vget_low_f32(a0), vget_high_f32(a0));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+#endif
+
+// ===== 系数表 =====
+
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 50; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+// 同 libswresample build_filter：相位 ph 的第 i 个系数对应输入相对输出时刻的偏移 i - center - ph / up
+static int build_filter(fixed_ratio_t *ratio)
+{
+    int64_t g = av_gcd(ratio->src_rate, ratio->dst_rate);
+    ratio->up = (int)(ratio->dst_rate / g);
+    ratio->down = (int)(ratio->src_rate / g);
+    double factor = FFMIN(ratio->dst_rate * CUTOFF / ratio->src_rate, 1.0);
+    int tap_count = FFMAX((int)ceil(FILTER_SIZE / factor), 1);   // 下采样时滤波器按比例变长
+    ratio->center = (tap_count - 1) / 2;
+    ratio->taps = FFALIGN(tap_count, TAPS_ALIGN);
+    ratio->coefs = (float *)av_mallocz(sizeof(float) * ratio->up * ratio->taps);
+    double *tab = (double *)av_malloc(sizeof(double) * tap_count);
+    if (!ratio->coefs || !tab) {
+        av_free(tab);
+        return AVERROR(ENOMEM);
+    }
+    for (int ph = 0; ph < ratio->up; ph++) {
+        double norm = 0;
+        for (int i = 0; i < tap_count; i++) {
+            double t = (double)(i - ratio->center) - (double)ph / ratio->up;
+            double x = M_PI * t * factor;
+            double y = x == 0 ? 1.0 : sin(x) / x;
+            double w = 2.0 * t / tap_count;
+            y *= bessel_i0(KAISER_BETA * sqrt(FFMAX(1 - w * w, 0)));
+            tab[i] = y;
+            norm += y;
+        }
+        // 归一化，直流增益为1
+        for (int i = 0; i < tap_count; i++)
+            ratio->coefs[ph * ratio->taps + i] = (float)(tab[i] / norm);
+    }
+    av_free(tab);
+    return 0;
+}
+
+static void init_tables(void)
+{
+    s_dot = dot_c;
+#if FIXED_RESAMPLER_SSE
+    s_dot = dot_sse;
+    s_dot_name = "sse";
+#elif FIXED_RESAMPLER_NEON
+    s_dot = dot_neon;
+    s_dot_name = "neon";
+#endif
+#if FIXED_RESAMPLER_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        s_dot = dot_avx2;
+        s_dot_name = "avx2-fma";
+    }
+#endif
+    for (int i = 0; i < NB_RATIOS; i++) {
+        if ((s_init_ret = build_filter(&s_ratios[i])) < 0)
+            return;
+    }
+}
+
+static const fixed_ratio_t *find_ratio(int src_rate, int dst_rate)
+{
+    for (int i = 0; i < NB_RATIOS; i++) {
+        if (s_ratios[i].src_rate == src_rate && s_ratios[i].dst_rate == dst_rate)
+            return &s_ratios[i];
+    }
+    return NULL;
+}
+
+static int format_supported(enum AVSampleFormat fmt)
+{
+    return fmt == AV_SAMPLE_FMT_S16 || fmt == AV_SAMPLE_FMT_S16P || fmt == AV_SAMPLE_FMT_FLT ||
+           fmt == AV_SAMPLE_FMT_FLTP;
+}
+
+int fixed_resampler_supported(int src_rate, int dst_rate, enum AVSampleFormat src_fmt,
+                              enum AVSampleFormat dst_fmt)
+{
+    return find_ratio(src_rate, dst_rate) && format_supported(src_fmt) && format_supported(dst_fmt);
+}
+
+const char *fixed_resampler_simd_name(void)
+{
+    pthread_once(&s_once, init_tables);
+    return s_dot_name;
+}
+
+// ===== 重采样 =====
+
+fixed_resampler_t *fixed_resampler_alloc(int src_rate, int dst_rate, int channels,
+                                         enum AVSampleFormat src_fmt, enum AVSampleFormat dst_fmt)
+{
+    if (!fixed_resampler_supported(src_rate, dst_rate, src_fmt, dst_fmt) || channels <= 0) {
+        return NULL;
+    }
+    pthread_once(&s_once, init_tables);
+    if (s_init_ret < 0) {
+        printf("fixed resampler: build filter failed\n");
+        return NULL;
+    }
+    fixed_resampler_t *r = (fixed_resampler_t *)av_mallocz(sizeof(fixed_resampler_t));
+    if (!r) {
+        return NULL;
+    }
+    r->ratio = find_ratio(src_rate, dst_rate);
+    r->channels = channels;
+    r->src_fmt = src_fmt;
+    r->dst_fmt = dst_fmt;
+    // 开头补 center 个0，第一个输出对应输入时刻 0
+    r->buf_capacity = FFALIGN(r->ratio->taps + 2048, 16);
+    r->buf = (float *)av_mallocz(sizeof(float) * r->buf_capacity * channels);
+    if (!r->buf) {
+        av_free(r);
+        return NULL;
+    }
+    r->buf_len = r->ratio->center;
+    r->buf_start = -r->ratio->center;
+    return r;
+}
+
+void fixed_resampler_free(fixed_resampler_t *r)
+{
+    if (!r) {
+        return;
+    }
+    av_free(r->buf);
+    av_free(r->tmp);
+    av_free(r);
+}
+
+// 缓存到输入位置 last 为止时，最后一个可以计算的输出序号
+static int64_t last_out_index(const fixed_resampler_t *r, int64_t last, int64_t nb_in, int flush)
+{
+    const fixed_ratio_t *ratio = r->ratio;
+    // 输出 j 的中心输入 n = floor(j * M / L)，需要 x[n - center + taps - 1]
+    int64_t n_max = last - (ratio->taps - 1 - ratio->center);
+    int64_t j_max = n_max < 0 ? -1 : ((n_max + 1) * ratio->up - 1) / ratio->down;
+    if (flush) {
+        // flush 后总输出为 ceil(nb_in * L / M)，和 swr 一样
+        int64_t total = (nb_in * ratio->up + ratio->down - 1) / ratio->down;
+        j_max = FFMIN(j_max, total - 1);
+    }
+    return j_max;
+}
+
+int fixed_resampler_get_out_samples(fixed_resampler_t *r, int nb_in, int flush)
+{
+    int64_t last = r->buf_start + r->buf_len - 1;
+    int64_t total_in = r->nb_in;
+    if (flush) {
+        if (!r->flushed)
+            last += r->ratio->taps;     // flush 时补0
+    } else {
+        last += nb_in;
+        total_in += nb_in;
+    }
+    int64_t count = last_out_index(r, last, total_in, flush || r->flushed) - r->nb_out + 1;
+    return count > 0 ? (int)FFMIN(count, INT32_MAX) : 0;
+}
+
+static int reserve_buf(fixed_resampler_t *r, int nb_samples)
+{
+    if (r->buf_len + nb_samples <= r->buf_capacity) {
+        return 0;
+    }
+    int capacity = FFALIGN(r->buf_len + nb_samples + r->buf_len / 2, 16);
+    float *buf = (float *)av_malloc(sizeof(float) * capacity * r->channels);
+    if (!buf) {
+        return AVERROR(ENOMEM);
+    }
+    for (int c = 0; c < r->channels; c++)
+        memcpy(buf + (size_t)c * capacity, r->buf + (size_t)c * r->buf_capacity, sizeof(float) * r->buf_len);
+    av_free(r->buf);
+    r->buf = buf;
+    r->buf_capacity = capacity;
+    r->nb_allocs++;
+    return 0;
+}
+
+// 输入转换成 float 平面追加到缓存，in 为 NULL 时追加0
+static void append_input(fixed_resampler_t *r, const uint8_t **in, int nb_in)
+{
+    const int ch = r->channels;
+    for (int c = 0; c < ch; c++) {
+        float *dst = r->buf + (size_t)c * r->buf_capacity + r->buf_len;
+        if (!in) {
+            memset(dst, 0, sizeof(float) * nb_in);
+            continue;
+        }
+        switch (r->src_fmt) {
+        case AV_SAMPLE_FMT_FLTP:
+            memcpy(dst, in[c], sizeof(float) * nb_in);
+            break;
+        case AV_SAMPLE_FMT_FLT: {
+            const float *src = (const float *)in[0] + c;
+            for (int i = 0; i < nb_in; i++)
+                dst[i] = src[i * ch];
+            break;
+        }
+        case AV_SAMPLE_FMT_S16P: {
+            const int16_t *src = (const int16_t *)in[c];
+            for (int i = 0; i < nb_in; i++)
+                dst[i] = src[i] * (1.0f / (1 << 15));
+            break;
+        }
+        default: {  // AV_SAMPLE_FMT_S16
+            const int16_t *src = (const int16_t *)in[0] + c;
+            for (int i = 0; i < nb_in; i++)
+                dst[i] = src[i * ch] * (1.0f / (1 << 15));
+            break;
+        }
+        }
+    }
+    r->buf_len += nb_in;
+}
+
+// 一个通道的 float 输出写成输出格式，float 转 S16 和 swr 一样四舍五入并饱和
+static void store_output(fixed_resampler_t *r, uint8_t **out, int c, const float *src, int count)
+{
+    const int ch = r->channels;
+    switch (r->dst_fmt) {
+    case AV_SAMPLE_FMT_FLTP:
+        memcpy(out[c], src, sizeof(float) * count);
+        break;
+    case AV_SAMPLE_FMT_FLT: {
+        float *dst = (float *)out[0] + c;
+        for (int i = 0; i < count; i++)
+            dst[i * ch] = src[i];
+        break;
+    }
+    case AV_SAMPLE_FMT_S16P: {
+        int16_t *dst = (int16_t *)out[c];
+        for (int i = 0; i < count; i++)
+            dst[i] = av_clip_int16(lrintf(src[i] * (1 << 15)));
+        break;
+    }
+    default: {  // AV_SAMPLE_FMT_S16
+        int16_t *dst = (int16_t *)out[0] + c;
+        for (int i = 0; i < count; i++)
+            dst[i * ch] = av_clip_int16(lrintf(src[i] * (1 << 15)));
+        break;
+    }
+    }
+}
+
+int fixed_resampler_convert(fixed_resampler_t *r, uint8_t **out, int out_count, const uint8_t **in,
+                            int nb_in)
+{
+    const fixed_ratio_t *ratio = r->ratio;
+    int ret = 0;
+    if (in) {
+        if (r->flushed) {
+            return AVERROR(EINVAL);
+        }
+        if ((ret = reserve_buf(r, nb_in)) < 0)
+            return ret;
+        append_input(r, in, nb_in);
+        r->nb_in += nb_in;
+    } else if (!r->flushed) {
+        // 最后一个输入之后补0，让最后几个输出的滤波器窗口完整
+        if ((ret = reserve_buf(r, ratio->taps)) < 0)
+            return ret;
+        append_input(r, NULL, ratio->taps);
+        r->flushed = 1;
+    }
+
+    int64_t last = r->buf_start + r->buf_len - 1;
+    int64_t count = last_out_index(r, last, r->nb_in, r->flushed) - r->nb_out + 1;
+    count = FFMIN(FFMAX(count, 0), out_count);
+    if (count > r->tmp_capacity) {
+        av_freep(&r->tmp);
+        r->tmp = (float *)av_malloc(sizeof(float) * count);
+        if (!r->tmp) {
+            r->tmp_capacity = 0;
+            return AVERROR(ENOMEM);
+        }
+        r->tmp_capacity = (int)count;
+        r->nb_allocs++;
+    }
+
+    // 第一个输出的中心输入和相位
+    int64_t pos = r->nb_out * ratio->down;
+    int64_t n0 = pos / ratio->up;
+    int p0 = (int)(pos % ratio->up);
+    int64_t n = n0;
+    for (int c = 0; c < r->channels; c++) {
+        const float *x = r->buf + (size_t)c * r->buf_capacity - r->buf_start - ratio->center;
+        n = n0;
+        int p = p0;
+        for (int k = 0; k < count; k++) {
+            r->tmp[k] = s_dot(ratio->coefs + p * ratio->taps, x + n, ratio->taps);
+            p += ratio->down;
+            n += p / ratio->up;
+            p %= ratio->up;
+        }
+        store_output(r, out, c, r->tmp, (int)count);
+    }
+    r->nb_out += count;
+
+    // 丢掉以后用不到的输入：下一个输出从 x[n - center] 开始
+    int64_t drop = n - ratio->center - r->buf_start;
+    if (drop > 0) {
+        drop = FFMIN(drop, r->buf_len);
+        r->buf_len -= (int)drop;
+        for (int c = 0; c < r->channels; c++) {
+            float *plane = r->buf + (size_t)c * r->buf_capacity;
+            memmove(plane, plane + drop, sizeof(float) * r->buf_len);
+        }
+        r->buf_start += drop;
+    }
+    return (int)count;
+}
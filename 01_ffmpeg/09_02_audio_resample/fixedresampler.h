@@ -0,0 +1,87 @@
+#ifndef FIXEDRESAMPLER_H
+#define FIXEDRESAMPLER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "libavutil/samplefmt.h"
+
+/**
+* 常用采样率的定比多相 FIR 重采样，audio_resampler_t 的快速路径：
+* (1) 只支持 44100<->48000、48000->16000、8000->48000，其他情况由 audio_resampler_t 使用 swresample;
+* (2) 滤波器和 swresample 默认参数的设计方法相同(Kaiser 窗 sinc，filter_size 32，cutoff 0.97，beta 9，
+*     精确有理数相位)，输出时刻也和 swr 对齐，可以直接和 swr 的输出比较误差;
+* (3) 各比例的系数表在第一次使用时生成一次，所有实例共享(C 里没有编译期计算，这是最接近的做法);
+* (4) 内层是每个输出点一次定长点积，x86 上运行时检测到 AVX2+FMA 时使用 AVX2 FMA，否则 SSE/NEON/标量;
+* (5) 输出采样数由相位直接算出，不需要每次调用 swr_get_delay + av_rescale_rnd。
+* 内部按 float 平面格式计算，输入输出支持 S16/S16P/FLT/FLTP。
+*/
+
+typedef struct fixed_ratio fixed_ratio_t;
+
+typedef struct fixed_resampler {
+    const fixed_ratio_t *ratio;
+    int channels;
+    enum AVSampleFormat src_fmt;
+    enum AVSampleFormat dst_fmt;
+    float *buf;                 // 每个通道 buf_capacity 个 float，缓存还要用到的输入
+    int buf_capacity;
+    int buf_len;                // 每个通道缓存的采样点数
+    int64_t buf_start;          // buf 第一个采样在输入中的位置(开始时补了 center 个0，所以是负数)
+    float *tmp;                 // 一个通道的输出，转换成输出格式前的 float
+    int tmp_capacity;
+    int64_t nb_in;              // 输入的采样点总数
+    int64_t nb_out;             // 输出的采样点总数，也是下一个输出的序号
+    int flushed;
+    int64_t nb_allocs;          // 缓存扩容次数
+} fixed_resampler_t;
+
+/**
+ * @brief 是否支持这个采样率和格式组合
+ */
+int fixed_resampler_supported(int src_rate, int dst_rate, enum AVSampleFormat src_fmt,
+                              enum AVSampleFormat dst_fmt);
+
+/**
+ * @brief 分配
+ * @return 不支持或失败返回NULL
+ */
+fixed_resampler_t *fixed_resampler_alloc(int src_rate, int dst_rate, int channels,
+                                         enum AVSampleFormat src_fmt, enum AVSampleFormat dst_fmt);
+
+/**
+ * @brief 释放
+ */
+void fixed_resampler_free(fixed_resampler_t *r);
+
+/**
+ * @brief 下一次 fixed_resampler_convert 输入 nb_in 个采样点(in 为 NULL 时是 flush)会输出的采样点数，不改变状态
+ */
+int fixed_resampler_get_out_samples(fixed_resampler_t *r, int nb_in, int flush);
+
+/**
+ * @brief 重采样，用法同 swr_convert：in 为 NULL 时 flush
+ * @param r
+ * @param out 输出各平面，容量 out_count
+ * @param out_count 不小于 fixed_resampler_get_out_samples 时输出全部，否则剩下的留到下一次
+ * @param in 输入各平面
+ * @param nb_in
+ * @return 输出的采样点数，失败返回负数
+ */
+int fixed_resampler_convert(fixed_resampler_t *r, uint8_t **out, int out_count, const uint8_t **in,
+                            int nb_in);
+
+/**
+ * @brief 当前使用的点积实现：avx2-fma/sse/neon/c
+ */
+const char *fixed_resampler_simd_name(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FIXEDRESAMPLER_H
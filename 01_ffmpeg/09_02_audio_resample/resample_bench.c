@@ -0,0 +1,394 @@
+/**
+ * @brief         audio_resampler_t 分配次数和耗时对比，每帧 1024 个采样点
+ *                1. legacy：每帧分配临时 AVFrame 包装输入(原 send_frame3 的写法)，
+ *                   audio_resampler_receive_frame 每个输出帧 av_frame_alloc + av_frame_get_buffer;
+ *                2. into：audio_resampler_send_frame3 原地构造通道指针，
+ *                   audio_resampler_receive_frame_into 循环写入同一个帧;
+ *                3. pooled：audio_resampler_receive_pooled_frame 取帧，用完 audio_resampler_recycle_frame。
+ *                预热若干帧之后统计稳态的分配次数：重采样器内部的计数，以及 glibc 下替换 malloc 系列函数
+ *                统计的整个进程的堆分配次数。into/pooled 稳态有分配时输出 FAIL 并返回非0，可以直接当测试运行。
+ *                另外对比 AVAudioFifo 和 audio_ring 的读写耗时(fifo 中缓存的数据越多，AVAudioFifo 读时 memmove 越多)，
+ *                以及 SPSC 模式下一个线程 send、另一个线程 receive 的输出和单线程逐字节一致。
+ *
+ *                用法: 09_02_resample_bench [帧数]，默认 20000 帧
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#include "libavutil/time.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/audio_fifo.h"
+#include "audioresampler.h"
+
+#define FRAME_SAMPLES 1024
+#define WARMUP_FRAMES 64
+
+#if defined(__GLIBC__) && !defined(_WIN32)
+/**
+ * 替换 malloc 系列函数统计堆分配次数。可执行文件中定义的符号优先于 libc，
+ * FFmpeg 动态库里的 av_malloc(posix_memalign) 也会调用到这里
+ */
+#    define HAVE_MALLOC_COUNT 1
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+static volatile long long s_malloc_count = 0;
+
+void *malloc(size_t size)
+{
+    s_malloc_count++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    s_malloc_count++;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    s_malloc_count++;
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    s_malloc_count++;
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    s_malloc_count++;
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    s_malloc_count++;
+    void *p = __libc_memalign(alignment, size);
+    if (!p)
+        return ENOMEM;
+    *ptr = p;
+    return 0;
+}
+
+static long long malloc_count(void)
+{
+    return s_malloc_count;
+}
+#else
+#    define HAVE_MALLOC_COUNT 0
+static long long malloc_count(void)
+{
+    return 0;
+}
+#endif
+
+enum { PATH_LEGACY = 0, PATH_INTO, PATH_POOLED, PATH_NB };
+static const char *path_names[PATH_NB] = {"legacy", "into", "pooled"};
+
+typedef struct bench_config {
+    enum AVSampleFormat src_fmt;
+    int src_rate;
+    enum AVSampleFormat dst_fmt;
+    int dst_rate;
+} bench_config_t;
+
+static const bench_config_t configs[] = {
+    {AV_SAMPLE_FMT_S16, 44100, AV_SAMPLE_FMT_FLTP, 48000},
+    {AV_SAMPLE_FMT_S16, 48000, AV_SAMPLE_FMT_FLTP, 44100},
+    {AV_SAMPLE_FMT_S16, 48000, AV_SAMPLE_FMT_FLTP, 48000},  // 只做格式转换
+    {AV_SAMPLE_FMT_S16, 48000, AV_SAMPLE_FMT_S16, 48000},   // 只用 fifo
+};
+
+// 原 audio_resampler_send_frame3 的写法：每帧分配一个临时 AVFrame 包装输入
+static void send_legacy(audio_resampler_t *r, uint8_t *in_data, int in_bytes, int64_t pts)
+{
+    AVFrame *frame = av_frame_alloc();
+    frame->format = r->resampler_params.src_sample_fmt;
+    frame->channel_layout = r->resampler_params.src_channel_layout;
+    frame->nb_samples = in_bytes / av_get_bytes_per_sample(r->resampler_params.src_sample_fmt) /
+                        r->src_channels;
+    avcodec_fill_audio_frame(frame, r->src_channels, r->resampler_params.src_sample_fmt, in_data,
+                             in_bytes, 0);
+    frame->pts = pts;
+    audio_resampler_send_frame(r, frame);
+    av_frame_free(&frame);
+}
+
+// 处理一帧输入，返回取出的输出帧数
+static int run_frame(audio_resampler_t *r, int path, uint8_t *in_data, int in_bytes, int64_t pts,
+                     AVFrame *out)
+{
+    int nb_out = 0;
+    if (path == PATH_LEGACY) {
+        send_legacy(r, in_data, in_bytes, pts);
+        AVFrame *frame;
+        while ((frame = audio_resampler_receive_frame(r, FRAME_SAMPLES)) != NULL) {
+            av_frame_free(&frame);
+            nb_out++;
+        }
+    } else if (path == PATH_INTO) {
+        audio_resampler_send_frame3(r, in_data, in_bytes, pts);
+        while (audio_resampler_receive_frame_into(r, out, FRAME_SAMPLES) > 0)
+            nb_out++;
+    } else {
+        audio_resampler_send_frame3(r, in_data, in_bytes, pts);
+        AVFrame *frame;
+        while ((frame = audio_resampler_receive_pooled_frame(r, FRAME_SAMPLES)) != NULL) {
+            audio_resampler_recycle_frame(r, frame);
+            nb_out++;
+        }
+    }
+    return nb_out;
+}
+
+// 返回稳态的分配次数(重采样器计数 + 进程计数)
+static long long bench(const bench_config_t *cfg, int path, uint8_t *in_data, int in_bytes,
+                       int nb_frames)
+{
+    audio_resampler_params_t params;
+    params.src_sample_fmt = cfg->src_fmt;
+    params.src_sample_rate = cfg->src_rate;
+    params.src_channel_layout = AV_CH_LAYOUT_STEREO;
+    params.dst_sample_fmt = cfg->dst_fmt;
+    params.dst_sample_rate = cfg->dst_rate;
+    params.dst_channel_layout = AV_CH_LAYOUT_STEREO;
+    audio_resampler_t *r = audio_resampler_alloc(params);
+    AVFrame *out = av_frame_alloc();
+    if (!r || !out) {
+        printf("alloc resampler failed\n");
+        audio_resampler_free(r);
+        av_frame_free(&out);
+        return -1;
+    }
+
+    int64_t pts = 0;
+    for (int i = 0; i < WARMUP_FRAMES; i++, pts += FRAME_SAMPLES)
+        run_frame(r, path, in_data, in_bytes, pts, out);
+
+    long long resampler_allocs = audio_resampler_get_alloc_count(r);
+    long long process_allocs = malloc_count();
+    int64_t nb_out = 0;
+    int64_t start = av_gettime_relative();
+    for (int i = 0; i < nb_frames; i++, pts += FRAME_SAMPLES)
+        nb_out += run_frame(r, path, in_data, in_bytes, pts, out);
+    int64_t elapsed = av_gettime_relative() - start;
+    process_allocs = malloc_count() - process_allocs;
+    resampler_allocs = audio_resampler_get_alloc_count(r) - resampler_allocs;
+
+    printf("%s %5d -> %s %5d %-6s | %7.1f ns/frame | allocs/frame resampler:%.2f",
+           av_get_sample_fmt_name(cfg->src_fmt), cfg->src_rate,
+           av_get_sample_fmt_name(cfg->dst_fmt), cfg->dst_rate, path_names[path],
+           elapsed * 1000.0 / nb_frames, (double)resampler_allocs / nb_frames);
+    if (HAVE_MALLOC_COUNT)
+        printf(" process:%.2f", (double)process_allocs / nb_frames);
+    printf(" | out frames:%lld\n", (long long)nb_out);
+
+    av_frame_free(&out);
+    audio_resampler_free(r);
+    return resampler_allocs + process_allocs;
+}
+
+// fifo 中保持 backlog 个采样点，每次写入、读出一帧，对比 AVAudioFifo(和原来的重采样器一样初始容量为1) 和 audio_ring
+static void bench_fifo(int backlog, int nb_frames)
+{
+    static float planes[2][FRAME_SAMPLES];
+    uint8_t *data[2] = {(uint8_t *)planes[0], (uint8_t *)planes[1]};
+    AVAudioFifo *fifo = av_audio_fifo_alloc(AV_SAMPLE_FMT_FLTP, 2, 1);
+    audio_ring_t *ring = audio_ring_alloc(AV_SAMPLE_FMT_FLTP, 2, backlog + FRAME_SAMPLES, 0);
+    if (!fifo || !ring) {
+        printf("alloc fifo failed\n");
+        av_audio_fifo_free(fifo);
+        audio_ring_free(ring);
+        return;
+    }
+    for (int i = 0; i < backlog; i += FRAME_SAMPLES) {
+        av_audio_fifo_write(fifo, (void **)data, FRAME_SAMPLES);
+        audio_ring_write(ring, data, FRAME_SAMPLES);
+    }
+
+    int64_t start = av_gettime_relative();
+    for (int i = 0; i < nb_frames; i++) {
+        av_audio_fifo_write(fifo, (void **)data, FRAME_SAMPLES);
+        av_audio_fifo_read(fifo, (void **)data, FRAME_SAMPLES);
+    }
+    int64_t fifo_us = av_gettime_relative() - start;
+    start = av_gettime_relative();
+    for (int i = 0; i < nb_frames; i++) {
+        audio_ring_write(ring, data, FRAME_SAMPLES);
+        audio_ring_read(ring, data, FRAME_SAMPLES);
+    }
+    int64_t ring_us = av_gettime_relative() - start;
+    printf("fifo backlog %6d | AVAudioFifo %7.1f ns/frame | audio_ring %7.1f ns/frame\n", backlog,
+           fifo_us * 1000.0 / nb_frames, ring_us * 1000.0 / nb_frames);
+    av_audio_fifo_free(fifo);
+    audio_ring_free(ring);
+}
+
+typedef struct spsc_ctx {
+    audio_resampler_t *resampler;
+    uint8_t *in_data;
+    int in_bytes;
+    int nb_frames;
+    int64_t nb_eagain;          // fifo 满、生产者等待的次数
+    atomic_int done;
+} spsc_ctx_t;
+
+static uint64_t hash_frame(uint64_t h, const AVFrame *frame)
+{
+    int planar = av_sample_fmt_is_planar(frame->format);
+    int nb_planes = planar ? frame->channels : 1;
+    int size = frame->nb_samples * av_get_bytes_per_sample(frame->format) * (planar ? 1 : frame->channels);
+    for (int i = 0; i < nb_planes; i++) {
+        for (int j = 0; j < size; j++) {
+            h ^= frame->extended_data[i][j];
+            h *= 1099511628211ULL;  // FNV-1a
+        }
+    }
+    return h;
+}
+
+// 生产者线程：只调用 send，fifo 满时等消费者
+static void *spsc_producer(void *arg)
+{
+    spsc_ctx_t *ctx = (spsc_ctx_t *)arg;
+    int64_t pts = 0;
+    for (int i = 0; i <= ctx->nb_frames; i++, pts += FRAME_SAMPLES) {
+        uint8_t *in = i < ctx->nb_frames ? ctx->in_data : NULL;    // 最后 flush
+        int ret;
+        while ((ret = audio_resampler_send_frame3(ctx->resampler, in, ctx->in_bytes, pts)) == AVERROR(EAGAIN)) {
+            ctx->nb_eagain++;
+            sched_yield();
+        }
+        if (ret < 0)
+            break;
+    }
+    atomic_store_explicit(&ctx->done, 1, memory_order_release);
+    return NULL;
+}
+
+// 取出所有输出帧并计算哈希，threaded 为 1 时 send 在另一个线程
+static uint64_t run_spsc(const bench_config_t *cfg, int threaded, uint8_t *in_data, int in_bytes,
+                         int nb_frames)
+{
+    audio_resampler_params_t params;
+    params.src_sample_fmt = cfg->src_fmt;
+    params.src_sample_rate = cfg->src_rate;
+    params.src_channel_layout = AV_CH_LAYOUT_STEREO;
+    params.dst_sample_fmt = cfg->dst_fmt;
+    params.dst_sample_rate = cfg->dst_rate;
+    params.dst_channel_layout = AV_CH_LAYOUT_STEREO;
+    // 线程模式用很小的 fifo，让生产者经常等待、读写经常绕回
+    spsc_ctx_t ctx = {0};
+    ctx.resampler = audio_resampler_alloc2(params, threaded ? 4 * FRAME_SAMPLES : 0,
+                                           threaded ? AUDIO_RESAMPLER_FLAG_THREAD_SAFE : 0);
+    ctx.in_data = in_data;
+    ctx.in_bytes = in_bytes;
+    ctx.nb_frames = nb_frames;
+    atomic_init(&ctx.done, 0);
+    AVFrame *out = av_frame_alloc();
+    if (!ctx.resampler || !out) {
+        audio_resampler_free(ctx.resampler);
+        av_frame_free(&out);
+        return 0;
+    }
+
+    uint64_t h = 14695981039346656037ULL;
+    int64_t start = av_gettime_relative();
+    pthread_t tid;
+    if (threaded) {
+        pthread_create(&tid, NULL, spsc_producer, &ctx);
+        for (;;) {
+            int done = atomic_load_explicit(&ctx.done, memory_order_acquire);
+            int got = 0;
+            while (audio_resampler_receive_frame_into(ctx.resampler, out, FRAME_SAMPLES) > 0) {
+                h = hash_frame(h, out);
+                got = 1;
+            }
+            if (done)
+                break;
+            if (!got)
+                sched_yield();
+        }
+        pthread_join(tid, NULL);
+    } else {
+        int64_t pts = 0;
+        for (int i = 0; i <= nb_frames; i++, pts += FRAME_SAMPLES) {
+            audio_resampler_send_frame3(ctx.resampler, i < nb_frames ? in_data : NULL, in_bytes, pts);
+            while (audio_resampler_receive_frame_into(ctx.resampler, out, FRAME_SAMPLES) > 0)
+                h = hash_frame(h, out);
+        }
+    }
+    if (audio_resampler_receive_frame_into(ctx.resampler, out, 0) > 0)   // 不足一帧的剩余采样
+        h = hash_frame(h, out);
+    int64_t elapsed = av_gettime_relative() - start;
+
+    printf("%s %5d -> %s %5d %-6s | %7.1f ns/frame | hash:%016llx", av_get_sample_fmt_name(cfg->src_fmt),
+           cfg->src_rate, av_get_sample_fmt_name(cfg->dst_fmt), cfg->dst_rate,
+           threaded ? "spsc" : "single", elapsed * 1000.0 / nb_frames, (unsigned long long)h);
+    if (threaded)
+        printf(" producer waits:%lld", (long long)ctx.nb_eagain);
+    printf("\n");
+    if (threaded)
+        audio_ring_dump_stats(ctx.resampler->fifo, "spsc");
+    av_frame_free(&out);
+    audio_resampler_free(ctx.resampler);
+    return h;
+}
+
+int main(int argc, char **argv)
+{
+    int nb_frames = argc > 1 ? atoi(argv[1]) : 20000;
+    if (nb_frames <= 0) {
+        printf("invalid frames\n");
+        return -1;
+    }
+
+    // 1024 个采样点的立体声 S16 交错输入
+    int16_t in_data[FRAME_SAMPLES * 2];
+    for (int i = 0; i < FRAME_SAMPLES; i++) {
+        in_data[2 * i] = (int16_t)(10000 * sin(2 * M_PI * 440.0 * i / 48000));
+        in_data[2 * i + 1] = in_data[2 * i];
+    }
+
+    printf("%d frames of %d samples, process malloc count:%s\n", nb_frames, FRAME_SAMPLES,
+           HAVE_MALLOC_COUNT ? "yes" : "no");
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+        for (int path = 0; path < PATH_NB; path++) {
+            long long allocs = bench(&configs[i], path, (uint8_t *)in_data, sizeof(in_data),
+                                     nb_frames);
+            if (path != PATH_LEGACY && allocs != 0) {
+                printf("FAIL: %s path allocated %lld times in steady state\n", path_names[path],
+                       allocs);
+                failed = 1;
+            }
+        }
+    }
+
+    const int backlogs[] = {0, 4096, 16384, 65536};
+    for (size_t i = 0; i < sizeof(backlogs) / sizeof(backlogs[0]); i++)
+        bench_fifo(backlogs[i], nb_frames);
+
+    for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+        uint64_t single = run_spsc(&configs[i], 0, (uint8_t *)in_data, sizeof(in_data), nb_frames);
+        uint64_t spsc = run_spsc(&configs[i], 1, (uint8_t *)in_data, sizeof(in_data), nb_frames);
+        if (single != spsc) {
+            printf("FAIL: spsc output differs from single thread\n");
+            failed = 1;
+        }
+    }
+    printf("%s\n", failed ? "FAIL" : "PASS: zero allocations in steady state, spsc output matches");
+    return failed;
+}
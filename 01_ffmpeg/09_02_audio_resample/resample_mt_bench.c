@@ -0,0 +1,178 @@
+/**
+ * @brief         按通道分组多线程重采样的扩展性测试
+ *                立体声、5.1、7.1、16 声道的平面 float 输入，每帧 1024 个采样点，
+ *                分别用 1/2/4/8 个线程(audio_resampler_set_threads)重采样，输出耗时、加速比(相对列表中第一个线程数，默认为单线程)、
+ *                相对实时的倍数，并检查输出和第一个线程数的结果逐字节一致，不一致时输出 FAIL 并返回非0。
+ *
+ *                用法: 09_02_resample_mt_bench [帧数] [线程数列表]，默认 2000 帧，线程数 1,2,4,8
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "libavutil/time.h"
+#include "libavutil/channel_layout.h"
+#include "audioresampler.h"
+
+#define FRAME_SAMPLES 1024
+#define MAX_THREAD_CASES 16
+
+typedef struct layout_case {
+    const char *name;
+    uint64_t channel_layout;
+} layout_case_t;
+
+static const layout_case_t layouts[] = {
+    {"stereo", AV_CH_LAYOUT_STEREO},
+    {"5.1", AV_CH_LAYOUT_5POINT1},
+    {"7.1", AV_CH_LAYOUT_7POINT1},
+    {"16ch", AV_CH_LAYOUT_HEXADECAGONAL},
+};
+
+typedef struct rate_case {
+    int src_rate;
+    int dst_rate;
+} rate_case_t;
+
+static const rate_case_t rates[] = {
+    {96000, 48000},
+    {48000, 96000},
+};
+
+static uint64_t hash_frame(uint64_t h, const AVFrame *frame)
+{
+    int size = frame->nb_samples * av_get_bytes_per_sample(frame->format);
+    for (int i = 0; i < frame->channels; i++) {
+        for (int j = 0; j < size; j++) {
+            h ^= frame->extended_data[i][j];
+            h *= 1099511628211ULL;  // FNV-1a
+        }
+    }
+    return h;
+}
+
+// 返回耗时(us)，失败返回 -1
+static int64_t run(const layout_case_t *layout, const rate_case_t *rate, int nb_threads,
+                   uint8_t **in_data, int nb_frames, uint64_t *hash, int *groups)
+{
+    audio_resampler_params_t params;
+    params.src_sample_fmt = AV_SAMPLE_FMT_FLTP;
+    params.src_sample_rate = rate->src_rate;
+    params.src_channel_layout = layout->channel_layout;
+    params.dst_sample_fmt = AV_SAMPLE_FMT_FLTP;
+    params.dst_sample_rate = rate->dst_rate;
+    params.dst_channel_layout = layout->channel_layout;
+    audio_resampler_t *resampler = audio_resampler_alloc(params);
+    AVFrame *out = av_frame_alloc();
+    if (!resampler || !out) {
+        printf("alloc resampler failed\n");
+        audio_resampler_free(resampler);
+        av_frame_free(&out);
+        return -1;
+    }
+    *groups = audio_resampler_set_threads(resampler, nb_threads);
+    if (*groups < 0) {
+        printf("audio_resampler_set_threads failed\n");
+        av_frame_free(&out);
+        audio_resampler_free(resampler);
+        return -1;
+    }
+
+    uint64_t h = 14695981039346656037ULL;
+    int64_t pts = 0;
+    int64_t start = av_gettime_relative();
+    for (int i = 0; i <= nb_frames; i++, pts += FRAME_SAMPLES) {
+        // 最后一次 flush
+        int ret = audio_resampler_send_frame2(resampler, i < nb_frames ? in_data : NULL,
+                                              FRAME_SAMPLES, pts);
+        if (ret < 0) {
+            printf("audio_resampler_send_frame2 failed:%d\n", ret);
+            break;
+        }
+        while (audio_resampler_receive_frame_into(resampler, out, FRAME_SAMPLES) > 0)
+            h = hash_frame(h, out);
+    }
+    if (audio_resampler_receive_frame_into(resampler, out, 0) > 0)   // 不足一帧的剩余采样
+        h = hash_frame(h, out);
+    int64_t elapsed = av_gettime_relative() - start;
+
+    *hash = h;
+    av_frame_free(&out);
+    audio_resampler_free(resampler);
+    return elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    int nb_frames = argc > 1 ? atoi(argv[1]) : 2000;
+    int threads[MAX_THREAD_CASES] = {1, 2, 4, 8};
+    int nb_thread_cases = 4;
+    if (nb_frames <= 0) {
+        printf("invalid frames\n");
+        return -1;
+    }
+    if (argc > 2) {
+        nb_thread_cases = 0;
+        char *list = argv[2];
+        char *end = NULL;
+        while (*list && nb_thread_cases < MAX_THREAD_CASES) {
+            int n = (int)strtol(list, &end, 10);
+            if (end == list || n <= 0) {
+                printf("invalid threads list:%s\n", argv[2]);
+                return -1;
+            }
+            threads[nb_thread_cases++] = n;
+            list = *end == ',' ? end + 1 : end;
+        }
+    }
+
+    // 每个通道不同频率的正弦波，避免各通道数据相同看不出分组错位
+    int max_channels = av_get_channel_layout_nb_channels(AV_CH_LAYOUT_HEXADECAGONAL);
+    float *samples = (float *)av_malloc(sizeof(float) * FRAME_SAMPLES * max_channels);
+    uint8_t *in_data[AUDIO_RESAMPLER_MAX_CHANNELS];
+    if (!samples) {
+        printf("alloc samples failed\n");
+        return -1;
+    }
+    for (int ch = 0; ch < max_channels; ch++) {
+        float *p = samples + ch * FRAME_SAMPLES;
+        for (int i = 0; i < FRAME_SAMPLES; i++)
+            p[i] = 0.5f * (float)sin(2 * M_PI * (220.0 + 110.0 * ch) * i / 48000);
+        in_data[ch] = (uint8_t *)p;
+    }
+
+    printf("%d frames of %d samples, FLTP\n", nb_frames, FRAME_SAMPLES);
+    int failed = 0;
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+        for (size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+            int channels = av_get_channel_layout_nb_channels(layouts[l].channel_layout);
+            double audio_us = (double)nb_frames * FRAME_SAMPLES * 1000000.0 / rates[r].src_rate;
+            uint64_t single_hash = 0;
+            int64_t single_us = 0;
+            for (int t = 0; t < nb_thread_cases; t++) {
+                uint64_t hash = 0;
+                int groups = 0;
+                int64_t us = run(&layouts[l], &rates[r], threads[t], in_data, nb_frames, &hash, &groups);
+                if (us < 0) {
+                    failed = 1;
+                    continue;
+                }
+                if (t == 0) {
+                    single_hash = hash;
+                    single_us = us;
+                }
+                int match = hash == single_hash;
+                printf("%-6s %2dch %5d -> %5d | threads:%d groups:%2d | %8.1f us/frame | x%.2f | %6.1fx realtime | %s\n",
+                       layouts[l].name, channels, rates[r].src_rate, rates[r].dst_rate, threads[t],
+                       groups, us / (double)nb_frames, us > 0 ? (double)single_us / us : 0.0,
+                       us > 0 ? audio_us / us : 0.0, match ? "match" : "MISMATCH");
+                if (!match)
+                    failed = 1;
+            }
+        }
+    }
+    av_free(samples);
+    printf("%s\n", failed ? "FAIL" : "PASS: multi-threaded output matches single thread");
+    return failed;
+}
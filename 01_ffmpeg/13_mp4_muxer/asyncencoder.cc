@@ -0,0 +1,204 @@
+#include "asyncencoder.h"
+extern "C"
+{
+#include "libavutil/time.h"
+#include "libavutil/mathematics.h"
+}
+
+AsyncEncoder::~AsyncEncoder()
+{
+    Stop();
+    bounded_queue_free(in_queue_);
+    bounded_queue_free(out_queue_);
+}
+
+int AsyncEncoder::Start(const char *name, EncodeFunc encode, AVRational time_base, int in_capacity,
+                        int out_capacity)
+{
+    if (thread_.joinable() || !encode || in_capacity <= 0 || out_capacity <= 0) {
+        printf("AsyncEncoder::Start invalid parameters\n");
+        return -1;
+    }
+    name_ = name ? name : "encoder";
+    encode_ = encode;
+    time_base_ = time_base;
+    in_queue_ = bounded_queue_alloc(in_capacity);
+    out_queue_ = bounded_queue_alloc(out_capacity);
+    if (!in_queue_ || !out_queue_) {
+        printf("bounded_queue_alloc failed\n");
+        return -1;
+    }
+    thread_ = std::thread(&AsyncEncoder::Run, this);
+    return 0;
+}
+
+void AsyncEncoder::Run()
+{
+    PacketList packets;     // 循环使用，稳态下不分配
+    while (1) {
+        AVFrame *frame = NULL;
+        int ret = bounded_queue_pop(in_queue_, (void **)&frame);
+        if (ret == AVERROR_EXIT) {
+            break;      // Stop 中止
+        }
+        bool flush = ret == AVERROR_EOF;
+        int64_t start = av_gettime_relative();
+        ret = encode_(flush ? NULL : frame, packets);
+        encode_us_ += av_gettime_relative() - start;
+        av_frame_free(&frame);  // 编码器需要时自己持有引用
+        if (!flush)
+            nb_frames_++;
+
+        int i = 0;
+        if (ret >= 0) {
+            for (; i < packets.Size(); i++) {
+                // 输出队列满时在这里等待 muxer
+                if (bounded_queue_push(out_queue_, packets[i].Get()) < 0)
+                    break;
+                packets[i].Release();
+                nb_packets_++;
+            }
+        }
+        int pushed = packets.Size();
+        packets.Clear();    // 没有放进队列的包回到池中
+        if (ret < 0 || i < pushed) {
+            if (ret < 0)
+                printf("[%s] encode failed:%d\n", name_.c_str(), ret);
+            error_ = ret < 0 ? ret : AVERROR_EXIT;
+            bounded_queue_abort(in_queue_);     // 读文件的线程不再阻塞在 Submit
+            bounded_queue_abort(out_queue_);
+            return;
+        }
+        if (flush)
+            break;
+    }
+    bounded_queue_finish(out_queue_);
+}
+
+int AsyncEncoder::Submit(FrameHandle frame)
+{
+    if (!in_queue_ || !frame) {
+        return AVERROR(EINVAL);
+    }
+    AVFrame *f = frame.Release();
+    int ret = bounded_queue_push(in_queue_, f);     // 输入队列满时在这里等待编码线程
+    if (ret < 0) {
+        av_frame_free(&f);
+    }
+    return ret;
+}
+
+void AsyncEncoder::Finish()
+{
+    if (in_queue_)
+        bounded_queue_finish(in_queue_);
+}
+
+int AsyncEncoder::Poll(AVPacket **packet)
+{
+    if (!out_queue_) {
+        return AVERROR(EINVAL);
+    }
+    if (peek_) {
+        *packet = peek_;
+        peek_ = NULL;
+        return 0;
+    }
+    int ret = bounded_queue_try_pop(out_queue_, (void **)packet);
+    if (ret == AVERROR_EOF)
+        eof_ = true;
+    return ret;
+}
+
+int AsyncEncoder::Receive(AVPacket **packet)
+{
+    if (!out_queue_) {
+        return AVERROR(EINVAL);
+    }
+    if (peek_) {
+        *packet = peek_;
+        peek_ = NULL;
+        return 0;
+    }
+    int ret = bounded_queue_pop(out_queue_, (void **)packet);
+    if (ret == AVERROR_EOF)
+        eof_ = true;
+    return ret;
+}
+
+int AsyncEncoder::ReceiveInterleaved(AsyncEncoder *const *encoders, int nb_encoders, AVPacket **packet)
+{
+    AsyncEncoder *best = NULL;
+    for (int i = 0; i < nb_encoders; i++) {
+        AsyncEncoder *enc = encoders[i];
+        // 每个还没有结束的编码器都要有一个包才能比较，没有就等待这个编码器
+        if (!enc->peek_ && !enc->eof_) {
+            int ret = bounded_queue_pop(enc->out_queue_, (void **)&enc->peek_);
+            if (ret == AVERROR_EOF) {
+                enc->eof_ = true;
+            } else if (ret < 0) {
+                return ret;
+            }
+        }
+        if (!enc->peek_)
+            continue;
+        int64_t dts = enc->peek_->dts != AV_NOPTS_VALUE ? enc->peek_->dts : enc->peek_->pts;
+        int64_t best_dts = 0;
+        if (best)
+            best_dts = best->peek_->dts != AV_NOPTS_VALUE ? best->peek_->dts : best->peek_->pts;
+        if (!best || av_compare_ts(dts, enc->time_base_, best_dts, best->time_base_) < 0)
+            best = enc;
+    }
+    if (!best) {
+        return AVERROR_EOF;
+    }
+    *packet = best->peek_;
+    best->peek_ = NULL;
+    return 0;
+}
+
+void AsyncEncoder::FreeFrame(void *opaque, void *item)
+{
+    (void)opaque;
+    AVFrame *frame = (AVFrame *)item;
+    av_frame_free(&frame);
+}
+
+void AsyncEncoder::FreePacket(void *opaque, void *item)
+{
+    packet_pool_put((packet_pool_t *)opaque, (AVPacket *)item);
+}
+
+void AsyncEncoder::Stop()
+{
+    if (thread_.joinable()) {
+        // 正常结束时编码线程已经(或者马上)退出，否则中止两个队列让它退出
+        if (!eof_ && error_ == 0) {
+            bounded_queue_abort(in_queue_);
+            bounded_queue_abort(out_queue_);
+        }
+        thread_.join();
+    }
+    if (in_queue_)
+        bounded_queue_drain(in_queue_, FreeFrame, NULL);
+    if (out_queue_)
+        bounded_queue_drain(out_queue_, FreePacket, pkt_pool_);
+    if (peek_) {
+        packet_pool_put(pkt_pool_, peek_);
+        peek_ = NULL;
+    }
+}
+
+void AsyncEncoder::DumpStats()
+{
+    bounded_queue_stats_t in_stats, out_stats;
+    if (!in_queue_ || !out_queue_)
+        return;
+    bounded_queue_get_stats(in_queue_, &in_stats);
+    bounded_queue_get_stats(out_queue_, &out_stats);
+    printf("[%s] frames:%lld packets:%lld encode:%.1fms (%.2fms/frame)"
+           " | in queue max:%d submit waits:%lld | out queue max:%d encoder waits:%lld\n",
+           name_.c_str(), (long long)nb_frames_, (long long)nb_packets_, encode_us_ / 1000.0,
+           nb_frames_ > 0 ? encode_us_ / 1000.0 / nb_frames_ : 0.0, in_stats.max_depth,
+           (long long)in_stats.push_waits, out_stats.max_depth, (long long)out_stats.push_waits);
+}
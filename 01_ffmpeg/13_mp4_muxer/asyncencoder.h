@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+extern "C"
+{
+#include "libavcodec/avcodec.h"
+}
+#include "boundedqueue.h"
+#include "packetpool.h"
+#include "framehandle.h"
+#include "packethandle.h"
+
+/**
+* 异步编码：每个编码器一个编码线程，和读文件、重采样、写文件并行执行。
+* (1) Submit 把帧(连同所有权)放进输入队列，队列满时阻塞，读文件被限制在编码速度上(背压);
+* (2) 编码线程取出帧调用编码回调，输出的包按编码顺序放进输出队列，输出队列满时编码线程阻塞，
+*     muxer 来不及写时编码也会停下来，各阶段缓存的数据量都有上限;
+* (3) Finish 表示输入结束，编码线程 flush 编码器后结束输出队列，Poll/Receive 取完后返回 AVERROR_EOF;
+* (4) ReceiveInterleaved 从多个编码器中按 dts 顺序取包交给 muxer，每个编码器内部的顺序不变;
+* (5) 编码出错时两个队列都中止，Submit 和 Receive 返回 AVERROR_EXIT，GetError 得到错误码。
+* 帧在编码线程中送入编码器后就释放，编码器需要保留时自己持有引用(见 VideoEncoder::AcquireFrame)。
+*/
+class AsyncEncoder
+{
+public:
+    // 在编码线程中调用：frame 为 NULL 表示 flush，输出的包追加到 packets，返回 <0 失败
+    typedef std::function<int(AVFrame *frame, PacketList &packets)> EncodeFunc;
+
+    AsyncEncoder() = default;
+    ~AsyncEncoder();
+    AsyncEncoder(const AsyncEncoder &) = delete;
+    AsyncEncoder &operator=(const AsyncEncoder &) = delete;
+
+    /**
+     * @brief 启动编码线程
+     * @param name 打印统计时的名字
+     * @param encode 编码回调
+     * @param time_base 输出包的时间基(编码器的 time_base)，多个编码器之间按 dts 排序时使用
+     * @param in_capacity 输入队列最多缓存的帧数
+     * @param out_capacity 输出队列最多缓存的包数
+     * @return 0 成功，<0 失败
+     */
+    int Start(const char *name, EncodeFunc encode, AVRational time_base, int in_capacity = 8,
+              int out_capacity = 64);
+    // 设置包回收池，Stop 时丢弃的包归还到池中，和编码器使用同一个池
+    void SetPacketPool(packet_pool_t *pool) { pkt_pool_ = pool; }
+
+    /**
+     * @brief 送入一帧，输入队列满时阻塞
+     * @return 0 成功，<0 已经停止或编码出错，帧已经释放
+     */
+    int Submit(FrameHandle frame);
+    // 输入结束
+    void Finish();
+
+    /**
+     * @brief 非阻塞地取一个包，调用者用完后 packet_pool_put
+     * @return 0 成功，AVERROR(EAGAIN) 暂时没有，AVERROR_EOF 全部取完，AVERROR_EXIT 编码出错
+     */
+    int Poll(AVPacket **packet);
+    // 同上，没有包时阻塞
+    int Receive(AVPacket **packet);
+
+    /**
+     * @brief 从多个编码器中取 dts 最小的包，所有编码器都取完后返回 AVERROR_EOF
+     * @return 同 Receive
+     */
+    static int ReceiveInterleaved(AsyncEncoder *const *encoders, int nb_encoders, AVPacket **packet);
+
+    // 等待编码线程退出，还没有 Finish 时中止，丢弃队列中剩余的帧和包
+    void Stop();
+    int GetError() const { return error_; }
+    AVRational GetTimeBase() const { return time_base_; }
+    // 打印编码耗时和队列统计，Stop 之后调用
+    void DumpStats();
+
+private:
+    void Run();
+    static void FreeFrame(void *opaque, void *item);
+    static void FreePacket(void *opaque, void *item);
+
+    std::string name_;
+    EncodeFunc encode_;
+    AVRational time_base_ = {1, 1000000};
+    bounded_queue_t *in_queue_ = NULL;
+    bounded_queue_t *out_queue_ = NULL;
+    packet_pool_t *pkt_pool_ = NULL;
+    std::thread thread_;
+    AVPacket *peek_ = NULL;     // ReceiveInterleaved 取出来等待比较的包
+    bool eof_ = false;          // 输出已经全部取完
+    std::atomic<int> error_{0};
+    int64_t nb_frames_ = 0;     // 以下只在编码线程中修改，Stop 之后读取
+    int64_t nb_packets_ = 0;
+    int64_t encode_us_ = 0;
+};
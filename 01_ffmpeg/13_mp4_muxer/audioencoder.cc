@@ -50,6 +50,9 @@ void AudioEncoder::DeInit()
         avcodec_free_context(&codec_ctx_); // codec_ctx_被设置为NULL
                                            //        codec_ctx_ = NULL;  // 不需要再写
     }
+    spare_.Reset();     // 在包回收池释放之前归还
+    // 只是标记，还被帧引用的内存在最后一次 unref 时释放
+    av_buffer_pool_uninit(&frame_pool_);
 }
 AVPacket *AudioEncoder::Encode(AVFrame *frame, int stream_index, int64_t pts, int64_t time_base)
 {
@@ -84,7 +87,7 @@ AVPacket *AudioEncoder::Encode(AVFrame *frame, int stream_index, int64_t pts, in
 }
 
 int AudioEncoder::Encode(AVFrame *frame, int stream_index, int64_t pts, int64_t time_base,
-                         std::vector<AVPacket *> &packets)
+                         PacketList &packets)
 {
     if (!codec_ctx_) {
         printf("codec_ctx_ null\n");
@@ -103,21 +106,26 @@ int AudioEncoder::Encode(AVFrame *frame, int stream_index, int64_t pts, int64_t
         return -1;
     }
     while (1) {
-        AVPacket *packet = av_packet_alloc();
-        ret = avcodec_receive_packet(codec_ctx_, packet);
-        packet->stream_index = stream_index;
+        // 大多数调用没有输出(EAGAIN)，空包留在 spare_ 中下次继续用
+        if (!spare_) {
+            spare_ = PacketHandle::Get(pkt_pool_);
+            if (!spare_) {
+                printf("packet_pool_get failed\n");
+                return -1;
+            }
+        }
+        ret = avcodec_receive_packet(codec_ctx_, spare_.Get());
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
             ret = 0;
-            av_packet_free(&packet);
             break;
         } else if (ret < 0) {
             char errbuf[1024] = {0};
             av_strerror(ret, errbuf, sizeof(errbuf) - 1);
             printf("aac avcodec_receive_packet failed:%s\n", errbuf);
-            av_packet_free(&packet);
-            ret = -1;
+            return -1;
         }
-        packets.push_back(packet);
+        spare_->stream_index = stream_index;
+        packets.PushBack(std::move(spare_));
     }
     return ret;
 }
@@ -135,6 +143,50 @@ int AudioEncoder::GetSampleFormat()
 
     return AV_SAMPLE_FMT_NONE;
 }
+int AudioEncoder::AcquireFrame(FrameHandle &frame)
+{
+    if (!codec_ctx_) {
+        printf("codec_ctx_ null\n");
+        return -1;
+    }
+    int linesize = 0;
+    int size = av_samples_get_buffer_size(&linesize, codec_ctx_->channels, codec_ctx_->frame_size,
+                                          codec_ctx_->sample_fmt, 0);
+    if (size < 0) {
+        printf("av_samples_get_buffer_size failed\n");
+        return size;
+    }
+    if (!frame_pool_) {
+        frame_pool_ = av_buffer_pool_init(size, av_buffer_alloc);
+        if (!frame_pool_) {
+            printf("av_buffer_pool_init failed\n");
+            return AVERROR(ENOMEM);
+        }
+    }
+    if (!frame) {
+        frame = FrameHandle::Alloc();
+        if (!frame)
+            return AVERROR(ENOMEM);
+    } else {
+        av_frame_unref(frame.Get());
+    }
+    frame->buf[0] = av_buffer_pool_get(frame_pool_);
+    if (!frame->buf[0]) {
+        printf("av_buffer_pool_get failed\n");
+        return AVERROR(ENOMEM);
+    }
+    frame->format = codec_ctx_->sample_fmt;
+    frame->channels = codec_ctx_->channels;
+    frame->channel_layout = codec_ctx_->channel_layout;
+    frame->sample_rate = codec_ctx_->sample_rate;
+    frame->nb_samples = codec_ctx_->frame_size;
+    // 和 av_frame_get_buffer 的布局一致(平面按默认对齐)，重采样器可以直接复用这一帧输出
+    av_samples_fill_arrays(frame->data, frame->linesize, frame->buf[0]->data, frame->channels,
+                           frame->nb_samples, (AVSampleFormat)frame->format, 0);
+    frame->extended_data = frame->data;
+    return 0;
+}
+
 AVCodecContext *AudioEncoder::GetCodecContext()
 {
     return codec_ctx_;
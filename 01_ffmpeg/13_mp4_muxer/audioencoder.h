@@ -6,6 +6,9 @@ extern "C"
 #include "libavcodec/avcodec.h"
 #include "libavutil/frame.h"
 }
+#include "packetpool.h"
+#include "framehandle.h"
+#include "packethandle.h"
 
 class AudioEncoder
 {
@@ -17,12 +20,22 @@ public:
     // 释放资源
     void DeInit();
     AVPacket *Encode(AVFrame *frame, int stream_index, int64_t pts, int64_t time_base);
-    int Encode(AVFrame *frame, int stream_index, int64_t pts, int64_t time_base, std::vector<AVPacket*>& packets);
+    int Encode(AVFrame *frame, int stream_index, int64_t pts, int64_t time_base, PacketList &packets);
     // 获取一帧数据 每个通道需要多少个采样点
     int GetFrameSize();
     // 编码器需要的采样格式
     int GetSampleFormat();
+    // 从编码器的内存池取一帧(编码器的格式、声道，GetFrameSize 个采样点)，frame 为空时分配，
+    // 不为空时先释放原来的引用；调用者填好数据(最后一帧可以减小 nb_samples)后传给 Encode，
+    // 帧释放后内存回到池中，可以在别的线程中编码和释放
+    int AcquireFrame(FrameHandle &frame);
     AVCodecContext *GetCodecContext();
+    // 设置包回收池，输出的包从池中获取，不设置则使用 av_packet_alloc
+    void SetPacketPool(packet_pool_t *pool)
+    {
+        spare_.Reset();
+        pkt_pool_ = pool;
+    }
     int GetChannels() { return channels_; }
     int GetSampleRate() { return sample_rate_; }
 
@@ -32,4 +45,7 @@ private:
     int bit_rate_ = 128 * 1024;
     int64_t pts_ = 0;
     AVCodecContext *codec_ctx_ = NULL;
+    packet_pool_t *pkt_pool_ = NULL;
+    PacketHandle spare_;                // 没有取到输出时留着下次用
+    AVBufferPool *frame_pool_ = NULL;   // AcquireFrame 的内存池，所有平面在一块内存中
 };
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+extern "C"
+{
+#include "libavutil/frame.h"
+}
+
+// 独占一个 AVFrame：只能移动不能拷贝，析构时 av_frame_free
+class FrameHandle
+{
+public:
+    FrameHandle() = default;
+    explicit FrameHandle(AVFrame *frame) : frame_(frame) {}
+    ~FrameHandle() { av_frame_free(&frame_); }
+
+    FrameHandle(const FrameHandle &) = delete;
+    FrameHandle &operator=(const FrameHandle &) = delete;
+    FrameHandle(FrameHandle &&other) noexcept : frame_(other.Release()) {}
+    FrameHandle &operator=(FrameHandle &&other) noexcept
+    {
+        if (this != &other)
+            Reset(other.Release());
+        return *this;
+    }
+
+    // 分配一个空帧，失败时句柄为空
+    static FrameHandle Alloc() { return FrameHandle(av_frame_alloc()); }
+
+    AVFrame *Get() const { return frame_; }
+    AVFrame *operator->() const { return frame_; }
+    explicit operator bool() const { return frame_ != NULL; }
+
+    // 交出所有权，调用者负责释放
+    AVFrame *Release()
+    {
+        AVFrame *frame = frame_;
+        frame_ = NULL;
+        return frame;
+    }
+    void Reset(AVFrame *frame = NULL)
+    {
+        av_frame_free(&frame_);
+        frame_ = frame;
+    }
+
+private:
+    AVFrame *frame_ = NULL;
+};
@@ -1,12 +1,16 @@
 #include <iostream>
+#include <thread>
 #include <vector>
 #include "muxer.h"
 #include "videoencoder.h"
 #include "audioencoder.h"
-#include "audioresampler.h"
+#include "asyncencoder.h"
+#include "resampler.h"
+#include "pcmconv.h"
 extern "C"
 {
 #include "libavutil/avutil.h"
+#include "libavutil/time.h"
 }
 
 #define YUV_WIDTH 720
@@ -23,20 +27,157 @@ extern "C"
 
 #define AUDIO_TIME_BASE 1000000
 #define VIDEO_TIME_BASE 1000000
+
+// 1: 读 yuv、读 pcm(+重采样)、视频编码、音频编码各一个线程，主线程按 dts 顺序写文件;
+// 0: 单线程交替读文件、编码、写文件
+#define ASYNC_ENCODE 1
+#define VIDEO_QUEUE_FRAMES 8    // 编码器输入队列最多缓存的帧数
+#define AUDIO_QUEUE_FRAMES 32
+#define PACKET_QUEUE_SIZE 64    // 编码器输出队列最多缓存的包数
 //ffmpeg -i sound_in_sync_test.mp4 -pix_fmt yuv420p 720x576_yuv420p.yuv
 //ffmpeg -i sound_in_sync_test.mp4 -vn -ar 44100 -ac 2 -f s16le 44100_2_s16le.pcm
-// 执行文件  yuv文件 pcm文件 输出mp4文件
+// 执行文件  yuv文件 pcm文件 输出mp4文件 [视频比特流过滤器链]
+
+// 从 yuv 文件读第 index 帧到编码器内存池的帧里，返回 1 读到一帧，0 文件结束，<0 失败
+static int ReadVideoFrame(VideoEncoder &encoder, FILE *fp, int64_t index, int fps, FrameHandle &frame)
+{
+    // 上一帧还被编码器(lookahead 等)引用时，池里会取到另一块内存
+    if (encoder.AcquireFrame(frame) < 0) {
+        printf("video_encoder.AcquireFrame failed\n");
+        return -1;
+    }
+    size_t read_len = fread(frame->data[0], 1, encoder.GetFrameBufferSize(), fp);
+    if (read_len < (size_t)encoder.GetFrameBufferSize()) {
+        printf("fread yuv frame finish\n");
+        return 0;
+    }
+    frame->pts = av_rescale(index, VIDEO_TIME_BASE, fps);
+    return 1;
+}
+
+/**
+* 从 pcm 文件读数据，输出编码器需要的帧(内存来自编码器的内存池，pts 时间基为 1/AUDIO_TIME_BASE)：
+* 采样率、声道数不变，只是 S16 -> FLTP 时直接转换，不经过 swresample;
+* 否则经过 Resampler 转换成编码器的格式、采样率，按编码器的帧长输出。
+* pts 由采样点数得到，输入输出采样率不同也不会漂移。
+*/
+class PcmSource
+{
+public:
+    int Init(FILE *fp, AudioEncoder *encoder, int sample_rate, int channels, int sample_format)
+    {
+        fp_ = fp;
+        encoder_ = encoder;
+        sample_rate_ = sample_rate;
+        channels_ = channels;
+        sample_bytes_ = av_get_bytes_per_sample((AVSampleFormat)sample_format) * channels;
+        // 每次读编码器一帧的采样点
+        if (sample_bytes_ <= 0 || encoder->GetFrameSize() <= 0) {
+            printf("pcm_frame_size <= 0\n");
+            return -1;
+        }
+        buf_.resize((size_t)sample_bytes_ * encoder->GetFrameSize());
+        direct_ = sample_format == AV_SAMPLE_FMT_S16 && encoder->GetSampleFormat() == AV_SAMPLE_FMT_FLTP
+                  && sample_rate == encoder->GetSampleRate() && channels == encoder->GetChannels();
+        printf("audio front-end: %s\n", direct_ ? "direct s16->fltp" : "resampler");
+        if (direct_)
+            return 0;
+
+        audio_resampler_params_t params;
+        params.src_sample_fmt = (AVSampleFormat)sample_format;
+        params.src_sample_rate = sample_rate;
+        params.src_channel_layout = av_get_default_channel_layout(channels);
+        params.dst_sample_fmt = (AVSampleFormat)encoder->GetSampleFormat();
+        params.dst_sample_rate = encoder->GetSampleRate();
+        params.dst_channel_layout = av_get_default_channel_layout(encoder->GetChannels());
+        if (resampler_.Init(params, encoder->GetFrameSize()) < 0) {
+            printf("audio_resampler.Init failed\n");
+            return -1;
+        }
+        return 0;
+    }
+
+    // 读一帧到 frame，返回 1 得到一帧，0 结束，<0 失败
+    int Read(FrameHandle &frame)
+    {
+        if (encoder_->AcquireFrame(frame) < 0) {
+            printf("audio_encoder.AcquireFrame failed\n");
+            return -1;
+        }
+        if (direct_) {
+            int nb_read = ReadFile();
+            if (nb_read <= 0)
+                return 0;
+            pcm_s16_to_fltp((float *const *)frame->extended_data, (const int16_t *)buf_.data(), channels_,
+                            nb_read);
+            frame->nb_samples = nb_read;    // 最后一帧可能不足 frame_size
+            frame->pts = av_rescale(nb_samples_ - nb_read, AUDIO_TIME_BASE, sample_rate_);
+            return 1;
+        }
+        // 重采样器中不够一帧时继续读文件，输出直接写到池中的帧里
+        while (1) {
+            int ret = resampler_.Receive(frame);
+            if (ret < 0) {
+                printf("audio_resampler.Receive error\n");
+                return ret;
+            }
+            if (ret > 0) {
+                frame->pts = av_rescale_q(frame->pts, resampler_.GetTimeBase(), AVRational{1, AUDIO_TIME_BASE});
+                return 1;
+            }
+            if (eof_)
+                return 0;
+            int64_t pts = nb_samples_;
+            int nb_read = ReadFile();
+            if (nb_read > 0 && resampler_.Send(buf_.data(), nb_read * sample_bytes_, pts,
+                                               AVRational{1, sample_rate_}) < 0) {
+                printf("audio_resampler.Send error\n");
+                return -1;
+            }
+            if (eof_)
+                resampler_.Flush();
+        }
+    }
+
+private:
+    // 读一帧的数据到 buf_，返回读到的采样点数
+    int ReadFile()
+    {
+        if (eof_)
+            return 0;
+        size_t read_len = fread(buf_.data(), 1, buf_.size(), fp_);
+        if (read_len < buf_.size()) {
+            eof_ = true;
+            printf("fread pcm finish\n");
+        }
+        int nb_read = (int)(read_len / sample_bytes_);
+        nb_samples_ += nb_read;
+        return nb_read;
+    }
+
+    FILE *fp_ = NULL;
+    AudioEncoder *encoder_ = NULL;
+    int sample_rate_ = 0;
+    int channels_ = 0;
+    int sample_bytes_ = 0;
+    bool direct_ = false;
+    bool eof_ = false;
+    std::vector<uint8_t> buf_;
+    Resampler resampler_;
+    int64_t nb_samples_ = 0;    // 已读取的 pcm 采样点
+};
 
 int main(int argc, char **argv)
 {
-    if (argc != 4) {
-        printf("usage -> exe in.yuv in.pcm out.mp4");
+    if (argc != 4 && argc != 5) {
+        printf("usage -> exe in.yuv in.pcm out.mp4 [bsf1,bsf2,...]");
         return -1;
     }
     //1. 打开pcm，yuv文件
     char *in_yuv_name = argv[1];
     char *in_pcm_name = argv[2];
     char *out_mp4_name = argv[3];
+    const char *video_bsf = argc == 5 ? argv[4] : NULL; // 例如 h264_metadata=level=4.1
     FILE *in_yuv_fd = NULL;
     FILE *in_pcm_fd = NULL;
     //1. 打开测试文件
@@ -68,16 +209,7 @@ int main(int argc, char **argv)
         printf("video_encoder.InitH264 failed\n");
         return -1;
     }
-    // 分配yuv buf
-    int y_frame_size = yuv_width * yuv_height;
-    int u_frame_size = yuv_width * yuv_height / 4;
-    int v_frame_size = yuv_width * yuv_height / 4;
-    int yuv_frame_size = y_frame_size + u_frame_size + v_frame_size;
-    uint8_t *yuv_frame_buf = (uint8_t *)malloc(yuv_frame_size);
-    if (!yuv_frame_buf) {
-        printf("malloc(yuv_frame_size)\n");
-        return -1;
-    }
+    // yuv 直接读到编码器内存池的帧里，以引用计数送入编码器，编码器释放后内存回到池中，不需要拷贝
 
     // 2.2 初始化audio
     // 初始化音频编码器
@@ -91,38 +223,30 @@ int main(int argc, char **argv)
         printf("audio_encoder.InitAAC failed\n");
         return -1;
     }
-    // 分配pcm buf
-    // pcm_frame_size  = 单个采样点占用的字节 * 通道数量 * 每个通道有多少给采用点
-    int pcm_frame_size = av_get_bytes_per_sample((AVSampleFormat)pcm_sample_format) * pcm_channels
-                         * audio_encoder.GetFrameSize();
-    if (pcm_frame_size <= 0) {
-        printf("pcm_frame_size <= 0\n");
-        return -1;
-    }
-    uint8_t *pcm_frame_buf = (uint8_t *)malloc(pcm_frame_size);
-    if (!pcm_frame_buf) {
-        printf("malloc(pcm_frame_size)\n");
+    PcmSource pcm_source;
+    if (pcm_source.Init(in_pcm_fd, &audio_encoder, pcm_sample_rate, pcm_channels, pcm_sample_format) < 0) {
         return -1;
     }
 
-    // 初始化重采样
-    AudioResampler audio_resampler;
-    ret = audio_resampler.InitFromS16ToFLTP(
-        pcm_channels, pcm_sample_rate, audio_encoder.GetChannels(), audio_encoder.GetSampleRate());
-    if (ret < 0) {
-        printf("audio_resampler.InitFromS16ToFLTP failed\n");
+    // 编码器和muxer共用的包回收池，SendPacket后包回到池中给编码器继续使用
+    packet_pool_t *pkt_pool = packet_pool_alloc(0);
+    if (!pkt_pool) {
+        printf("packet_pool_alloc failed\n");
         return -1;
     }
+    video_encoder.SetPacketPool(pkt_pool);
+    audio_encoder.SetPacketPool(pkt_pool);
 
     //3. MP4初始化，包括新建流，open io，send header
     Muxer mp4_muxer;
+    mp4_muxer.SetPacketPool(pkt_pool);
     ret = mp4_muxer.Init(out_mp4_name);
     if (ret < 0) {
         printf("mp4_muxer.Init failed\n");
         return -1;
     }
 
-    ret = mp4_muxer.AddStream(video_encoder.GetCodecContext());
+    ret = mp4_muxer.AddStream(video_encoder.GetCodecContext(), video_bsf);
     if (ret < 0) {
         printf("mp4_muxer.AddStream video failed\n");
         return -1;
@@ -145,92 +269,143 @@ int main(int argc, char **argv)
         printf("mp4_muxer.SendHeader failed\n");
         return -1;
     }
-    // 4. 在while循环读取yuv、pcm进行编码然后发送给MP4 muxer
+    // 4. 读取yuv、pcm进行编码然后发送给MP4 muxer
     // 4.1 时间戳相关
     int64_t audio_time_base = AUDIO_TIME_BASE;
     int64_t video_time_base = VIDEO_TIME_BASE;
-    double audio_pts = 0;
-    double video_pts = 0;
-    double audio_frame_duration =
-        1.0 * audio_encoder.GetFrameSize() / pcm_sample_rate * audio_time_base;
-    double video_frame_duration = 1.0 / yuv_fps * video_time_base;
-
-    int audio_finish = 0; // 两者都为0的时候才结束while循环
-    int video_finish = 0;
-
-    size_t read_len = 0;
-    AVPacket *packet = NULL;
     int audio_index = mp4_muxer.GetAudioStreamIndex();
     int video_index = mp4_muxer.GetVideoStreamIndex();
-    std::vector<AVPacket *> packets;
-    while (1) {
-        if (audio_finish && video_finish) {
-            break;
+    int64_t start_time = av_gettime_relative();
+    int encode_ret = 0;     // 编码中途出错时不写 trailer，返回非0
+
+    if (ASYNC_ENCODE) {
+        // 4.2 每个编码器一个编码线程，两个线程分别读 yuv、pcm，主线程按 dts 顺序把包交给 muxer。
+        // 队列都有上限，视频编码慢时读 yuv 的线程阻塞在 Submit，音频先编码的包在输出队列中等待视频
+        AsyncEncoder async_video;
+        AsyncEncoder async_audio;
+        async_video.SetPacketPool(pkt_pool);
+        async_audio.SetPacketPool(pkt_pool);
+        ret = async_video.Start("video", [&](AVFrame *frame, PacketList &packets) {
+            return video_encoder.Encode((const AVFrame *)frame, video_index, frame ? frame->pts : 0,
+                                        video_time_base, packets);
+        }, video_encoder.GetCodecContext()->time_base, VIDEO_QUEUE_FRAMES, PACKET_QUEUE_SIZE);
+        if (ret < 0) {
+            printf("async_video.Start failed\n");
+            return -1;
         }
-        packets.clear();
-
-        printf("apts:%0.0lf vpts:%0.0lf\n", audio_pts / 1000, video_pts / 1000);
-        if ((video_finish != 1
-             && audio_pts > video_pts) // audio和vidoe都还有数据，优先audio（audio_pts > video_pts）
-            || (video_finish != 1 && audio_finish == 1)) {
-            read_len = fread(yuv_frame_buf, 1, yuv_frame_size, in_yuv_fd);
-            if (read_len < yuv_frame_size) {
-                video_finish = 1;
-                printf("fread yuv_frame_buf finish\n");
+        ret = async_audio.Start("audio", [&](AVFrame *frame, PacketList &packets) {
+            return audio_encoder.Encode(frame, audio_index, frame ? frame->pts : 0, audio_time_base,
+                                        packets);
+        }, audio_encoder.GetCodecContext()->time_base, AUDIO_QUEUE_FRAMES, PACKET_QUEUE_SIZE);
+        if (ret < 0) {
+            printf("async_audio.Start failed\n");
+            return -1;
+        }
+
+        std::thread video_reader([&]() {
+            FrameHandle frame;
+            for (int64_t i = 0; ReadVideoFrame(video_encoder, in_yuv_fd, i, yuv_fps, frame) > 0; i++) {
+                if (async_video.Submit(std::move(frame)) < 0)
+                    break;
             }
-            if (video_finish != 1) {
-                ret = video_encoder.Encode(yuv_frame_buf, yuv_frame_size, video_index, video_pts,
-                                           video_time_base, packets);
-            } else { // 传入空数据
-                ret =
-                    video_encoder.Encode(NULL, 0, video_index, video_pts, video_time_base, packets);
+            async_video.Finish();
+        });
+        std::thread audio_reader([&]() {
+            FrameHandle frame;
+            while (pcm_source.Read(frame) > 0) {
+                if (async_audio.Submit(std::move(frame)) < 0)
+                    break;
             }
-            video_pts += video_frame_duration; // 叠加pts
-            if (ret >= 0) {
-                for (auto packet : packets) {
-                    mp4_muxer.SendPacket(packet);
+            async_audio.Finish();
+        });
+
+        AsyncEncoder *encoders[2] = {&async_video, &async_audio};
+        AVPacket *packet = NULL;
+        while ((ret = AsyncEncoder::ReceiveInterleaved(encoders, 2, &packet)) == 0) {
+            mp4_muxer.SendPacket(packet);
+        }
+        if (ret != AVERROR_EOF) {
+            printf("async encode failed, video:%d audio:%d\n", async_video.GetError(), async_audio.GetError());
+            encode_ret = ret;
+        }
+        // 出错时中止队列，阻塞在 Submit 的读线程也能退出
+        async_video.Stop();
+        async_audio.Stop();
+        video_reader.join();
+        audio_reader.join();
+        async_video.DumpStats();
+        async_audio.DumpStats();
+    } else {
+        // 4.2 单线程：audio和video都还有数据时 pts 小的先编码
+        int64_t audio_pts = 0;  // 下一帧的 pts
+        int64_t video_pts = 0;
+        int64_t nb_video_frames = 0;
+        int audio_finish = 0; // 两者都为1的时候才结束while循环
+        int video_finish = 0;
+        FrameHandle frame;
+        PacketList packets;     // 循环使用，编码到写文件之间没有按包的堆分配
+        while (!audio_finish || !video_finish) {
+            printf("apts:%lld vpts:%lld\n", (long long)audio_pts / 1000, (long long)video_pts / 1000);
+            if (!video_finish && (audio_finish || audio_pts > video_pts)) {
+                ret = ReadVideoFrame(video_encoder, in_yuv_fd, nb_video_frames, yuv_fps, frame);
+                if (ret > 0) {
+                    ret = video_encoder.Encode(frame.Get(), video_index, frame->pts, video_time_base, packets);
+                    video_pts = av_rescale(++nb_video_frames, video_time_base, yuv_fps);
+                } else { // 传入空数据
+                    video_finish = 1;
+                    ret = video_encoder.Encode((const AVFrame *)NULL, video_index, video_pts, video_time_base,
+                                               packets);
                 }
-            }
-        } else if (audio_finish != 1) {
-            read_len = fread(pcm_frame_buf, 1, pcm_frame_size, in_pcm_fd);
-            if (read_len < pcm_frame_size) {
-                audio_finish = 1;
-                printf("fread pcm_frame_buf finish\n");
-            }
-            if (audio_finish != 1) {
-                AVFrame *fltp_frame = AllocFltpPcmFrame(pcm_channels, audio_encoder.GetFrameSize());
-                ret = audio_resampler.ResampleFromS16ToFLTP(pcm_frame_buf, fltp_frame);
-                if (ret < 0)
-                    printf("ResampleFromS16ToFLTP error\n");
-                ret = audio_encoder.Encode(fltp_frame, audio_index, audio_pts, audio_time_base,
-                                           packets);
-                FreePcmFrame(fltp_frame);
             } else {
-                ret = audio_encoder.Encode(NULL, video_index, audio_pts, audio_time_base, packets);
-            }
-            audio_pts += audio_frame_duration; // 叠加pts
-            if (ret >= 0) {
-                for (auto packet : packets) {
-                    mp4_muxer.SendPacket(packet);
+                ret = pcm_source.Read(frame);
+                if (ret > 0) {
+                    int64_t pts = frame->pts;
+                    audio_pts = pts + av_rescale(frame->nb_samples, audio_time_base, frame->sample_rate);
+                    ret = audio_encoder.Encode(frame.Get(), audio_index, pts, audio_time_base, packets);
+                } else {
+                    audio_finish = 1;
+                    ret = audio_encoder.Encode(NULL, audio_index, audio_pts, audio_time_base, packets);
                 }
             }
+            if (ret < 0) {
+                printf("encode failed\n");
+                packets.Clear();
+                encode_ret = ret;
+                break;
+            }
+            for (int i = 0; i < packets.Size(); i++) {
+                mp4_muxer.SendPacket(std::move(packets[i]));
+            }
+            packets.Clear();
         }
     }
-    ret = mp4_muxer.SendTrailer();
-    if (ret < 0) {
-        printf("mp4_muxer.SendTrailer failed\n");
-    }
+    printf("encode %s, wall time:%.1fms\n", ASYNC_ENCODE ? "async" : "sync",
+           (av_gettime_relative() - start_time) / 1000.0);
 
-    printf("write mp4 finish\n");
+    if (encode_ret < 0) {
+        // 文件没有写完，不写 trailer，避免留下看起来完整的截断文件
+        ret = encode_ret;
+        printf("write mp4 failed:%d\n", ret);
+    } else {
+        ret = mp4_muxer.SendTrailer();
+        if (ret < 0) {
+            printf("mp4_muxer.SendTrailer failed\n");
+        } else {
+            printf("write mp4 finish\n");
+        }
+    }
+    packet_pool_dump_stats(pkt_pool, "mp4_muxer");
+    printf("video frame pool acquire:%lld alloc:%lld\n", (long long)video_encoder.GetPoolAcquireCount(),
+           (long long)video_encoder.GetPoolAllocCount());
 
-    if (yuv_frame_buf)
-        free(yuv_frame_buf);
-    if (pcm_frame_buf)
-        free(pcm_frame_buf);
     if (in_yuv_fd)
         fclose(in_yuv_fd);
     if (in_pcm_fd)
         fclose(in_pcm_fd);
+    // 编码器留着的空包要在池释放之前归还
+    video_encoder.DeInit();
+    audio_encoder.DeInit();
+    packet_pool_free(pkt_pool);
 
-    return 0;
+    return ret < 0 ? -1 : 0;
 }
@@ -26,6 +26,16 @@ void Muxer::DeInit()
     if (fmt_ctx_) {
         avformat_close_input(&fmt_ctx_);
     }
+    if (aud_bsf_chain_) {
+        bsf_chain_dump_stats(aud_bsf_chain_, "muxer audio");
+        bsf_chain_free(aud_bsf_chain_);
+        aud_bsf_chain_ = NULL;
+    }
+    if (vid_bsf_chain_) {
+        bsf_chain_dump_stats(vid_bsf_chain_, "muxer video");
+        bsf_chain_free(vid_bsf_chain_);
+        vid_bsf_chain_ = NULL;
+    }
     url_ = "";
     aud_codec_ctx_ = NULL;
     aud_stream_ = NULL;
@@ -35,7 +45,7 @@ void Muxer::DeInit()
     vid_stream_ = NULL;
     video_index_ = -1;
 }
-int Muxer::AddStream(AVCodecContext *codec_ctx)
+int Muxer::AddStream(AVCodecContext *codec_ctx, const char *bsf_filters)
 {
     if (!fmt_ctx_) {
         printf("fmt ctx is NULL\n");
@@ -55,16 +65,34 @@ int Muxer::AddStream(AVCodecContext *codec_ctx)
     // st->index = fmt_ctx_->nb_streams - 1;
     // 从编码器上下文复制
     avcodec_parameters_from_context(st->codecpar, codec_ctx);
+
+    bsf_chain_t *bsf_chain = NULL;
+    if (bsf_filters && bsf_filters[0]) {
+        bsf_chain = bsf_chain_alloc(bsf_filters, st->codecpar, codec_ctx->time_base, st->index,
+                                    pkt_pool_);
+        if (!bsf_chain) {
+            printf("bsf_chain_alloc failed:%s\n", bsf_filters);
+            return -1;
+        }
+        // 过滤器可能修改 extradata 等参数，写头之前以过滤器输出为准
+        avcodec_parameters_copy(st->codecpar, bsf_chain_get_par_out(bsf_chain));
+    }
     av_dump_format(fmt_ctx_, st->index, url_.c_str(), 1);
 
     if (codec_ctx->codec_type == AVMEDIA_TYPE_AUDIO) {
         aud_codec_ctx_ = codec_ctx;
         aud_stream_ = st;
         audio_index_ = st->index;
+        bsf_chain_free(aud_bsf_chain_);
+        aud_bsf_chain_ = bsf_chain;
     } else if (codec_ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
         vid_codec_ctx_ = codec_ctx;
         vid_stream_ = st;
         video_index_ = st->index;
+        bsf_chain_free(vid_bsf_chain_);
+        vid_bsf_chain_ = bsf_chain;
+    } else {
+        bsf_chain_free(bsf_chain);
     }
     return 0;
 }
@@ -89,22 +117,60 @@ int Muxer::SendPacket(AVPacket *packet)
     if (!packet || packet->size <= 0 || !packet->data) {
         printf("packet is null\n");
         if (packet)
-            av_packet_free(&packet);
+            packet_pool_put(pkt_pool_, packet);
 
         return -1;
     }
 
     AVRational src_time_base; // 编码后的包
     AVRational dst_time_base; // mp4 输出文件对应流的 time_base
+    bsf_chain_t *bsf_chain = NULL;
+    AVStream *stream = NULL;
 
     if (vid_stream_ && vid_codec_ctx_ && stream_index == video_index_) {
         src_time_base = vid_codec_ctx_->time_base;
         dst_time_base = vid_stream_->time_base;
+        bsf_chain = vid_bsf_chain_;
+        stream = vid_stream_;
     } else if (aud_stream_ && aud_codec_ctx_ && stream_index == audio_index_) {
         src_time_base = aud_codec_ctx_->time_base;
         dst_time_base = aud_stream_->time_base;
+        bsf_chain = aud_bsf_chain_;
+        stream = aud_stream_;
     }
 
+    if (bsf_chain) {
+        // 先经过过滤器链，时间基还是编码器的时间基
+        int ret = bsf_chain_send_packet(bsf_chain, packet);
+        packet_pool_put(pkt_pool_, packet);
+        if (ret < 0) {
+            return -1;
+        }
+        return DrainBsfChain(bsf_chain, stream);
+    }
+    return WritePacket(packet, src_time_base, dst_time_base);
+}
+int Muxer::DrainBsfChain(bsf_chain_t *chain, AVStream *stream)
+{
+    int ret = 0;
+    AVRational src_time_base = bsf_chain_get_time_base_out(chain);
+    while (1) {
+        AVPacket *out = packet_pool_get(pkt_pool_);
+        if (!out) {
+            return -1;
+        }
+        if (bsf_chain_receive_packet(chain, out) < 0) {
+            packet_pool_put(pkt_pool_, out);
+            break;
+        }
+        if (WritePacket(out, src_time_base, stream->time_base) < 0) {
+            ret = -1;
+        }
+    }
+    return ret;
+}
+int Muxer::WritePacket(AVPacket *packet, AVRational src_time_base, AVRational dst_time_base)
+{
     // 时间基转换
     packet->pts = av_rescale_q(packet->pts, src_time_base, dst_time_base);
     packet->dts = av_rescale_q(packet->dts, src_time_base, dst_time_base);
@@ -115,7 +181,7 @@ int Muxer::SendPacket(AVPacket *packet)
                                      packet); //不是立即写入文件，内部缓存，主要是对pts进行排序
     //    ret = av_write_frame(fmt_ctx_, packet);
 
-    av_packet_free(&packet);
+    packet_pool_put(pkt_pool_, packet);
 
     if (ret == 0) {
         return 0;
@@ -132,6 +198,13 @@ int Muxer::SendTrailer()
         printf("fmt ctx is NULL\n");
         return -1;
     }
+    // 冲刷过滤器链中缓存的包
+    if (vid_bsf_chain_ && bsf_chain_send_packet(vid_bsf_chain_, NULL) == 0) {
+        DrainBsfChain(vid_bsf_chain_, vid_stream_);
+    }
+    if (aud_bsf_chain_ && bsf_chain_send_packet(aud_bsf_chain_, NULL) == 0) {
+        DrainBsfChain(aud_bsf_chain_, aud_stream_);
+    }
     int ret = av_write_trailer(fmt_ctx_);
     if (ret != 0) {
         char errbuf[1024] = {0};
@@ -10,6 +10,9 @@ extern "C"
 #include "libavutil/mathematics.h"
 #include "libavutil/rational.h"
 }
+#include "packetpool.h"
+#include "bsfchain.h"
+#include "packethandle.h"
 
 class Muxer
 {
@@ -27,17 +30,22 @@ public:
     void DeInit();
 
     // 创建流，外部设置好AVCodecContext参数传入
-    int AddStream(AVCodecContext *codec_ctx);
+    // bsf_filters 不为空时给该流挂一个比特流过滤器链，例如 "h264_metadata=level=4.1,dump_extra"
+    int AddStream(AVCodecContext *codec_ctx, const char *bsf_filters = NULL);
 
     // 写流
     int SendHeader();
     int SendPacket(AVPacket *packet);
+    // 同上，包写完后回到 SetPacketPool 设置的池中(应该和取包的池是同一个)
+    int SendPacket(PacketHandle packet) { return SendPacket(packet.Release()); }
     int SendTrailer();
 
     int Open(); // avio_open
 
     int GetAudioStreamIndex() { return audio_index_; }
     int GetVideoStreamIndex() { return video_index_; }
+    // 设置包回收池，SendPacket 写完后把包归还到池中，不设置则直接释放
+    void SetPacketPool(packet_pool_t *pool) { pkt_pool_ = pool; }
 
 private:
     AVFormatContext *fmt_ctx_ = NULL;
@@ -51,4 +59,15 @@ private:
 
     int audio_index_ = -1;
     int video_index_ = -1;
+
+    // 过滤后的包写入文件
+    int WritePacket(AVPacket *packet, AVRational src_time_base, AVRational dst_time_base);
+    // 从过滤器链取出所有包写入文件
+    int DrainBsfChain(bsf_chain_t *chain, AVStream *stream);
+
+    packet_pool_t *pkt_pool_ = NULL;
+
+    // 每个流的比特流过滤器链，可以为NULL
+    bsf_chain_t *aud_bsf_chain_ = NULL;
+    bsf_chain_t *vid_bsf_chain_ = NULL;
 };
\ No newline at end of file
@@ -0,0 +1,242 @@
+/**
+ * @brief         编码 -> mux 热路径的分配次数检查
+ *                合成的 yuv/pcm 帧经过 VideoEncoder、AudioEncoder 编码，输出的包放在 PacketList 中，
+ *                再交给 Muxer 写入 mp4。预热之后统计：
+ *                1. C++ 堆分配次数(operator new，包括 std::vector 扩容);
+ *                2. 包回收池真正调用 av_packet_alloc 的次数;
+ *                3. PacketList 内部数组不够用、扩容到堆上的次数。
+ *                三项都为 0 时输出 PASS，否则输出 FAIL 并返回非0。
+ *                注意：包的数据由编码器(x264、aac)在 FFmpeg 内部分配，不在统计范围内。
+ *
+ *                用法: 13_packet_alloc_check [输出文件] [统计的视频帧数]，
+ *                默认 packet_alloc_check.mp4、250 帧
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+#include "muxer.h"
+#include "videoencoder.h"
+#include "audioencoder.h"
+
+#define VIDEO_WIDTH 352
+#define VIDEO_HEIGHT 288
+#define VIDEO_FPS 25
+#define VIDEO_BIT_RATE 300 * 1024
+#define AUDIO_SAMPLE_RATE 44100
+#define AUDIO_CHANNELS 2
+#define AUDIO_BIT_RATE 128 * 1024
+#define TIME_BASE 1000000
+#define WARMUP_FRAMES 50        // 预热的视频帧数，编码器 lookahead 填满、池中缓存够用
+
+static std::atomic<int64_t> g_new_count(0);
+
+void *operator new(size_t size)
+{
+    g_new_count++;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+struct AllocCounters {
+    int64_t new_count;
+    int64_t packet_alloc_count;
+    int64_t pool_get_count;
+    int64_t overflow_count;
+};
+
+static void get_counters(packet_pool_t *pool, PacketList &packets, AllocCounters *counters)
+{
+    packet_pool_stats_t stats;
+    packet_pool_get_stats(pool, &stats);
+    counters->new_count = g_new_count;
+    counters->packet_alloc_count = stats.packet_alloc_count;
+    counters->pool_get_count = stats.get_count;
+    counters->overflow_count = packets.GetOverflowAllocCount();
+}
+
+// 包交给 muxer 后回到池中，返回写入的包数，<0 失败
+static int send_packets(Muxer &muxer, PacketList &packets)
+{
+    int nb = packets.Size();
+    for (int i = 0; i < nb; i++) {
+        if (muxer.SendPacket(std::move(packets[i])) < 0) {
+            packets.Clear();
+            return -1;
+        }
+    }
+    packets.Clear();
+    return nb;
+}
+
+class Checker
+{
+public:
+    ~Checker()
+    {
+        // 编码器留着的空包在池释放之前归还
+        video_encoder_.DeInit();
+        audio_encoder_.DeInit();
+        muxer_.DeInit();
+        packet_pool_free(pool_);
+    }
+
+    int Init(const char *url)
+    {
+        pool_ = packet_pool_alloc(0);
+        if (!pool_) {
+            printf("packet_pool_alloc failed\n");
+            return -1;
+        }
+        if (video_encoder_.InitH264(VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_FPS, VIDEO_BIT_RATE) < 0 ||
+            audio_encoder_.InitAAC(AUDIO_CHANNELS, AUDIO_SAMPLE_RATE, AUDIO_BIT_RATE) < 0) {
+            return -1;
+        }
+        video_encoder_.SetPacketPool(pool_);
+        audio_encoder_.SetPacketPool(pool_);
+        muxer_.SetPacketPool(pool_);
+        if (muxer_.Init(url) < 0 || muxer_.AddStream(video_encoder_.GetCodecContext()) < 0 ||
+            muxer_.AddStream(audio_encoder_.GetCodecContext()) < 0 || muxer_.Open() < 0 ||
+            muxer_.SendHeader() < 0) {
+            printf("muxer init failed\n");
+            return -1;
+        }
+        video_index_ = muxer_.GetVideoStreamIndex();
+        audio_index_ = muxer_.GetAudioStreamIndex();
+        return 0;
+    }
+
+    // 编码一帧视频以及 pts 在它之前的音频，返回 <0 失败
+    int EncodeFrame()
+    {
+        int64_t video_pts = av_rescale(nb_video_frames_, TIME_BASE, VIDEO_FPS);
+        while (audio_pts_ <= video_pts) {
+            if (EncodeAudio() < 0)
+                return -1;
+        }
+        if (video_encoder_.AcquireFrame(frame_) < 0) {
+            return -1;
+        }
+        // 亮度随帧号变化，避免编码器输出全是 skip 的包
+        memset(frame_->data[0], (int)(nb_video_frames_ * 3 & 0xff), video_encoder_.GetFrameBufferSize());
+        int ret = video_encoder_.Encode((const AVFrame *)frame_.Get(), video_index_, video_pts, TIME_BASE,
+                                        packets_);
+        nb_video_frames_++;
+        if (ret < 0 || (ret = send_packets(muxer_, packets_)) < 0)
+            return -1;
+        nb_packets_ += ret;
+        return 0;
+    }
+
+    int Flush()
+    {
+        if (video_encoder_.Encode((const AVFrame *)NULL, video_index_, 0, TIME_BASE, packets_) < 0 ||
+            send_packets(muxer_, packets_) < 0)
+            return -1;
+        if (audio_encoder_.Encode(NULL, audio_index_, audio_pts_, TIME_BASE, packets_) < 0 ||
+            send_packets(muxer_, packets_) < 0)
+            return -1;
+        return muxer_.SendTrailer();
+    }
+
+    packet_pool_t *GetPool() { return pool_; }
+    PacketList &GetPacketList() { return packets_; }
+    int64_t GetPacketCount() const { return nb_packets_; }
+
+private:
+    int EncodeAudio()
+    {
+        if (audio_encoder_.AcquireFrame(frame_) < 0) {
+            return -1;
+        }
+        // 440Hz 正弦波
+        for (int i = 0; i < frame_->nb_samples; i++) {
+            float v = 0.3f * (float)sin(2 * M_PI * 440 * (nb_samples_ + i) / AUDIO_SAMPLE_RATE);
+            for (int ch = 0; ch < frame_->channels; ch++)
+                ((float *)frame_->data[ch])[i] = v;
+        }
+        int64_t pts = audio_pts_;
+        nb_samples_ += frame_->nb_samples;
+        audio_pts_ = av_rescale(nb_samples_, TIME_BASE, AUDIO_SAMPLE_RATE);
+        int ret = audio_encoder_.Encode(frame_.Get(), audio_index_, pts, TIME_BASE, packets_);
+        if (ret < 0 || (ret = send_packets(muxer_, packets_)) < 0)
+            return -1;
+        nb_packets_ += ret;
+        return 0;
+    }
+
+    packet_pool_t *pool_ = NULL;
+    VideoEncoder video_encoder_;
+    AudioEncoder audio_encoder_;
+    Muxer muxer_;
+    FrameHandle frame_;
+    PacketList packets_;
+    int video_index_ = -1;
+    int audio_index_ = -1;
+    int64_t nb_video_frames_ = 0;
+    int64_t nb_samples_ = 0;
+    int64_t audio_pts_ = 0;
+    int64_t nb_packets_ = 0;
+};
+
+int main(int argc, char **argv)
+{
+    const char *url = argc > 1 ? argv[1] : "packet_alloc_check.mp4";
+    int nb_frames = argc > 2 ? atoi(argv[2]) : 250;
+    if (nb_frames <= 0) {
+        printf("invalid frames\n");
+        return -1;
+    }
+
+    Checker checker;
+    if (checker.Init(url) < 0) {
+        printf("init failed\n");
+        return -1;
+    }
+    for (int i = 0; i < WARMUP_FRAMES; i++) {
+        if (checker.EncodeFrame() < 0) {
+            printf("encode failed\n");
+            return -1;
+        }
+    }
+
+    AllocCounters before, after;
+    int64_t packets_before = checker.GetPacketCount();
+    get_counters(checker.GetPool(), checker.GetPacketList(), &before);
+    for (int i = 0; i < nb_frames; i++) {
+        if (checker.EncodeFrame() < 0) {
+            printf("encode failed\n");
+            return -1;
+        }
+    }
+    get_counters(checker.GetPool(), checker.GetPacketList(), &after);
+    int64_t nb_packets = checker.GetPacketCount() - packets_before;
+
+    if (checker.Flush() < 0) {
+        printf("flush failed\n");
+        return -1;
+    }
+
+    int64_t new_count = after.new_count - before.new_count;
+    int64_t packet_allocs = after.packet_alloc_count - before.packet_alloc_count;
+    int64_t overflows = after.overflow_count - before.overflow_count;
+    int64_t pool_gets = after.pool_get_count - before.pool_get_count;
+    bool ok = new_count == 0 && packet_allocs == 0 && overflows == 0;
+    printf("%d video frames, %lld packets | operator new:%lld av_packet_alloc:%lld list overflow:%lld"
+           " | pool get/packet:%.2f | %s\n",
+           nb_frames, (long long)nb_packets, (long long)new_count, (long long)packet_allocs,
+           (long long)overflows, nb_packets > 0 ? (double)pool_gets / nb_packets : 0.0, ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+#include "packetpool.h"
+
+// 独占一个 AVPacket：只能移动不能拷贝，析构时归还到包回收池(pool 为 NULL 时 av_packet_free)
+class PacketHandle
+{
+public:
+    PacketHandle() = default;
+    PacketHandle(packet_pool_t *pool, AVPacket *packet) : pool_(pool), packet_(packet) {}
+    ~PacketHandle() { Reset(); }
+
+    PacketHandle(const PacketHandle &) = delete;
+    PacketHandle &operator=(const PacketHandle &) = delete;
+    PacketHandle(PacketHandle &&other) noexcept : pool_(other.pool_), packet_(other.Release()) {}
+    PacketHandle &operator=(PacketHandle &&other) noexcept
+    {
+        if (this != &other) {
+            Reset();
+            pool_ = other.pool_;
+            packet_ = other.Release();
+        }
+        return *this;
+    }
+
+    // 从池中取一个空包，失败时句柄为空
+    static PacketHandle Get(packet_pool_t *pool) { return PacketHandle(pool, packet_pool_get(pool)); }
+
+    AVPacket *Get() const { return packet_; }
+    AVPacket *operator->() const { return packet_; }
+    explicit operator bool() const { return packet_ != NULL; }
+
+    // 交出所有权，调用者负责归还(例如 Muxer::SendPacket)
+    AVPacket *Release()
+    {
+        AVPacket *packet = packet_;
+        packet_ = NULL;
+        return packet;
+    }
+    void Reset()
+    {
+        if (packet_)
+            packet_pool_put(pool_, packet_);
+        packet_ = NULL;
+    }
+
+private:
+    packet_pool_t *pool_ = NULL;
+    AVPacket *packet_ = NULL;
+};
+
+/**
+* 编码器一次输出的包：前 N 个放在对象内部的数组里，超出时才放到 std::vector(只在第一次超出时分配，
+* Clear 之后保留容量)。同一个 PacketList 循环使用时稳态下没有堆分配。
+* Clear 和析构时还没有取走的包归还到池中。
+*/
+template <int N>
+class SmallPacketList
+{
+public:
+    SmallPacketList() = default;
+    SmallPacketList(const SmallPacketList &) = delete;
+    SmallPacketList &operator=(const SmallPacketList &) = delete;
+
+    void PushBack(PacketHandle packet)
+    {
+        if (size_ < N) {
+            inline_[size_] = std::move(packet);
+        } else {
+            if (overflow_.capacity() == overflow_.size())
+                overflow_allocs_++;
+            overflow_.push_back(std::move(packet));
+        }
+        size_++;
+    }
+    int Size() const { return size_; }
+    bool Empty() const { return size_ == 0; }
+    PacketHandle &operator[](int i) { return i < N ? inline_[i] : overflow_[i - N]; }
+    void Clear()
+    {
+        for (int i = 0; i < size_ && i < N; i++)
+            inline_[i].Reset();
+        overflow_.clear();
+        size_ = 0;
+    }
+    // overflow_ 扩容的次数，用于确认内部数组的大小是否足够
+    int64_t GetOverflowAllocCount() const { return overflow_allocs_; }
+
+private:
+    PacketHandle inline_[N];
+    std::vector<PacketHandle> overflow_;
+    int size_ = 0;
+    int64_t overflow_allocs_ = 0;
+};
+
+// 一次编码通常输出 0~1 个包，flush 时输出编码器中缓存的所有包(x264 lookahead 可能有几十个)
+typedef SmallPacketList<16> PacketList;
@@ -0,0 +1,104 @@
+#include "resampler.h"
+
+int Resampler::Init(const audio_resampler_params_t &params, int frame_size)
+{
+    ctx_.reset(audio_resampler_alloc(params));
+    if (!ctx_) {
+        printf("audio_resampler_alloc failed\n");
+        return -1;
+    }
+    params_ = params;
+    frame_size_ = frame_size > 0 ? frame_size : 0;
+    flushed_ = false;
+    return 0;
+}
+
+int Resampler::EnableDriftCompensation(const audio_resampler_drift_params_t *params)
+{
+    if (!ctx_) {
+        return AVERROR(EINVAL);
+    }
+    return audio_resampler_enable_drift_compensation(ctx_.get(), params);
+}
+
+// 第一个输入 pts 换算到输出采样率，之后的 pts 由 audio_resampler_t 按输出采样点数累加
+int64_t Resampler::ToOutputPts(int64_t pts, AVRational time_base)
+{
+    if (pts == AV_NOPTS_VALUE)
+        return 0;
+    return av_rescale_q(pts, time_base, GetTimeBase());
+}
+
+int Resampler::Send(uint8_t **in_data, int nb_samples, int64_t pts, AVRational time_base)
+{
+    if (!ctx_ || flushed_ || !in_data) {
+        printf("Resampler::Send invalid state\n");
+        return AVERROR(EINVAL);
+    }
+    return audio_resampler_send_frame2(ctx_.get(), in_data, nb_samples, ToOutputPts(pts, time_base));
+}
+
+int Resampler::Send(const AVFrame *frame, AVRational time_base)
+{
+    if (!frame) {
+        return Flush();
+    }
+    return Send(frame->extended_data, frame->nb_samples, frame->pts, time_base);
+}
+
+int Resampler::Send(uint8_t *in_data, int in_bytes, int64_t pts, AVRational time_base)
+{
+    if (!ctx_ || flushed_ || !in_data) {
+        printf("Resampler::Send invalid state\n");
+        return AVERROR(EINVAL);
+    }
+    return audio_resampler_send_frame3(ctx_.get(), in_data, in_bytes, ToOutputPts(pts, time_base));
+}
+
+int Resampler::Flush()
+{
+    if (!ctx_) {
+        return AVERROR(EINVAL);
+    }
+    if (flushed_)
+        return 0;
+    flushed_ = true;
+    return audio_resampler_send_frame2(ctx_.get(), NULL, 0, AV_NOPTS_VALUE);
+}
+
+int Resampler::Receive(FrameHandle &frame)
+{
+    if (!ctx_) {
+        return AVERROR(EINVAL);
+    }
+    if (!frame) {
+        frame = FrameHandle::Alloc();
+        if (!frame)
+            return AVERROR(ENOMEM);
+    }
+    int nb_samples = frame_size_;
+    // flush 之后不足一帧的部分也输出
+    if (flushed_ && audio_resampler_get_fifo_size(ctx_.get()) < nb_samples)
+        nb_samples = 0;
+    return audio_resampler_receive_frame_into(ctx_.get(), frame.Get(), nb_samples);
+}
+
+FrameHandle Resampler::Receive()
+{
+    FrameHandle frame;
+    if (Receive(frame) <= 0)
+        return FrameHandle();
+    return frame;
+}
+
+int Resampler::GetBufferedSamples() const
+{
+    return audio_resampler_get_fifo_size(ctx_.get());
+}
+
+int64_t Resampler::GetNextPts() const
+{
+    if (!ctx_)
+        return AV_NOPTS_VALUE;
+    return audio_resampler_get_cur_pts(ctx_.get());
+}
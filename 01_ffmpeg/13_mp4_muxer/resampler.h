@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+extern "C"
+{
+#include "audioresampler.h"
+}
+#include "framehandle.h"
+
+/**
+* 通用的音频重采样：任意采样格式、声道布局、采样率之间转换。
+* 内部就是 09_02_audio_resample 的 audio_resampler_t(swresample/定比快速路径 + fifo)，这里只做 C++ 封装：
+* (1) RAII 管理重采样器，不需要 DeInit;
+* (2) 输出帧用 FrameHandle，循环使用同一个句柄时稳态下没有分配;
+* (3) frame_size > 0 时按帧对齐输出(例如 AAC 的 1024)，fifo 不够一帧时不输出，flush 后输出剩余不足一帧的部分;
+* (4) 输出 pts 的时间基是 1/输出采样率，由第一个输入 pts 加上已输出的采样点数得到，长时间运行也没有累计误差。
+*/
+class Resampler
+{
+public:
+    Resampler() = default;
+    Resampler(const Resampler &) = delete;
+    Resampler &operator=(const Resampler &) = delete;
+    Resampler(Resampler &&) = default;
+    Resampler &operator=(Resampler &&) = default;
+
+    /**
+     * @brief 初始化，可以重复调用，之前缓存的数据丢弃
+     * @param params 输入输出的格式、采样率、声道布局
+     * @param frame_size 每个输出帧的采样点数，<=0 时有多少输出多少
+     * @return 0 成功，<0 失败
+     */
+    int Init(const audio_resampler_params_t &params, int frame_size = 0);
+
+    // 打开时钟漂移补偿(见 audio_resampler_enable_drift_compensation)，Init 之后、第一次 Send 之前调用，
+    // 之后 Send 的 pts 要用本地时钟
+    int EnableDriftCompensation(const audio_resampler_drift_params_t *params = NULL);
+    // 当前的采样率调整比例(百万分之一)
+    double GetDriftPpm() const { return audio_resampler_get_drift_ppm(ctx_.get()); }
+
+    /**
+     * @brief 送入 nb_samples 个采样点
+     * @param in_data 平面格式每个通道一个指针，交错格式只用 in_data[0]
+     * @param pts 第一个采样点的时间戳，时间基为 time_base，只有第一次送入的 pts 有效
+     * @return 这次重采样得到的采样点数，<0 失败
+     */
+    int Send(uint8_t **in_data, int nb_samples, int64_t pts, AVRational time_base);
+    int Send(const AVFrame *frame, AVRational time_base);
+    // 连续存放的一块数据(交错格式或者各平面依次存放)，in_bytes 为总字节数
+    int Send(uint8_t *in_data, int in_bytes, int64_t pts, AVRational time_base);
+
+    // 输入结束，取出重采样器里剩余的采样点
+    int Flush();
+
+    /**
+     * @brief 取一帧输出，写入 frame(为空时分配)，帧内存可以复用时不重新分配
+     * @return 输出的采样点数，数据不够一帧返回0，<0 失败
+     */
+    int Receive(FrameHandle &frame);
+    // 同上，每次返回新分配的帧，数据不够时句柄为空
+    FrameHandle Receive();
+
+    // fifo 中缓存的采样点数
+    int GetBufferedSamples() const;
+    int GetFrameSize() const { return frame_size_; }
+    // 输出 pts 的时间基
+    AVRational GetTimeBase() const { return AVRational{1, params_.dst_sample_rate}; }
+    // 下一个输出帧的 pts，还没有输入时为 AV_NOPTS_VALUE
+    int64_t GetNextPts() const;
+
+private:
+    struct Deleter
+    {
+        void operator()(audio_resampler_t *r) const { audio_resampler_free(r); }
+    };
+    int64_t ToOutputPts(int64_t pts, AVRational time_base);
+
+    std::unique_ptr<audio_resampler_t, Deleter> ctx_;
+    audio_resampler_params_t params_ = {};
+    int frame_size_ = 0;
+    bool flushed_ = false;
+};
@@ -65,6 +65,19 @@ int VideoEncoder::InitH264(int width, int height, int fps, int bit_rate)
     frame_->height = height_;
     frame_->format = codec_ctx_->pix_fmt;
 
+    ref_frame_ = av_frame_alloc();
+    if (!ref_frame_) {
+        printf("av_frame_alloc failed\n");
+        return -1;
+    }
+    // AcquireFrame 的内存池：各平面连续存放，和 yuv 文件的布局一致
+    frame_buffer_size_ = av_image_get_buffer_size(codec_ctx_->pix_fmt, width_, height_, 1);
+    frame_pool_ = av_buffer_pool_init2(frame_buffer_size_, this, PoolAlloc, NULL);
+    if (!frame_pool_) {
+        printf("av_buffer_pool_init2 failed\n");
+        return -1;
+    }
+
     printf("Inith264 success\n");
     return 0;
 }
@@ -77,6 +90,53 @@ void VideoEncoder::DeInit()
     if (frame_) {
         av_frame_free(&frame_);
     }
+    av_frame_free(&ref_frame_);
+    spare_.Reset();     // 在包回收池释放之前归还
+    // 只是标记，还被帧引用的内存在最后一次 unref 时释放
+    av_buffer_pool_uninit(&frame_pool_);
+}
+
+// 池中没有空闲内存时调用，只在 AcquireFrame 的线程中调用
+AVBufferRef *VideoEncoder::PoolAlloc(void *opaque, int size)
+{
+    VideoEncoder *encoder = (VideoEncoder *)opaque;
+    encoder->pool_alloc_count_++;
+    return av_buffer_alloc(size);
+}
+
+int VideoEncoder::AcquireFrame(FrameHandle &frame)
+{
+    if (!frame_pool_) {
+        printf("frame_pool_ null\n");
+        return -1;
+    }
+    if (!frame) {
+        frame = FrameHandle::Alloc();
+        if (!frame)
+            return AVERROR(ENOMEM);
+    } else {
+        av_frame_unref(frame.Get());    // 之前的内存还被编码器引用时不受影响
+    }
+    frame->buf[0] = av_buffer_pool_get(frame_pool_);
+    if (!frame->buf[0]) {
+        printf("av_buffer_pool_get failed\n");
+        return AVERROR(ENOMEM);
+    }
+    pool_acquire_count_++;
+    frame->width = width_;
+    frame->height = height_;
+    frame->format = codec_ctx_->pix_fmt;
+    av_image_fill_arrays(frame->data, frame->linesize, frame->buf[0]->data,
+                         (AVPixelFormat)frame->format, frame->width, frame->height, 1);
+    return 0;
+}
+
+FrameHandle VideoEncoder::AcquireFrame()
+{
+    FrameHandle frame;
+    if (AcquireFrame(frame) < 0)
+        return FrameHandle();
+    return frame;
 }
 
 AVPacket *VideoEncoder::Encode(uint8_t *yuv_data, int yuv_size, int stream_index, int64_t pts,
@@ -124,29 +184,88 @@ AVPacket *VideoEncoder::Encode(uint8_t *yuv_data, int yuv_size, int stream_index
 }
 
 int VideoEncoder::Encode(uint8_t *yuv_data, int yuv_size, int stream_index, int64_t pts,
-                         int64_t time_base, std::vector<AVPacket *> &packets)
+                         int64_t time_base, PacketList &packets)
 {
     if (!codec_ctx_) {
         printf("codec_ctx_ null\n");
         return -1;
     }
-    int ret = 0;
+    if (!yuv_data) {
+        return SendFrame(NULL, stream_index, packets);
+    }
 
-    pts = av_rescale_q(pts, AVRational{1, (int)time_base}, codec_ctx_->time_base);
-    frame_->pts = pts;
-    if (yuv_data) {
-        int ret_size =
-            av_image_fill_arrays(frame_->data, frame_->linesize, yuv_data,
-                                 (AVPixelFormat)frame_->format, frame_->width, frame_->height, 1);
+    frame_->pts = av_rescale_q(pts, AVRational{1, (int)time_base}, codec_ctx_->time_base);
+    int ret_size =
+        av_image_fill_arrays(frame_->data, frame_->linesize, yuv_data,
+                             (AVPixelFormat)frame_->format, frame_->width, frame_->height, 1);
+    if (ret_size != yuv_size) {
+        printf("ret_size:%d != yuv_size:%d -> failed\n", ret_size, yuv_size);
+        return -1;
+    }
+    return SendFrame(frame_, stream_index, packets);
+}
 
-        if (ret_size != yuv_size) {
-            printf("ret_size:%d != yuv_size:%d -> failed\n", ret_size, yuv_size);
-            return -1;
-        }
-        ret = avcodec_send_frame(codec_ctx_, frame_);
-    } else {
-        ret = avcodec_send_frame(codec_ctx_, NULL);
+int VideoEncoder::Encode(const AVFrame *frame, int stream_index, int64_t pts, int64_t time_base,
+                         PacketList &packets)
+{
+    if (!codec_ctx_) {
+        printf("codec_ctx_ null\n");
+        return -1;
+    }
+    if (!frame) {
+        return SendFrame(NULL, stream_index, packets);
+    }
+    // 没有引用计数的帧 av_frame_ref 会整帧拷贝，应该用 Encode(yuv_data, yuv_size, ...)
+    if (!frame->buf[0]) {
+        printf("frame is not reference counted\n");
+        return -1;
     }
+    int ret = av_frame_ref(ref_frame_, frame);
+    if (ret < 0) {
+        printf("av_frame_ref failed\n");
+        return -1;
+    }
+    ref_frame_->pts = av_rescale_q(pts, AVRational{1, (int)time_base}, codec_ctx_->time_base);
+    ret = SendFrame(ref_frame_, stream_index, packets);
+    av_frame_unref(ref_frame_);     // 编码器还需要这一帧时自己持有引用
+    return ret;
+}
+
+int VideoEncoder::Encode(uint8_t *yuv_data, int yuv_size, void (*free_cb)(void *opaque, uint8_t *data),
+                         void *opaque, int stream_index, int64_t pts, int64_t time_base,
+                         PacketList &packets)
+{
+    if (!codec_ctx_) {
+        printf("codec_ctx_ null\n");
+        return -1;
+    }
+    if (!yuv_data) {
+        return SendFrame(NULL, stream_index, packets);
+    }
+    if (yuv_size != frame_buffer_size_) {
+        printf("yuv_size:%d != %d -> failed\n", yuv_size, frame_buffer_size_);
+        return -1;
+    }
+    ref_frame_->buf[0] = av_buffer_create(yuv_data, yuv_size, free_cb, opaque, 0);
+    if (!ref_frame_->buf[0]) {
+        printf("av_buffer_create failed\n");
+        return -1;
+    }
+    ref_frame_->width = width_;
+    ref_frame_->height = height_;
+    ref_frame_->format = codec_ctx_->pix_fmt;
+    av_image_fill_arrays(ref_frame_->data, ref_frame_->linesize, yuv_data,
+                         (AVPixelFormat)ref_frame_->format, width_, height_, 1);
+    ref_frame_->pts = av_rescale_q(pts, AVRational{1, (int)time_base}, codec_ctx_->time_base);
+    int ret = SendFrame(ref_frame_, stream_index, packets);
+    // 编码器没有保留这一帧时 free_cb 在这里调用，否则在编码器释放它时调用
+    av_frame_unref(ref_frame_);
+    return ret;
+}
+
+int VideoEncoder::SendFrame(const AVFrame *frame, int stream_index, PacketList &packets)
+{
+    int ret = avcodec_send_frame(codec_ctx_, frame);
     if (ret != 0) {
         char errbuf[1024] = {0};
         av_strerror(ret, errbuf, sizeof(errbuf) - 1);
@@ -155,21 +274,26 @@ int VideoEncoder::Encode(uint8_t *yuv_data, int yuv_size, int stream_index, int6
     }
 
     while (1) {
-        AVPacket *packet = av_packet_alloc();
-        ret = avcodec_receive_packet(codec_ctx_, packet);
-        packet->stream_index = stream_index;
+        // 大多数调用没有输出(EAGAIN)，空包留在 spare_ 中下次继续用
+        if (!spare_) {
+            spare_ = PacketHandle::Get(pkt_pool_);
+            if (!spare_) {
+                printf("packet_pool_get failed\n");
+                return -1;
+            }
+        }
+        ret = avcodec_receive_packet(codec_ctx_, spare_.Get());
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
             ret = 0;
-            av_packet_free(&packet);
             break;
         } else if (ret < 0) {
             char errbuf[1024] = {0};
             av_strerror(ret, errbuf, sizeof(errbuf) - 1);
             printf("h264 avcodec_receive_packet failed:%s\n", errbuf);
-            av_packet_free(&packet);
             return -1;
         }
-        packets.push_back(packet);
+        spare_->stream_index = stream_index;
+        packets.PushBack(std::move(spare_));
     }
     return ret;
 }
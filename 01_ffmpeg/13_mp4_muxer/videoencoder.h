@@ -6,7 +6,20 @@ extern "C"
 #include "libavformat/avformat.h"
 #include "libavcodec/avcodec.h"
 }
+#include "packetpool.h"
+#include "framehandle.h"
+#include "packethandle.h"
 
+/**
+* H264 编码，输入帧有三种送法：
+* (1) Encode(yuv_data, ...)：调用者的裸内存，没有引用计数，FFmpeg 内部需要保留帧时(帧级多线程编码等)会整帧拷贝;
+* (2) AcquireFrame + Encode(frame, ...)：从编码器持有的内存池取帧，填好后送入，编码器只增加引用，
+*     最后一个引用释放后内存自动回到池中，稳态下没有分配也没有拷贝;
+* (3) Encode(yuv_data, ..., free_cb, opaque, ...)：调用者的内存用 av_buffer_create 包装后送入，
+*     编码器释放最后一个引用时回调 free_cb，调用者在回调之后才能改写、复用这块内存。
+* (2)(3) 在编码器内部延迟持有帧(lookahead、B 帧、帧级多线程)时也是安全的。
+* 输出的包以 PacketHandle 追加到 PacketList，包从回收池中取，调用者交给 Muxer::SendPacket 后回到池中。
+*/
 class VideoEncoder
 {
 public:
@@ -18,10 +31,45 @@ public:
                      int64_t time_base);
                      
     int Encode(uint8_t *yuv_data, int yuv_size, int stream_index, int64_t pts,
-                        int64_t time_base, std::vector<AVPacket *>& packets);
-   
+                        int64_t time_base, PacketList &packets);
+
+    /**
+     * @brief 从编码器的内存池取一帧，宽高、像素格式同编码器，各平面连续存放(和 yuv 文件的布局一致，
+     *        可以直接 fread GetFrameBufferSize() 字节到 data[0])
+     * @param frame 为空时分配，不为空时先释放它原来的引用再复用
+     * @return 0 成功，<0 失败
+     */
+    int AcquireFrame(FrameHandle &frame);
+    // 同上，每次返回新的句柄，失败时句柄为空
+    FrameHandle AcquireFrame();
+    // AcquireFrame 的帧数据大小
+    int GetFrameBufferSize() const { return frame_buffer_size_; }
+    /**
+     * @brief 送入引用计数的帧(frame->buf 不为空)，编码器只增加引用，不拷贝数据。
+     *        返回后调用者可以释放自己的引用，但在编码器释放之前不能改写帧的内存
+     * @param frame NULL 表示 flush
+     */
+    int Encode(const AVFrame *frame, int stream_index, int64_t pts, int64_t time_base,
+               PacketList &packets);
+    /**
+     * @brief 送入调用者的内存，用 av_buffer_create 包装成引用计数的帧，不拷贝数据
+     * @param free_cb 编码器释放最后一个引用时调用 free_cb(opaque, yuv_data)，可能在编码器内部线程中调用;
+     *        返回失败时如果没有调用过 free_cb，内存仍归调用者
+     */
+    int Encode(uint8_t *yuv_data, int yuv_size, void (*free_cb)(void *opaque, uint8_t *data),
+               void *opaque, int stream_index, int64_t pts, int64_t time_base,
+               PacketList &packets);
+    // 内存池统计：取帧次数和真正分配内存的次数
+    int64_t GetPoolAcquireCount() const { return pool_acquire_count_; }
+    int64_t GetPoolAllocCount() const { return pool_alloc_count_; }
 
     AVCodecContext *GetCodecContext();
+    // 设置包回收池，输出的包从池中获取，不设置则使用 av_packet_alloc
+    void SetPacketPool(packet_pool_t *pool)
+    {
+        spare_.Reset();
+        pkt_pool_ = pool;
+    }
 
 private:
     int width_ = 0;
@@ -30,5 +78,17 @@ private:
     int bit_rate_ = 500 * 1024;
     int64_t pts_ = 0;
     AVCodecContext *codec_ctx_ = NULL;
+    packet_pool_t *pkt_pool_ = NULL;
     AVFrame *frame_ = NULL;
+
+    // 送入一帧(NULL 为 flush)并取出所有输出的包
+    int SendFrame(const AVFrame *frame, int stream_index, PacketList &packets);
+    static AVBufferRef *PoolAlloc(void *opaque, int size);
+
+    PacketHandle spare_;                // 没有取到输出时留着下次用，不用每次都从池中取、还
+    AVFrame *ref_frame_ = NULL;         // 引用计数送入时的临时帧，只持有引用
+    AVBufferPool *frame_pool_ = NULL;   // AcquireFrame 的内存池，每帧一块连续内存
+    int frame_buffer_size_ = 0;
+    int64_t pool_acquire_count_ = 0;
+    int64_t pool_alloc_count_ = 0;
 };
\ No newline at end of file
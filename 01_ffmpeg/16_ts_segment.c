@@ -0,0 +1,325 @@
+/**
+ * @brief         MPEG-TS 切片：按关键帧把输入(TS/MP4/FLV)切成 HLS 的 ts 分片并生成 m3u8
+ *                1. 只做 stream copy，不解码不编码
+ *                2. 只在视频关键帧处切片，保证每个分片都能独立解码
+ *                3. 一次只持有一个 AVPacket 和一个输出分片，内存占用与输入文件大小无关
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "libavutil/log.h"
+#include "libavutil/mathematics.h"
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+
+#define ERROR_STRING_SIZE 1024
+#define MAX_PATH_SIZE 1024
+#define DEFAULT_SEGMENT_DURATION 6.0 // 默认分片时长(秒)
+
+// 切片器的上下文
+typedef struct ts_segmenter {
+    AVFormatContext *ifmt_ctx;  // 输入
+    AVFormatContext *ofmt_ctx;  // 当前正在写的分片
+    int *stream_mapping;        // 输入流 -> 输出流 的映射，-1表示丢弃
+    int nb_out_streams;
+    int video_index;            // 用来判断切点的视频流，没有视频时按时间切
+
+    const char *out_prefix;     // 分片文件前缀，例如 out/live 生成 out/live_0.ts
+    double target_duration;     // 期望的分片时长(秒)
+    int segment_index;          // 当前分片序号
+    int64_t segment_start;      // 当前分片起始时间，单位 AV_TIME_BASE
+    int64_t last_end;           // 已写入包的最大结束时间，单位 AV_TIME_BASE
+    double max_duration;        // 所有分片的最大时长，用于 EXT-X-TARGETDURATION
+
+    FILE *entry_fp;             // m3u8 分片条目先写到临时文件，结束时再拼成完整的 m3u8
+    char entry_filename[MAX_PATH_SIZE];
+} ts_segmenter_t;
+
+static char errors[ERROR_STRING_SIZE];
+
+static const char *get_err(int errnum)
+{
+    av_strerror(errnum, errors, sizeof(errors));
+    return errors;
+}
+
+// 分片文件名去掉目录部分，m3u8 中使用相对路径
+static const char *get_basename(const char *path)
+{
+    const char *p1 = strrchr(path, '/');
+    const char *p2 = strrchr(path, '\\');
+    const char *p = p1 > p2 ? p1 : p2;
+    return p ? p + 1 : path;
+}
+
+/**
+ * @brief 打开一个新的分片
+ * @return 成功返回0
+ */
+static int open_segment(ts_segmenter_t *seg)
+{
+    char filename[MAX_PATH_SIZE];
+    snprintf(filename, sizeof(filename), "%s_%d.ts", seg->out_prefix, seg->segment_index);
+
+    int ret = avformat_alloc_output_context2(&seg->ofmt_ctx, NULL, "mpegts", filename);
+    if (ret < 0) {
+        printf("avformat_alloc_output_context2 failed: %s\n", get_err(ret));
+        return ret;
+    }
+    for (unsigned int i = 0; i < seg->ifmt_ctx->nb_streams; i++) {
+        if (seg->stream_mapping[i] < 0)
+            continue;
+        AVStream *in_stream = seg->ifmt_ctx->streams[i];
+        AVStream *out_stream = avformat_new_stream(seg->ofmt_ctx, NULL);
+        if (!out_stream) {
+            printf("avformat_new_stream failed\n");
+            return AVERROR(ENOMEM);
+        }
+        ret = avcodec_parameters_copy(out_stream->codecpar, in_stream->codecpar);
+        if (ret < 0) {
+            printf("avcodec_parameters_copy failed: %s\n", get_err(ret));
+            return ret;
+        }
+        out_stream->codecpar->codec_tag = 0; // 由 mpegts muxer 自己决定
+        out_stream->time_base = in_stream->time_base;
+    }
+    ret = avio_open(&seg->ofmt_ctx->pb, filename, AVIO_FLAG_WRITE);
+    if (ret < 0) {
+        printf("avio_open %s failed: %s\n", filename, get_err(ret));
+        return ret;
+    }
+    // MP4/FLV 输入的 H.264 为 AVCC 格式，mpegts muxer 会自动插入 h264_mp4toannexb
+    ret = avformat_write_header(seg->ofmt_ctx, NULL);
+    if (ret < 0) {
+        printf("avformat_write_header failed: %s\n", get_err(ret));
+        return ret;
+    }
+    printf("open segment %s\n", filename);
+    return 0;
+}
+
+/**
+ * @brief 结束当前分片，并把分片条目写入 m3u8 临时文件
+ * @param end_time 分片结束时间，单位 AV_TIME_BASE
+ */
+static int close_segment(ts_segmenter_t *seg, int64_t end_time)
+{
+    if (!seg->ofmt_ctx) {
+        return 0;
+    }
+    int ret = av_write_trailer(seg->ofmt_ctx);
+    if (ret < 0) {
+        printf("av_write_trailer failed: %s\n", get_err(ret));
+    }
+    avio_closep(&seg->ofmt_ctx->pb);
+    avformat_free_context(seg->ofmt_ctx);
+    seg->ofmt_ctx = NULL;
+
+    double duration = (end_time - seg->segment_start) / (double)AV_TIME_BASE;
+    if (duration < 0)
+        duration = 0;
+    if (duration > seg->max_duration)
+        seg->max_duration = duration;
+
+    char filename[MAX_PATH_SIZE];
+    snprintf(filename, sizeof(filename), "%s_%d.ts", seg->out_prefix, seg->segment_index);
+    fprintf(seg->entry_fp, "#EXTINF:%.6f,\n%s\n", duration, get_basename(filename));
+    printf("close segment %s, duration:%.3fs\n", filename, duration);
+
+    seg->segment_index++;
+    return ret;
+}
+
+/**
+ * @brief 生成最终的 m3u8: 头部 + 临时文件中的分片条目 + ENDLIST
+ */
+static int write_playlist(ts_segmenter_t *seg, const char *m3u8_filename)
+{
+    FILE *fp = fopen(m3u8_filename, "wb");
+    if (!fp) {
+        printf("open %s failed\n", m3u8_filename);
+        return -1;
+    }
+    fprintf(fp, "#EXTM3U\n");
+    fprintf(fp, "#EXT-X-VERSION:3\n");
+    fprintf(fp, "#EXT-X-TARGETDURATION:%d\n", (int)ceil(seg->max_duration));
+    fprintf(fp, "#EXT-X-MEDIA-SEQUENCE:0\n");
+    fprintf(fp, "#EXT-X-PLAYLIST-TYPE:VOD\n");
+
+    // 条目只需顺序拷贝，使用固定大小的缓冲区
+    char buf[4096];
+    size_t len = 0;
+    fflush(seg->entry_fp);
+    rewind(seg->entry_fp);
+    while ((len = fread(buf, 1, sizeof(buf), seg->entry_fp)) > 0) {
+        fwrite(buf, 1, len, fp);
+    }
+    fprintf(fp, "#EXT-X-ENDLIST\n");
+    fclose(fp);
+    return 0;
+}
+
+// 包的时间(优先pts)，单位 AV_TIME_BASE
+static int64_t get_packet_time(const AVPacket *pkt, AVRational time_base)
+{
+    int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+    if (ts == AV_NOPTS_VALUE)
+        return AV_NOPTS_VALUE;
+    return av_rescale_q(ts, time_base, AV_TIME_BASE_Q);
+}
+
+/**
+ * 使用示例：
+ * 16_ts_segment input.ts out/live out/live.m3u8 6
+ * 生成 out/live_0.ts out/live_1.ts ... 和 out/live.m3u8
+ * 播放: ffplay out/live.m3u8
+ */
+int main(int argc, char **argv)
+{
+    if (argc < 4) {
+        printf("用法: %s input.ts out_prefix out.m3u8 [segment_seconds]\n", argv[0]);
+        return -1;
+    }
+    const char *in_filename = argv[1];
+    const char *m3u8_filename = argv[3];
+
+    ts_segmenter_t seg;
+    memset(&seg, 0, sizeof(seg));
+    seg.out_prefix = argv[2];
+    seg.target_duration = argc > 4 ? atof(argv[4]) : DEFAULT_SEGMENT_DURATION;
+    if (seg.target_duration <= 0)
+        seg.target_duration = DEFAULT_SEGMENT_DURATION;
+    seg.segment_start = AV_NOPTS_VALUE;
+    seg.last_end = AV_NOPTS_VALUE;
+
+    AVPacket *pkt = NULL;
+    int ret = 0;
+
+    // m3u8 条目的临时文件
+    snprintf(seg.entry_filename, sizeof(seg.entry_filename), "%s.tmp", m3u8_filename);
+    seg.entry_fp = fopen(seg.entry_filename, "wb+");
+    if (!seg.entry_fp) {
+        printf("打开临时文件 %s 失败\n", seg.entry_filename);
+        return -1;
+    }
+
+    if ((ret = avformat_open_input(&seg.ifmt_ctx, in_filename, NULL, NULL)) < 0) {
+        printf("打开输入文件失败: %s\n", get_err(ret));
+        goto cleanup;
+    }
+    if ((ret = avformat_find_stream_info(seg.ifmt_ctx, NULL)) < 0) {
+        printf("获取流信息失败: %s\n", get_err(ret));
+        goto cleanup;
+    }
+    av_dump_format(seg.ifmt_ctx, 0, in_filename, 0);
+
+    // 只保留音视频流，其它流(数据流、字幕)丢弃
+    seg.stream_mapping = (int *)av_mallocz_array(seg.ifmt_ctx->nb_streams, sizeof(int));
+    if (!seg.stream_mapping) {
+        ret = AVERROR(ENOMEM);
+        goto cleanup;
+    }
+    for (unsigned int i = 0; i < seg.ifmt_ctx->nb_streams; i++) {
+        enum AVMediaType type = seg.ifmt_ctx->streams[i]->codecpar->codec_type;
+        if (type == AVMEDIA_TYPE_VIDEO || type == AVMEDIA_TYPE_AUDIO) {
+            seg.stream_mapping[i] = seg.nb_out_streams++;
+        } else {
+            seg.stream_mapping[i] = -1;
+        }
+    }
+    seg.video_index = av_find_best_stream(seg.ifmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (seg.video_index < 0) {
+        printf("没有视频流，按时间切片\n");
+    }
+
+    pkt = av_packet_alloc();
+    if (!pkt) {
+        ret = AVERROR(ENOMEM);
+        goto cleanup;
+    }
+
+    while ((ret = av_read_frame(seg.ifmt_ctx, pkt)) >= 0) {
+        int in_index = pkt->stream_index;
+        if (seg.stream_mapping[in_index] < 0) {
+            av_packet_unref(pkt);
+            continue;
+        }
+        AVStream *in_stream = seg.ifmt_ctx->streams[in_index];
+        int64_t pkt_time = get_packet_time(pkt, in_stream->time_base);
+
+        // 判断是否是切点：有视频流时只在视频关键帧处切
+        int is_cut_point = 0;
+        if (seg.video_index >= 0) {
+            is_cut_point = in_index == seg.video_index && (pkt->flags & AV_PKT_FLAG_KEY);
+        } else {
+            is_cut_point = 1;
+        }
+
+        if (!seg.ofmt_ctx) {
+            // 第一个分片从第一个切点开始，之前的包无法独立解码
+            if (!is_cut_point || pkt_time == AV_NOPTS_VALUE) {
+                av_packet_unref(pkt);
+                continue;
+            }
+            if ((ret = open_segment(&seg)) < 0)
+                goto cleanup;
+            seg.segment_start = pkt_time;
+        } else if (is_cut_point && pkt_time != AV_NOPTS_VALUE
+                   && pkt_time - seg.segment_start >= (int64_t)(seg.target_duration * AV_TIME_BASE)) {
+            // 当前分片时长已经足够，在关键帧处切出新的分片
+            close_segment(&seg, pkt_time);
+            if ((ret = open_segment(&seg)) < 0)
+                goto cleanup;
+            seg.segment_start = pkt_time;
+        }
+
+        if (pkt_time != AV_NOPTS_VALUE) {
+            int64_t end = pkt_time + av_rescale_q(pkt->duration, in_stream->time_base, AV_TIME_BASE_Q);
+            if (seg.last_end == AV_NOPTS_VALUE || end > seg.last_end)
+                seg.last_end = end;
+        }
+
+        // 时间戳保持连续，只转换时间基
+        AVStream *out_stream = seg.ofmt_ctx->streams[seg.stream_mapping[in_index]];
+        pkt->stream_index = seg.stream_mapping[in_index];
+        av_packet_rescale_ts(pkt, in_stream->time_base, out_stream->time_base);
+        pkt->pos = -1;
+        ret = av_interleaved_write_frame(seg.ofmt_ctx, pkt); // 内部会 unref pkt
+        if (ret < 0) {
+            printf("av_interleaved_write_frame failed: %s\n", get_err(ret));
+            goto cleanup;
+        }
+    }
+    // 只有读到文件末尾才算正常结束，读取出错时不生成播放列表
+    if (ret != AVERROR_EOF) {
+        printf("av_read_frame failed: %s\n", get_err(ret));
+        goto cleanup;
+    }
+
+    // 最后一个分片
+    close_segment(&seg, seg.last_end);
+    if (write_playlist(&seg, m3u8_filename) == 0) {
+        printf("生成 %s 完成, 分片数:%d, 最大分片时长:%.3fs\n", m3u8_filename, seg.segment_index,
+               seg.max_duration);
+    }
+    ret = 0;
+
+cleanup:
+    if (seg.ofmt_ctx) {
+        avio_closep(&seg.ofmt_ctx->pb);
+        avformat_free_context(seg.ofmt_ctx);
+    }
+    if (seg.entry_fp) {
+        fclose(seg.entry_fp);
+        remove(seg.entry_filename);
+    }
+    if (pkt)
+        av_packet_free(&pkt);
+    av_freep(&seg.stream_mapping);
+    if (seg.ifmt_ctx)
+        avformat_close_input(&seg.ifmt_ctx);
+
+    return ret < 0 ? -1 : 0;
+}
@@ -0,0 +1,571 @@
+/**
+ * @brief         多线程分块提取 MP4 中的 H.264(Annex-B) 和 AAC(ADTS)
+ *                07_demux_mp4.c 是顺序 av_read_frame，大文件时受限于单线程读取速度。
+ *                这里只用 demuxer 解析一次 moov 里的 sample table(每个sample的偏移、大小)，
+ *                然后把 mdat 按字节数切成连续的几段，每个线程用 pread 读取自己那一段并转换格式，
+ *                再用 pwrite 写到输出文件中预先算好的位置，结果和顺序提取的顺序一致。
+ *
+ *                输出大小可以预先计算的前提：
+ *                1. 视频 NALU 长度前缀为4字节(avcC lengthSizeMinusOne = 3)，替换为4字节起始码后大小不变，
+ *                   关键帧前额外插入 SPS/PPS;
+ *                2. 音频每个 sample 前加7字节 ADTS 头。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#    include <io.h>
+#    include <windows.h>
+#else
+#    include <unistd.h>
+#endif
+
+#include "libavutil/log.h"
+#include "libavutil/cpu.h"
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+
+#define ERROR_STRING_SIZE 1024
+#define ADTS_HEADER_LEN 7          // ADTS头部固定长度
+#define READ_BLOCK_SIZE (4 << 20)  // 每次 pread 最多读取 4MB
+#define MAX_THREADS 64
+
+#ifndef O_BINARY
+#    define O_BINARY 0
+#endif
+
+enum { TRACK_VIDEO = 0, TRACK_AUDIO = 1 };
+
+// AAC采样率索引表
+static const int sampling_frequencies[] = {
+    96000, 88200, 64000, 48000, 44100,
+    32000, 24000, 22050, 16000, 12000,
+    11025, 8000
+};
+
+// 一个 sample 在输入文件和输出文件中的位置
+typedef struct sample_entry {
+    int64_t pos;        // 在输入文件中的偏移
+    int64_t out_offset; // 在对应输出文件中的偏移
+    int size;           // 在输入文件中的大小
+    int out_size;       // 转换后的大小
+    int track;          // TRACK_VIDEO / TRACK_AUDIO
+    int keyframe;       // 是否关键帧
+} sample_entry_t;
+
+// 所有线程共享的只读信息
+typedef struct extract_ctx {
+    int in_fd;
+    int out_fd[2];              // 视频、音频输出文件
+    sample_entry_t *samples;    // 按 pos 排序后的 sample
+    int nb_samples;
+    uint8_t *sps_pps;           // Annex-B 格式的 SPS/PPS
+    int sps_pps_size;
+    int aac_profile;
+    int aac_sample_rate;
+    int aac_channels;
+} extract_ctx_t;
+
+// 每个线程处理 [begin, end) 范围内的 sample
+typedef struct extract_task {
+    extract_ctx_t *ctx;
+    pthread_t tid;
+    int begin;
+    int end;
+    int64_t read_bytes;
+    int64_t write_bytes;
+    int bad_samples;            // NALU 长度异常的 sample 数量
+    int ret;
+} extract_task_t;
+
+static char errors[ERROR_STRING_SIZE];
+
+static const char *get_err(int errnum)
+{
+    av_strerror(errnum, errors, sizeof(errors));
+    return errors;
+}
+
+/**
+ * 按偏移读写，不修改文件指针，多个线程可以同时使用同一个 fd
+ * Windows 没有 pread/pwrite，使用带 OVERLAPPED 偏移的 ReadFile/WriteFile
+ */
+static int64_t pread_full(int fd, void *buf, size_t size, int64_t offset)
+{
+    size_t done = 0;
+    while (done < size) {
+#ifdef _WIN32
+        OVERLAPPED ov;
+        DWORD n = 0;
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset = (DWORD)((offset + done) & 0xffffffff);
+        ov.OffsetHigh = (DWORD)((offset + done) >> 32);
+        if (!ReadFile((HANDLE)_get_osfhandle(fd), (uint8_t *)buf + done, (DWORD)(size - done), &n,
+                      &ov) || n == 0)
+            break;
+#else
+        ssize_t n = pread(fd, (uint8_t *)buf + done, size - done, offset + done);
+        if (n <= 0)
+            break;
+#endif
+        done += n;
+    }
+    return done;
+}
+
+static int64_t pwrite_full(int fd, const void *buf, size_t size, int64_t offset)
+{
+    size_t done = 0;
+    while (done < size) {
+#ifdef _WIN32
+        OVERLAPPED ov;
+        DWORD n = 0;
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset = (DWORD)((offset + done) & 0xffffffff);
+        ov.OffsetHigh = (DWORD)((offset + done) >> 32);
+        if (!WriteFile((HANDLE)_get_osfhandle(fd), (const uint8_t *)buf + done,
+                       (DWORD)(size - done), &n, &ov) || n == 0)
+            break;
+#else
+        ssize_t n = pwrite(fd, (const uint8_t *)buf + done, size - done, offset + done);
+        if (n <= 0)
+            break;
+#endif
+        done += n;
+    }
+    return done;
+}
+
+// ADTS 头中的采样率索引，不在表中返回-1
+static int adts_sample_rate_index(int samplerate)
+{
+    int frequencies_size = sizeof(sampling_frequencies) / sizeof(sampling_frequencies[0]);
+    for (int i = 0; i < frequencies_size; i++) {
+        if (sampling_frequencies[i] == samplerate)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * 生成ADTS头部，参考 07_demux_mp4.c
+ * @return 成功返回0，采样率不支持时返回-1(不写入任何数据)
+ */
+static int adts_header(uint8_t *p_adts_header, const int data_length, const int profile,
+                       const int samplerate, const int channels)
+{
+    int sampling_frequency_index = adts_sample_rate_index(samplerate);
+    int adtsLen = data_length + ADTS_HEADER_LEN;
+    if (sampling_frequency_index < 0) {
+        return -1;
+    }
+    p_adts_header[0] = 0xff;
+    p_adts_header[1] = 0xf1;                                    // MPEG-4, 无CRC
+    p_adts_header[2] = (profile) << 6;
+    p_adts_header[2] |= (sampling_frequency_index & 0x0f) << 2;
+    p_adts_header[2] |= (channels & 0x04) >> 2;
+    p_adts_header[3] = (channels & 0x03) << 6;
+    p_adts_header[3] |= ((adtsLen & 0x1800) >> 11);
+    p_adts_header[4] = (uint8_t)((adtsLen & 0x7f8) >> 3);
+    p_adts_header[5] = (uint8_t)((adtsLen & 0x7) << 5);
+    p_adts_header[5] |= 0x1f;
+    p_adts_header[6] = 0xfc;
+    return 0;
+}
+
+/**
+ * 解析 avcC，得到 Annex-B 格式的 SPS/PPS
+ * @return 成功返回 NALU 长度前缀的字节数，失败返回-1
+ */
+static int parse_avcc(const uint8_t *extradata, int extradata_size, uint8_t **ps, int *ps_size)
+{
+    if (!extradata || extradata_size < 7 || extradata[0] != 1) {
+        printf("extradata 不是 avcC 格式\n");
+        return -1;
+    }
+    int length_size = (extradata[4] & 0x03) + 1;
+    // 输出不会比 extradata 大太多: 每个参数集的2字节长度换成4字节起始码
+    uint8_t *out = (uint8_t *)av_malloc(extradata_size * 2 + 64);
+    if (!out)
+        return -1;
+    int out_size = 0;
+    const uint8_t *p = extradata + 5;
+    const uint8_t *end = extradata + extradata_size;
+    for (int type = 0; type < 2; type++) { // 0: SPS, 1: PPS
+        if (p >= end)
+            break;
+        int count = type == 0 ? (*p++ & 0x1f) : *p++;
+        for (int i = 0; i < count; i++) {
+            if (end - p < 2)
+                break;
+            int len = (p[0] << 8) | p[1];
+            p += 2;
+            if (end - p < len)
+                break;
+            static const uint8_t start_code[4] = {0, 0, 0, 1};
+            memcpy(out + out_size, start_code, 4);
+            memcpy(out + out_size + 4, p, len);
+            out_size += 4 + len;
+            p += len;
+        }
+    }
+    *ps = out;
+    *ps_size = out_size;
+    return length_size;
+}
+
+/**
+ * 把一个 AVCC 格式的 sample 转为 Annex-B，输出大小固定为 sps_pps_size(关键帧) + size
+ * @return NALU 长度异常返回-1(剩余数据原样拷贝，保证输出大小不变)
+ */
+static int avcc_to_annexb(const extract_ctx_t *ctx, const sample_entry_t *s, const uint8_t *in,
+                          uint8_t *out)
+{
+    if (s->keyframe && ctx->sps_pps_size > 0) {
+        memcpy(out, ctx->sps_pps, ctx->sps_pps_size);
+        out += ctx->sps_pps_size;
+    }
+    const uint8_t *p = in;
+    const uint8_t *end = in + s->size;
+    while (end - p >= 4) {
+        uint32_t len = ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+        if (len > (uint32_t)(end - p - 4))
+            break;
+        out[0] = 0;
+        out[1] = 0;
+        out[2] = 0;
+        out[3] = 1;
+        memcpy(out + 4, p + 4, len);
+        out += 4 + len;
+        p += 4 + len;
+    }
+    if (p != end) {
+        memcpy(out, p, end - p);
+        return -1;
+    }
+    return 0;
+}
+
+static void *extract_thread(void *arg)
+{
+    extract_task_t *task = (extract_task_t *)arg;
+    extract_ctx_t *ctx = task->ctx;
+    uint8_t *in_buf = (uint8_t *)av_malloc(READ_BLOCK_SIZE);
+    int out_buf_size = READ_BLOCK_SIZE + ctx->sps_pps_size + 64 * 1024;
+    uint8_t *out_buf = (uint8_t *)av_malloc(out_buf_size);
+    if (!in_buf || !out_buf) {
+        task->ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    int i = task->begin;
+    while (i < task->end) {
+        // 1. 合并相邻的 sample，一次 pread 读取一整块
+        const sample_entry_t *first = &ctx->samples[i];
+        int j = i;
+        int64_t block_end = first->pos;
+        while (j < task->end) {
+            int64_t e = ctx->samples[j].pos + ctx->samples[j].size;
+            if (e - first->pos > READ_BLOCK_SIZE && j > i)
+                break;
+            if (e > block_end)
+                block_end = e;
+            j++;
+        }
+        int64_t block_size = block_end - first->pos;
+        uint8_t *block = in_buf;
+        uint8_t *large = NULL;
+        if (block_size > READ_BLOCK_SIZE) { // 单个 sample 超过 4MB
+            large = (uint8_t *)av_malloc(block_size);
+            if (!large) {
+                task->ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            block = large;
+        }
+        if (pread_full(ctx->in_fd, block, block_size, first->pos) != block_size) {
+            printf("pread failed, pos:%" PRId64 " size:%" PRId64 "\n", first->pos, block_size);
+            av_free(large);
+            task->ret = AVERROR(EIO);
+            goto end;
+        }
+        task->read_bytes += block_size;
+
+        // 2. 逐个转换，同一输出文件中连续的 sample 合并为一次 pwrite
+        int k = i;
+        while (k < j) {
+            int track = ctx->samples[k].track;
+            int64_t out_offset = ctx->samples[k].out_offset;
+            int used = 0;
+            int m = k;
+            while (m < j && ctx->samples[m].track == track
+                   && ctx->samples[m].out_offset == out_offset + used
+                   && (used == 0 || used + ctx->samples[m].out_size <= out_buf_size)) {
+                const sample_entry_t *s = &ctx->samples[m];
+                uint8_t *dst = out_buf + used;
+                uint8_t *big = NULL;
+                if (s->out_size > out_buf_size) { // 超大 sample 单独处理
+                    big = (uint8_t *)av_malloc(s->out_size);
+                    if (!big) {
+                        av_free(large);
+                        task->ret = AVERROR(ENOMEM);
+                        goto end;
+                    }
+                    dst = big;
+                }
+                const uint8_t *src = block + (s->pos - first->pos);
+                if (track == TRACK_VIDEO) {
+                    if (avcc_to_annexb(ctx, s, src, dst) < 0)
+                        task->bad_samples++;
+                } else {
+                    // main 中已经检查过采样率，这里失败说明参数被改坏了，不能写出没有头部的帧
+                    if (adts_header(dst, s->size, ctx->aac_profile, ctx->aac_sample_rate,
+                                    ctx->aac_channels) < 0) {
+                        printf("adts_header failed, sample_rate:%d\n", ctx->aac_sample_rate);
+                        av_free(big);
+                        av_free(large);
+                        task->ret = AVERROR(EINVAL);
+                        goto end;
+                    }
+                    memcpy(dst + ADTS_HEADER_LEN, src, s->size);
+                }
+                if (big) {
+                    pwrite_full(ctx->out_fd[track], big, s->out_size, s->out_offset);
+                    task->write_bytes += s->out_size;
+                    av_free(big);
+                    m++;
+                    break;
+                }
+                used += s->out_size;
+                m++;
+            }
+            if (used > 0) {
+                if (pwrite_full(ctx->out_fd[track], out_buf, used, out_offset) != used) {
+                    printf("pwrite failed, offset:%" PRId64 " size:%d\n", out_offset, used);
+                    av_free(large);
+                    task->ret = AVERROR(EIO);
+                    goto end;
+                }
+                task->write_bytes += used;
+            }
+            k = m;
+        }
+        av_free(large);
+        i = j;
+    }
+
+end:
+    av_free(in_buf);
+    av_free(out_buf);
+    return NULL;
+}
+
+static int compare_sample_pos(const void *a, const void *b)
+{
+    const sample_entry_t *sa = (const sample_entry_t *)a;
+    const sample_entry_t *sb = (const sample_entry_t *)b;
+    if (sa->pos < sb->pos)
+        return -1;
+    return sa->pos > sb->pos;
+}
+
+/**
+ * 从 demuxer 建立的 index_entries(即 moov 的 sample table) 收集 sample，
+ * 按流内顺序计算输出偏移，再按文件偏移排序
+ */
+static int collect_samples(extract_ctx_t *ctx, AVStream *streams[2], int64_t out_total[2])
+{
+    int total = 0;
+    for (int t = 0; t < 2; t++)
+        total += streams[t]->nb_index_entries;
+    if (total <= 0) {
+        printf("没有 sample table(fragmented MP4?)，请使用 07_demux_mp4\n");
+        return -1;
+    }
+    ctx->samples = (sample_entry_t *)av_malloc_array(total, sizeof(sample_entry_t));
+    if (!ctx->samples)
+        return AVERROR(ENOMEM);
+
+    int n = 0;
+    for (int t = 0; t < 2; t++) {
+        int64_t offset = 0;
+        for (int i = 0; i < streams[t]->nb_index_entries; i++) {
+            const AVIndexEntry *e = &streams[t]->index_entries[i];
+            sample_entry_t *s = &ctx->samples[n++];
+            s->pos = e->pos;
+            s->size = e->size;
+            s->track = t;
+            s->keyframe = (e->flags & AVINDEX_KEYFRAME) != 0;
+            if (t == TRACK_VIDEO)
+                s->out_size = s->size + (s->keyframe ? ctx->sps_pps_size : 0);
+            else
+                s->out_size = s->size + ADTS_HEADER_LEN;
+            s->out_offset = offset;
+            offset += s->out_size;
+        }
+        out_total[t] = offset;
+    }
+    ctx->nb_samples = n;
+    qsort(ctx->samples, n, sizeof(sample_entry_t), compare_sample_pos);
+    return 0;
+}
+
+/**
+ * 使用示例：
+ * 17_parallel_demux_mp4 input.mp4 out.h264 out.aac [threads]
+ */
+int main(int argc, char **argv)
+{
+    if (argc < 4) {
+        printf("用法: %s input.mp4 out.h264 out.aac [threads]\n", argv[0]);
+        return -1;
+    }
+    const char *in_filename = argv[1];
+    int nb_threads = argc > 4 ? atoi(argv[4]) : av_cpu_count();
+    if (nb_threads < 1)
+        nb_threads = 1;
+    if (nb_threads > MAX_THREADS)
+        nb_threads = MAX_THREADS;
+
+    AVFormatContext *ifmt_ctx = NULL;
+    AVDictionary *opts = NULL;
+    extract_ctx_t ctx;
+    extract_task_t tasks[MAX_THREADS];
+    int nb_tasks = 0;
+    int ret = 0;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.in_fd = ctx.out_fd[0] = ctx.out_fd[1] = -1;
+
+    // 1. 用 demuxer 解析 moov, 忽略 edit list 保证 index_entries 与 sample table 一一对应
+    av_dict_set(&opts, "ignore_editlist", "1", 0);
+    ret = avformat_open_input(&ifmt_ctx, in_filename, NULL, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        printf("打开输入文件失败: %s\n", get_err(ret));
+        return -1;
+    }
+    if ((ret = avformat_find_stream_info(ifmt_ctx, NULL)) < 0) {
+        printf("获取流信息失败: %s\n", get_err(ret));
+        goto cleanup;
+    }
+    if (strcmp(ifmt_ctx->iformat->name, "mov,mp4,m4a,3gp,3g2,mj2") != 0) {
+        printf("输入不是 MP4: %s\n", ifmt_ctx->iformat->name);
+        ret = -1;
+        goto cleanup;
+    }
+    int video_index = av_find_best_stream(ifmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    int audio_index = av_find_best_stream(ifmt_ctx, AVMEDIA_TYPE_AUDIO, -1, -1, NULL, 0);
+    if (video_index < 0 || audio_index < 0) {
+        printf("未找到音视频流 (video:%d, audio:%d)\n", video_index, audio_index);
+        ret = -1;
+        goto cleanup;
+    }
+    AVStream *streams[2] = {ifmt_ctx->streams[video_index], ifmt_ctx->streams[audio_index]};
+    if (streams[0]->codecpar->codec_id != AV_CODEC_ID_H264
+        || streams[1]->codecpar->codec_id != AV_CODEC_ID_AAC) {
+        printf("只支持 H.264 + AAC\n");
+        ret = -1;
+        goto cleanup;
+    }
+
+    // 2. SPS/PPS 和 NALU 长度前缀
+    int length_size = parse_avcc(streams[0]->codecpar->extradata,
+                                 streams[0]->codecpar->extradata_size, &ctx.sps_pps,
+                                 &ctx.sps_pps_size);
+    if (length_size != 4) {
+        printf("NALU 长度前缀为 %d 字节，输出大小无法预先计算，请使用 07_demux_mp4\n", length_size);
+        ret = -1;
+        goto cleanup;
+    }
+    ctx.aac_profile = streams[1]->codecpar->profile;
+    ctx.aac_sample_rate = streams[1]->codecpar->sample_rate;
+    ctx.aac_channels = streams[1]->codecpar->channels;
+    // 输出大小按每帧 ADTS_HEADER_LEN 预先计算，采样率不在 ADTS 表中时无法生成头部
+    if (adts_sample_rate_index(ctx.aac_sample_rate) < 0) {
+        printf("AAC 采样率 %d 不支持 ADTS\n", ctx.aac_sample_rate);
+        ret = -1;
+        goto cleanup;
+    }
+
+    // 3. 收集 sample，计算每个 sample 的输出位置
+    int64_t out_total[2] = {0, 0};
+    if ((ret = collect_samples(&ctx, streams, out_total)) < 0)
+        goto cleanup;
+
+    ctx.in_fd = open(in_filename, O_RDONLY | O_BINARY);
+    ctx.out_fd[TRACK_VIDEO] = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+    ctx.out_fd[TRACK_AUDIO] = open(argv[3], O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+    if (ctx.in_fd < 0 || ctx.out_fd[0] < 0 || ctx.out_fd[1] < 0) {
+        printf("打开文件失败\n");
+        ret = -1;
+        goto cleanup;
+    }
+
+    // 4. 按字节数把 sample 切成 nb_threads 段连续的区间
+    int64_t total_bytes = 0;
+    for (int i = 0; i < ctx.nb_samples; i++)
+        total_bytes += ctx.samples[i].size;
+    int64_t per_task = total_bytes / nb_threads + 1;
+    int begin = 0;
+    while (begin < ctx.nb_samples && nb_tasks < nb_threads) {
+        int end = begin;
+        int64_t bytes = 0;
+        while (end < ctx.nb_samples && (bytes < per_task || nb_tasks == nb_threads - 1)) {
+            bytes += ctx.samples[end].size;
+            end++;
+        }
+        memset(&tasks[nb_tasks], 0, sizeof(extract_task_t));
+        tasks[nb_tasks].ctx = &ctx;
+        tasks[nb_tasks].begin = begin;
+        tasks[nb_tasks].end = end;
+        nb_tasks++;
+        begin = end;
+    }
+
+    // 5. 并行读取、转换、写入
+    int64_t start_time = av_gettime_relative();
+    for (int i = 0; i < nb_tasks; i++) {
+        if (pthread_create(&tasks[i].tid, NULL, extract_thread, &tasks[i]) != 0) {
+            printf("pthread_create failed\n");
+            extract_thread(&tasks[i]); // 创建线程失败就在当前线程处理
+            tasks[i].tid = pthread_self();
+        }
+    }
+    int64_t read_bytes = 0, write_bytes = 0;
+    int bad_samples = 0;
+    for (int i = 0; i < nb_tasks; i++) {
+        if (!pthread_equal(tasks[i].tid, pthread_self()))
+            pthread_join(tasks[i].tid, NULL);
+        read_bytes += tasks[i].read_bytes;
+        write_bytes += tasks[i].write_bytes;
+        bad_samples += tasks[i].bad_samples;
+        if (tasks[i].ret < 0)
+            ret = tasks[i].ret;
+    }
+    int64_t cost = av_gettime_relative() - start_time;
+
+    printf("threads:%d samples:%d read:%" PRId64 "MB write:%" PRId64 "MB, h264:%" PRId64
+           " aac:%" PRId64 " bytes\n",
+           nb_tasks, ctx.nb_samples, read_bytes >> 20, write_bytes >> 20, out_total[0],
+           out_total[1]);
+    printf("time:%" PRId64 "ms, %.1fMB/s, bad samples:%d\n", cost / 1000,
+           cost > 0 ? read_bytes / (cost / 1000000.0) / (1 << 20) : 0.0, bad_samples);
+
+cleanup:
+    if (ctx.in_fd >= 0)
+        close(ctx.in_fd);
+    for (int t = 0; t < 2; t++) {
+        if (ctx.out_fd[t] >= 0)
+            close(ctx.out_fd[t]);
+    }
+    av_freep(&ctx.samples);
+    av_freep(&ctx.sps_pps);
+    if (ifmt_ctx)
+        avformat_close_input(&ifmt_ctx);
+    return ret < 0 ? -1 : 0;
+}
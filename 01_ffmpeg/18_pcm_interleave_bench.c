@@ -0,0 +1,151 @@
+/**
+ * @brief         PCM 平面 <-> 交错转换的性能对比
+ *                05_decode_audio.c / 08_avio_decod_aac.c 原来每个样本每个声道调用一次 fwrite，
+ *                这里对比三种写法(结果都写到临时文件)：
+ *                1. 逐样本 fwrite;
+ *                2. 标量转换整帧 + 一次 fwrite;
+ *                3. SIMD 转换整帧 + 一次 fwrite;
+ *                另外单独测量转换函数本身(不含写文件)的耗时，并校验 SIMD 和标量结果一致。
+ *
+ *                用法: 18_pcm_interleave_bench [秒数]，默认10秒 48kHz 音频
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavutil/samplefmt.h"
+#include "pcmconv.h"
+
+#define SAMPLE_RATE 48000
+#define FRAME_SAMPLES 1024      // 每帧样本数，同 AAC
+#define MAX_CHANNELS 8
+#define CONV_LOOPS 20           // 单独测转换函数时的重复次数
+
+// 逐样本写入，和原来 decode() 里的写法一致
+static void write_per_sample(FILE *fp, uint8_t *const *planes, int channels, int nb_samples, int bps)
+{
+    for (int i = 0; i < nb_samples; i++) {
+        for (int ch = 0; ch < channels; ch++) {
+            fwrite(planes[ch] + bps * i, 1, bps, fp);
+        }
+    }
+}
+
+static void bench_format(enum AVSampleFormat fmt, int channels, int seconds)
+{
+    int bps = av_get_bytes_per_sample(fmt);
+    int nb_frames = SAMPLE_RATE * seconds / FRAME_SAMPLES;
+    uint8_t *planes[MAX_CHANNELS] = {NULL};
+    uint8_t *planes_back[MAX_CHANNELS] = {NULL};
+    uint8_t *packed = (uint8_t *)av_malloc(FRAME_SAMPLES * channels * bps);
+    uint8_t *packed_ref = (uint8_t *)av_malloc(FRAME_SAMPLES * channels * bps);
+    FILE *fp = tmpfile();
+    if (!packed || !packed_ref || !fp) {
+        printf("alloc failed\n");
+        goto end;
+    }
+    for (int ch = 0; ch < channels; ch++) {
+        planes[ch] = (uint8_t *)av_malloc(FRAME_SAMPLES * bps);
+        planes_back[ch] = (uint8_t *)av_malloc(FRAME_SAMPLES * bps);
+        if (!planes[ch] || !planes_back[ch]) {
+            printf("alloc failed\n");
+            goto end;
+        }
+        for (int i = 0; i < FRAME_SAMPLES * bps; i++)
+            planes[ch][i] = (uint8_t)rand();
+    }
+
+    // 校验：SIMD 和标量结果一致，交错再解交错回到原始数据
+    pcm_interleave(packed, (const uint8_t *const *)planes, channels, FRAME_SAMPLES, fmt);
+    pcm_interleave_c(packed_ref, (const uint8_t *const *)planes, channels, FRAME_SAMPLES, fmt);
+    int ok = memcmp(packed, packed_ref, FRAME_SAMPLES * channels * bps) == 0;
+    pcm_deinterleave(planes_back, packed, channels, FRAME_SAMPLES, fmt);
+    for (int ch = 0; ok && ch < channels; ch++)
+        ok = memcmp(planes[ch], planes_back[ch], FRAME_SAMPLES * bps) == 0;
+
+    // 1. 逐样本 fwrite
+    int64_t start = av_gettime_relative();
+    for (int f = 0; f < nb_frames; f++)
+        write_per_sample(fp, planes, channels, FRAME_SAMPLES, bps);
+    fflush(fp);
+    int64_t t_per_sample = av_gettime_relative() - start;
+
+    // 2. 标量转换 + 一次 fwrite
+    rewind(fp);
+    start = av_gettime_relative();
+    for (int f = 0; f < nb_frames; f++) {
+        int size = pcm_interleave_c(packed, (const uint8_t *const *)planes, channels,
+                                    FRAME_SAMPLES, fmt);
+        fwrite(packed, 1, size, fp);
+    }
+    fflush(fp);
+    int64_t t_scalar_write = av_gettime_relative() - start;
+
+    // 3. SIMD 转换 + 一次 fwrite
+    rewind(fp);
+    start = av_gettime_relative();
+    for (int f = 0; f < nb_frames; f++) {
+        int size = pcm_interleave(packed, (const uint8_t *const *)planes, channels,
+                                  FRAME_SAMPLES, fmt);
+        fwrite(packed, 1, size, fp);
+    }
+    fflush(fp);
+    int64_t t_simd_write = av_gettime_relative() - start;
+
+    // 只测转换函数
+    int64_t nb_conv = (int64_t)nb_frames * CONV_LOOPS;
+    start = av_gettime_relative();
+    for (int64_t f = 0; f < nb_conv; f++)
+        pcm_interleave_c(packed, (const uint8_t *const *)planes, channels, FRAME_SAMPLES, fmt);
+    int64_t t_scalar = av_gettime_relative() - start;
+    start = av_gettime_relative();
+    for (int64_t f = 0; f < nb_conv; f++)
+        pcm_interleave(packed, (const uint8_t *const *)planes, channels, FRAME_SAMPLES, fmt);
+    int64_t t_simd = av_gettime_relative() - start;
+    start = av_gettime_relative();
+    for (int64_t f = 0; f < nb_conv; f++)
+        pcm_deinterleave_c(planes_back, packed, channels, FRAME_SAMPLES, fmt);
+    int64_t t_scalar_de = av_gettime_relative() - start;
+    start = av_gettime_relative();
+    for (int64_t f = 0; f < nb_conv; f++)
+        pcm_deinterleave(planes_back, packed, channels, FRAME_SAMPLES, fmt);
+    int64_t t_simd_de = av_gettime_relative() - start;
+
+    double frame_ns = 1000.0 / nb_conv; // us 总耗时 -> ns/帧
+    printf("%-5s %dch %s | write per-sample:%7.1fms scalar:%6.1fms simd:%6.1fms (x%.1f)"
+           " | ns/frame interleave c:%7.0f simd:%7.0f deinterleave c:%7.0f simd:%7.0f\n",
+           av_get_sample_fmt_name(fmt), channels, ok ? "ok  " : "FAIL",
+           t_per_sample / 1000.0, t_scalar_write / 1000.0, t_simd_write / 1000.0,
+           t_simd_write > 0 ? (double)t_per_sample / t_simd_write : 0.0,
+           t_scalar * frame_ns, t_simd * frame_ns, t_scalar_de * frame_ns, t_simd_de * frame_ns);
+
+end:
+    for (int ch = 0; ch < channels; ch++) {
+        av_free(planes[ch]);
+        av_free(planes_back[ch]);
+    }
+    av_free(packed);
+    av_free(packed_ref);
+    if (fp)
+        fclose(fp);
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 10;
+    if (seconds <= 0)
+        seconds = 10;
+    const enum AVSampleFormat fmts[] = {AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_S32P};
+    const int channels[] = {1, 2, 6, 8};
+
+    printf("simd:%s, %d seconds of %dHz audio, %d samples per frame\n", pcm_conv_simd_name(),
+           seconds, SAMPLE_RATE, FRAME_SAMPLES);
+    for (size_t f = 0; f < sizeof(fmts) / sizeof(fmts[0]); f++) {
+        for (size_t c = 0; c < sizeof(channels) / sizeof(channels[0]); c++) {
+            bench_format(fmts[f], channels[c], seconds);
+        }
+    }
+    return 0;
+}
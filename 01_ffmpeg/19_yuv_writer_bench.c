@@ -0,0 +1,137 @@
+/**
+ * @brief         原始帧写文件的性能对比(默认4K)
+ *                1. 逐行 fwrite(06_decode_video.c 原来的写法);
+ *                2. yuv_writer writev 方式：无行填充时整平面一段，有填充时每行一段，一帧一次 writev;
+ *                3. yuv_writer mmap 方式。
+ *                每种像素格式分别测试 linesize == 行宽(无填充) 和 linesize > 行宽(有填充) 两种帧。
+ *
+ *                用法: 19_yuv_writer_bench out.yuv [帧数] [宽] [高]，默认 30 帧 3840x2160
+ *                测试结束会删除输出文件
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/frame.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/time.h"
+#include "yuvwriter.h"
+
+#define LINE_PADDING 64     // 有填充的帧每行多出的像素
+
+// 逐行 fwrite，各平面行宽和行数同 yuv_writer
+static int64_t write_per_row(FILE *fp, const AVFrame *frame, int64_t *nb_calls)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((enum AVPixelFormat)frame->format);
+    int row_bytes[4] = {0};
+    av_image_fill_linesizes(row_bytes, (enum AVPixelFormat)frame->format, frame->width);
+    int nb_planes = av_pix_fmt_count_planes((enum AVPixelFormat)frame->format);
+    int64_t total = 0;
+    for (int i = 0; i < nb_planes; i++) {
+        int rows = (i == 1 || i == 2) ? AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h)
+                                      : frame->height;
+        for (int j = 0; j < rows; j++)
+            fwrite(frame->data[i] + j * frame->linesize[i], 1, row_bytes[i], fp);
+        *nb_calls += rows;
+        total += (int64_t)row_bytes[i] * rows;
+    }
+    return total;
+}
+
+// 分配一帧并填充内容；padded 时分配更宽的缓存再把宽度改回来，使 linesize 大于行宽
+static AVFrame *alloc_frame(enum AVPixelFormat fmt, int width, int height, int padded)
+{
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
+        return NULL;
+    }
+    frame->format = fmt;
+    frame->width = padded ? width + LINE_PADDING : width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 1) < 0) {
+        av_frame_free(&frame);
+        return NULL;
+    }
+    frame->width = width;
+    for (int i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; i++)
+        memset(frame->buf[i]->data, 0x40 + i * 0x20, frame->buf[i]->size);
+    return frame;
+}
+
+static void bench(const char *path, enum AVPixelFormat fmt, int width, int height, int nb_frames,
+                  int padded)
+{
+    AVFrame *frame = alloc_frame(fmt, width, height, padded);
+    if (!frame) {
+        printf("alloc %s frame failed\n", av_get_pix_fmt_name(fmt));
+        return;
+    }
+
+    // 1. 逐行 fwrite
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        printf("open %s failed\n", path);
+        av_frame_free(&frame);
+        return;
+    }
+    int64_t fwrite_calls = 0;
+    int64_t bytes = 0;
+    int64_t start = av_gettime_relative();
+    for (int i = 0; i < nb_frames; i++)
+        bytes += write_per_row(fp, frame, &fwrite_calls);
+    fclose(fp);
+    int64_t t_row = av_gettime_relative() - start;
+
+    // 2. writev / 3. mmap，关闭文件的时间也计算在内
+    int64_t t_writer[2] = {0};
+    int64_t calls[2] = {0};
+    for (int use_mmap = 0; use_mmap < 2; use_mmap++) {
+        start = av_gettime_relative();
+        yuv_writer_t *w = yuv_writer_open(path, use_mmap);
+        if (!w) {
+            continue;
+        }
+        for (int i = 0; i < nb_frames; i++)
+            yuv_writer_write_frame(w, frame);
+        calls[use_mmap] = w->stats.nb_syscalls;
+        yuv_writer_close(w);
+        t_writer[use_mmap] = av_gettime_relative() - start;
+    }
+    remove(path);
+
+    double mb = bytes / (1024.0 * 1024.0);
+    printf("%-12s %s linesize[0]:%5d | fwrite/row:%7.1fms (%lld calls) writev:%7.1fms (%lld calls,"
+           " x%.2f) mmap:%7.1fms (%lld maps, x%.2f) | %.1fMB\n",
+           av_get_pix_fmt_name(fmt), padded ? "padded" : "packed", frame->linesize[0],
+           t_row / 1000.0, (long long)fwrite_calls, t_writer[0] / 1000.0, (long long)calls[0],
+           t_writer[0] > 0 ? (double)t_row / t_writer[0] : 0.0, t_writer[1] / 1000.0,
+           (long long)calls[1], t_writer[1] > 0 ? (double)t_row / t_writer[1] : 0.0, mb);
+    av_frame_free(&frame);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("usage: %s out.yuv [frames] [width] [height]\n", argv[0]);
+        return -1;
+    }
+    const char *path = argv[1];
+    int nb_frames = argc > 2 ? atoi(argv[2]) : 30;
+    int width = argc > 3 ? atoi(argv[3]) : 3840;
+    int height = argc > 4 ? atoi(argv[4]) : 2160;
+    if (nb_frames <= 0 || width <= 0 || height <= 0) {
+        printf("invalid arguments\n");
+        return -1;
+    }
+    const enum AVPixelFormat fmts[] = {
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12, AV_PIX_FMT_YUV420P10LE,
+        AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV444P, AV_PIX_FMT_P010LE,
+    };
+    printf("%d frames of %dx%d\n", nb_frames, width, height);
+    for (size_t i = 0; i < sizeof(fmts) / sizeof(fmts[0]); i++) {
+        bench(path, fmts[i], width, height, nb_frames, 0);
+        bench(path, fmts[i], width, height, nb_frames, 1);
+    }
+    return 0;
+}
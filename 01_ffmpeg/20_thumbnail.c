@@ -0,0 +1,370 @@
+/**
+ * @brief         关键帧缩略图 / 拼图(sprite sheet)生成
+ *                06_decode_video.c 的流程会解码每一帧，生成缩略图时大部分解码都是浪费。
+ *                keyframe 模式(默认)：
+ *                1. 每隔 interval 秒 seek 到目标时间之后的第一个关键帧;
+ *                2. 解码器设置 skip_frame = AVDISCARD_NONKEY，只把这个关键帧包送进解码器并立即 drain,
+ *                   不等待后续包;
+ *                3. 缩小 2x/4x 时用盒式滤波快速缩小(其他尺寸用 sws_scale)，直接写入内存中的 N x M 拼图;
+ *                4. 拼图满了写出一张，输出文件是连续的 YUV420P 大图。
+ *                full 模式：顺序解码全部帧，每隔 interval 取一帧，用来对比每张缩略图的延迟。
+ *
+ *                用法: 20_thumbnail in.mp4 out.yuv [间隔秒数] [列数] [行数] [2|4|宽x高] [full]
+ *                默认每10秒一张，5x5 拼图，缩小4倍
+ *                播放: ffplay -pixel_format yuv420p -video_size 拼图宽x高 out.yuv
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+#include "sprite.h"         // 缩略图拼图
+#include "yuvwriter.h"      // 写出拼图
+
+typedef struct thumb_ctx {
+    AVFormatContext *fmt_ctx;
+    AVCodecContext *dec_ctx;
+    AVStream *st;
+    int stream_index;
+    AVPacket *pkt;
+    AVFrame *frame;
+    sprite_sheet_t *sheet;
+    yuv_writer_t *writer;
+
+    // 统计
+    int64_t nb_thumbs;
+    int64_t nb_dup;             // 多个时间点落在同一个关键帧上，跳过
+    int64_t nb_sheets;
+    int64_t nb_read;            // 读取的包
+    int64_t nb_sent;            // 送进解码器的包
+    int64_t nb_decoded;         // 解码器输出的帧
+    int64_t seek_us;
+    int64_t read_us;
+    int64_t decode_us;
+    int64_t latency_sum_us;     // 每张缩略图从开始 seek(full 模式为上一张之后)到放进拼图的耗时
+    int64_t latency_max_us;
+} thumb_ctx_t;
+
+static char err_buf[128] = {0};
+
+static char *av_get_err(int errnum)
+{
+    av_strerror(errnum, err_buf, 128);
+    return err_buf;
+}
+
+// 帧时间戳转换为相对流开始的微秒
+static int64_t frame_time_us(const thumb_ctx_t *c, const AVFrame *frame)
+{
+    int64_t pts = frame->best_effort_timestamp;
+    if (pts == AV_NOPTS_VALUE) {
+        return AV_NOPTS_VALUE;
+    }
+    if (c->st->start_time != AV_NOPTS_VALUE)
+        pts -= c->st->start_time;
+    return av_rescale_q(pts, c->st->time_base, AV_TIME_BASE_Q);
+}
+
+// 放进拼图，满了写出
+static int add_thumb(thumb_ctx_t *c, const AVFrame *frame)
+{
+    int ret = sprite_sheet_add(c->sheet, frame);
+    if (ret < 0) {
+        return ret;
+    }
+    c->nb_thumbs++;
+    if (ret == 1) {
+        ret = yuv_writer_write_frame(c->writer, c->sheet->frame);
+        if (ret < 0) {
+            return ret;
+        }
+        c->nb_sheets++;
+        sprite_sheet_reset(c->sheet);
+    }
+    return 0;
+}
+
+static void add_latency(thumb_ctx_t *c, int64_t latency)
+{
+    c->latency_sum_us += latency;
+    if (latency > c->latency_max_us)
+        c->latency_max_us = latency;
+}
+
+/**
+ * 送入一个关键帧包后立即 drain，取出第一帧放到 c->frame。
+ * 解码器有重排序延迟时(has_b_frames)，不 drain 要再送几个包才会输出
+ */
+static int decode_keyframe(thumb_ctx_t *c, int *got_frame)
+{
+    int64_t start = av_gettime_relative();
+    *got_frame = 0;
+    int ret = avcodec_send_packet(c->dec_ctx, c->pkt);
+    av_packet_unref(c->pkt);
+    if (ret < 0) {
+        printf("avcodec_send_packet failed:%s\n", av_get_err(ret));
+        return ret;
+    }
+    c->nb_sent++;
+    avcodec_send_packet(c->dec_ctx, NULL);
+    AVFrame *tmp = av_frame_alloc();
+    if (!tmp) {
+        return AVERROR(ENOMEM);
+    }
+    while ((ret = avcodec_receive_frame(c->dec_ctx, tmp)) >= 0) {
+        c->nb_decoded++;
+        if (!*got_frame) {
+            av_frame_move_ref(c->frame, tmp);
+            *got_frame = 1;
+        } else {
+            av_frame_unref(tmp);
+        }
+    }
+    av_frame_free(&tmp);
+    // drain 之后必须 flush 才能继续送包
+    avcodec_flush_buffers(c->dec_ctx);
+    c->decode_us += av_gettime_relative() - start;
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
+static int run_keyframe(thumb_ctx_t *c, int64_t interval_us, int64_t duration_us)
+{
+    int64_t last_time = AV_NOPTS_VALUE;
+    int ret = 0;
+    c->dec_ctx->skip_frame = AVDISCARD_NONKEY;
+
+    for (int64_t t = 0; duration_us <= 0 || t < duration_us; t += interval_us) {
+        int64_t start = av_gettime_relative();
+        int64_t ts = av_rescale_q(t, AV_TIME_BASE_Q, c->st->time_base);
+        if (c->st->start_time != AV_NOPTS_VALUE)
+            ts += c->st->start_time;
+        // 优先取目标时间之后的关键帧，间隔比 GOP 短时不会反复落到同一个关键帧上
+        ret = avformat_seek_file(c->fmt_ctx, c->stream_index, ts, ts, INT64_MAX, 0);
+        if (ret < 0)
+            ret = av_seek_frame(c->fmt_ctx, c->stream_index, ts, AVSEEK_FLAG_BACKWARD);
+        if (ret < 0) {
+            printf("seek to %.3fs failed:%s\n", t / 1000000.0, av_get_err(ret));
+            break;
+        }
+        int64_t seek_end = av_gettime_relative();
+        c->seek_us += seek_end - start;
+
+        // 读到这个流的第一个关键帧包，其他包直接丢掉，不送解码器
+        int got_key = 0;
+        while ((ret = av_read_frame(c->fmt_ctx, c->pkt)) >= 0) {
+            c->nb_read++;
+            if (c->pkt->stream_index == c->stream_index && (c->pkt->flags & AV_PKT_FLAG_KEY)) {
+                got_key = 1;
+                break;
+            }
+            av_packet_unref(c->pkt);
+        }
+        c->read_us += av_gettime_relative() - seek_end;
+        if (!got_key) {
+            ret = ret == AVERROR_EOF ? 0 : ret;
+            break;      // 后面没有关键帧了
+        }
+
+        int got_frame = 0;
+        ret = decode_keyframe(c, &got_frame);
+        if (ret < 0) {
+            break;
+        }
+        if (!got_frame) {
+            continue;
+        }
+        int64_t time = frame_time_us(c, c->frame);
+        if (last_time != AV_NOPTS_VALUE && time != AV_NOPTS_VALUE && time <= last_time) {
+            c->nb_dup++;
+            av_frame_unref(c->frame);
+            continue;
+        }
+        if (time != AV_NOPTS_VALUE && time > t + interval_us) {
+            t = time / interval_us * interval_us;   // 关键帧比目标时间晚很多，跳过中间的时间点
+        }
+        last_time = time;
+        ret = add_thumb(c, c->frame);
+        av_frame_unref(c->frame);
+        if (ret < 0) {
+            break;
+        }
+        add_latency(c, av_gettime_relative() - start);
+    }
+    return ret;
+}
+
+static int run_full(thumb_ctx_t *c, int64_t interval_us)
+{
+    int64_t next_time = 0;
+    int64_t last = av_gettime_relative();
+    int ret = 0;
+    int eof = 0;
+
+    while (!eof) {
+        int64_t start = av_gettime_relative();
+        ret = av_read_frame(c->fmt_ctx, c->pkt);
+        c->read_us += av_gettime_relative() - start;
+        if (ret == AVERROR_EOF) {
+            eof = 1;    // 发送空包冲刷解码器
+        } else if (ret < 0) {
+            break;
+        } else {
+            c->nb_read++;
+            if (c->pkt->stream_index != c->stream_index) {
+                av_packet_unref(c->pkt);
+                continue;
+            }
+        }
+
+        start = av_gettime_relative();
+        ret = avcodec_send_packet(c->dec_ctx, eof ? NULL : c->pkt);
+        av_packet_unref(c->pkt);
+        if (ret < 0) {
+            printf("avcodec_send_packet failed:%s\n", av_get_err(ret));
+            break;
+        }
+        c->nb_sent++;
+        while ((ret = avcodec_receive_frame(c->dec_ctx, c->frame)) >= 0) {
+            c->nb_decoded++;
+            int64_t time = frame_time_us(c, c->frame);
+            if (time != AV_NOPTS_VALUE && time >= next_time) {
+                ret = add_thumb(c, c->frame);
+                if (ret < 0) {
+                    av_frame_unref(c->frame);
+                    return ret;
+                }
+                next_time = (time / interval_us + 1) * interval_us;
+                int64_t now = av_gettime_relative();
+                add_latency(c, now - last);
+                last = now;
+            }
+            av_frame_unref(c->frame);
+        }
+        c->decode_us += av_gettime_relative() - start;
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+            printf("avcodec_receive_frame failed:%s\n", av_get_err(ret));
+            break;
+        }
+        ret = 0;
+    }
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    thumb_ctx_t c;
+    int ret = -1;
+
+    if (argc < 3) {
+        printf("usage: %s in.mp4 out.yuv [interval_s] [cols] [rows] [2|4|WxH] [full]\n", argv[0]);
+        return -1;
+    }
+    const char *in_filename = argv[1];
+    const char *out_filename = argv[2];
+    double interval = argc > 3 ? atof(argv[3]) : 10.0;
+    int cols = argc > 4 ? atoi(argv[4]) : 5;
+    int rows = argc > 5 ? atoi(argv[5]) : 5;
+    const char *scale = argc > 6 ? argv[6] : "4";
+    int full = argc > 7 && strcmp(argv[7], "full") == 0;
+    if (interval <= 0 || cols <= 0 || rows <= 0) {
+        printf("invalid arguments\n");
+        return -1;
+    }
+    int64_t interval_us = (int64_t)(interval * 1000000);
+
+    memset(&c, 0, sizeof(c));
+    ret = avformat_open_input(&c.fmt_ctx, in_filename, NULL, NULL);
+    if (ret < 0) {
+        printf("avformat_open_input %s failed:%s\n", in_filename, av_get_err(ret));
+        return -1;
+    }
+    ret = avformat_find_stream_info(c.fmt_ctx, NULL);
+    if (ret < 0) {
+        printf("avformat_find_stream_info failed:%s\n", av_get_err(ret));
+        goto failed;
+    }
+    AVCodec *codec = NULL;
+    c.stream_index = av_find_best_stream(c.fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (c.stream_index < 0) {
+        printf("no video stream in %s\n", in_filename);
+        ret = c.stream_index;
+        goto failed;
+    }
+    c.st = c.fmt_ctx->streams[c.stream_index];
+
+    c.dec_ctx = avcodec_alloc_context3(codec);
+    if (!c.dec_ctx) {
+        ret = AVERROR(ENOMEM);
+        goto failed;
+    }
+    avcodec_parameters_to_context(c.dec_ctx, c.st->codecpar);
+    // 每次只解码一个关键帧，帧级多线程只会增加延迟，用片级多线程
+    c.dec_ctx->thread_count = 0;
+    c.dec_ctx->thread_type = FF_THREAD_SLICE;
+    ret = avcodec_open2(c.dec_ctx, codec, NULL);
+    if (ret < 0) {
+        printf("avcodec_open2 failed:%s\n", av_get_err(ret));
+        goto failed;
+    }
+
+    // 格子大小：2/4 为缩小倍数(YUV420P 时走快速路径)，否则为 宽x高
+    int cell_w = 0, cell_h = 0;
+    if (strcmp(scale, "2") == 0 || strcmp(scale, "4") == 0) {
+        sprite_cell_size(c.dec_ctx->width, c.dec_ctx->height, scale[0] == '2' ? 1 : 2, &cell_w,
+                         &cell_h);
+    } else if (sscanf(scale, "%dx%d", &cell_w, &cell_h) != 2) {
+        printf("invalid scale:%s\n", scale);
+        ret = AVERROR(EINVAL);
+        goto failed;
+    }
+    c.sheet = sprite_sheet_alloc(cols, rows, FFALIGN(cell_w, 2), FFALIGN(cell_h, 2));
+    c.writer = yuv_writer_open(out_filename, 0);
+    c.pkt = av_packet_alloc();
+    c.frame = av_frame_alloc();
+    if (!c.sheet || !c.writer || !c.pkt || !c.frame) {
+        ret = AVERROR(ENOMEM);
+        goto failed;
+    }
+
+    int64_t duration_us = c.fmt_ctx->duration;
+    printf("%s %dx%d %s duration:%.3fs, thumbnail every %.3fs, sheet %dx%d of %dx%d\n",
+           in_filename, c.dec_ctx->width, c.dec_ctx->height, codec->name,
+           duration_us > 0 ? duration_us / 1000000.0 : 0.0, interval, cols, rows,
+           c.sheet->cell_w, c.sheet->cell_h);
+
+    int64_t start = av_gettime_relative();
+    ret = full ? run_full(&c, interval_us) : run_keyframe(&c, interval_us, duration_us);
+    // 最后一张拼图没填满也写出
+    if (ret >= 0 && c.sheet->nb_cells > 0) {
+        ret = yuv_writer_write_frame(c.writer, c.sheet->frame);
+        if (ret >= 0)
+            c.nb_sheets++;
+    }
+    int64_t total_us = av_gettime_relative() - start;
+
+    printf("[thumbnail] mode:%s thumbs:%lld dup:%lld sheets:%lld time:%.1fms"
+           " latency avg:%.3fms max:%.3fms\n",
+           full ? "full" : "keyframe", (long long)c.nb_thumbs, (long long)c.nb_dup,
+           (long long)c.nb_sheets, total_us / 1000.0,
+           c.nb_thumbs > 0 ? c.latency_sum_us / 1000.0 / c.nb_thumbs : 0.0,
+           c.latency_max_us / 1000.0);
+    printf("[thumbnail] packets read:%lld sent:%lld frames decoded:%lld seek:%.1fms read:%.1fms"
+           " decode:%.1fms\n",
+           (long long)c.nb_read, (long long)c.nb_sent, (long long)c.nb_decoded,
+           c.seek_us / 1000.0, c.read_us / 1000.0, c.decode_us / 1000.0);
+    sprite_sheet_dump_stats(c.sheet, "thumbnail");
+    yuv_writer_dump_stats(c.writer, "thumbnail");
+    printf("play: ffplay -pixel_format yuv420p -video_size %dx%d %s\n", c.sheet->frame->width,
+           c.sheet->frame->height, out_filename);
+
+failed:
+    av_frame_free(&c.frame);
+    av_packet_free(&c.pkt);
+    yuv_writer_close(c.writer);
+    sprite_sheet_free(c.sheet);
+    avcodec_free_context(&c.dec_ctx);
+    avformat_close_input(&c.fmt_ctx);
+    return ret < 0 ? -1 : 0;
+}
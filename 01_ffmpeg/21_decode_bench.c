@@ -0,0 +1,557 @@
+/**
+ * @brief         解码性能测试，按阶段统计耗时
+ *                05_decode_audio.c / 06_decode_video.c 只能看到总时间，这里把解码循环拆成四个阶段：
+ *                1. read   fread 读取输入文件;
+ *                2. parse  av_parser_parse2 切分裸流;
+ *                3. decode avcodec_send_packet / avcodec_receive_frame;
+ *                4. write  输出原始数据(视频 yuv_writer，音频转交错后一次 fwrite)。
+ *                测试码流由本程序先编码生成(不依赖外部文件)，覆盖几种分辨率和编码器；
+ *                libx264 等外部编码器不存在时跳过对应用例。
+ *                每个阶段统计纳秒和 CPU 周期(x86 用 rdtsc)，输出 fps、每帧各阶段 ns 和进程的峰值 RSS。
+ *                解码循环是单线程顺序执行的(不用 06 的流水线)，方便把时间归到各个阶段；
+ *                --threads 设置解码器内部线程数，给多个值时逐个测试，输出相对第一个值的加速比。
+ *
+ *                用法: 21_decode_bench [--threads 1,2,4,8] [--frames 视频帧数] [--seconds 音频秒数]
+ *                      [--tmp 临时文件前缀]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _WIN32
+#    include <windows.h>
+#    include <psapi.h>
+#else
+#    include <time.h>
+#    include <sys/resource.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#    ifdef _MSC_VER
+#        include <intrin.h>
+#    else
+#        include <x86intrin.h>
+#    endif
+#    define HAVE_TSC 1
+#else
+#    define HAVE_TSC 0
+#endif
+
+#include "libavutil/opt.h"
+#include "libavutil/mem.h"
+#include "libavutil/channel_layout.h"
+#include "libavcodec/avcodec.h"
+#include "pcmconv.h"        // 音频转交错
+#include "yuvwriter.h"      // 视频写文件
+
+#define INBUF_SIZE 20480    // 每次 fread 的大小，同 06_decode_video.c
+#define MAX_THREAD_COUNTS 16
+
+enum { STAGE_READ = 0, STAGE_PARSE, STAGE_DECODE, STAGE_WRITE, STAGE_NB };
+static const char *stage_names[STAGE_NB] = {"read", "parse", "decode", "write"};
+
+typedef struct bench_case {
+    enum AVMediaType type;
+    enum AVCodecID codec_id;
+    const char *encoder;    // 生成测试码流用的编码器
+    int width;
+    int height;
+    int sample_rate;
+    int channels;
+} bench_case_t;
+
+static const bench_case_t bench_cases[] = {
+    {AVMEDIA_TYPE_VIDEO, AV_CODEC_ID_MPEG2VIDEO, "mpeg2video", 640, 360, 0, 0},
+    {AVMEDIA_TYPE_VIDEO, AV_CODEC_ID_MPEG2VIDEO, "mpeg2video", 1280, 720, 0, 0},
+    {AVMEDIA_TYPE_VIDEO, AV_CODEC_ID_MPEG2VIDEO, "mpeg2video", 1920, 1080, 0, 0},
+    {AVMEDIA_TYPE_VIDEO, AV_CODEC_ID_MPEG4, "mpeg4", 1280, 720, 0, 0},
+    {AVMEDIA_TYPE_VIDEO, AV_CODEC_ID_H264, "libx264", 640, 360, 0, 0},
+    {AVMEDIA_TYPE_VIDEO, AV_CODEC_ID_H264, "libx264", 1280, 720, 0, 0},
+    {AVMEDIA_TYPE_VIDEO, AV_CODEC_ID_H264, "libx264", 1920, 1080, 0, 0},
+    {AVMEDIA_TYPE_VIDEO, AV_CODEC_ID_H264, "libx264", 3840, 2160, 0, 0},
+    {AVMEDIA_TYPE_AUDIO, AV_CODEC_ID_MP2, "mp2", 0, 0, 44100, 2},
+    {AVMEDIA_TYPE_AUDIO, AV_CODEC_ID_AC3, "ac3", 0, 0, 48000, 6},
+};
+
+// 一个时间点：纳秒 + CPU 周期
+typedef struct tick {
+    int64_t ns;
+    uint64_t cycles;
+} tick_t;
+
+typedef struct bench_result {
+    int64_t nb_frames;
+    int64_t nb_packets;
+    int64_t in_bytes;
+    int64_t stage_ns[STAGE_NB];
+    uint64_t stage_cycles[STAGE_NB];
+    int64_t total_ns;
+} bench_result_t;
+
+static char err_buf[128] = {0};
+
+static char *av_get_err(int errnum)
+{
+    av_strerror(errnum, err_buf, 128);
+    return err_buf;
+}
+
+static int64_t now_ns(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER counter;
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (int64_t)((double)counter.QuadPart * 1e9 / freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static inline tick_t tick_now(void)
+{
+    tick_t t;
+    t.ns = now_ns();
+#if HAVE_TSC
+    t.cycles = __rdtsc();
+#else
+    t.cycles = 0;
+#endif
+    return t;
+}
+
+static inline void stage_add(bench_result_t *r, int stage, tick_t begin)
+{
+    tick_t end = tick_now();
+    r->stage_ns[stage] += end.ns - begin.ns;
+    r->stage_cycles[stage] += end.cycles - begin.cycles;
+}
+
+// 进程的峰值 RSS(MB)，只增不减，所以是到目前为止所有用例的最大值
+static double peak_rss_mb(void)
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return pmc.PeakWorkingSetSize / (1024.0 * 1024.0);
+    return 0.0;
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+        return 0.0;
+#    ifdef __APPLE__
+    return ru.ru_maxrss / (1024.0 * 1024.0);   // 字节
+#    else
+    return ru.ru_maxrss / 1024.0;              // KB
+#    endif
+#endif
+}
+
+static const char *case_name(const bench_case_t *bc, char *buf, int size)
+{
+    if (bc->type == AVMEDIA_TYPE_VIDEO)
+        snprintf(buf, size, "%s %dx%d", avcodec_get_name(bc->codec_id), bc->width, bc->height);
+    else
+        snprintf(buf, size, "%s %dHz %dch", avcodec_get_name(bc->codec_id), bc->sample_rate,
+                 bc->channels);
+    return buf;
+}
+
+// ===== 生成测试码流 =====
+
+// 运动的渐变图案，同 FFmpeg encode_video 示例
+static void fill_video_frame(AVFrame *frame, int i)
+{
+    for (int y = 0; y < frame->height; y++)
+        for (int x = 0; x < frame->width; x++)
+            frame->data[0][y * frame->linesize[0] + x] = x + y + i * 3;
+    for (int y = 0; y < frame->height / 2; y++) {
+        for (int x = 0; x < frame->width / 2; x++) {
+            frame->data[1][y * frame->linesize[1] + x] = 128 + y + i * 2;
+            frame->data[2][y * frame->linesize[2] + x] = 64 + x + i * 5;
+        }
+    }
+}
+
+// 每个声道不同频率的正弦波，支持编码器常用的 S16/S16P/FLT/FLTP
+static void fill_audio_frame(AVFrame *frame, int64_t first_sample)
+{
+    int planar = av_sample_fmt_is_planar((enum AVSampleFormat)frame->format);
+    int is_float = av_get_packed_sample_fmt((enum AVSampleFormat)frame->format) == AV_SAMPLE_FMT_FLT;
+    for (int ch = 0; ch < frame->channels; ch++) {
+        double freq = 220.0 * (ch + 1);
+        for (int i = 0; i < frame->nb_samples; i++) {
+            double v = 0.5 * sin(2 * M_PI * freq * (first_sample + i) / frame->sample_rate);
+            int idx = planar ? i : i * frame->channels + ch;
+            uint8_t *plane = frame->data[planar ? ch : 0];
+            if (is_float)
+                ((float *)plane)[idx] = (float)v;
+            else
+                ((int16_t *)plane)[idx] = (int16_t)(v * 32767);
+        }
+    }
+}
+
+static int write_packets(AVCodecContext *enc_ctx, AVFrame *frame, AVPacket *pkt, FILE *fp)
+{
+    int ret = avcodec_send_frame(enc_ctx, frame);
+    if (ret < 0) {
+        return ret;
+    }
+    while ((ret = avcodec_receive_packet(enc_ctx, pkt)) >= 0) {
+        fwrite(pkt->data, 1, pkt->size, fp);
+        av_packet_unref(pkt);
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+/**
+ * 编码生成测试码流(裸流)写到 path
+ * @return 编码器不存在返回 AVERROR_ENCODER_NOT_FOUND
+ */
+static int generate_stream(const bench_case_t *bc, int nb_video_frames, int audio_seconds,
+                           const char *path)
+{
+    const AVCodec *codec = avcodec_find_encoder_by_name(bc->encoder);
+    if (!codec) {
+        return AVERROR_ENCODER_NOT_FOUND;
+    }
+    AVCodecContext *enc_ctx = avcodec_alloc_context3(codec);
+    AVFrame *frame = av_frame_alloc();
+    AVPacket *pkt = av_packet_alloc();
+    FILE *fp = NULL;
+    int ret = AVERROR(ENOMEM);
+    if (!enc_ctx || !frame || !pkt) {
+        goto end;
+    }
+
+    if (bc->type == AVMEDIA_TYPE_VIDEO) {
+        enc_ctx->width = bc->width;
+        enc_ctx->height = bc->height;
+        enc_ctx->time_base = (AVRational){1, 25};
+        enc_ctx->framerate = (AVRational){25, 1};
+        enc_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+        enc_ctx->gop_size = 25;
+        enc_ctx->max_b_frames = 2;
+        enc_ctx->bit_rate = (int64_t)bc->width * bc->height * 4;    // 1080p 约 8Mbps
+        if (codec->id == AV_CODEC_ID_H264)
+            av_opt_set(enc_ctx->priv_data, "preset", "veryfast", 0);
+    } else {
+        enc_ctx->sample_rate = bc->sample_rate;
+        enc_ctx->channels = bc->channels;
+        enc_ctx->channel_layout = av_get_default_channel_layout(bc->channels);
+        enc_ctx->sample_fmt = codec->sample_fmts ? codec->sample_fmts[0] : AV_SAMPLE_FMT_S16;
+        enc_ctx->bit_rate = 64000 * bc->channels;
+    }
+    ret = avcodec_open2(enc_ctx, codec, NULL);
+    if (ret < 0) {
+        printf("open encoder %s failed:%s\n", bc->encoder, av_get_err(ret));
+        goto end;
+    }
+
+    if (bc->type == AVMEDIA_TYPE_VIDEO) {
+        frame->format = enc_ctx->pix_fmt;
+        frame->width = enc_ctx->width;
+        frame->height = enc_ctx->height;
+    } else {
+        frame->format = enc_ctx->sample_fmt;
+        frame->channels = enc_ctx->channels;
+        frame->channel_layout = enc_ctx->channel_layout;
+        frame->sample_rate = enc_ctx->sample_rate;
+        frame->nb_samples = enc_ctx->frame_size;
+    }
+    ret = av_frame_get_buffer(frame, 0);
+    if (ret < 0) {
+        goto end;
+    }
+
+    fp = fopen(path, "wb");
+    if (!fp) {
+        printf("open %s failed\n", path);
+        ret = AVERROR(EIO);
+        goto end;
+    }
+    int nb_frames = bc->type == AVMEDIA_TYPE_VIDEO
+                        ? nb_video_frames
+                        : (int)((int64_t)audio_seconds * bc->sample_rate / enc_ctx->frame_size);
+    for (int i = 0; i < nb_frames; i++) {
+        ret = av_frame_make_writable(frame);
+        if (ret < 0) {
+            goto end;
+        }
+        if (bc->type == AVMEDIA_TYPE_VIDEO) {
+            fill_video_frame(frame, i);
+        } else {
+            fill_audio_frame(frame, (int64_t)i * frame->nb_samples);
+        }
+        frame->pts = bc->type == AVMEDIA_TYPE_VIDEO ? i : (int64_t)i * frame->nb_samples;
+        ret = write_packets(enc_ctx, frame, pkt, fp);
+        if (ret < 0) {
+            goto end;
+        }
+    }
+    ret = write_packets(enc_ctx, NULL, pkt, fp);
+
+end:
+    if (fp)
+        fclose(fp);
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+    avcodec_free_context(&enc_ctx);
+    return ret;
+}
+
+// ===== 解码测试 =====
+
+typedef struct bench_ctx {
+    AVCodecContext *dec_ctx;
+    AVFrame *frame;
+    yuv_writer_t *yuv_writer;   // 视频输出
+    FILE *pcm_fp;               // 音频输出
+    uint8_t *pcm_buf;
+    unsigned int pcm_buf_size;
+    bench_result_t *r;
+} bench_ctx_t;
+
+static int decode_packet(bench_ctx_t *b, AVPacket *pkt)
+{
+    bench_result_t *r = b->r;
+    tick_t t = tick_now();
+    int ret = avcodec_send_packet(b->dec_ctx, pkt);
+    if (ret < 0) {
+        printf("avcodec_send_packet failed:%s\n", av_get_err(ret));
+        return ret;
+    }
+    if (pkt)
+        r->nb_packets++;
+    for (;;) {
+        ret = avcodec_receive_frame(b->dec_ctx, b->frame);
+        stage_add(r, STAGE_DECODE, t);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return 0;
+        } else if (ret < 0) {
+            printf("avcodec_receive_frame failed:%s\n", av_get_err(ret));
+            return ret;
+        }
+        r->nb_frames++;
+
+        t = tick_now();
+        if (b->yuv_writer) {
+            ret = yuv_writer_write_frame(b->yuv_writer, b->frame);
+        } else {
+            ret = pcm_frame_to_interleaved(b->frame, &b->pcm_buf, &b->pcm_buf_size);
+            if (ret > 0)
+                fwrite(b->pcm_buf, 1, ret, b->pcm_fp);
+        }
+        av_frame_unref(b->frame);
+        stage_add(r, STAGE_WRITE, t);
+        if (ret < 0) {
+            return ret;
+        }
+        t = tick_now();
+    }
+}
+
+static int run_decode(const bench_case_t *bc, const char *in_path, const char *out_path,
+                      int threads, bench_result_t *r)
+{
+    uint8_t inbuf[INBUF_SIZE + AV_INPUT_BUFFER_PADDING_SIZE];
+    bench_ctx_t b;
+    AVCodecParserContext *parser = NULL;
+    AVPacket *pkt = NULL;
+    FILE *in_fp = NULL;
+    int ret = AVERROR(ENOMEM);
+
+    memset(&b, 0, sizeof(b));
+    memset(r, 0, sizeof(*r));
+    memset(inbuf + INBUF_SIZE, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    b.r = r;
+
+    const AVCodec *codec = avcodec_find_decoder(bc->codec_id);
+    if (!codec) {
+        printf("decoder %s not found\n", avcodec_get_name(bc->codec_id));
+        return AVERROR_DECODER_NOT_FOUND;
+    }
+    parser = av_parser_init(codec->id);
+    b.dec_ctx = avcodec_alloc_context3(codec);
+    b.frame = av_frame_alloc();
+    pkt = av_packet_alloc();
+    if (!parser || !b.dec_ctx || !b.frame || !pkt) {
+        goto end;
+    }
+    b.dec_ctx->thread_count = threads;
+    ret = avcodec_open2(b.dec_ctx, codec, NULL);
+    if (ret < 0) {
+        printf("avcodec_open2 failed:%s\n", av_get_err(ret));
+        goto end;
+    }
+
+    in_fp = fopen(in_path, "rb");
+    if (bc->type == AVMEDIA_TYPE_VIDEO)
+        b.yuv_writer = yuv_writer_open(out_path, 0);
+    else
+        b.pcm_fp = fopen(out_path, "wb");
+    if (!in_fp || (!b.yuv_writer && !b.pcm_fp)) {
+        printf("open %s / %s failed\n", in_path, out_path);
+        ret = AVERROR(EIO);
+        goto end;
+    }
+
+    tick_t start = tick_now();
+    for (;;) {
+        tick_t t = tick_now();
+        size_t data_size = fread(inbuf, 1, INBUF_SIZE, in_fp);
+        stage_add(r, STAGE_READ, t);
+        r->in_bytes += data_size;
+        int eof = data_size == 0;
+        uint8_t *data = inbuf;
+        // 文件结束时再调用一次 parser(空输入)取出最后一个包
+        while (data_size > 0 || eof) {
+            t = tick_now();
+            ret = av_parser_parse2(parser, b.dec_ctx, &pkt->data, &pkt->size, data, (int)data_size,
+                                   AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+            stage_add(r, STAGE_PARSE, t);
+            if (ret < 0) {
+                printf("av_parser_parse2 failed:%s\n", av_get_err(ret));
+                goto end;
+            }
+            data += ret;
+            data_size -= ret;
+            if (pkt->size) {
+                ret = decode_packet(&b, pkt);
+                if (ret < 0) {
+                    goto end;
+                }
+            } else if (eof) {
+                break;
+            }
+        }
+        if (eof) {
+            break;
+        }
+    }
+    ret = decode_packet(&b, NULL);  // 冲刷解码器
+    r->total_ns = tick_now().ns - start.ns;
+
+end:
+    if (in_fp)
+        fclose(in_fp);
+    if (b.pcm_fp)
+        fclose(b.pcm_fp);
+    yuv_writer_close(b.yuv_writer);
+    remove(out_path);
+    av_freep(&b.pcm_buf);
+    av_packet_free(&pkt);
+    av_frame_free(&b.frame);
+    avcodec_free_context(&b.dec_ctx);
+    av_parser_close(parser);
+    return ret;
+}
+
+static void print_result(const char *name, int threads, const bench_result_t *r,
+                         const bench_result_t *base)
+{
+    double seconds = r->total_ns / 1e9;
+    double fps = seconds > 0 ? r->nb_frames / seconds : 0.0;
+    printf("%-22s thr:%2d frames:%5lld fps:%9.1f", name, threads, (long long)r->nb_frames, fps);
+    if (base && base != r && base->total_ns > 0 && r->total_ns > 0)
+        printf(" (x%.2f)", (double)base->total_ns / r->total_ns);
+    printf(" | ns/frame");
+    for (int i = 0; i < STAGE_NB; i++)
+        printf(" %s:%.0f", stage_names[i],
+               r->nb_frames > 0 ? (double)r->stage_ns[i] / r->nb_frames : 0.0);
+#if HAVE_TSC
+    printf(" | cycles/frame decode:%.0f",
+           r->nb_frames > 0 ? (double)r->stage_cycles[STAGE_DECODE] / r->nb_frames : 0.0);
+#endif
+    printf(" | in:%.2fMB peak rss:%.1fMB\n", r->in_bytes / (1024.0 * 1024.0), peak_rss_mb());
+}
+
+// 解析 "1,2,4,8"
+static int parse_threads(const char *str, int *threads, int max)
+{
+    int n = 0;
+    while (*str && n < max) {
+        char *end = NULL;
+        long v = strtol(str, &end, 10);
+        if (end == str || v < 0) {
+            return AVERROR(EINVAL);
+        }
+        threads[n++] = (int)v;
+        str = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') {
+            return AVERROR(EINVAL);
+        }
+    }
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    int threads[MAX_THREAD_COUNTS] = {1};
+    int nb_threads = 1;
+    int nb_video_frames = 250;
+    int audio_seconds = 30;
+    const char *tmp_prefix = "decode_bench";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            nb_threads = parse_threads(argv[++i], threads, MAX_THREAD_COUNTS);
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            nb_video_frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            audio_seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tmp") == 0 && i + 1 < argc) {
+            tmp_prefix = argv[++i];
+        } else {
+            printf("usage: %s [--threads 1,2,4,8] [--frames N] [--seconds N] [--tmp prefix]\n",
+                   argv[0]);
+            return -1;
+        }
+    }
+    if (nb_threads <= 0 || nb_video_frames <= 0 || audio_seconds <= 0) {
+        printf("invalid arguments\n");
+        return -1;
+    }
+
+    char in_path[1024], out_path[1024], name[64];
+    snprintf(in_path, sizeof(in_path), "%s.es", tmp_prefix);
+    snprintf(out_path, sizeof(out_path), "%s.raw", tmp_prefix);
+    printf("video frames:%d audio seconds:%d pcm conv:%s tsc:%s\n", nb_video_frames,
+           audio_seconds, pcm_conv_simd_name(), HAVE_TSC ? "yes" : "no");
+
+    for (size_t i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); i++) {
+        const bench_case_t *bc = &bench_cases[i];
+        case_name(bc, name, sizeof(name));
+        int ret = generate_stream(bc, nb_video_frames, audio_seconds, in_path);
+        if (ret == AVERROR_ENCODER_NOT_FOUND) {
+            printf("%-22s skipped, encoder %s not found\n", name, bc->encoder);
+            continue;
+        } else if (ret < 0) {
+            printf("%-22s generate stream failed:%s\n", name, av_get_err(ret));
+            continue;
+        }
+
+        bench_result_t base;
+        memset(&base, 0, sizeof(base));
+        // 音频解码器基本不使用多线程，只测第一个线程数
+        int nb_runs = bc->type == AVMEDIA_TYPE_VIDEO ? nb_threads : 1;
+        for (int j = 0; j < nb_runs; j++) {
+            bench_result_t r;
+            if (run_decode(bc, in_path, out_path, threads[j], &r) < 0) {
+                printf("%-22s thr:%2d decode failed\n", name, threads[j]);
+                continue;
+            }
+            if (j == 0)
+                base = r;
+            print_result(name, threads[j], &r, j == 0 ? NULL : &base);
+        }
+        remove(in_path);
+    }
+    return 0;
+}
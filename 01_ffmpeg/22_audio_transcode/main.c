@@ -0,0 +1,510 @@
+/**
+ * @brief         一次完成 音频解码 -> 重采样 -> AAC 编码 的转码器
+ *                原来需要 05_decode_audio(写 PCM 文件) -> 09_02_audio_resample -> 10_encode_audio
+ *                三个程序通过磁盘上的临时 PCM 文件串起来。这里三个阶段在三个线程中并行，
+ *                解码出的 AVFrame 直接送进 audio_resampler_t，按编码器的 frame_size 取出后送给 AAC 编码器，
+ *                没有中间文件：
+ *                  解封装+解码线程 --frame_queue--> 重采样线程 --resampled_queue--> 编码+封装(主线程)
+ *                队列有界，下游慢时上游阻塞，内存不会无限增长。
+ *                重采样输出使用重采样器的帧池，编码完的帧经 recycled_queue 还给重采样线程回收，稳态下不再分配帧。
+ *                结束时输出吞吐(相对实时的倍数)和端到端延迟(解码器输出一帧到包含这帧第一个采样的包写出)。
+ *
+ *                用法: 22_audio_transcode in.mp3 out.aac [采样率] [声道数] [码率]
+ *                默认 48000Hz 2声道 128kbps，输出格式由文件名决定(.aac 为 ADTS，.m4a 为 MP4)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "libavutil/time.h"
+#include "libavutil/channel_layout.h"
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+#include "audioresampler.h"     // 重采样
+#include "boundedqueue.h"       // 线程之间传递帧
+
+#define FRAME_QUEUE_SIZE 32     // 解码 -> 重采样 最多缓存的帧
+#define RESAMPLED_QUEUE_SIZE 32 // 重采样 -> 编码 最多缓存的帧
+#define LATENCY_RING_SIZE 1024  // 在途帧的解码时间记录，超过队列和 fifo 能缓存的帧数即可
+// 在途的池帧最多是 resampled_queue 容量 + 编码线程手上一帧 + 帧池容量，回收队列不会满
+#define RECYCLED_QUEUE_SIZE (RESAMPLED_QUEUE_SIZE * 2 + 4)
+
+/**
+ * 记录每个解码帧最后一个采样之后的 pts(输出采样率为单位)和解码出来的时间，
+ * 编码器输出包时按包的 pts 找到对应的解码帧，计算端到端延迟
+ */
+typedef struct latency_entry {
+    int64_t end_pts;
+    int64_t time_us;
+} latency_entry_t;
+
+typedef struct latency_tracker {
+    pthread_mutex_t mutex;
+    latency_entry_t entries[LATENCY_RING_SIZE];
+    int head;
+    int count;
+    int64_t sum_us;
+    int64_t max_us;
+    int64_t nb;
+} latency_tracker_t;
+
+typedef struct transcoder {
+    AVFormatContext *ifmt_ctx;
+    AVFormatContext *ofmt_ctx;
+    AVCodecContext *dec_ctx;
+    AVCodecContext *enc_ctx;
+    AVStream *out_stream;
+    int stream_index;
+    audio_resampler_t *resampler;
+
+    bounded_queue_t *frame_queue;
+    bounded_queue_t *resampled_queue;
+    bounded_queue_t *recycled_queue;    // 编码完的帧还给重采样线程放回帧池
+    latency_tracker_t latency;
+
+    // 各阶段统计
+    int64_t nb_decoded;         // 解码帧数
+    int64_t nb_in_samples;      // 输入采样数(单声道)
+    int64_t nb_resampled;       // 重采样后送给编码器的帧数
+    int64_t nb_packets;
+    int64_t out_bytes;
+    int64_t decode_us;          // 各线程的忙碌时间(不含在队列上等待)
+    int64_t resample_us;
+    int64_t encode_us;
+    int decode_error;
+    int resample_error;
+} transcoder_t;
+
+static void latency_push(latency_tracker_t *t, int64_t end_pts, int64_t time_us)
+{
+    pthread_mutex_lock(&t->mutex);
+    if (t->count == LATENCY_RING_SIZE) {
+        t->head = (t->head + 1) % LATENCY_RING_SIZE;    // 满了丢掉最早的
+        t->count--;
+    }
+    latency_entry_t *e = &t->entries[(t->head + t->count) % LATENCY_RING_SIZE];
+    e->end_pts = end_pts;
+    e->time_us = time_us;
+    t->count++;
+    pthread_mutex_unlock(&t->mutex);
+}
+
+// 包的第一个采样位于 pts，之前的帧都已经编码完，丢掉
+static void latency_update(latency_tracker_t *t, int64_t pts, int64_t now)
+{
+    pthread_mutex_lock(&t->mutex);
+    while (t->count > 1 && t->entries[t->head].end_pts <= pts) {
+        t->head = (t->head + 1) % LATENCY_RING_SIZE;
+        t->count--;
+    }
+    if (t->count > 0) {
+        int64_t latency = now - t->entries[t->head].time_us;
+        t->sum_us += latency;
+        if (latency > t->max_us)
+            t->max_us = latency;
+        t->nb++;
+    }
+    pthread_mutex_unlock(&t->mutex);
+}
+
+static void abort_all(transcoder_t *t)
+{
+    bounded_queue_abort(t->frame_queue);
+    bounded_queue_abort(t->resampled_queue);
+}
+
+// 解封装 + 解码线程
+static void *decode_thread(void *arg)
+{
+    transcoder_t *t = (transcoder_t *)arg;
+    AVPacket *pkt = av_packet_alloc();
+    int64_t next_pts = 0;       // 输出采样率为单位，按采样数连续计算，不依赖输入的时间戳
+    int ret = 0;
+    int eof = 0;
+
+    if (!pkt) {
+        t->decode_error = AVERROR(ENOMEM);
+        abort_all(t);
+        return NULL;
+    }
+    int64_t start = av_gettime_relative();
+    while (!eof) {
+        ret = av_read_frame(t->ifmt_ctx, pkt);
+        if (ret == AVERROR_EOF) {
+            eof = 1;    // 发送空包冲刷解码器
+        } else if (ret < 0) {
+            printf("av_read_frame failed:%s\n", av_err2str(ret));
+            break;
+        } else if (pkt->stream_index != t->stream_index) {
+            av_packet_unref(pkt);
+            continue;
+        }
+        ret = avcodec_send_packet(t->dec_ctx, eof ? NULL : pkt);
+        av_packet_unref(pkt);
+        if (ret < 0) {
+            printf("avcodec_send_packet failed:%s, skip packet\n", av_err2str(ret));
+            continue;
+        }
+        for (;;) {
+            AVFrame *frame = av_frame_alloc();
+            if (!frame) {
+                ret = AVERROR(ENOMEM);
+                break;
+            }
+            ret = avcodec_receive_frame(t->dec_ctx, frame);
+            if (ret < 0) {
+                av_frame_free(&frame);
+                break;
+            }
+            t->nb_decoded++;
+            t->nb_in_samples += frame->nb_samples;
+            if (!frame->channel_layout)
+                frame->channel_layout = av_get_default_channel_layout(frame->channels);
+            frame->pts = next_pts;
+            next_pts += av_rescale(frame->nb_samples, t->enc_ctx->sample_rate, frame->sample_rate);
+            int64_t now = av_gettime_relative();
+            latency_push(&t->latency, next_pts, now);
+            t->decode_us += now - start;
+            ret = bounded_queue_push(t->frame_queue, frame);    // 队列满时等待重采样线程
+            start = av_gettime_relative();
+            if (ret < 0) {
+                av_frame_free(&frame);
+                goto end;
+            }
+        }
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+            printf("avcodec_receive_frame failed:%s\n", av_err2str(ret));
+            break;
+        }
+        ret = 0;
+    }
+end:
+    t->decode_us += av_gettime_relative() - start;
+    if (ret < 0 && ret != AVERROR_EXIT && ret != AVERROR_EOF) {
+        t->decode_error = ret;
+        abort_all(t);
+    }
+    bounded_queue_finish(t->frame_queue);
+    av_packet_free(&pkt);
+    return NULL;
+}
+
+// 从 fifo 中取出编码器需要的帧大小，flush 时取出剩余的所有采样
+static int push_resampled(transcoder_t *t, int flush)
+{
+    int frame_size = t->enc_ctx->frame_size;
+    AVFrame *frame = NULL;
+    // 帧池只在重采样线程中使用，先把编码线程还回来的帧放回池中
+    while (bounded_queue_try_pop(t->recycled_queue, (void **)&frame) == 0)
+        audio_resampler_recycle_frame(t->resampler, frame);
+    for (;;) {
+        int nb = frame_size;
+        if (flush) {
+            int fifo_size = audio_resampler_get_fifo_size(t->resampler);
+            nb = fifo_size < frame_size ? fifo_size : frame_size;   // 最后一帧可以不足 frame_size
+        }
+        frame = audio_resampler_receive_pooled_frame(t->resampler, nb);
+        if (!frame) {
+            return 0;
+        }
+        t->nb_resampled++;
+        int ret = bounded_queue_push(t->resampled_queue, frame);
+        if (ret < 0) {
+            av_frame_free(&frame);
+            return ret;
+        }
+    }
+}
+
+// 重采样线程
+static void *resample_thread(void *arg)
+{
+    transcoder_t *t = (transcoder_t *)arg;
+    AVFrame *frame = NULL;
+    int ret = 0;
+    while ((ret = bounded_queue_pop(t->frame_queue, (void **)&frame)) == 0) {
+        int64_t start = av_gettime_relative();
+        ret = audio_resampler_send_frame(t->resampler, frame);
+        av_frame_free(&frame);
+        if (ret < 0) {
+            printf("audio_resampler_send_frame failed:%s\n", av_err2str(ret));
+            break;
+        }
+        ret = push_resampled(t, 0);
+        t->resample_us += av_gettime_relative() - start;
+        if (ret < 0) {
+            break;
+        }
+    }
+    if (ret == AVERROR_EOF) {
+        // 冲刷重采样器中缓存的采样
+        int64_t start = av_gettime_relative();
+        audio_resampler_send_frame(t->resampler, NULL);
+        ret = push_resampled(t, 1);
+        t->resample_us += av_gettime_relative() - start;
+    }
+    if (ret < 0 && ret != AVERROR_EOF && ret != AVERROR_EXIT) {
+        t->resample_error = ret;
+        abort_all(t);
+    }
+    bounded_queue_finish(t->resampled_queue);
+    return NULL;
+}
+
+static int encode_write(transcoder_t *t, AVFrame *frame, AVPacket *pkt)
+{
+    int ret = avcodec_send_frame(t->enc_ctx, frame);
+    if (ret < 0) {
+        printf("avcodec_send_frame failed:%s\n", av_err2str(ret));
+        return ret;
+    }
+    while ((ret = avcodec_receive_packet(t->enc_ctx, pkt)) >= 0) {
+        int64_t pts = pkt->pts;
+        t->nb_packets++;
+        t->out_bytes += pkt->size;
+        pkt->stream_index = t->out_stream->index;
+        av_packet_rescale_ts(pkt, t->enc_ctx->time_base, t->out_stream->time_base);
+        ret = av_interleaved_write_frame(t->ofmt_ctx, pkt);
+        if (ret < 0) {
+            printf("av_interleaved_write_frame failed:%s\n", av_err2str(ret));
+            return ret;
+        }
+        latency_update(&t->latency, pts, av_gettime_relative());
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+static int open_input(transcoder_t *t, const char *filename)
+{
+    int ret = avformat_open_input(&t->ifmt_ctx, filename, NULL, NULL);
+    if (ret < 0) {
+        printf("avformat_open_input %s failed:%s\n", filename, av_err2str(ret));
+        return ret;
+    }
+    ret = avformat_find_stream_info(t->ifmt_ctx, NULL);
+    if (ret < 0) {
+        printf("avformat_find_stream_info failed:%s\n", av_err2str(ret));
+        return ret;
+    }
+    AVCodec *codec = NULL;
+    t->stream_index = av_find_best_stream(t->ifmt_ctx, AVMEDIA_TYPE_AUDIO, -1, -1, &codec, 0);
+    if (t->stream_index < 0) {
+        printf("no audio stream in %s\n", filename);
+        return t->stream_index;
+    }
+    t->dec_ctx = avcodec_alloc_context3(codec);
+    if (!t->dec_ctx) {
+        return AVERROR(ENOMEM);
+    }
+    avcodec_parameters_to_context(t->dec_ctx, t->ifmt_ctx->streams[t->stream_index]->codecpar);
+    ret = avcodec_open2(t->dec_ctx, codec, NULL);
+    if (ret < 0) {
+        printf("open decoder failed:%s\n", av_err2str(ret));
+        return ret;
+    }
+    if (!t->dec_ctx->channel_layout)
+        t->dec_ctx->channel_layout = av_get_default_channel_layout(t->dec_ctx->channels);
+    return 0;
+}
+
+static int open_output(transcoder_t *t, const char *filename, int sample_rate, int channels,
+                       int bit_rate)
+{
+    int ret = avformat_alloc_output_context2(&t->ofmt_ctx, NULL, NULL, filename);
+    if (ret < 0 || !t->ofmt_ctx) {
+        printf("avformat_alloc_output_context2 %s failed\n", filename);
+        return ret < 0 ? ret : AVERROR(EINVAL);
+    }
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_AAC);
+    if (!codec) {
+        printf("aac encoder not found\n");
+        return AVERROR_ENCODER_NOT_FOUND;
+    }
+    t->enc_ctx = avcodec_alloc_context3(codec);
+    t->out_stream = avformat_new_stream(t->ofmt_ctx, NULL);
+    if (!t->enc_ctx || !t->out_stream) {
+        return AVERROR(ENOMEM);
+    }
+    t->enc_ctx->sample_fmt = AV_SAMPLE_FMT_FLTP;   // FFmpeg原生AAC要求平面浮点
+    t->enc_ctx->sample_rate = sample_rate;
+    t->enc_ctx->channels = channels;
+    t->enc_ctx->channel_layout = av_get_default_channel_layout(channels);
+    t->enc_ctx->bit_rate = bit_rate;
+    t->enc_ctx->time_base = (AVRational){1, sample_rate};
+    if (t->ofmt_ctx->oformat->flags & AVFMT_GLOBALHEADER)
+        t->enc_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;   // MP4 等需要 extradata
+    ret = avcodec_open2(t->enc_ctx, codec, NULL);
+    if (ret < 0) {
+        printf("open aac encoder failed:%s\n", av_err2str(ret));
+        return ret;
+    }
+    avcodec_parameters_from_context(t->out_stream->codecpar, t->enc_ctx);
+    t->out_stream->time_base = t->enc_ctx->time_base;
+
+    if (!(t->ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&t->ofmt_ctx->pb, filename, AVIO_FLAG_WRITE);
+        if (ret < 0) {
+            printf("avio_open %s failed:%s\n", filename, av_err2str(ret));
+            return ret;
+        }
+    }
+    ret = avformat_write_header(t->ofmt_ctx, NULL);
+    if (ret < 0) {
+        printf("avformat_write_header failed:%s\n", av_err2str(ret));
+    }
+    return ret;
+}
+
+static void dump_queue_stats(bounded_queue_t *q, const char *name)
+{
+    bounded_queue_stats_t s;
+    bounded_queue_get_stats(q, &s);
+    printf("[transcode] %s max depth:%d/%d push waits:%lld pop waits:%lld\n", name, s.max_depth,
+           q->capacity, (long long)s.push_waits, (long long)s.pop_waits);
+}
+
+static void free_queue(bounded_queue_t *q)
+{
+    AVFrame *frame = NULL;
+    if (!q) {
+        return;
+    }
+    while (bounded_queue_try_pop(q, (void **)&frame) == 0)
+        av_frame_free(&frame);
+    bounded_queue_free(q);
+}
+
+int main(int argc, char **argv)
+{
+    transcoder_t t;
+    pthread_t decode_tid, resample_tid;
+    int threads_started = 0;
+    AVPacket *pkt = NULL;
+    AVFrame *frame = NULL;
+    int ret = 0;
+
+    if (argc < 3) {
+        printf("usage: %s in.mp3 out.aac [sample_rate] [channels] [bit_rate]\n", argv[0]);
+        return -1;
+    }
+    int sample_rate = argc > 3 ? atoi(argv[3]) : 48000;
+    int channels = argc > 4 ? atoi(argv[4]) : 2;
+    int bit_rate = argc > 5 ? atoi(argv[5]) : 128000;
+    if (sample_rate <= 0 || channels <= 0 || bit_rate <= 0) {
+        printf("invalid arguments\n");
+        return -1;
+    }
+
+    memset(&t, 0, sizeof(t));
+    pthread_mutex_init(&t.latency.mutex, NULL);
+    if ((ret = open_input(&t, argv[1])) < 0 ||
+        (ret = open_output(&t, argv[2], sample_rate, channels, bit_rate)) < 0) {
+        goto end;
+    }
+
+    audio_resampler_params_t params;
+    params.src_sample_fmt = t.dec_ctx->sample_fmt;
+    params.src_sample_rate = t.dec_ctx->sample_rate;
+    params.src_channel_layout = t.dec_ctx->channel_layout;
+    params.dst_sample_fmt = t.enc_ctx->sample_fmt;
+    params.dst_sample_rate = t.enc_ctx->sample_rate;
+    params.dst_channel_layout = t.enc_ctx->channel_layout;
+    t.resampler = audio_resampler_alloc(params);
+    t.frame_queue = bounded_queue_alloc(FRAME_QUEUE_SIZE);
+    t.resampled_queue = bounded_queue_alloc(RESAMPLED_QUEUE_SIZE);
+    t.recycled_queue = bounded_queue_alloc(RECYCLED_QUEUE_SIZE);
+    pkt = av_packet_alloc();
+    if (!t.resampler || !t.frame_queue || !t.resampled_queue || !t.recycled_queue || !pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    printf("%s: %s %dHz %dch %s -> %s: aac %dHz %dch %dbps frame_size:%d\n", argv[1],
+           t.dec_ctx->codec->name, t.dec_ctx->sample_rate, t.dec_ctx->channels,
+           av_get_sample_fmt_name(t.dec_ctx->sample_fmt), argv[2], sample_rate, channels, bit_rate,
+           t.enc_ctx->frame_size);
+
+    int64_t start_time = av_gettime_relative();
+    if (pthread_create(&decode_tid, NULL, decode_thread, &t) != 0) {
+        ret = AVERROR(EAGAIN);
+        goto end;
+    }
+    threads_started = 1;
+    if (pthread_create(&resample_tid, NULL, resample_thread, &t) != 0) {
+        abort_all(&t);
+        pthread_join(decode_tid, NULL);
+        threads_started = 0;
+        ret = AVERROR(EAGAIN);
+        goto end;
+    }
+    threads_started = 2;
+
+    // 主线程编码 + 封装
+    while ((ret = bounded_queue_pop(t.resampled_queue, (void **)&frame)) == 0) {
+        int64_t start = av_gettime_relative();
+        ret = encode_write(&t, frame, pkt);
+        // 编码器不持有帧的引用，还给重采样线程复用
+        if (bounded_queue_push(t.recycled_queue, frame) < 0)
+            av_frame_free(&frame);
+        t.encode_us += av_gettime_relative() - start;
+        if (ret < 0) {
+            abort_all(&t);
+            break;
+        }
+    }
+    if (ret == AVERROR_EOF) {
+        int64_t start = av_gettime_relative();
+        ret = encode_write(&t, NULL, pkt);     // 冲刷编码器
+        t.encode_us += av_gettime_relative() - start;
+    }
+    pthread_join(decode_tid, NULL);
+    pthread_join(resample_tid, NULL);
+    threads_started = 0;
+    if (ret >= 0 && (t.decode_error < 0 || t.resample_error < 0))
+        ret = t.decode_error < 0 ? t.decode_error : t.resample_error;
+    if (ret >= 0)
+        av_write_trailer(t.ofmt_ctx);
+    int64_t total_us = av_gettime_relative() - start_time;
+
+    // 吞吐和延迟统计
+    double seconds = total_us / 1000000.0;
+    double audio_seconds = t.dec_ctx->sample_rate > 0
+                               ? (double)t.nb_in_samples / t.dec_ctx->sample_rate : 0.0;
+    printf("[transcode] audio:%.2fs time:%.3fs speed:x%.1f decoded frames:%lld encoder frames:%lld"
+           " packets:%lld out:%.1fKB\n",
+           audio_seconds, seconds, seconds > 0 ? audio_seconds / seconds : 0.0,
+           (long long)t.nb_decoded, (long long)t.nb_resampled, (long long)t.nb_packets,
+           t.out_bytes / 1024.0);
+    printf("[transcode] busy decode:%.1fms resample:%.1fms encode:%.1fms"
+           " latency avg:%.3fms max:%.3fms\n",
+           t.decode_us / 1000.0, t.resample_us / 1000.0, t.encode_us / 1000.0,
+           t.latency.nb > 0 ? t.latency.sum_us / 1000.0 / t.latency.nb : 0.0,
+           t.latency.max_us / 1000.0);
+    dump_queue_stats(t.frame_queue, "frame queue");
+    dump_queue_stats(t.resampled_queue, "resampled queue");
+    printf("[transcode] resampler allocs:%lld\n",
+           (long long)audio_resampler_get_alloc_count(t.resampler));
+
+end:
+    if (threads_started) {
+        abort_all(&t);
+        pthread_join(decode_tid, NULL);
+        if (threads_started > 1)
+            pthread_join(resample_tid, NULL);
+    }
+    if (ret < 0 && ret != AVERROR_EOF)
+        printf("transcode failed:%s\n", av_err2str(ret));
+    free_queue(t.frame_queue);
+    free_queue(t.resampled_queue);
+    free_queue(t.recycled_queue);
+    av_packet_free(&pkt);
+    audio_resampler_free(t.resampler);
+    avcodec_free_context(&t.dec_ctx);
+    avcodec_free_context(&t.enc_ctx);
+    if (t.ofmt_ctx && !(t.ofmt_ctx->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&t.ofmt_ctx->pb);
+    avformat_free_context(t.ofmt_ctx);
+    avformat_close_input(&t.ifmt_ctx);
+    pthread_mutex_destroy(&t.latency.mutex);
+    return ret < 0 && ret != AVERROR_EOF ? -1 : 0;
+}
@@ -0,0 +1,155 @@
+/**
+ * @brief         采样率不变时 S16 交错 -> FLTP 的几种写法对比(13_mp4_muxer 的音频前端)
+ *                每帧 1024 个采样点(AAC 帧长)，同一段输入依次测量：
+ *                1. 原来的写法：每帧 av_frame_alloc + av_frame_get_buffer，swr_convert，编码后 av_frame_free;
+ *                2. swr_convert 写入复用的帧;
+ *                3. 标量 pcm_s16_to_fltp_c 写入复用的帧;
+ *                4. SIMD pcm_s16_to_fltp 写入复用的帧(13_mp4_muxer 现在的直接路径)。
+ *                校验 SIMD、标量的结果和 swr 逐位一致，不一致时输出 FAIL 并返回非0。
+ *
+ *                用法: 23_pcm_s16_fltp_bench [帧数]，默认 20000 帧
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/time.h"
+#include "libavutil/frame.h"
+#include "libavutil/opt.h"
+#include "libavutil/channel_layout.h"
+#include "libswresample/swresample.h"
+#include "pcmconv.h"
+
+#define SAMPLE_RATE 48000
+#define FRAME_SAMPLES 1024
+#define INPUT_FRAMES 16         // 输入缓存的帧数，测试时循环使用
+
+static AVFrame *alloc_fltp_frame(int channels)
+{
+    AVFrame *frame = av_frame_alloc();
+    if (!frame)
+        return NULL;
+    frame->format = AV_SAMPLE_FMT_FLTP;
+    frame->channels = channels;
+    frame->channel_layout = av_get_default_channel_layout(channels);
+    frame->sample_rate = SAMPLE_RATE;
+    frame->nb_samples = FRAME_SAMPLES;
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        av_frame_free(&frame);
+        return NULL;
+    }
+    return frame;
+}
+
+static int frame_equal(const AVFrame *a, const AVFrame *b, int channels)
+{
+    for (int ch = 0; ch < channels; ch++) {
+        if (memcmp(a->data[ch], b->data[ch], sizeof(float) * FRAME_SAMPLES) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+// 返回 0 成功，1 结果不一致，<0 失败
+static int bench_channels(int channels, int nb_frames)
+{
+    int64_t layout = av_get_default_channel_layout(channels);
+    SwrContext *swr = swr_alloc_set_opts(NULL, layout, AV_SAMPLE_FMT_FLTP, SAMPLE_RATE,
+                                         layout, AV_SAMPLE_FMT_S16, SAMPLE_RATE, 0, NULL);
+    int16_t *in = (int16_t *)av_malloc(sizeof(int16_t) * channels * FRAME_SAMPLES * INPUT_FRAMES);
+    AVFrame *ref = alloc_fltp_frame(channels);
+    AVFrame *frame = alloc_fltp_frame(channels);
+    int ret = -1;
+    if (!swr || swr_init(swr) < 0 || !in || !ref || !frame) {
+        printf("alloc failed\n");
+        goto end;
+    }
+    // 包含 -32768 和 32767 两个边界值
+    for (int i = 0; i < channels * FRAME_SAMPLES * INPUT_FRAMES; i++)
+        in[i] = (int16_t)rand();
+    in[0] = -32768;
+    in[1] = 32767;
+
+    // 校验：每一帧标量和 SIMD 的结果都和 swr 一致
+    int ok = 1;
+    for (int f = 0; f < INPUT_FRAMES && ok; f++) {
+        const uint8_t *src = (const uint8_t *)(in + (size_t)f * channels * FRAME_SAMPLES);
+        swr_convert(swr, ref->data, FRAME_SAMPLES, &src, FRAME_SAMPLES);
+        pcm_s16_to_fltp((float *const *)frame->data, (const int16_t *)src, channels, FRAME_SAMPLES);
+        ok = frame_equal(ref, frame, channels);
+        pcm_s16_to_fltp_c((float *const *)frame->data, (const int16_t *)src, channels, FRAME_SAMPLES);
+        ok = ok && frame_equal(ref, frame, channels);
+    }
+
+    // 1. 每帧分配新帧 + swr
+    int64_t start = av_gettime_relative();
+    for (int f = 0; f < nb_frames; f++) {
+        const uint8_t *src = (const uint8_t *)(in + (size_t)(f % INPUT_FRAMES) * channels * FRAME_SAMPLES);
+        AVFrame *tmp = alloc_fltp_frame(channels);
+        if (!tmp) {
+            printf("alloc_fltp_frame failed\n");
+            goto end;
+        }
+        swr_convert(swr, tmp->data, FRAME_SAMPLES, &src, FRAME_SAMPLES);
+        av_frame_free(&tmp);
+    }
+    int64_t t_alloc_swr = av_gettime_relative() - start;
+
+    // 2. 复用帧 + swr
+    start = av_gettime_relative();
+    for (int f = 0; f < nb_frames; f++) {
+        const uint8_t *src = (const uint8_t *)(in + (size_t)(f % INPUT_FRAMES) * channels * FRAME_SAMPLES);
+        swr_convert(swr, frame->data, FRAME_SAMPLES, &src, FRAME_SAMPLES);
+    }
+    int64_t t_swr = av_gettime_relative() - start;
+
+    // 3. 复用帧 + 标量转换
+    start = av_gettime_relative();
+    for (int f = 0; f < nb_frames; f++) {
+        const int16_t *src = in + (size_t)(f % INPUT_FRAMES) * channels * FRAME_SAMPLES;
+        pcm_s16_to_fltp_c((float *const *)frame->data, src, channels, FRAME_SAMPLES);
+    }
+    int64_t t_scalar = av_gettime_relative() - start;
+
+    // 4. 复用帧 + SIMD 转换
+    start = av_gettime_relative();
+    for (int f = 0; f < nb_frames; f++) {
+        const int16_t *src = in + (size_t)(f % INPUT_FRAMES) * channels * FRAME_SAMPLES;
+        pcm_s16_to_fltp((float *const *)frame->data, src, channels, FRAME_SAMPLES);
+    }
+    int64_t t_simd = av_gettime_relative() - start;
+
+    double frame_ns = 1000.0 / nb_frames;   // us 总耗时 -> ns/帧
+    printf("%dch | ns/frame alloc+swr:%7.0f swr:%7.0f c:%7.0f simd:%7.0f"
+           " | simd vs alloc+swr x%.1f, vs swr x%.1f | %s\n",
+           channels, t_alloc_swr * frame_ns, t_swr * frame_ns, t_scalar * frame_ns, t_simd * frame_ns,
+           t_simd > 0 ? (double)t_alloc_swr / t_simd : 0.0, t_simd > 0 ? (double)t_swr / t_simd : 0.0,
+           ok ? "PASS" : "FAIL");
+    ret = ok ? 0 : 1;
+
+end:
+    swr_free(&swr);
+    av_free(in);
+    av_frame_free(&ref);
+    av_frame_free(&frame);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int nb_frames = argc > 1 ? atoi(argv[1]) : 20000;
+    if (nb_frames <= 0) {
+        printf("invalid frames\n");
+        return -1;
+    }
+    const int channels[] = {1, 2, 6};
+    int failed = 0;
+
+    printf("simd:%s, %d frames of %d samples, s16 -> fltp, %dHz\n", pcm_conv_simd_name(), nb_frames,
+           FRAME_SAMPLES, SAMPLE_RATE);
+    for (size_t c = 0; c < sizeof(channels) / sizeof(channels[0]); c++) {
+        if (bench_channels(channels[c], nb_frames) != 0)
+            failed = 1;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,269 @@
+/**
+ * @brief         包回收池(common/packetpool)的分配次数检查
+ *                模拟 demux -> bsf -> mux 的包流转：
+ *                1. 从池中取包，packet_pool_new_data 分配不同大小的数据(覆盖多个分级)，
+ *                   或者用 packet_pool_ref 拷贝一个没有引用计数的包;
+ *                2. 一批包送入过滤器链(bsf_chain，中间包和输出包也从同一个池中取);
+ *                3. 取出过滤后的包校验数据，然后归还到池中。
+ *                预热之后统计：
+ *                1. 池真正调用 av_packet_alloc 的次数;
+ *                2. glibc 下替换 malloc 系列函数统计的整个进程的堆分配次数，
+ *                   其中不小于最小数据分级(PACKET_POOL_MIN_CLASS_SIZE)的算作包数据的分配。
+ *                av_packet_alloc 和包数据的分配都为 0、get/put 次数相等并且数据校验一致时输出 PASS，
+ *                否则输出 FAIL 并返回非0。
+ *                注意：av_buffer_pool_get、av_packet_ref 每次复用都会分配 AVBuffer/AVBufferRef 这样的小结构体，
+ *                这是 FFmpeg 的实现决定的，只输出每个包的次数，不作为失败条件。非 glibc 平台不统计进程的堆分配。
+ *
+ *                用法: 24_packet_pool_check [统计的批次数]，默认 2000 批
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "packetpool.h"
+#include "bsfchain.h"
+
+#define BATCH_SIZE 8            // 每批送入过滤器链的包数
+#define WARMUP_BATCHES 16       // 预热的批次数，池中缓存够一批在各阶段同时存在的包
+#define BSF_FILTERS "null,null" // 两级直通过滤器，经过中间包数组
+
+#if defined(__GLIBC__) && !defined(_WIN32)
+/**
+ * 替换 malloc 系列函数统计堆分配次数。可执行文件中定义的符号优先于 libc，
+ * FFmpeg 动态库里的 av_malloc(posix_memalign) 也会调用到这里
+ */
+#    define HAVE_MALLOC_COUNT 1
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+static volatile long long s_malloc_count = 0;
+static volatile long long s_large_count = 0;    // 包数据大小的分配
+
+static void count_alloc(size_t size)
+{
+    s_malloc_count++;
+    if (size >= PACKET_POOL_MIN_CLASS_SIZE)
+        s_large_count++;
+}
+
+void *malloc(size_t size)
+{
+    count_alloc(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    count_alloc(nmemb * size);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    count_alloc(size);
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    count_alloc(size);
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    count_alloc(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    count_alloc(size);
+    void *p = __libc_memalign(alignment, size);
+    if (!p)
+        return ENOMEM;
+    *ptr = p;
+    return 0;
+}
+
+static long long malloc_count(void)
+{
+    return s_malloc_count;
+}
+
+static long long large_alloc_count(void)
+{
+    return s_large_count;
+}
+#else
+#    define HAVE_MALLOC_COUNT 0
+static long long malloc_count(void)
+{
+    return 0;
+}
+
+static long long large_alloc_count(void)
+{
+    return 0;
+}
+#endif
+
+// 循环使用的包大小，覆盖 1KB ~ 512KB 的分级以及 0 字节以外的小包
+static const int g_sizes[] = {100, 1024, 1500, 4000, 20000, 65536, 200000, 524288};
+#define NB_SIZES (int)(sizeof(g_sizes) / sizeof(g_sizes[0]))
+
+// 包的数据由序号决定，取出后可以校验
+static uint8_t pattern_byte(int64_t seq, int i)
+{
+    return (uint8_t)(seq * 31 + i * 7);
+}
+
+static int check_packet(const AVPacket *pkt)
+{
+    int64_t seq = pkt->pts;
+    if (pkt->size != g_sizes[seq % NB_SIZES])
+        return 0;
+    for (int i = 0; i < pkt->size; i += 97) {
+        if (pkt->data[i] != pattern_byte(seq, i))
+            return 0;
+    }
+    return 1;
+}
+
+// 按序号生成一个包：偶数用池内数据，奇数从没有引用计数的栈上包拷贝
+static AVPacket *make_packet(packet_pool_t *pool, int64_t seq, uint8_t *scratch)
+{
+    AVPacket *pkt = packet_pool_get(pool);
+    if (!pkt)
+        return NULL;
+    int size = g_sizes[seq % NB_SIZES];
+    int ret = 0;
+    if (seq % 2 == 0) {
+        ret = packet_pool_new_data(pool, pkt, size);
+        if (ret == 0) {
+            for (int i = 0; i < size; i++)
+                pkt->data[i] = pattern_byte(seq, i);
+        }
+    } else {
+        AVPacket src;
+        av_init_packet(&src);
+        src.data = scratch;
+        src.size = size;
+        for (int i = 0; i < size; i++)
+            scratch[i] = pattern_byte(seq, i);
+        ret = packet_pool_ref(pool, pkt, &src);
+    }
+    if (ret < 0) {
+        packet_pool_put(pool, pkt);
+        return NULL;
+    }
+    pkt->pts = pkt->dts = seq;
+    return pkt;
+}
+
+// 一批包穿过过滤器链，返回校验失败的包数，<0 失败
+static int run_batch(packet_pool_t *pool, bsf_chain_t *chain, int64_t *seq, uint8_t *scratch)
+{
+    AVPacket *pkts[BATCH_SIZE];
+    int nb = 0;
+    for (; nb < BATCH_SIZE; nb++) {
+        pkts[nb] = make_packet(pool, (*seq)++, scratch);
+        if (!pkts[nb])
+            break;
+    }
+    int ret = nb == BATCH_SIZE ? bsf_chain_send_packets(chain, pkts, nb) : -1;
+    for (int i = 0; i < nb; i++)
+        packet_pool_put(pool, pkts[i]); // 数据引用已经被过滤器链取走
+    if (ret < 0) {
+        printf("make packet or bsf_chain_send_packets failed\n");
+        return -1;
+    }
+
+    int bad = 0;
+    while (1) {
+        AVPacket *out = packet_pool_get(pool);
+        if (!out)
+            return -1;
+        if (bsf_chain_receive_packet(chain, out) < 0) {
+            packet_pool_put(pool, out);
+            break;
+        }
+        if (!check_packet(out))
+            bad++;
+        packet_pool_put(pool, out);
+    }
+    return bad;
+}
+
+int main(int argc, char **argv)
+{
+    int nb_batches = argc > 1 ? atoi(argv[1]) : 2000;
+    if (nb_batches <= 0) {
+        printf("invalid batches\n");
+        return -1;
+    }
+    int ret = -1;
+    int64_t seq = 0;
+    bsf_chain_t *chain = NULL;
+    AVCodecParameters *par = avcodec_parameters_alloc();
+    uint8_t *scratch = (uint8_t *)malloc(g_sizes[NB_SIZES - 1]);
+    packet_pool_t *pool = packet_pool_alloc(0);
+    if (!par || !scratch || !pool) {
+        printf("alloc failed\n");
+        goto end;
+    }
+    par->codec_type = AVMEDIA_TYPE_VIDEO;
+    par->codec_id = AV_CODEC_ID_H264;
+    chain = bsf_chain_alloc(BSF_FILTERS, par, (AVRational){1, 90000}, 0, pool);
+    if (!chain) {
+        printf("bsf_chain_alloc failed\n");
+        goto end;
+    }
+
+    int bad = 0;
+    for (int i = 0; i < WARMUP_BATCHES; i++) {
+        int n = run_batch(pool, chain, &seq, scratch);
+        if (n < 0)
+            goto end;
+        bad += n;
+    }
+    packet_pool_stats_t before, after;
+    packet_pool_get_stats(pool, &before);
+    long long mallocs = malloc_count();
+    long long large_allocs = large_alloc_count();
+    for (int i = 0; i < nb_batches; i++) {
+        int n = run_batch(pool, chain, &seq, scratch);
+        if (n < 0)
+            goto end;
+        bad += n;
+    }
+    large_allocs = large_alloc_count() - large_allocs;
+    mallocs = malloc_count() - mallocs;
+    packet_pool_get_stats(pool, &after);
+
+    int64_t packet_allocs = after.packet_alloc_count - before.packet_alloc_count;
+    int64_t gets = after.get_count - before.get_count;
+    int64_t puts = after.put_count - before.put_count;
+    int ok = packet_allocs == 0 && large_allocs == 0 && gets == puts && bad == 0;
+    printf("%d batches x %d packets | get:%lld put:%lld | av_packet_alloc:%lld",
+           nb_batches, BATCH_SIZE, (long long)gets, (long long)puts, (long long)packet_allocs);
+    if (HAVE_MALLOC_COUNT)
+        printf(" data malloc:%lld malloc/packet:%.2f", large_allocs,
+               (double)mallocs / ((double)nb_batches * BATCH_SIZE));
+    else
+        printf(" (process heap not counted)");
+    printf(" | bad packets:%d | %s\n", bad, ok ? "PASS" : "FAIL");
+    packet_pool_dump_stats(pool, "24_packet_pool_check");
+    bsf_chain_dump_stats(chain, "24_packet_pool_check");
+    ret = ok ? 0 : 1;
+
+end:
+    bsf_chain_free(chain);
+    packet_pool_free(pool);
+    avcodec_parameters_free(&par);
+    free(scratch);
+    return ret;
+}
@@ -0,0 +1,380 @@
+/**
+ * @brief         GOP 指纹(common/fingerprint)的跨封装检查
+ *                同一份 H.264 + AAC 码流分别封装成 mp4、ts、flv：
+ *                mp4/flv 中 H.264 带长度前缀、SPS/PPS 在 extradata，AAC 是裸数据；
+ *                ts 中 H.264 是起始码格式、关键帧前带 SPS/PPS、每帧前有 AUD，AAC 每帧带 ADTS 头。
+ *                分别计算三个文件视频、音频流的 GOP 哈希，和 mp4 的完全一致时输出 PASS，
+ *                否则输出 FAIL 并返回非0。
+ *
+ *                用法: 25_fingerprint_check [输入mp4] [临时文件前缀]
+ *                      不指定输入时先用 libx264 + aac 编码生成 <前缀>.mp4(默认前缀 fingerprint_check)，
+ *                      libx264 不存在时跳过
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "libavformat/avformat.h"
+#include "libavutil/opt.h"
+#include "libavutil/channel_layout.h"
+#include "fingerprint.h"
+
+#define VIDEO_WIDTH 320
+#define VIDEO_HEIGHT 240
+#define VIDEO_FPS 25
+#define VIDEO_FRAMES 250            // 10 秒，每秒一个 GOP
+#define AUDIO_SAMPLE_RATE 48000
+#define AUDIO_CHANNELS 2
+
+static char err_buf[128] = {0};
+
+static char *av_get_err(int errnum)
+{
+    av_strerror(errnum, err_buf, 128);
+    return err_buf;
+}
+
+// 一个文件中一路流的 GOP 哈希
+typedef struct stream_hashes {
+    uint64_t *hashes;
+    int nb_gops;
+} stream_hashes_t;
+
+// ===== 生成测试文件 =====
+
+// 运动的渐变图案，同 FFmpeg encode_video 示例
+static void fill_video_frame(AVFrame *frame, int i)
+{
+    for (int y = 0; y < frame->height; y++)
+        for (int x = 0; x < frame->width; x++)
+            frame->data[0][y * frame->linesize[0] + x] = x + y + i * 3;
+    for (int y = 0; y < frame->height / 2; y++) {
+        for (int x = 0; x < frame->width / 2; x++) {
+            frame->data[1][y * frame->linesize[1] + x] = 128 + y + i * 2;
+            frame->data[2][y * frame->linesize[2] + x] = 64 + x + i * 5;
+        }
+    }
+}
+
+static void fill_audio_frame(AVFrame *frame, int64_t first_sample)
+{
+    for (int ch = 0; ch < frame->channels; ch++) {
+        double freq = 220.0 * (ch + 1);
+        for (int i = 0; i < frame->nb_samples; i++)
+            ((float *)frame->data[ch])[i] =
+                (float)(0.5 * sin(2 * M_PI * freq * (first_sample + i) / frame->sample_rate));
+    }
+}
+
+// 送入一帧(NULL 为 flush)，输出的包写入文件
+static int encode_write(AVFormatContext *oc, AVCodecContext *enc_ctx, AVStream *st, AVFrame *frame,
+                        AVPacket *pkt)
+{
+    int ret = avcodec_send_frame(enc_ctx, frame);
+    if (ret < 0) {
+        return ret;
+    }
+    while ((ret = avcodec_receive_packet(enc_ctx, pkt)) >= 0) {
+        av_packet_rescale_ts(pkt, enc_ctx->time_base, st->time_base);
+        pkt->stream_index = st->index;
+        if ((ret = av_interleaved_write_frame(oc, pkt)) < 0)
+            return ret;
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+static AVCodecContext *open_encoder(const AVCodec *codec, AVFormatContext *oc)
+{
+    AVCodecContext *enc_ctx = avcodec_alloc_context3(codec);
+    if (!enc_ctx) {
+        return NULL;
+    }
+    if (codec->type == AVMEDIA_TYPE_VIDEO) {
+        enc_ctx->width = VIDEO_WIDTH;
+        enc_ctx->height = VIDEO_HEIGHT;
+        enc_ctx->time_base = (AVRational){1, VIDEO_FPS};
+        enc_ctx->framerate = (AVRational){VIDEO_FPS, 1};
+        enc_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+        enc_ctx->gop_size = VIDEO_FPS;
+        enc_ctx->max_b_frames = 2;
+        enc_ctx->bit_rate = 400000;
+        av_opt_set(enc_ctx->priv_data, "preset", "veryfast", 0);
+    } else {
+        enc_ctx->sample_rate = AUDIO_SAMPLE_RATE;
+        enc_ctx->channels = AUDIO_CHANNELS;
+        enc_ctx->channel_layout = av_get_default_channel_layout(AUDIO_CHANNELS);
+        enc_ctx->sample_fmt = AV_SAMPLE_FMT_FLTP;
+        enc_ctx->bit_rate = 128000;
+        enc_ctx->time_base = (AVRational){1, AUDIO_SAMPLE_RATE};
+    }
+    if (oc->oformat->flags & AVFMT_GLOBALHEADER)
+        enc_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    int ret = avcodec_open2(enc_ctx, codec, NULL);
+    if (ret < 0) {
+        printf("open encoder %s failed:%s\n", codec->name, av_get_err(ret));
+        avcodec_free_context(&enc_ctx);
+    }
+    return enc_ctx;
+}
+
+static AVFrame *alloc_frame(AVCodecContext *enc_ctx)
+{
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
+        return NULL;
+    }
+    if (enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+        frame->format = enc_ctx->pix_fmt;
+        frame->width = enc_ctx->width;
+        frame->height = enc_ctx->height;
+    } else {
+        frame->format = enc_ctx->sample_fmt;
+        frame->channels = enc_ctx->channels;
+        frame->channel_layout = enc_ctx->channel_layout;
+        frame->sample_rate = enc_ctx->sample_rate;
+        frame->nb_samples = enc_ctx->frame_size;
+    }
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        av_frame_free(&frame);
+    }
+    return frame;
+}
+
+/**
+ * 编码生成 H.264 + AAC 的 mp4
+ * @return libx264 不存在返回 AVERROR_ENCODER_NOT_FOUND
+ */
+static int generate_mp4(const char *path)
+{
+    const AVCodec *vcodec = avcodec_find_encoder_by_name("libx264");
+    const AVCodec *acodec = avcodec_find_encoder(AV_CODEC_ID_AAC);
+    if (!vcodec || !acodec) {
+        return AVERROR_ENCODER_NOT_FOUND;
+    }
+    AVFormatContext *oc = NULL;
+    AVCodecContext *venc = NULL, *aenc = NULL;
+    AVFrame *vframe = NULL, *aframe = NULL;
+    AVPacket *pkt = av_packet_alloc();
+    int ret = avformat_alloc_output_context2(&oc, NULL, NULL, path);
+    if (ret < 0 || !pkt) {
+        printf("alloc output %s failed\n", path);
+        goto end;
+    }
+    ret = AVERROR(ENOMEM);
+    venc = open_encoder(vcodec, oc);
+    aenc = open_encoder(acodec, oc);
+    if (!venc || !aenc || !(vframe = alloc_frame(venc)) || !(aframe = alloc_frame(aenc))) {
+        goto end;
+    }
+    AVStream *vst = avformat_new_stream(oc, NULL);
+    AVStream *ast = avformat_new_stream(oc, NULL);
+    if (!vst || !ast) {
+        goto end;
+    }
+    avcodec_parameters_from_context(vst->codecpar, venc);
+    avcodec_parameters_from_context(ast->codecpar, aenc);
+    vst->time_base = venc->time_base;
+    ast->time_base = aenc->time_base;
+    if ((ret = avio_open(&oc->pb, path, AVIO_FLAG_WRITE)) < 0 ||
+        (ret = avformat_write_header(oc, NULL)) < 0) {
+        printf("open %s failed:%s\n", path, av_get_err(ret));
+        goto end;
+    }
+
+    // pts 小的先编码，音视频交错写入
+    int64_t nb_samples = 0;
+    for (int i = 0; i < VIDEO_FRAMES; i++) {
+        while (av_compare_ts(nb_samples, aenc->time_base, i, venc->time_base) <= 0) {
+            if ((ret = av_frame_make_writable(aframe)) < 0)
+                goto end;
+            fill_audio_frame(aframe, nb_samples);
+            aframe->pts = nb_samples;
+            nb_samples += aframe->nb_samples;
+            if ((ret = encode_write(oc, aenc, ast, aframe, pkt)) < 0)
+                goto end;
+        }
+        if ((ret = av_frame_make_writable(vframe)) < 0)
+            goto end;
+        fill_video_frame(vframe, i);
+        vframe->pts = i;
+        if ((ret = encode_write(oc, venc, vst, vframe, pkt)) < 0)
+            goto end;
+    }
+    if ((ret = encode_write(oc, venc, vst, NULL, pkt)) < 0 ||
+        (ret = encode_write(oc, aenc, ast, NULL, pkt)) < 0)
+        goto end;
+    ret = av_write_trailer(oc);
+
+end:
+    if (ret < 0)
+        printf("generate %s failed:%s\n", path, av_get_err(ret));
+    if (oc && !(oc->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&oc->pb);
+    avformat_free_context(oc);
+    avcodec_free_context(&venc);
+    avcodec_free_context(&aenc);
+    av_frame_free(&vframe);
+    av_frame_free(&aframe);
+    av_packet_free(&pkt);
+    return ret;
+}
+
+// ===== 转封装 =====
+
+// 只改封装不改码流，ts 封装时 muxer 自动转成起始码格式并加 ADTS 头
+static int remux(const char *in_path, const char *out_path)
+{
+    AVFormatContext *ic = NULL, *oc = NULL;
+    AVPacket *pkt = av_packet_alloc();
+    int ret = avformat_open_input(&ic, in_path, NULL, NULL);
+    if (ret < 0 || !pkt || (ret = avformat_find_stream_info(ic, NULL)) < 0 ||
+        (ret = avformat_alloc_output_context2(&oc, NULL, NULL, out_path)) < 0) {
+        printf("remux %s -> %s init failed\n", in_path, out_path);
+        goto end;
+    }
+    for (unsigned int i = 0; i < ic->nb_streams; i++) {
+        AVStream *st = avformat_new_stream(oc, NULL);
+        if (!st || (ret = avcodec_parameters_copy(st->codecpar, ic->streams[i]->codecpar)) < 0) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        st->codecpar->codec_tag = 0;
+    }
+    if ((ret = avio_open(&oc->pb, out_path, AVIO_FLAG_WRITE)) < 0 ||
+        (ret = avformat_write_header(oc, NULL)) < 0) {
+        printf("open %s failed:%s\n", out_path, av_get_err(ret));
+        goto end;
+    }
+    while (av_read_frame(ic, pkt) >= 0) {
+        av_packet_rescale_ts(pkt, ic->streams[pkt->stream_index]->time_base,
+                             oc->streams[pkt->stream_index]->time_base);
+        pkt->pos = -1;
+        if ((ret = av_interleaved_write_frame(oc, pkt)) < 0) {
+            printf("write %s failed:%s\n", out_path, av_get_err(ret));
+            goto end;
+        }
+    }
+    ret = av_write_trailer(oc);
+
+end:
+    if (oc && !(oc->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&oc->pb);
+    avformat_free_context(oc);
+    avformat_close_input(&ic);
+    av_packet_free(&pkt);
+    return ret;
+}
+
+// ===== 指纹 =====
+
+// 计算文件中视频、音频流的 GOP 哈希，hashes[0] 视频，hashes[1] 音频
+static int fingerprint_file(const char *path, stream_hashes_t hashes[2])
+{
+    AVFormatContext *ic = NULL;
+    AVPacket *pkt = av_packet_alloc();
+    gop_fp_t *fps[2] = {NULL, NULL};
+    int ret = avformat_open_input(&ic, path, NULL, NULL);
+    if (ret < 0 || !pkt || (ret = avformat_find_stream_info(ic, NULL)) < 0) {
+        printf("open %s failed\n", path);
+        goto end;
+    }
+    const enum AVMediaType types[2] = {AVMEDIA_TYPE_VIDEO, AVMEDIA_TYPE_AUDIO};
+    for (int t = 0; t < 2; t++) {
+        int index = av_find_best_stream(ic, types[t], -1, -1, NULL, 0);
+        if (index < 0) {
+            printf("%s: %s stream not found\n", path, av_get_media_type_string(types[t]));
+            ret = index;
+            goto end;
+        }
+        fps[t] = gop_fp_alloc(NULL, ic->streams[index]->codecpar, index, 0, 0);
+        if (!fps[t]) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+    }
+    while (av_read_frame(ic, pkt) >= 0) {
+        for (int t = 0; t < 2; t++)
+            gop_fp_feed(fps[t], pkt);
+        av_packet_unref(pkt);
+    }
+    for (int t = 0; t < 2; t++) {
+        gop_fp_finish(fps[t]);
+        hashes[t].nb_gops = fps[t]->nb_gops;
+        hashes[t].hashes = (uint64_t *)av_malloc_array(fps[t]->nb_gops + 1, sizeof(uint64_t));
+        if (!hashes[t].hashes) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        memcpy(hashes[t].hashes, fps[t]->hashes, fps[t]->nb_gops * sizeof(uint64_t));
+    }
+    ret = 0;
+
+end:
+    gop_fp_free(fps[0]);
+    gop_fp_free(fps[1]);
+    avformat_close_input(&ic);
+    av_packet_free(&pkt);
+    return ret;
+}
+
+// 返回相同的 GOP 数，全部相同时等于 a->nb_gops
+static int count_same(const stream_hashes_t *a, const stream_hashes_t *b)
+{
+    int same = 0;
+    for (int i = 0; i < a->nb_gops && i < b->nb_gops; i++) {
+        if (a->hashes[i] == b->hashes[i])
+            same++;
+    }
+    return same;
+}
+
+int main(int argc, char **argv)
+{
+    const char *prefix = argc > 2 ? argv[2] : "fingerprint_check";
+    char mp4_path[1024], remux_path[1024];
+    const char *in_path = argc > 1 ? argv[1] : NULL;
+    if (!in_path) {
+        snprintf(mp4_path, sizeof(mp4_path), "%s.mp4", prefix);
+        int ret = generate_mp4(mp4_path);
+        if (ret == AVERROR_ENCODER_NOT_FOUND) {
+            printf("libx264 not found, skipped (pass an H.264 + AAC mp4 to check it)\n");
+            return 0;
+        } else if (ret < 0) {
+            return -1;
+        }
+        in_path = mp4_path;
+    }
+
+    stream_hashes_t ref[2] = {{NULL, 0}, {NULL, 0}};
+    if (fingerprint_file(in_path, ref) < 0) {
+        return -1;
+    }
+    printf("%s: video gops:%d audio gops:%d\n", in_path, ref[0].nb_gops, ref[1].nb_gops);
+    int failed = ref[0].nb_gops < 2;    // 至少两个 GOP，否则检查没有意义
+    const char *formats[] = {"ts", "flv"};
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        snprintf(remux_path, sizeof(remux_path), "%s.%s", prefix, formats[f]);
+        stream_hashes_t cur[2] = {{NULL, 0}, {NULL, 0}};
+        if (remux(in_path, remux_path) < 0 || fingerprint_file(remux_path, cur) < 0) {
+            failed = 1;
+            continue;
+        }
+        int ok = 1;
+        printf("%-28s", remux_path);
+        for (int t = 0; t < 2; t++) {
+            int same = count_same(&ref[t], &cur[t]);
+            int match = cur[t].nb_gops == ref[t].nb_gops && same == ref[t].nb_gops;
+            printf(" | %s gops:%d same:%d", t == 0 ? "video" : "audio", cur[t].nb_gops, same);
+            ok = ok && match;
+        }
+        printf(" | %s\n", ok ? "PASS" : "FAIL");
+        failed = failed || !ok;
+        av_free(cur[0].hashes);
+        av_free(cur[1].hashes);
+    }
+    av_free(ref[0].hashes);
+    av_free(ref[1].hashes);
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,154 @@
+#include "boundedqueue.h"
+#include <stdio.h>
+#include <string.h>
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+
+bounded_queue_t *bounded_queue_alloc(int capacity)
+{
+    if (capacity <= 0) {
+        return NULL;
+    }
+    bounded_queue_t *q = (bounded_queue_t *)av_mallocz(sizeof(bounded_queue_t));
+    if (!q) {
+        return NULL;
+    }
+    q->items = (void **)av_mallocz_array(capacity, sizeof(void *));
+    if (!q->items) {
+        av_freep(&q);
+        return NULL;
+    }
+    q->capacity = capacity;
+    pthread_mutex_init(&q->mutex, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    return q;
+}
+
+void bounded_queue_free(bounded_queue_t *q)
+{
+    if (!q) {
+        return;
+    }
+    if (q->count > 0) {
+        printf("bounded queue freed with %d items left\n", q->count);
+    }
+    pthread_cond_destroy(&q->not_full);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_mutex_destroy(&q->mutex);
+    av_freep(&q->items);
+    av_freep(&q);
+}
+
+int bounded_queue_push(bounded_queue_t *q, void *item)
+{
+    pthread_mutex_lock(&q->mutex);
+    if (q->count == q->capacity && !q->aborted && !q->finished) {
+        q->stats.push_waits++;
+        while (q->count == q->capacity && !q->aborted && !q->finished)
+            pthread_cond_wait(&q->not_full, &q->mutex);
+    }
+    if (q->aborted || q->finished) {
+        pthread_mutex_unlock(&q->mutex);
+        return AVERROR_EXIT;
+    }
+    q->items[(q->head + q->count) % q->capacity] = item;
+    q->count++;
+    q->stats.nb_push++;
+    if (q->count > q->stats.max_depth)
+        q->stats.max_depth = q->count;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->mutex);
+    return 0;
+}
+
+// 调用者已经加锁且队列不为空
+static void *take_item(bounded_queue_t *q)
+{
+    void *item = q->items[q->head];
+    q->items[q->head] = NULL;
+    q->head = (q->head + 1) % q->capacity;
+    q->count--;
+    q->stats.nb_pop++;
+    pthread_cond_signal(&q->not_full);
+    return item;
+}
+
+int bounded_queue_pop(bounded_queue_t *q, void **item)
+{
+    pthread_mutex_lock(&q->mutex);
+    if (q->count == 0 && !q->aborted && !q->finished) {
+        q->stats.pop_waits++;
+        while (q->count == 0 && !q->aborted && !q->finished)
+            pthread_cond_wait(&q->not_empty, &q->mutex);
+    }
+    int ret = 0;
+    if (q->aborted) {
+        ret = AVERROR_EXIT;
+    } else if (q->count == 0) {
+        ret = AVERROR_EOF;      // 生产者已经结束并且数据已经取完
+    } else {
+        *item = take_item(q);
+    }
+    pthread_mutex_unlock(&q->mutex);
+    return ret;
+}
+
+int bounded_queue_try_pop(bounded_queue_t *q, void **item)
+{
+    pthread_mutex_lock(&q->mutex);
+    int ret = 0;
+    if (q->aborted) {
+        ret = AVERROR_EXIT;
+    } else if (q->count == 0) {
+        ret = q->finished ? AVERROR_EOF : AVERROR(EAGAIN);
+    } else {
+        *item = take_item(q);
+    }
+    pthread_mutex_unlock(&q->mutex);
+    return ret;
+}
+
+void bounded_queue_drain(bounded_queue_t *q, void (*free_item)(void *opaque, void *item), void *opaque)
+{
+    pthread_mutex_lock(&q->mutex);
+    while (q->count > 0) {
+        void *item = take_item(q);
+        if (free_item)
+            free_item(opaque, item);
+    }
+    pthread_mutex_unlock(&q->mutex);
+}
+
+void bounded_queue_finish(bounded_queue_t *q)
+{
+    pthread_mutex_lock(&q->mutex);
+    q->finished = 1;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_cond_broadcast(&q->not_full);
+    pthread_mutex_unlock(&q->mutex);
+}
+
+void bounded_queue_abort(bounded_queue_t *q)
+{
+    pthread_mutex_lock(&q->mutex);
+    q->aborted = 1;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_cond_broadcast(&q->not_full);
+    pthread_mutex_unlock(&q->mutex);
+}
+
+int bounded_queue_size(bounded_queue_t *q)
+{
+    pthread_mutex_lock(&q->mutex);
+    int count = q->count;
+    pthread_mutex_unlock(&q->mutex);
+    return count;
+}
+
+void bounded_queue_get_stats(bounded_queue_t *q, bounded_queue_stats_t *stats)
+{
+    pthread_mutex_lock(&q->mutex);
+    *stats = q->stats;
+    pthread_mutex_unlock(&q->mutex);
+}
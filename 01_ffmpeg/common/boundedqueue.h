@@ -0,0 +1,100 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+* 有界阻塞队列，用于在线程之间传递 AVPacket/AVFrame 等指针：
+* (1) 队列满时生产者阻塞，队列空时消费者阻塞，控制各阶段之间缓存的数据量;
+* (2) 生产者调用 bounded_queue_finish 表示不会再有数据，消费者取完剩余数据后得到 AVERROR_EOF;
+* (3) bounded_queue_abort 让所有阻塞的线程立即返回，用于出错退出。
+*/
+
+typedef struct bounded_queue_stats {
+    int64_t nb_push;        // 入队次数
+    int64_t nb_pop;         // 出队次数
+    int64_t push_waits;     // 队列满导致生产者等待的次数
+    int64_t pop_waits;      // 队列空导致消费者等待的次数
+    int max_depth;          // 队列中数据最多时的数量
+} bounded_queue_stats_t;
+
+typedef struct bounded_queue {
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    void **items;           // 环形数组
+    int capacity;
+    int head;
+    int count;
+    int finished;           // 生产者已经结束
+    int aborted;
+    bounded_queue_stats_t stats;
+} bounded_queue_t;
+
+/**
+ * @brief 分配队列
+ * @param capacity 最多缓存多少项
+ * @return 失败返回NULL
+ */
+bounded_queue_t *bounded_queue_alloc(int capacity);
+
+/**
+ * @brief 释放队列，队列里剩余的数据由调用者先取出释放
+ */
+void bounded_queue_free(bounded_queue_t *q);
+
+/**
+ * @brief 入队，队列满时阻塞
+ * @return 成功返回0；队列已经 abort/finish 返回 AVERROR_EXIT
+ */
+int bounded_queue_push(bounded_queue_t *q, void *item);
+
+/**
+ * @brief 出队，队列空时阻塞
+ * @return 成功返回0；生产者已结束且队列为空返回 AVERROR_EOF；abort 返回 AVERROR_EXIT
+ */
+int bounded_queue_pop(bounded_queue_t *q, void **item);
+
+/**
+ * @brief 非阻塞出队
+ * @return 成功返回0；队列为空返回 AVERROR(EAGAIN)；生产者已结束且队列为空返回 AVERROR_EOF
+ */
+int bounded_queue_try_pop(bounded_queue_t *q, void **item);
+
+/**
+ * @brief 取出并释放队列中剩余的数据，abort 之后也可以调用，用于出错退出时清理
+ * @param free_item 每一项调用一次，在持有队列锁时调用，不能再操作这个队列
+ */
+void bounded_queue_drain(bounded_queue_t *q, void (*free_item)(void *opaque, void *item), void *opaque);
+
+/**
+ * @brief 生产者结束，不会再入队
+ */
+void bounded_queue_finish(bounded_queue_t *q);
+
+/**
+ * @brief 中止，唤醒所有阻塞的线程
+ */
+void bounded_queue_abort(bounded_queue_t *q);
+
+/**
+ * @brief 当前队列中的数据量
+ */
+int bounded_queue_size(bounded_queue_t *q);
+
+/**
+ * @brief 获取统计信息
+ */
+void bounded_queue_get_stats(bounded_queue_t *q, bounded_queue_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOUNDEDQUEUE_H
@@ -0,0 +1,333 @@
+#include "bsfchain.h"
+#include <stdio.h>
+#include <string.h>
+#include "libavutil/avstring.h"
+#include "libavutil/dict.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/time.h"
+
+// 解析单个过滤器 "name=key1=val1:key2=val2" 并创建上下文
+static int create_filter(bsf_chain_t *chain, const char *desc)
+{
+    char name[64] = {0};
+    const char *opts = strchr(desc, '=');
+    size_t name_len = opts ? (size_t)(opts - desc) : strlen(desc);
+    if (name_len == 0 || name_len >= sizeof(name)) {
+        printf("invalid bsf: %s\n", desc);
+        return AVERROR(EINVAL);
+    }
+    memcpy(name, desc, name_len);
+
+    const AVBitStreamFilter *filter = av_bsf_get_by_name(name);
+    if (!filter) {
+        printf("bsf %s not found\n", name);
+        return AVERROR_BSF_NOT_FOUND;
+    }
+    AVBSFContext *ctx = NULL;
+    int ret = av_bsf_alloc(filter, &ctx);
+    if (ret < 0) {
+        return ret;
+    }
+    if (opts && opts[1]) {
+        AVDictionary *dict = NULL;
+        ret = av_dict_parse_string(&dict, opts + 1, "=", ":", 0);
+        if (ret >= 0)
+            ret = av_opt_set_dict2(ctx, &dict, AV_OPT_SEARCH_CHILDREN);
+        if (ret >= 0 && av_dict_count(dict) > 0) {
+            AVDictionaryEntry *e = av_dict_get(dict, "", NULL, AV_DICT_IGNORE_SUFFIX);
+            printf("bsf %s unknown option: %s\n", name, e->key);
+            ret = AVERROR(EINVAL);
+        }
+        av_dict_free(&dict);
+        if (ret < 0) {
+            av_bsf_free(&ctx);
+            return ret;
+        }
+    }
+    chain->filters[chain->nb_filters] = ctx;
+    chain->stats[chain->nb_filters].name = filter->name;
+    chain->nb_filters++;
+    return 0;
+}
+
+static int parse_filters(bsf_chain_t *chain, const char *filters)
+{
+    if (!filters || !filters[0]) {
+        return create_filter(chain, "null");
+    }
+    char *str = av_strdup(filters);
+    if (!str) {
+        return AVERROR(ENOMEM);
+    }
+    int ret = 0;
+    char *saveptr = NULL;
+    for (char *desc = av_strtok(str, ",", &saveptr); desc; desc = av_strtok(NULL, ",", &saveptr)) {
+        if (chain->nb_filters >= BSF_CHAIN_MAX_FILTERS) {
+            printf("too many bsf, max:%d\n", BSF_CHAIN_MAX_FILTERS);
+            ret = AVERROR(EINVAL);
+            break;
+        }
+        if ((ret = create_filter(chain, desc)) < 0)
+            break;
+    }
+    av_free(str);
+    return ret;
+}
+
+// 数组容量不足时扩容，稳定运行后不会再分配
+static int ensure_capacity(AVPacket ***array, int *capacity, int need)
+{
+    if (need <= *capacity) {
+        return 0;
+    }
+    int new_capacity = FFMAX(need, *capacity * 2);
+    new_capacity = FFMAX(new_capacity, 16);
+    AVPacket **p = (AVPacket **)av_realloc_array(*array, new_capacity, sizeof(AVPacket *));
+    if (!p) {
+        return AVERROR(ENOMEM);
+    }
+    *array = p;
+    *capacity = new_capacity;
+    return 0;
+}
+
+bsf_chain_t *bsf_chain_alloc(const char *filters, const AVCodecParameters *par,
+                             AVRational time_base, int stream_index, packet_pool_t *pkt_pool)
+{
+    bsf_chain_t *chain = (bsf_chain_t *)av_mallocz(sizeof(bsf_chain_t));
+    if (!chain) {
+        return NULL;
+    }
+    chain->stream_index = stream_index;
+    chain->pkt_pool = pkt_pool;
+
+    int ret = parse_filters(chain, filters);
+    if (ret < 0) {
+        bsf_chain_free(chain);
+        return NULL;
+    }
+    // 前一个过滤器的输出参数作为后一个过滤器的输入参数
+    for (int i = 0; i < chain->nb_filters; i++) {
+        AVBSFContext *ctx = chain->filters[i];
+        if (i == 0) {
+            ret = avcodec_parameters_copy(ctx->par_in, par);
+            ctx->time_base_in = time_base;
+        } else {
+            ret = avcodec_parameters_copy(ctx->par_in, chain->filters[i - 1]->par_out);
+            ctx->time_base_in = chain->filters[i - 1]->time_base_out;
+        }
+        if (ret >= 0)
+            ret = av_bsf_init(ctx);
+        if (ret < 0) {
+            char errbuf[128] = {0};
+            av_strerror(ret, errbuf, sizeof(errbuf) - 1);
+            printf("init bsf %s failed:%s\n", chain->stats[i].name, errbuf);
+            bsf_chain_free(chain);
+            return NULL;
+        }
+    }
+    return chain;
+}
+
+void bsf_chain_free(bsf_chain_t *chain)
+{
+    if (!chain) {
+        return;
+    }
+    for (int i = 0; i < chain->nb_filters; i++) {
+        av_bsf_free(&chain->filters[i]);
+    }
+    for (int i = 0; i < chain->nb_out; i++) {
+        packet_pool_put(chain->pkt_pool, chain->out_pkts[chain->out_head + i]);
+    }
+    av_freep(&chain->batch[0]);
+    av_freep(&chain->batch[1]);
+    av_freep(&chain->out_pkts);
+    av_freep(&chain);
+}
+
+/**
+ * 让一批包穿过第 index 个过滤器
+ * @param in 输入包，NULL表示冲刷
+ * @param out_array 输出包数组
+ * @return 输出包数量，失败返回负数
+ */
+static int filter_batch(bsf_chain_t *chain, int index, AVPacket **in, int nb_in,
+                        AVPacket ***out_array, int *out_capacity, int flush)
+{
+    AVBSFContext *ctx = chain->filters[index];
+    bsf_filter_stats_t *stats = &chain->stats[index];
+    int nb_out = 0;
+    int ret = 0;
+    int i = 0;
+    int64_t start = av_gettime_relative();
+
+    for (i = 0; i <= nb_in; i++) {
+        if (i < nb_in) {
+            ret = av_bsf_send_packet(ctx, in[i]);   // 数据引用被过滤器取走
+            packet_pool_put(chain->pkt_pool, in[i]);
+            in[i] = NULL;
+            stats->nb_in++;
+        } else if (flush) {
+            ret = av_bsf_send_packet(ctx, NULL);
+        } else {
+            break;
+        }
+        if (ret < 0) {
+            char errbuf[128] = {0};
+            av_strerror(ret, errbuf, sizeof(errbuf) - 1);
+            printf("bsf %s send packet failed:%s\n", stats->name, errbuf);
+            continue;   // 丢弃出错的包，继续处理后面的
+        }
+        while (1) {
+            if ((ret = ensure_capacity(out_array, out_capacity, nb_out + 1)) < 0)
+                goto end;
+            AVPacket *pkt = packet_pool_get(chain->pkt_pool);
+            if (!pkt) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            ret = av_bsf_receive_packet(ctx, pkt);
+            if (ret < 0) {
+                packet_pool_put(chain->pkt_pool, pkt);
+                break;
+            }
+            (*out_array)[nb_out++] = pkt;
+            stats->nb_out++;
+        }
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+            char errbuf[128] = {0};
+            av_strerror(ret, errbuf, sizeof(errbuf) - 1);
+            printf("bsf %s receive packet failed:%s\n", stats->name, errbuf);
+        }
+    }
+    ret = nb_out;
+
+end:
+    stats->time_us += av_gettime_relative() - start;
+    if (ret < 0) {
+        for (int j = i + 1; j < nb_in; j++)
+            packet_pool_put(chain->pkt_pool, in[j]);
+        for (int j = 0; j < nb_out; j++)
+            packet_pool_put(chain->pkt_pool, (*out_array)[j]);
+    }
+    return ret;
+}
+
+int bsf_chain_send_packets(bsf_chain_t *chain, AVPacket **pkts, int nb_pkts)
+{
+    if (!chain) {
+        return AVERROR(EINVAL);
+    }
+    if (chain->eof) {
+        return AVERROR_EOF;
+    }
+    int flush = (!pkts || nb_pkts == 0);
+    int ret = 0;
+
+    // 第一级的输入是调用者的包，先把数据引用转移到池中的包
+    if ((ret = ensure_capacity(&chain->batch[0], &chain->batch_capacity[0], nb_pkts)) < 0)
+        return ret;
+    int nb_cur = 0;
+    for (int i = 0; i < nb_pkts; i++) {
+        if (!pkts[i] || (!pkts[i]->data && !pkts[i]->side_data_elems))
+            continue;
+        AVPacket *pkt = packet_pool_get(chain->pkt_pool);
+        if (!pkt) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        av_packet_move_ref(pkt, pkts[i]);
+        chain->batch[0][nb_cur++] = pkt;
+    }
+
+    int cur = 0;
+    for (int i = 0; i < chain->nb_filters; i++) {
+        int next = cur ^ 1;
+        ret = filter_batch(chain, i, chain->batch[cur], nb_cur, &chain->batch[next],
+                           &chain->batch_capacity[next], flush);
+        if (ret < 0)
+            return ret;
+        nb_cur = ret;
+        cur = next;
+    }
+
+    // 最后一级的输出放入输出队列，队列头部已经取走的位置先挪掉
+    if (chain->out_head > 0) {
+        memmove(chain->out_pkts, chain->out_pkts + chain->out_head,
+                chain->nb_out * sizeof(AVPacket *));
+        chain->out_head = 0;
+    }
+    if ((ret = ensure_capacity(&chain->out_pkts, &chain->out_capacity,
+                               chain->out_head + chain->nb_out + nb_cur)) < 0)
+        goto fail_out;
+    for (int i = 0; i < nb_cur; i++) {
+        AVPacket *pkt = chain->batch[cur][i];
+        pkt->stream_index = chain->stream_index;
+        chain->out_pkts[chain->out_head + chain->nb_out++] = pkt;
+    }
+    if (flush)
+        chain->eof = 1;
+    return 0;
+
+fail_out:
+    for (int i = 0; i < nb_cur; i++)
+        packet_pool_put(chain->pkt_pool, chain->batch[cur][i]);
+    return ret;
+fail:
+    for (int i = 0; i < nb_cur; i++)
+        packet_pool_put(chain->pkt_pool, chain->batch[0][i]);
+    return ret;
+}
+
+int bsf_chain_send_packet(bsf_chain_t *chain, AVPacket *pkt)
+{
+    if (!pkt) {
+        return bsf_chain_send_packets(chain, NULL, 0);
+    }
+    return bsf_chain_send_packets(chain, &pkt, 1);
+}
+
+int bsf_chain_receive_packet(bsf_chain_t *chain, AVPacket *pkt)
+{
+    if (!chain) {
+        return AVERROR(EINVAL);
+    }
+    if (chain->nb_out == 0) {
+        return chain->eof ? AVERROR_EOF : AVERROR(EAGAIN);
+    }
+    AVPacket *out = chain->out_pkts[chain->out_head];
+    chain->out_pkts[chain->out_head] = NULL;
+    chain->out_head++;
+    chain->nb_out--;
+    if (chain->nb_out == 0) {
+        chain->out_head = 0;
+    }
+    av_packet_move_ref(pkt, out);
+    packet_pool_put(chain->pkt_pool, out);
+    return 0;
+}
+
+const AVCodecParameters *bsf_chain_get_par_out(bsf_chain_t *chain)
+{
+    return chain->filters[chain->nb_filters - 1]->par_out;
+}
+
+AVRational bsf_chain_get_time_base_out(bsf_chain_t *chain)
+{
+    return chain->filters[chain->nb_filters - 1]->time_base_out;
+}
+
+void bsf_chain_dump_stats(bsf_chain_t *chain, const char *name)
+{
+    if (!chain) {
+        return;
+    }
+    for (int i = 0; i < chain->nb_filters; i++) {
+        const bsf_filter_stats_t *s = &chain->stats[i];
+        printf("[%s] bsf %d:%s in:%" PRId64 " out:%" PRId64 " time:%" PRId64 "us (%.2fus/pkt)\n",
+               name ? name : "bsf_chain", i, s->name, s->nb_in, s->nb_out, s->time_us,
+               s->nb_in > 0 ? (double)s->time_us / s->nb_in : 0.0);
+    }
+}
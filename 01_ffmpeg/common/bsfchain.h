@@ -0,0 +1,112 @@
+#ifndef BSFCHAIN_H
+#define BSFCHAIN_H
+
+#include <stdint.h>
+#include "packetpool.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "libavcodec/avcodec.h"
+
+/**
+* 比特流过滤器链：
+* (1) 通过字符串配置多个过滤器，例如 "h264_mp4toannexb,h264_metadata=level=4.1,dump_extra"，
+*     过滤器参数格式同 ffmpeg 命令行 -bsf: name=key1=val1:key2=val2;
+* (2) 一次送入一批包，每个过滤器先把整批处理完再交给下一个过滤器;
+* (3) 每个流一个过滤器链，过滤器上下文在整个流的生命周期内复用;
+* (4) 统计每个过滤器的输入/输出包数和耗时。
+*/
+
+#define BSF_CHAIN_MAX_FILTERS 16
+
+// 单个过滤器的统计
+typedef struct bsf_filter_stats {
+    const char *name;   // 过滤器名称
+    int64_t nb_in;      // 输入包数
+    int64_t nb_out;     // 输出包数
+    int64_t time_us;    // 累计耗时(微秒)
+} bsf_filter_stats_t;
+
+typedef struct bsf_chain {
+    AVBSFContext *filters[BSF_CHAIN_MAX_FILTERS];
+    bsf_filter_stats_t stats[BSF_CHAIN_MAX_FILTERS];
+    int nb_filters;
+    int stream_index;           // 输出包的 stream_index
+    packet_pool_t *pkt_pool;    // 中间包和输出包从池中获取，可以为NULL
+
+    // 批处理时两级之间交替使用的包数组
+    AVPacket **batch[2];
+    int batch_capacity[2];
+    // 处理完成等待取走的包
+    AVPacket **out_pkts;
+    int out_capacity;
+    int out_head;
+    int nb_out;
+    int eof;                    // 已经冲刷
+} bsf_chain_t;
+
+/**
+ * @brief 分配过滤器链
+ * @param filters 过滤器描述字符串，NULL或空字符串时使用 null 过滤器(直通)
+ * @param par 输入流的参数
+ * @param time_base 输入流的时间基
+ * @param stream_index 输出包使用的 stream_index
+ * @param pkt_pool 包回收池，可以为NULL
+ * @return 成功返回过滤器链；失败返回NULL
+ */
+bsf_chain_t *bsf_chain_alloc(const char *filters, const AVCodecParameters *par,
+                             AVRational time_base, int stream_index, packet_pool_t *pkt_pool);
+
+/**
+ * @brief 释放过滤器链
+ * @param chain
+ */
+void bsf_chain_free(bsf_chain_t *chain);
+
+/**
+ * @brief 送入一批包，函数返回时整批包已经穿过所有过滤器
+ * @param chain
+ * @param pkts 包数组，包的数据引用会被取走(包变为空包，由调用者释放或归还)，nb_pkts=0 且 pkts=NULL 表示冲刷
+ * @param nb_pkts 包数量
+ * @return 成功返回0
+ */
+int bsf_chain_send_packets(bsf_chain_t *chain, AVPacket **pkts, int nb_pkts);
+
+/**
+ * @brief 送入单个包，pkt为NULL表示冲刷
+ */
+int bsf_chain_send_packet(bsf_chain_t *chain, AVPacket *pkt);
+
+/**
+ * @brief 取出一个处理完成的包
+ * @param chain
+ * @param pkt 空包，数据引用会移动到这里
+ * @return 成功返回0；没有数据返回 AVERROR(EAGAIN)；冲刷完成后返回 AVERROR_EOF
+ */
+int bsf_chain_receive_packet(bsf_chain_t *chain, AVPacket *pkt);
+
+/**
+ * @brief 输出流的参数(部分过滤器会修改 extradata 等)
+ */
+const AVCodecParameters *bsf_chain_get_par_out(bsf_chain_t *chain);
+
+/**
+ * @brief 输出流的时间基
+ */
+AVRational bsf_chain_get_time_base_out(bsf_chain_t *chain);
+
+/**
+ * @brief 打印每个过滤器的统计信息
+ * @param chain
+ * @param name 打印时的前缀
+ */
+void bsf_chain_dump_stats(bsf_chain_t *chain, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSFCHAIN_H
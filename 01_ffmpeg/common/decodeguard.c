@@ -0,0 +1,107 @@
+#include "decodeguard.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/time.h"
+
+void decode_guard_init(decode_guard_t *g, int resilient)
+{
+    memset(g, 0, sizeof(decode_guard_t));
+    g->resilient = resilient;
+    g->need_keyframe = 1;
+    g->max_consecutive_errors = DECODE_GUARD_MAX_ERRORS;
+}
+
+void decode_guard_setup(decode_guard_t *g, AVCodecContext *dec_ctx)
+{
+    g->need_keyframe = dec_ctx->codec_type == AVMEDIA_TYPE_VIDEO;
+    if (!g->resilient) {
+        return;
+    }
+    // 有错误的帧做了错误隐藏后照常输出，而不是直接丢掉
+    dec_ctx->flags |= AV_CODEC_FLAG_OUTPUT_CORRUPT;
+    dec_ctx->error_concealment = FF_EC_GUESS_MVS | FF_EC_DEBLOCK;
+}
+
+// 容错模式下出错：进入等待关键帧状态，连续出错太多返回错误
+static int on_error(decode_guard_t *g)
+{
+    g->consecutive_errors++;
+    if (g->need_keyframe)
+        g->waiting_key = 1;
+    if (g->max_consecutive_errors > 0 && g->consecutive_errors >= g->max_consecutive_errors) {
+        printf("decode guard: %d consecutive errors, giving up\n", g->consecutive_errors);
+        return AVERROR_INVALIDDATA;
+    }
+    return 0;
+}
+
+int decode_guard_send_packet(decode_guard_t *g, AVCodecContext *dec_ctx, const AVPacket *pkt)
+{
+    int flush = !pkt || pkt->size == 0;     // 空包也表示冲刷
+    if (!flush && g->waiting_key) {
+        if (!(pkt->flags & AV_PKT_FLAG_KEY)) {
+            g->stats.nb_dropped++;  // 参考帧已经坏了，解码出来也是花屏，直接跳过
+            return 1;
+        }
+        g->waiting_key = 0;
+        g->stats.nb_resync++;
+    }
+
+    // 解码器把 reordered_opaque 复制到这个包解码出的帧上，用来计算每帧的延迟
+    dec_ctx->reordered_opaque = av_gettime_relative();
+    int ret = avcodec_send_packet(dec_ctx, pkt);
+    if (ret == 0) {
+        if (!flush)
+            g->stats.nb_packets++;
+        return 0;
+    }
+    if (!g->resilient || ret == AVERROR(EAGAIN) || ret == AVERROR_EOF || ret == AVERROR(ENOMEM)) {
+        return ret;
+    }
+    g->stats.nb_dropped++;
+    ret = on_error(g);
+    return ret < 0 ? ret : 1;
+}
+
+int decode_guard_receive_frame(decode_guard_t *g, AVCodecContext *dec_ctx, AVFrame *frame)
+{
+    int ret = avcodec_receive_frame(dec_ctx, frame);
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+        return ret;
+    } else if (ret < 0) {
+        g->stats.nb_errored++;
+        if (!g->resilient || ret == AVERROR(ENOMEM)) {
+            return ret;
+        }
+        ret = on_error(g);
+        // 出错后不再继续取帧，让调用者送下一个包
+        return ret < 0 ? ret : AVERROR(EAGAIN);
+    }
+
+    g->stats.nb_frames++;
+    if (frame->decode_error_flags || (frame->flags & AV_FRAME_FLAG_CORRUPT)) {
+        g->stats.nb_concealed++;
+    } else {
+        g->consecutive_errors = 0;
+    }
+    if (frame->reordered_opaque > 0) {
+        int64_t latency = av_gettime_relative() - frame->reordered_opaque;
+        g->stats.latency_sum_us += latency;
+        if (latency > g->stats.latency_max_us)
+            g->stats.latency_max_us = latency;
+    }
+    return 0;
+}
+
+void decode_guard_dump_stats(const decode_guard_t *g, const char *name)
+{
+    const decode_guard_stats_t *s = &g->stats;
+    printf("[%s] decode guard(%s) packets:%lld frames:%lld concealed:%lld dropped:%lld"
+           " errored:%lld resync:%lld latency avg:%.3fms max:%.3fms\n",
+           name ? name : "decode_guard", g->resilient ? "resilient" : "strict",
+           (long long)s->nb_packets, (long long)s->nb_frames, (long long)s->nb_concealed,
+           (long long)s->nb_dropped, (long long)s->nb_errored, (long long)s->nb_resync,
+           s->nb_frames > 0 ? s->latency_sum_us / 1000.0 / s->nb_frames : 0.0,
+           s->latency_max_us / 1000.0);
+}
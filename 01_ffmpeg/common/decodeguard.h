@@ -0,0 +1,81 @@
+#ifndef DECODEGUARD_H
+#define DECODEGUARD_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "libavcodec/avcodec.h"
+
+/**
+* 容错解码：包装 avcodec_send_packet / avcodec_receive_frame，
+* (1) 非容错模式和原来一样，错误直接返回给调用者;
+* (2) 容错模式下送包失败或解码出错不返回错误，而是丢掉后续的包直到下一个关键帧(视频)再继续送，
+*     音频每个包都可以独立解码，出错后直接继续;
+* (3) 统计隐藏错误的帧(解码器做了错误隐藏后输出)、丢弃的帧(没有送进解码器的包)、出错的帧(解码失败);
+* (4) 统计每帧解码延迟：送包时把时间记到 reordered_opaque，解码器会随帧重排序带出来，
+*     所以 B 帧和帧级多线程带来的延迟也计算在内。
+* 连续出错超过 max_consecutive_errors 次认为文件已经无法解码，返回错误。
+* 调用者需要给关键帧包设置 AV_PKT_FLAG_KEY(裸流可以用解析器的 key_frame)。
+*/
+
+typedef struct decode_guard_stats {
+    int64_t nb_packets;         // 送进解码器的包
+    int64_t nb_frames;          // 输出的帧(含隐藏错误的帧)
+    int64_t nb_concealed;       // 解码器隐藏了错误后输出的帧
+    int64_t nb_dropped;         // 丢弃的帧：送包失败或等待关键帧时跳过的包
+    int64_t nb_errored;         // 解码失败的帧(avcodec_receive_frame 返回错误)
+    int64_t nb_resync;          // 在关键帧处恢复解码的次数
+    int64_t latency_sum_us;     // 每帧从送包到取出的延迟
+    int64_t latency_max_us;
+} decode_guard_stats_t;
+
+typedef struct decode_guard {
+    int resilient;              // 是否容错
+    int need_keyframe;          // 出错后是否要等到关键帧(视频)
+    int waiting_key;            // 正在等待关键帧
+    int max_consecutive_errors; // <=0 表示不限制
+    int consecutive_errors;
+    decode_guard_stats_t stats;
+} decode_guard_t;
+
+#define DECODE_GUARD_MAX_ERRORS 100     // 默认连续出错次数上限
+
+/**
+ * @brief 初始化
+ * @param g
+ * @param resilient 0 为原来的行为，1 为容错模式
+ */
+void decode_guard_init(decode_guard_t *g, int resilient);
+
+/**
+ * @brief 设置解码器的容错选项(输出隐藏错误的帧等)，必须在 avcodec_open2 之前调用
+ */
+void decode_guard_setup(decode_guard_t *g, AVCodecContext *dec_ctx);
+
+/**
+ * @brief 送包，pkt 为 NULL 时冲刷解码器
+ * @return 送进解码器返回0；容错模式下包被丢弃返回1；其他同 avcodec_send_packet
+ */
+int decode_guard_send_packet(decode_guard_t *g, AVCodecContext *dec_ctx, const AVPacket *pkt);
+
+/**
+ * @brief 取帧
+ * @return 同 avcodec_receive_frame；容错模式下解码出错返回 AVERROR(EAGAIN)，
+ *         连续出错超过上限返回 AVERROR_INVALIDDATA
+ */
+int decode_guard_receive_frame(decode_guard_t *g, AVCodecContext *dec_ctx, AVFrame *frame);
+
+/**
+ * @brief 打印统计信息
+ */
+void decode_guard_dump_stats(const decode_guard_t *g, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DECODEGUARD_H
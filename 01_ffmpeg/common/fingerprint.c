@@ -0,0 +1,604 @@
+#include "fingerprint.h"
+#include <stdio.h>
+#include <string.h>
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+
+#define GOP_FP_MAGIC "GOPI"
+#define GOP_FP_VERSION 2       // 2: 哈希前去掉封装相关的部分(起始码/长度前缀、参数集、ADTS头)
+
+// ===== xxhash64 =====
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2CA63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t xxh_rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+// 按小端读取，memcpy 可以处理不对齐的地址
+static inline uint64_t xxh_read64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t xxh_read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t xxh_round(uint64_t acc, uint64_t input)
+{
+    acc += input * XXH_PRIME64_2;
+    acc = xxh_rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxh_merge_round(uint64_t acc, uint64_t val)
+{
+    acc ^= xxh_round(0, val);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static inline uint64_t xxh_avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t gop_fp_xxh64(const void *data, size_t len, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    const uint8_t *end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        // 4路并行处理32字节的块
+        const uint8_t *limit = end - 32;
+        uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = seed + XXH_PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME64_1;
+        do {
+            v1 = xxh_round(v1, xxh_read64(p));
+            v2 = xxh_round(v2, xxh_read64(p + 8));
+            v3 = xxh_round(v3, xxh_read64(p + 16));
+            v4 = xxh_round(v4, xxh_read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = xxh_rotl64(v1, 1) + xxh_rotl64(v2, 7) + xxh_rotl64(v3, 12) + xxh_rotl64(v4, 18);
+        h = xxh_merge_round(h, v1);
+        h = xxh_merge_round(h, v2);
+        h = xxh_merge_round(h, v3);
+        h = xxh_merge_round(h, v4);
+    } else {
+        h = seed + XXH_PRIME64_5;
+    }
+    h += (uint64_t)len;
+
+    // 剩余不足32字节的部分
+    while (p + 8 <= end) {
+        h ^= xxh_round(0, xxh_read64(p));
+        h = xxh_rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)xxh_read32(p) * XXH_PRIME64_1;
+        h = xxh_rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * XXH_PRIME64_5;
+        h = xxh_rotl64(h, 11) * XXH_PRIME64_1;
+        p++;
+    }
+    return xxh_avalanche(h);
+}
+
+// ===== 索引 =====
+
+// 把一项插入哈希表，调用者保证有空位
+static void table_insert(gop_fp_entry_t *table, int capacity, uint64_t hash, int file_id)
+{
+    int mask = capacity - 1;
+    int pos = (int)(hash & mask);
+    while (table[pos].file_id >= 0) {
+        pos = (pos + 1) & mask;
+    }
+    table[pos].hash = hash;
+    table[pos].file_id = file_id;
+}
+
+// 负载超过1/2时扩容并重新插入
+static int table_reserve(gop_fp_index_t *index, int need)
+{
+    if ((int64_t)need * 2 <= index->table_capacity) {
+        return 0;
+    }
+    int capacity = index->table_capacity > 0 ? index->table_capacity : 1024;
+    while ((int64_t)need * 2 > capacity) {
+        capacity <<= 1;
+    }
+    gop_fp_entry_t *table = (gop_fp_entry_t *)av_malloc_array(capacity, sizeof(gop_fp_entry_t));
+    if (!table) {
+        return AVERROR(ENOMEM);
+    }
+    for (int i = 0; i < capacity; i++) {
+        table[i].file_id = -1;
+    }
+    for (int i = 0; i < index->table_capacity; i++) {
+        if (index->table[i].file_id >= 0)
+            table_insert(table, capacity, index->table[i].hash, index->table[i].file_id);
+    }
+    av_freep(&index->table);
+    index->table = table;
+    index->table_capacity = capacity;
+    return 0;
+}
+
+int gop_fp_index_add(gop_fp_index_t *index, const char *name, const uint64_t *hashes, int nb_gops)
+{
+    if (!index || !name || nb_gops < 0) {
+        return AVERROR(EINVAL);
+    }
+    if (index->nb_files >= index->files_capacity) {
+        int capacity = index->files_capacity > 0 ? index->files_capacity * 2 : 16;
+        gop_fp_file_t *files = (gop_fp_file_t *)av_realloc_array(index->files, capacity,
+                                                                 sizeof(gop_fp_file_t));
+        if (!files) {
+            return AVERROR(ENOMEM);
+        }
+        index->files = files;
+        index->files_capacity = capacity;
+    }
+    int ret = table_reserve(index, index->table_count + nb_gops);
+    if (ret < 0) {
+        return ret;
+    }
+    gop_fp_file_t *file = &index->files[index->nb_files];
+    memset(file, 0, sizeof(gop_fp_file_t));
+    file->name = av_strdup(name);
+    file->hashes = (uint64_t *)av_malloc_array(nb_gops > 0 ? nb_gops : 1, sizeof(uint64_t));
+    if (!file->name || !file->hashes) {
+        av_freep(&file->name);
+        av_freep(&file->hashes);
+        return AVERROR(ENOMEM);
+    }
+    if (nb_gops > 0)
+        memcpy(file->hashes, hashes, nb_gops * sizeof(uint64_t));
+    file->nb_gops = nb_gops;
+
+    int file_id = index->nb_files++;
+    for (int i = 0; i < nb_gops; i++) {
+        table_insert(index->table, index->table_capacity, hashes[i], file_id);
+    }
+    index->table_count += nb_gops;
+    return file_id;
+}
+
+gop_fp_index_t *gop_fp_index_load(const char *path)
+{
+    gop_fp_index_t *index = (gop_fp_index_t *)av_mallocz(sizeof(gop_fp_index_t));
+    if (!index) {
+        return NULL;
+    }
+    FILE *fp = path ? fopen(path, "rb") : NULL;
+    if (!fp) {
+        return index;   // 第一次运行，索引文件还不存在
+    }
+
+    char magic[4] = {0};
+    uint32_t version = 0, nb_files = 0;
+    if (fread(magic, 1, 4, fp) != 4 || memcmp(magic, GOP_FP_MAGIC, 4) != 0 ||
+        fread(&version, sizeof(version), 1, fp) != 1 || version != GOP_FP_VERSION ||
+        fread(&nb_files, sizeof(nb_files), 1, fp) != 1) {
+        printf("invalid fingerprint index: %s\n", path);
+        goto fail;
+    }
+    for (uint32_t i = 0; i < nb_files; i++) {
+        char name[1024] = {0};
+        uint16_t name_len = 0;
+        uint32_t nb_gops = 0;
+        if (fread(&name_len, sizeof(name_len), 1, fp) != 1 || name_len >= sizeof(name) ||
+            fread(name, 1, name_len, fp) != name_len ||
+            fread(&nb_gops, sizeof(nb_gops), 1, fp) != 1 || nb_gops > INT32_MAX / 8) {
+            printf("fingerprint index %s truncated at file %u\n", path, i);
+            goto fail;
+        }
+        uint64_t *hashes = (uint64_t *)av_malloc_array(nb_gops > 0 ? nb_gops : 1, sizeof(uint64_t));
+        if (!hashes) {
+            goto fail;
+        }
+        if (fread(hashes, sizeof(uint64_t), nb_gops, fp) != nb_gops ||
+            gop_fp_index_add(index, name, hashes, (int)nb_gops) < 0) {
+            printf("fingerprint index %s truncated at file %u\n", path, i);
+            av_free(hashes);
+            goto fail;
+        }
+        av_free(hashes);
+    }
+    fclose(fp);
+    return index;
+
+fail:
+    fclose(fp);
+    gop_fp_index_free(index);
+    return NULL;
+}
+
+int gop_fp_index_save(gop_fp_index_t *index, const char *path)
+{
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        printf("open %s failed\n", path);
+        return AVERROR(EIO);
+    }
+    uint32_t version = GOP_FP_VERSION;
+    uint32_t nb_files = (uint32_t)index->nb_files;
+    int ok = fwrite(GOP_FP_MAGIC, 1, 4, fp) == 4 &&
+             fwrite(&version, sizeof(version), 1, fp) == 1 &&
+             fwrite(&nb_files, sizeof(nb_files), 1, fp) == 1;
+    for (int i = 0; ok && i < index->nb_files; i++) {
+        const gop_fp_file_t *file = &index->files[i];
+        size_t len = strlen(file->name);
+        uint16_t name_len = (uint16_t)(len < 1023 ? len : 1023);
+        uint32_t nb_gops = (uint32_t)file->nb_gops;
+        ok = fwrite(&name_len, sizeof(name_len), 1, fp) == 1 &&
+             fwrite(file->name, 1, name_len, fp) == name_len &&
+             fwrite(&nb_gops, sizeof(nb_gops), 1, fp) == 1 &&
+             fwrite(file->hashes, sizeof(uint64_t), nb_gops, fp) == nb_gops;
+    }
+    fclose(fp);
+    if (!ok) {
+        printf("write %s failed\n", path);
+        return AVERROR(EIO);
+    }
+    return 0;
+}
+
+void gop_fp_index_free(gop_fp_index_t *index)
+{
+    if (!index) {
+        return;
+    }
+    for (int i = 0; i < index->nb_files; i++) {
+        av_freep(&index->files[i].name);
+        av_freep(&index->files[i].hashes);
+    }
+    av_freep(&index->files);
+    av_freep(&index->table);
+    av_freep(&index);
+}
+
+int64_t gop_fp_index_memory(gop_fp_index_t *index)
+{
+    if (!index) {
+        return 0;
+    }
+    int64_t size = sizeof(gop_fp_index_t);
+    size += (int64_t)index->files_capacity * sizeof(gop_fp_file_t);
+    size += (int64_t)index->table_capacity * sizeof(gop_fp_entry_t);
+    for (int i = 0; i < index->nb_files; i++) {
+        size += strlen(index->files[i].name) + 1;
+        size += (int64_t)index->files[i].nb_gops * sizeof(uint64_t);
+    }
+    return size;
+}
+
+// ===== 指纹计算 =====
+
+// extradata 是 avcC/hvcC 时包中的 NAL 带长度前缀(mp4/flv)，返回前缀字节数；否则是 Annex-B 起始码(ts)，返回0
+static int get_nal_length_size(const AVCodecParameters *par)
+{
+    const uint8_t *extra = par->extradata;
+    if (!extra || extra[0] != 1) {
+        return 0;
+    }
+    if (par->codec_id == AV_CODEC_ID_H264 && par->extradata_size >= 7) {
+        return (extra[4] & 0x03) + 1;
+    }
+    if (par->codec_id == AV_CODEC_ID_HEVC && par->extradata_size >= 23) {
+        return (extra[21] & 0x03) + 1;
+    }
+    return 0;
+}
+
+// 参数集、SEI、AUD、结束符、填充数据不参与哈希：不同封装中它们的位置和有无都不一样
+// (mp4 放在 extradata 中，ts 在关键帧前重复，ts 封装时还会插入 AUD)
+static int skip_nal(enum AVCodecID codec_id, const uint8_t *nal)
+{
+    if (codec_id == AV_CODEC_ID_H264) {
+        int type = nal[0] & 0x1f;
+        return (type >= 6 && type <= 13) || type == 15;
+    }
+    int type = (nal[0] >> 1) & 0x3f;   // HEVC
+    return type >= 32 && type <= 40;
+}
+
+// 把一个 NAL 合并到包哈希中，返回参与计算的字节数
+static int hash_nal(gop_fp_t *fp, const uint8_t *nal, int size, uint64_t *hash)
+{
+    // Annex-B 中 4 字节起始码的第一个 0 和 trailing_zero 会留在上一个 NAL 末尾
+    while (size > 0 && nal[size - 1] == 0)
+        size--;
+    if (size <= 0 || skip_nal(fp->codec_id, nal)) {
+        return 0;
+    }
+    *hash = gop_fp_xxh64(nal, size, *hash);
+    return size;
+}
+
+// 下一个起始码 00 00 01 的位置，没有返回 end
+static const uint8_t *find_start_code(const uint8_t *p, const uint8_t *end)
+{
+    for (; p + 3 <= end; p++) {
+        if (p[0] == 0 && p[1] == 0 && p[2] == 1)
+            return p;
+    }
+    return end;
+}
+
+// H.264/HEVC：逐个 NAL 计算，长度前缀和起始码两种格式得到相同的结果
+static int hash_nal_payload(gop_fp_t *fp, const uint8_t *data, int size, uint64_t *hash)
+{
+    const uint8_t *end = data + size;
+    int bytes = 0;
+    if (fp->nal_length_size > 0) {
+        const uint8_t *p = data;
+        while (end - p >= fp->nal_length_size) {
+            uint32_t len = 0;
+            for (int i = 0; i < fp->nal_length_size; i++)
+                len = (len << 8) | p[i];
+            p += fp->nal_length_size;
+            if (len > (uint32_t)(end - p)) {
+                return -1;  // 长度前缀损坏
+            }
+            bytes += hash_nal(fp, p, (int)len, hash);
+            p += len;
+        }
+        return bytes;
+    }
+    const uint8_t *p = find_start_code(data, end);
+    if (p == end) {
+        return -1;      // 没有起始码
+    }
+    while (p < end) {
+        const uint8_t *nal = p + 3;
+        p = find_start_code(nal, end);
+        bytes += hash_nal(fp, nal, (int)(p - nal), hash);
+    }
+    return bytes;
+}
+
+// AAC：ts 中每帧带 ADTS 头，mp4/flv 中是裸数据，只对裸数据计算
+static int hash_adts_payload(const uint8_t *data, int size, uint64_t *hash)
+{
+    int bytes = 0;
+    while (size >= 7 && data[0] == 0xff && (data[1] & 0xf6) == 0xf0) {
+        int header_len = (data[1] & 0x01) ? 7 : 9;  // protection_absent=0 时多2字节 CRC
+        int frame_len = ((data[3] & 0x03) << 11) | (data[4] << 3) | (data[5] >> 5);
+        if (frame_len < header_len || frame_len > size) {
+            return -1;
+        }
+        *hash = gop_fp_xxh64(data + header_len, frame_len - header_len, *hash);
+        bytes += frame_len - header_len;
+        data += frame_len;
+        size -= frame_len;
+    }
+    return size == 0 ? bytes : -1;
+}
+
+/**
+ * 计算一个包的哈希，只包含和封装无关的内容
+ * @return 参与计算的字节数，0 表示包里没有需要计算的内容(例如只有参数集)
+ */
+static int hash_payload(gop_fp_t *fp, const uint8_t *data, int size, uint64_t *hash)
+{
+    int bytes = -1;
+    *hash = 0;
+    if (fp->codec_id == AV_CODEC_ID_H264 || fp->codec_id == AV_CODEC_ID_HEVC) {
+        bytes = hash_nal_payload(fp, data, size, hash);
+    } else if (fp->codec_id == AV_CODEC_ID_AAC) {
+        bytes = hash_adts_payload(data, size, hash);
+    }
+    if (bytes < 0) {
+        // 其他编码格式，或者格式不符(例如没有 ADTS 头的 AAC)，按原始数据计算
+        *hash = gop_fp_xxh64(data, size, 0);
+        bytes = size;
+    }
+    return bytes;
+}
+
+gop_fp_t *gop_fp_alloc(gop_fp_index_t *index, const AVCodecParameters *par, int stream_index,
+                       int probe_gops, double threshold)
+{
+    gop_fp_t *fp = (gop_fp_t *)av_mallocz(sizeof(gop_fp_t));
+    if (!fp) {
+        return NULL;
+    }
+    fp->index = index;
+    fp->stream_index = stream_index;
+    fp->is_video = par && par->codec_type == AVMEDIA_TYPE_VIDEO;
+    fp->codec_id = par ? par->codec_id : AV_CODEC_ID_NONE;
+    fp->nal_length_size = par ? get_nal_length_size(par) : 0;
+    fp->probe_gops = probe_gops > 0 ? probe_gops : GOP_FP_DEFAULT_PROBE;
+    fp->threshold = threshold > 0 ? threshold : GOP_FP_DEFAULT_THRESHOLD;
+    fp->dup_file_id = -1;
+
+    int nb_files = index ? index->nb_files : 0;
+    if (nb_files > 0) {
+        fp->hits = (int *)av_mallocz_array(nb_files, sizeof(int));
+        fp->last_hit = (int *)av_malloc_array(nb_files, sizeof(int));
+        if (!fp->hits || !fp->last_hit) {
+            gop_fp_free(fp);
+            return NULL;
+        }
+        for (int i = 0; i < nb_files; i++) {
+            fp->last_hit[i] = -1;
+        }
+    }
+    fp->stats.memory = sizeof(gop_fp_t) + (int64_t)nb_files * 2 * sizeof(int);
+    return fp;
+}
+
+void gop_fp_free(gop_fp_t *fp)
+{
+    if (!fp) {
+        return;
+    }
+    av_freep(&fp->hashes);
+    av_freep(&fp->hits);
+    av_freep(&fp->last_hit);
+    av_freep(&fp);
+}
+
+// 在索引中查找GOP哈希，给每个包含它的文件计一次命中
+static void lookup_gop(gop_fp_t *fp, uint64_t hash, int gop_no)
+{
+    gop_fp_index_t *index = fp->index;
+    if (!index || index->table_capacity == 0 || !fp->hits) {
+        return;
+    }
+    int mask = index->table_capacity - 1;
+    int pos = (int)(hash & mask);
+    while (index->table[pos].file_id >= 0) {
+        int file_id = index->table[pos].file_id;
+        if (index->table[pos].hash == hash && fp->last_hit[file_id] != gop_no) {
+            fp->last_hit[file_id] = gop_no;
+            fp->hits[file_id]++;
+        }
+        pos = (pos + 1) & mask;
+    }
+}
+
+// 读够 probe_gops 个GOP后选出命中最多的文件
+static void decide(gop_fp_t *fp)
+{
+    fp->decided = 1;
+    if (!fp->index || !fp->hits) {
+        return;
+    }
+    int best = -1;
+    for (int i = 0; i < fp->index->nb_files; i++) {
+        if (best < 0 || fp->hits[i] > fp->hits[best])
+            best = i;
+    }
+    if (best < 0) {
+        return;
+    }
+    double ratio = (double)fp->hits[best] / fp->nb_gops;
+    if (ratio >= fp->threshold) {
+        fp->dup_file_id = best;
+        fp->dup_ratio = ratio;
+    }
+}
+
+// 当前GOP结束，保存哈希并和索引比对
+static int close_gop(gop_fp_t *fp)
+{
+    if (fp->gop_packets == 0) {
+        return 0;
+    }
+    if (fp->nb_gops >= fp->hashes_capacity) {
+        int capacity = fp->hashes_capacity > 0 ? fp->hashes_capacity * 2 : 256;
+        uint64_t *hashes = (uint64_t *)av_realloc_array(fp->hashes, capacity, sizeof(uint64_t));
+        if (!hashes) {
+            return AVERROR(ENOMEM);
+        }
+        fp->stats.memory += (int64_t)(capacity - fp->hashes_capacity) * sizeof(uint64_t);
+        fp->hashes = hashes;
+        fp->hashes_capacity = capacity;
+    }
+    // 包数也参与哈希，避免只差几个空包的GOP冲突
+    uint64_t hash = xxh_avalanche(fp->gop_hash ^ ((uint64_t)fp->gop_packets * XXH_PRIME64_5));
+    fp->hashes[fp->nb_gops] = hash;
+    if (!fp->decided) {
+        lookup_gop(fp, hash, fp->nb_gops);
+    }
+    fp->nb_gops++;
+    fp->gop_hash = 0;
+    fp->gop_packets = 0;
+
+    if (!fp->decided && fp->nb_gops >= fp->probe_gops) {
+        decide(fp);
+        if (fp->dup_file_id >= 0)
+            return 1;
+    }
+    return 0;
+}
+
+int gop_fp_feed(gop_fp_t *fp, const AVPacket *pkt)
+{
+    if (!fp || !pkt) {
+        return AVERROR(EINVAL);
+    }
+    if (pkt->stream_index != fp->stream_index || !pkt->data || pkt->size <= 0) {
+        return 0;
+    }
+    int64_t start = av_gettime_relative();
+    int ret = 0;
+
+    // 视频遇到关键帧、音频攒够一组时，上一个GOP结束
+    int new_gop = fp->is_video ? (pkt->flags & AV_PKT_FLAG_KEY)
+                               : (fp->gop_packets >= GOP_FP_AUDIO_CHUNK);
+    if (new_gop) {
+        ret = close_gop(fp);
+    }
+    uint64_t pkt_hash = 0;
+    int bytes = 0;
+    if (ret >= 0 && (bytes = hash_payload(fp, pkt->data, pkt->size, &pkt_hash)) > 0) {
+        fp->gop_hash = xxh_round(fp->gop_hash, pkt_hash);  // 顺序相关的合并
+        fp->gop_packets++;
+        fp->stats.nb_packets++;
+        fp->stats.nb_bytes += bytes;
+    }
+    fp->stats.time_us += av_gettime_relative() - start;
+    return ret;
+}
+
+int gop_fp_finish(gop_fp_t *fp)
+{
+    if (!fp) {
+        return AVERROR(EINVAL);
+    }
+    int ret = close_gop(fp);
+    // 整个文件都不够 probe_gops 个GOP，用已有的GOP判断
+    if (ret == 0 && !fp->decided && fp->nb_gops > 0) {
+        decide(fp);
+        ret = fp->dup_file_id >= 0;
+    }
+    return ret;
+}
+
+void gop_fp_dump_stats(gop_fp_t *fp, int64_t loop_time_us)
+{
+    if (!fp) {
+        return;
+    }
+    const gop_fp_stats_t *s = &fp->stats;
+    printf("[fingerprint] gops:%d packets:%" PRId64 " bytes:%" PRId64 " time:%" PRId64 "us",
+           fp->nb_gops, s->nb_packets, s->nb_bytes, s->time_us);
+    if (s->time_us > 0)
+        printf(" (%.1fMB/s)", (double)s->nb_bytes / s->time_us);
+    if (loop_time_us > 0)
+        printf(" demux loop:%" PRId64 "us overhead:%.2f%%", loop_time_us,
+               100.0 * s->time_us / loop_time_us);
+    printf("\n[fingerprint] memory ctx:%" PRId64 "B index:%" PRId64 "B (%d files)\n", s->memory,
+           gop_fp_index_memory(fp->index), fp->index ? fp->index->nb_files : 0);
+    if (fp->dup_file_id >= 0) {
+        printf("[fingerprint] duplicate of %s, matched %.0f%% of first %d gops\n",
+               fp->index->files[fp->dup_file_id].name, fp->dup_ratio * 100,
+               FFMIN(fp->probe_gops, fp->nb_gops));
+    }
+}
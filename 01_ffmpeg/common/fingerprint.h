@@ -0,0 +1,169 @@
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "libavcodec/avcodec.h"
+
+/**
+* 按GOP计算码流指纹，用于识别重复上传的文件：
+* (1) 每个包的负载用 xxhash64 计算哈希，一个GOP内的包哈希按顺序合并成GOP哈希;
+*     计算前去掉和封装格式有关的部分：H.264/HEVC 按 NAL 计算，不含长度前缀/起始码，
+*     跳过参数集、SEI、AUD 等；AAC 去掉 ADTS 头。只有参数集的包不计入;
+* (2) GOP 以视频关键帧为边界，纯音频流每 GOP_FP_AUDIO_CHUNK 个包算一组;
+* (3) 所有文件的GOP哈希保存在一个紧凑的二进制索引文件中，每个GOP只占8字节;
+* (4) demux 读到前几个GOP后就和索引比对，命中比例超过阈值即认为是重复/近似重复文件，
+*     可以提前结束，跳过完整转码。
+* 注意：哈希基于压缩后的码流，重新编码过的文件不会命中；
+*      封装格式不同(mp4/flv/ts)但码流相同的文件可以命中(见 25_fingerprint_check)，
+*      前后被截断的文件按比例部分命中。
+*/
+
+#define GOP_FP_AUDIO_CHUNK 64       // 纯音频流多少个包算一组
+#define GOP_FP_DEFAULT_PROBE 3      // 默认读到多少个GOP后判断是否重复
+#define GOP_FP_DEFAULT_THRESHOLD 0.8 // 默认命中比例阈值
+
+/**
+ * @brief 计算 xxhash64
+ * @param data
+ * @param len
+ * @param seed
+ * @return 64位哈希值
+ */
+uint64_t gop_fp_xxh64(const void *data, size_t len, uint64_t seed);
+
+// 索引中的一个文件
+typedef struct gop_fp_file {
+    char *name;         // 文件名
+    uint64_t *hashes;   // 每个GOP的哈希
+    int nb_gops;
+} gop_fp_file_t;
+
+// 哈希表中的一项：GOP哈希 -> 文件
+typedef struct gop_fp_entry {
+    uint64_t hash;
+    int file_id;        // -1 表示空位
+} gop_fp_entry_t;
+
+/**
+* 索引文件格式(小端)：
+*   "GOPI" | u32 版本 | u32 文件数
+*   每个文件: u16 文件名长度 | 文件名 | u32 GOP数 | u64 GOP哈希 * GOP数
+*/
+typedef struct gop_fp_index {
+    gop_fp_file_t *files;
+    int nb_files;
+    int files_capacity;
+    gop_fp_entry_t *table;  // 开放寻址哈希表，容量为2的幂
+    int table_capacity;
+    int table_count;
+} gop_fp_index_t;
+
+/**
+ * @brief 加载索引文件，文件不存在时返回空索引
+ * @param path
+ * @return 失败返回NULL
+ */
+gop_fp_index_t *gop_fp_index_load(const char *path);
+
+/**
+ * @brief 保存索引文件
+ * @return 成功返回0
+ */
+int gop_fp_index_save(gop_fp_index_t *index, const char *path);
+
+/**
+ * @brief 添加一个文件的GOP哈希
+ * @return 成功返回文件id
+ */
+int gop_fp_index_add(gop_fp_index_t *index, const char *name, const uint64_t *hashes, int nb_gops);
+
+/**
+ * @brief 释放索引
+ */
+void gop_fp_index_free(gop_fp_index_t *index);
+
+/**
+ * @brief 索引占用的内存(字节)
+ */
+int64_t gop_fp_index_memory(gop_fp_index_t *index);
+
+// 指纹计算的统计信息
+typedef struct gop_fp_stats {
+    int64_t nb_packets;     // 参与计算的包数
+    int64_t nb_bytes;       // 参与计算的字节数
+    int64_t time_us;        // gop_fp_feed 累计耗时(微秒)
+    int64_t memory;         // 指纹上下文占用的内存(字节)，不含索引
+} gop_fp_stats_t;
+
+typedef struct gop_fp {
+    gop_fp_index_t *index;  // 用于比对的索引，可以为NULL
+    int stream_index;       // 参与计算的流
+    int is_video;
+    enum AVCodecID codec_id;
+    int nal_length_size;    // H.264/HEVC 长度前缀的字节数，0 表示 Annex-B 起始码
+    int probe_gops;         // 读到多少个GOP后判断是否重复
+    double threshold;       // 命中比例阈值
+
+    uint64_t gop_hash;      // 当前GOP的哈希
+    int gop_packets;        // 当前GOP的包数
+
+    uint64_t *hashes;       // 已经完成的GOP哈希
+    int nb_gops;
+    int hashes_capacity;
+
+    int *hits;              // 每个索引文件被命中的GOP数
+    int *last_hit;          // 每个索引文件最后一次被命中的GOP序号，避免同一个GOP重复计数
+    int decided;            // 已经给出判断
+    int dup_file_id;        // 重复文件在索引中的id，-1表示不重复
+    double dup_ratio;       // 命中比例
+
+    gop_fp_stats_t stats;
+} gop_fp_t;
+
+/**
+ * @brief 分配指纹计算上下文
+ * @param index 用于比对的索引，可以为NULL
+ * @param par 参与计算的流的参数
+ * @param stream_index 参与计算的流
+ * @param probe_gops <=0 使用默认值
+ * @param threshold <=0 使用默认值
+ * @return 失败返回NULL
+ */
+gop_fp_t *gop_fp_alloc(gop_fp_index_t *index, const AVCodecParameters *par, int stream_index,
+                       int probe_gops, double threshold);
+
+/**
+ * @brief 释放指纹计算上下文
+ */
+void gop_fp_free(gop_fp_t *fp);
+
+/**
+ * @brief 送入一个demux出来的包，其他流的包直接忽略
+ * @return 确认是重复文件返回1；否则返回0；失败返回负数
+ */
+int gop_fp_feed(gop_fp_t *fp, const AVPacket *pkt);
+
+/**
+ * @brief 结束最后一个GOP，文件读完后调用
+ * @return 确认是重复文件返回1；否则返回0
+ */
+int gop_fp_finish(gop_fp_t *fp);
+
+/**
+ * @brief 打印指纹统计信息
+ * @param fp
+ * @param loop_time_us demux 循环的总耗时，用于计算指纹计算所占比例，<=0 不计算
+ */
+void gop_fp_dump_stats(gop_fp_t *fp, int64_t loop_time_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FINGERPRINT_H
@@ -0,0 +1,251 @@
+#include "framepool.h"
+#include <stdio.h>
+#include <string.h>
+#include "libavutil/imgutils.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+
+static void destroy_pool(frame_pool_t *pool)
+{
+    pthread_mutex_destroy(&pool->stats_mutex);
+    pthread_mutex_destroy(&pool->mutex);
+    av_free(pool);
+}
+
+// 池中内存真正释放时更新内存统计(池被 uninit 之后，帧最后一次 unref 时)
+static void pool_buffer_free(void *opaque, uint8_t *data)
+{
+    frame_pool_t *pool = (frame_pool_t *)opaque;
+    // 分配时把大小记录在内存开头，数据从 FRAME_POOL_STRIDE_ALIGN 之后开始
+    uint8_t *base = data - FRAME_POOL_STRIDE_ALIGN;
+    int size = *(int *)base;
+    av_free(base);
+
+    pthread_mutex_lock(&pool->stats_mutex);
+    pool->stats.mem_bytes -= size;
+    int last = pool->freed && pool->stats.mem_bytes == 0;
+    pthread_mutex_unlock(&pool->stats_mutex);
+    if (last) {
+        destroy_pool(pool);     // frame_pool_free 之后最后一块内存也归还了
+    }
+}
+
+// AVBufferPool 没有空闲内存时调用
+static AVBufferRef *pool_buffer_alloc(void *opaque, int size)
+{
+    frame_pool_t *pool = (frame_pool_t *)opaque;
+    // 多分配一个对齐单位存放大小，数据地址仍然按 FRAME_POOL_STRIDE_ALIGN 对齐。
+    // AVBufferPool 复用时使用 AVBuffer 里的原始地址，所以偏移要在 av_buffer_create 时给出
+    int alloc_size = size + FRAME_POOL_STRIDE_ALIGN;
+    uint8_t *base = (uint8_t *)av_malloc(alloc_size);
+    if (!base) {
+        return NULL;
+    }
+    *(int *)base = alloc_size;
+    AVBufferRef *buf = av_buffer_create(base + FRAME_POOL_STRIDE_ALIGN, size, pool_buffer_free,
+                                        pool, 0);
+    if (!buf) {
+        av_free(base);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pool->stats_mutex);
+    pool->stats.buf_alloc_count++;
+    pool->stats.mem_bytes += alloc_size;
+    if (pool->stats.mem_bytes > pool->stats.mem_high_water)
+        pool->stats.mem_high_water = pool->stats.mem_bytes;
+    pthread_mutex_unlock(&pool->stats_mutex);
+    return buf;
+}
+
+frame_pool_t *frame_pool_alloc(void)
+{
+    frame_pool_t *pool = (frame_pool_t *)av_mallocz(sizeof(frame_pool_t));
+    if (!pool) {
+        return NULL;
+    }
+    if (pthread_mutex_init(&pool->mutex, NULL) != 0) {
+        av_freep(&pool);
+        return NULL;
+    }
+    if (pthread_mutex_init(&pool->stats_mutex, NULL) != 0) {
+        pthread_mutex_destroy(&pool->mutex);
+        av_freep(&pool);
+        return NULL;
+    }
+    pool->format = -1;
+    return pool;
+}
+
+static void uninit_pools(frame_pool_t *pool)
+{
+    // av_buffer_pool_uninit 只是标记，还在外面被引用的内存在最后一次 unref 时才真正释放
+    for (int i = 0; i < 4; i++) {
+        if (pool->pools[i])
+            av_buffer_pool_uninit(&pool->pools[i]);
+    }
+}
+
+void frame_pool_free(frame_pool_t *pool)
+{
+    if (!pool) {
+        return;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    uninit_pools(pool);     // 空闲内存在这里释放
+    pthread_mutex_unlock(&pool->mutex);
+
+    // 还有帧引用池内存时，结构体留到最后一块内存归还时(pool_buffer_free)再释放
+    pthread_mutex_lock(&pool->stats_mutex);
+    pool->freed = 1;
+    int last = pool->stats.mem_bytes == 0;
+    pthread_mutex_unlock(&pool->stats_mutex);
+    if (last) {
+        destroy_pool(pool);
+    }
+}
+
+/**
+ * 按帧参数(重新)创建每个平面的池，计算方法同 FFmpeg 内部 update_frame_pool：
+ * 宽高按解码器要求对齐，linesize 按 linesize_align 对齐
+ */
+static int update_pools(frame_pool_t *pool, AVCodecContext *codec_ctx, AVFrame *frame)
+{
+    if (pool->pools[0] && pool->width == frame->width && pool->height == frame->height &&
+        pool->format == frame->format) {
+        return 0;
+    }
+    int w = frame->width;
+    int h = frame->height;
+    int linesize_align[AV_NUM_DATA_POINTERS];
+    int linesize[4] = {0};
+    uint8_t *data[4] = {NULL};
+    int size[4] = {0};
+    int unaligned;
+    int ret;
+
+    avcodec_align_dimensions2(codec_ctx, &w, &h, linesize_align);
+    do {
+        // 宽度逐步增加对齐，直到所有平面的 linesize 都满足对齐要求
+        ret = av_image_fill_linesizes(linesize, (enum AVPixelFormat)frame->format, w);
+        if (ret < 0)
+            return ret;
+        w += w & ~(w - 1);
+        unaligned = 0;
+        for (int i = 0; i < 4; i++)
+            unaligned |= linesize[i] % linesize_align[i];
+    } while (unaligned);
+
+    int total = av_image_fill_pointers(data, (enum AVPixelFormat)frame->format, h, NULL, linesize);
+    if (total < 0) {
+        return total;
+    }
+    int i;
+    for (i = 0; i < 3 && data[i + 1]; i++)
+        size[i] = (int)(data[i + 1] - data[i]);
+    size[i] = (int)(total - (data[i] - data[0]));
+
+    uninit_pools(pool);
+    for (i = 0; i < 4; i++) {
+        pool->linesize[i] = linesize[i];
+        pool->plane_size[i] = size[i];
+        if (size[i] == 0)
+            continue;
+        // 多留16字节给部分解码器越界读取(同 FFmpeg)，av_malloc 已经保证起始地址对齐
+        pool->pools[i] = av_buffer_pool_init2(size[i] + 16, pool, pool_buffer_alloc, NULL);
+        if (!pool->pools[i]) {
+            uninit_pools(pool);
+            return AVERROR(ENOMEM);
+        }
+    }
+    pool->width = frame->width;
+    pool->height = frame->height;
+    pool->format = frame->format;
+    pthread_mutex_lock(&pool->stats_mutex);
+    pool->stats.nb_reconfig++;
+    pthread_mutex_unlock(&pool->stats_mutex);
+    return 0;
+}
+
+int frame_pool_get_buffer2(AVCodecContext *codec_ctx, AVFrame *frame, int flags)
+{
+    frame_pool_t *pool = (frame_pool_t *)codec_ctx->opaque;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((enum AVPixelFormat)frame->format);
+
+    // 音频、硬件帧、调色板格式、不支持直接渲染的解码器使用默认分配
+    if (!pool || codec_ctx->codec_type != AVMEDIA_TYPE_VIDEO || !desc ||
+        (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL)) ||
+        !(codec_ctx->codec->capabilities & AV_CODEC_CAP_DR1)) {
+        if (pool) {
+            pthread_mutex_lock(&pool->stats_mutex);
+            pool->stats.nb_fallback++;
+            pthread_mutex_unlock(&pool->stats_mutex);
+        }
+        return avcodec_default_get_buffer2(codec_ctx, frame, flags);
+    }
+
+    // 帧级多线程时多个线程同时进入，锁保护池的重建，避免取内存时池被替换
+    pthread_mutex_lock(&pool->mutex);
+    int ret = update_pools(pool, codec_ctx, frame);
+    if (ret < 0) {
+        pthread_mutex_unlock(&pool->mutex);
+        return ret;
+    }
+    memset(frame->data, 0, sizeof(frame->data));
+    frame->extended_data = frame->data;
+    for (int i = 0; i < 4 && pool->pools[i]; i++) {
+        frame->buf[i] = av_buffer_pool_get(pool->pools[i]);
+        if (!frame->buf[i]) {
+            pthread_mutex_unlock(&pool->mutex);
+            av_frame_unref(frame);
+            return AVERROR(ENOMEM);
+        }
+        frame->data[i] = frame->buf[i]->data;
+        frame->linesize[i] = pool->linesize[i];
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    pthread_mutex_lock(&pool->stats_mutex);
+    for (int i = 0; i < 4 && frame->buf[i]; i++)
+        pool->stats.buf_get_count++;
+    pool->stats.nb_frames++;
+    pthread_mutex_unlock(&pool->stats_mutex);
+    return 0;
+}
+
+int frame_pool_attach(frame_pool_t *pool, AVCodecContext *codec_ctx)
+{
+    if (!pool || !codec_ctx) {
+        return AVERROR(EINVAL);
+    }
+    codec_ctx->opaque = pool;
+    codec_ctx->get_buffer2 = frame_pool_get_buffer2;
+    // 回调是线程安全的，帧级多线程解码时可以在工作线程中直接调用
+    codec_ctx->thread_safe_callbacks = 1;
+    return 0;
+}
+
+void frame_pool_get_stats(frame_pool_t *pool, frame_pool_stats_t *stats)
+{
+    memset(stats, 0, sizeof(frame_pool_stats_t));
+    if (!pool) {
+        return;
+    }
+    pthread_mutex_lock(&pool->stats_mutex);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->stats_mutex);
+}
+
+void frame_pool_dump_stats(frame_pool_t *pool, const char *name)
+{
+    frame_pool_stats_t s;
+    frame_pool_get_stats(pool, &s);
+    double hit_rate = s.buf_get_count > 0 ? 100.0 * (s.buf_get_count - s.buf_alloc_count) /
+                                            s.buf_get_count : 0.0;
+    printf("[%s] frame pool frames:%lld fallback:%lld buf get:%lld alloc:%lld hit:%.2f%%"
+           " reconfig:%lld mem:%.1fMB high water:%.1fMB\n",
+           name ? name : "frame_pool", (long long)s.nb_frames, (long long)s.nb_fallback,
+           (long long)s.buf_get_count, (long long)s.buf_alloc_count, hit_rate,
+           (long long)s.nb_reconfig, s.mem_bytes / (1024.0 * 1024.0),
+           s.mem_high_water / (1024.0 * 1024.0));
+}
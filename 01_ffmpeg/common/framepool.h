@@ -0,0 +1,92 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "libavcodec/avcodec.h"
+#include "libavutil/buffer.h"
+
+/**
+* 解码帧内存池：
+* (1) 通过 get_buffer2 回调让解码器直接解码到池中的内存，每个平面一个 AVBufferPool;
+* (2) 内存大小按流的宽高/像素格式计算并按解码器要求对齐，分辨率或格式变化时重建池;
+* (3) 帧被 av_frame_unref 后内存回到池中，下游(帧队列、滤镜、编码器)持有帧引用不需要拷贝;
+* (4) 统计命中率和池占用内存的峰值。
+* 注意：FFmpeg 4.2 的 av_buffer_pool_get 每次仍会分配 AVBufferRef 结构体(几十字节)，
+*      池只消除平面数据的大块分配。
+* 不支持硬件解码和调色板格式，这些情况退回 avcodec_default_get_buffer2。
+*/
+
+#define FRAME_POOL_STRIDE_ALIGN 64  // 和 FFmpeg 开启 AVX512 时的 STRIDE_ALIGN 一致
+
+typedef struct frame_pool_stats {
+    int64_t nb_frames;          // get_buffer2 分配的帧数
+    int64_t nb_fallback;        // 不支持的格式退回默认分配的帧数
+    int64_t buf_get_count;      // 从池中取平面内存的次数
+    int64_t buf_alloc_count;    // 池中没有空闲内存、真正分配的次数
+    int64_t nb_reconfig;        // 分辨率/格式变化导致重建池的次数
+    int64_t mem_bytes;          // 池当前持有的内存(含正在被帧引用的)
+    int64_t mem_high_water;     // mem_bytes 的峰值
+} frame_pool_stats_t;
+
+typedef struct frame_pool {
+    pthread_mutex_t mutex;      // 帧级多线程解码时 get_buffer2 会在多个线程中调用，保护池的重建
+    pthread_mutex_t stats_mutex;    // 保护统计，内存归还可能发生在任意线程
+    AVBufferPool *pools[4];     // 每个平面一个池
+    int plane_size[4];          // 每个平面的内存大小
+    int linesize[4];
+    int width;                  // 当前池对应的帧参数
+    int height;
+    int format;
+    int freed;                  // 已经调用 frame_pool_free，等待外面的帧归还内存
+    frame_pool_stats_t stats;
+} frame_pool_t;
+
+/**
+ * @brief 分配帧内存池
+ * @return 失败返回NULL
+ */
+frame_pool_t *frame_pool_alloc(void);
+
+/**
+ * @brief 释放帧内存池，还在外面被引用的帧可以在之后继续释放
+ * @param pool
+ */
+void frame_pool_free(frame_pool_t *pool);
+
+/**
+ * @brief 让解码器从池中分配帧，必须在 avcodec_open2 之前调用
+ * @param pool
+ * @param codec_ctx 解码器上下文，会占用 opaque 字段
+ * @return 成功返回0
+ */
+int frame_pool_attach(frame_pool_t *pool, AVCodecContext *codec_ctx);
+
+/**
+ * @brief get_buffer2 回调，codec_ctx->opaque 为 frame_pool_t
+ */
+int frame_pool_get_buffer2(AVCodecContext *codec_ctx, AVFrame *frame, int flags);
+
+/**
+ * @brief 获取统计信息
+ */
+void frame_pool_get_stats(frame_pool_t *pool, frame_pool_stats_t *stats);
+
+/**
+ * @brief 打印统计信息
+ * @param pool
+ * @param name 打印时的前缀
+ */
+void frame_pool_dump_stats(frame_pool_t *pool, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FRAMEPOOL_H
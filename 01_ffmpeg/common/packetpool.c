@@ -0,0 +1,203 @@
+#include "packetpool.h"
+#include <stdio.h>
+#include <string.h>
+#include "libavutil/mem.h"
+
+#define PACKET_POOL_DEFAULT_MAX_FREE 256
+
+// AVBufferPool 未命中时的分配函数，用来统计真正的堆分配次数
+static AVBufferRef *data_pool_alloc(void *opaque, int size)
+{
+    packet_pool_t *pool = (packet_pool_t *)opaque;
+    AVBufferRef *buf = av_buffer_alloc(size);
+    if (buf) {
+        pthread_mutex_lock(&pool->mutex);
+        pool->stats.data_alloc_count++;
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    return buf;
+}
+
+// 找到能容纳 size 字节的最小分级，超出最大分级返回-1
+static int get_class_index(int size)
+{
+    int class_size = PACKET_POOL_MIN_CLASS_SIZE;
+    for (int i = 0; i < PACKET_POOL_NB_CLASSES; i++) {
+        if (size <= class_size)
+            return i;
+        class_size <<= 1;
+    }
+    return -1;
+}
+
+packet_pool_t *packet_pool_alloc(int max_free)
+{
+    packet_pool_t *pool = (packet_pool_t *)av_mallocz(sizeof(packet_pool_t));
+    if (!pool) {
+        return NULL;
+    }
+    pool->max_free = max_free > 0 ? max_free : PACKET_POOL_DEFAULT_MAX_FREE;
+    // 空闲链表一次分配到最大容量，之后不会再扩容
+    pool->free_packets = (AVPacket **)av_mallocz_array(pool->max_free, sizeof(AVPacket *));
+    if (!pool->free_packets) {
+        printf("packet pool alloc free list failed\n");
+        av_freep(&pool);
+        return NULL;
+    }
+    if (pthread_mutex_init(&pool->mutex, NULL) != 0) {
+        printf("packet pool init mutex failed\n");
+        av_freep(&pool->free_packets);
+        av_freep(&pool);
+        return NULL;
+    }
+    // 每一级的内存都要多留 AV_INPUT_BUFFER_PADDING_SIZE
+    int class_size = PACKET_POOL_MIN_CLASS_SIZE;
+    for (int i = 0; i < PACKET_POOL_NB_CLASSES; i++) {
+        pool->data_pools[i] = av_buffer_pool_init2(class_size + AV_INPUT_BUFFER_PADDING_SIZE, pool,
+                                                   data_pool_alloc, NULL);
+        if (!pool->data_pools[i]) {
+            printf("av_buffer_pool_init2 failed, class_size:%d\n", class_size);
+            packet_pool_free(pool);
+            return NULL;
+        }
+        class_size <<= 1;
+    }
+    return pool;
+}
+
+void packet_pool_free(packet_pool_t *pool)
+{
+    if (!pool) {
+        return;
+    }
+    for (int i = 0; i < pool->nb_free; i++) {
+        av_packet_free(&pool->free_packets[i]);
+    }
+    av_freep(&pool->free_packets);
+    // av_buffer_pool_uninit 只是标记，还在外面被引用的内存在最后一次 unref 时才真正释放
+    for (int i = 0; i < PACKET_POOL_NB_CLASSES; i++) {
+        if (pool->data_pools[i])
+            av_buffer_pool_uninit(&pool->data_pools[i]);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    av_freep(&pool);
+}
+
+AVPacket *packet_pool_get(packet_pool_t *pool)
+{
+    if (!pool) {
+        return av_packet_alloc();
+    }
+    AVPacket *pkt = NULL;
+    pthread_mutex_lock(&pool->mutex);
+    pool->stats.get_count++;
+    if (pool->nb_free > 0) {
+        pkt = pool->free_packets[--pool->nb_free];
+        pool->free_packets[pool->nb_free] = NULL;
+    } else {
+        pool->stats.packet_alloc_count++;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (!pkt) {
+        pkt = av_packet_alloc(); // 池里没有空闲包，真正分配
+    }
+    return pkt;
+}
+
+void packet_pool_put(packet_pool_t *pool, AVPacket *pkt)
+{
+    if (!pkt) {
+        return;
+    }
+    if (!pool) {
+        av_packet_free(&pkt);
+        return;
+    }
+    av_packet_unref(pkt); // 释放数据引用，池内数据会回到 AVBufferPool
+    pthread_mutex_lock(&pool->mutex);
+    pool->stats.put_count++;
+    if (pool->nb_free < pool->max_free) {
+        pool->free_packets[pool->nb_free++] = pkt;
+        pkt = NULL;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (pkt) {
+        av_packet_free(&pkt); // 空闲包已经足够多，直接释放
+    }
+}
+
+int packet_pool_new_data(packet_pool_t *pool, AVPacket *pkt, int size)
+{
+    if (!pool) {
+        return av_new_packet(pkt, size);
+    }
+    if (size < 0) {
+        return AVERROR(EINVAL);
+    }
+    int index = get_class_index(size);
+    AVBufferRef *buf = NULL;
+    if (index >= 0) {
+        buf = av_buffer_pool_get(pool->data_pools[index]);
+    } else {
+        buf = av_buffer_alloc(size + AV_INPUT_BUFFER_PADDING_SIZE); // 超出最大分级
+    }
+    pthread_mutex_lock(&pool->mutex);
+    pool->stats.data_get_count++;
+    if (index < 0 && buf)
+        pool->stats.data_alloc_count++;
+    pthread_mutex_unlock(&pool->mutex);
+    if (!buf) {
+        return AVERROR(ENOMEM);
+    }
+    memset(buf->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    av_packet_unref(pkt);
+    pkt->buf = buf;
+    pkt->data = buf->data;
+    pkt->size = size;
+    return 0;
+}
+
+int packet_pool_ref(packet_pool_t *pool, AVPacket *dst, const AVPacket *src)
+{
+    if (src->buf) {
+        return av_packet_ref(dst, src); // 有引用计数，只增加引用，不拷贝数据
+    }
+    int ret = av_packet_copy_props(dst, src);
+    if (ret < 0) {
+        return ret;
+    }
+    ret = packet_pool_new_data(pool, dst, src->size);
+    if (ret < 0) {
+        av_packet_unref(dst);
+        return ret;
+    }
+    if (src->size > 0)
+        memcpy(dst->data, src->data, src->size);
+    return 0;
+}
+
+void packet_pool_get_stats(packet_pool_t *pool, packet_pool_stats_t *stats)
+{
+    memset(stats, 0, sizeof(packet_pool_stats_t));
+    if (!pool) {
+        return;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    *stats = pool->stats;
+    stats->nb_free = pool->nb_free;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void packet_pool_dump_stats(packet_pool_t *pool, const char *name)
+{
+    packet_pool_stats_t stats;
+    packet_pool_get_stats(pool, &stats);
+    printf("[%s] packet get:%" PRId64 " put:%" PRId64 " alloc:%" PRId64
+           ", data get:%" PRId64 " alloc:%" PRId64 ", free:%d\n",
+           name ? name : "packet_pool", stats.get_count, stats.put_count,
+           stats.packet_alloc_count, stats.data_get_count, stats.data_alloc_count,
+           stats.nb_free);
+}
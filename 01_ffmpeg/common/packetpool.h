@@ -0,0 +1,111 @@
+#ifndef PACKETPOOL_H
+#define PACKETPOOL_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "libavcodec/avcodec.h"
+#include "libavutil/buffer.h"
+
+/**
+* AVPacket 回收池：
+* (1) AVPacket 结构体本身放在空闲链表里循环使用，避免每帧 av_packet_alloc/av_packet_free;
+* (2) 需要自己持有数据的包(非引用计数包的拷贝、自己组装的包)从按大小分级的 AVBufferPool 取内存;
+* (3) demux、bsf、mux 各个阶段共用同一个池，线程安全。
+* 注意：demuxer/bsf 内部产生的数据 buffer 由 FFmpeg 自己分配，池只回收 AVPacket 外壳。
+*/
+
+#define PACKET_POOL_NB_CLASSES 14       // 数据分级数量: 1KB, 2KB, ... 8MB
+#define PACKET_POOL_MIN_CLASS_SIZE 1024 // 最小的一级
+
+// 池的统计信息，用于确认稳定运行后不再有堆分配
+typedef struct packet_pool_stats {
+    int64_t get_count;          // packet_pool_get 调用次数
+    int64_t put_count;          // packet_pool_put 调用次数
+    int64_t packet_alloc_count; // 池中没有空闲包时真正调用 av_packet_alloc 的次数
+    int64_t data_get_count;     // packet_pool_new_data 调用次数
+    int64_t data_alloc_count;   // 真正分配数据内存的次数(AVBufferPool 未命中或超出最大分级)
+    int nb_free;                // 当前空闲的包数量
+} packet_pool_stats_t;
+
+typedef struct packet_pool {
+    pthread_mutex_t mutex;
+    AVPacket **free_packets;    // 空闲的包
+    int nb_free;                // 空闲包数量
+    int max_free;               // 最多缓存多少个空闲包，超出的直接释放
+    AVBufferPool *data_pools[PACKET_POOL_NB_CLASSES];   // 按大小分级的数据内存池
+    packet_pool_stats_t stats;
+} packet_pool_t;
+
+/**
+ * @brief 分配包回收池
+ * @param max_free 最多缓存的空闲包数量，<=0 则使用默认值
+ * @return 成功返回回收池；失败返回NULL
+ */
+packet_pool_t *packet_pool_alloc(int max_free);
+
+/**
+ * @brief 释放回收池。
+ *        还没有归还的包要在这之前 packet_pool_put，或者之后用 av_packet_free 释放，
+ *        池释放之后不能再对它调用 packet_pool_put(会访问已经释放的池和锁)。
+ *        包引用的池内数据不受影响，最后一次 av_packet_unref/av_packet_free 时才真正释放。
+ * @param pool
+ */
+void packet_pool_free(packet_pool_t *pool);
+
+/**
+ * @brief 获取一个空的包(已经初始化，没有数据)
+ * @param pool 为NULL时退化为 av_packet_alloc
+ * @return 失败返回NULL
+ */
+AVPacket *packet_pool_get(packet_pool_t *pool);
+
+/**
+ * @brief 归还包，内部会先 av_packet_unref
+ * @param pool 为NULL时退化为 av_packet_free
+ * @param pkt
+ */
+void packet_pool_put(packet_pool_t *pool, AVPacket *pkt);
+
+/**
+ * @brief 给包分配数据内存，作用同 av_new_packet，但内存从池中获取
+ * @param pool
+ * @param pkt 空的包
+ * @param size 数据大小(不含padding)
+ * @return 成功返回0
+ */
+int packet_pool_new_data(packet_pool_t *pool, AVPacket *pkt, int size);
+
+/**
+ * @brief 作用同 av_packet_ref：src 有引用计数则直接增加引用，否则把数据拷贝到池内存
+ * @param pool
+ * @param dst 空的包
+ * @param src
+ * @return 成功返回0
+ */
+int packet_pool_ref(packet_pool_t *pool, AVPacket *dst, const AVPacket *src);
+
+/**
+ * @brief 获取统计信息
+ * @param pool
+ * @param stats
+ */
+void packet_pool_get_stats(packet_pool_t *pool, packet_pool_stats_t *stats);
+
+/**
+ * @brief 打印统计信息
+ * @param pool
+ * @param name 打印时的前缀
+ */
+void packet_pool_dump_stats(packet_pool_t *pool, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PACKETPOOL_H
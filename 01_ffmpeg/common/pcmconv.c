@@ -0,0 +1,976 @@
+#include "pcmconv.h"
+#include <string.h>
+#include "libavutil/mem.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PCM_CONV_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PCM_CONV_SSE2 1
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PCM_CONV_NEON 1
+#endif
+
+// ===== 标量实现 =====
+// 声道数作为常量传入时编译器会把内层循环展开
+
+#define DEFINE_SCALAR(bits)                                                                    \
+static inline void interleave##bits##_c(uint##bits##_t *dst, const uint8_t *const *src,        \
+                                        int nb_channels, int start, int nb_samples)            \
+{                                                                                              \
+    for (int ch = 0; ch < nb_channels; ch++) {                                                 \
+        const uint##bits##_t *s = (const uint##bits##_t *)src[ch];                             \
+        uint##bits##_t *d = dst + ch;                                                          \
+        for (int i = start; i < nb_samples; i++)                                               \
+            d[i * nb_channels] = s[i];                                                         \
+    }                                                                                          \
+}                                                                                              \
+static inline void deinterleave##bits##_c(uint8_t *const *dst, const uint##bits##_t *src,      \
+                                          int nb_channels, int start, int nb_samples)          \
+{                                                                                              \
+    for (int ch = 0; ch < nb_channels; ch++) {                                                 \
+        uint##bits##_t *d = (uint##bits##_t *)dst[ch];                                         \
+        const uint##bits##_t *s = src + ch;                                                    \
+        for (int i = start; i < nb_samples; i++)                                               \
+            d[i] = s[i * nb_channels];                                                         \
+    }                                                                                          \
+}
+
+DEFINE_SCALAR(16)
+DEFINE_SCALAR(32)
+
+// 任意位宽(U8/DBL等)
+static void interleave_any_c(uint8_t *dst, const uint8_t *const *src, int nb_channels,
+                             int nb_samples, int bps)
+{
+    for (int i = 0; i < nb_samples; i++) {
+        for (int ch = 0; ch < nb_channels; ch++) {
+            memcpy(dst, src[ch] + i * bps, bps);
+            dst += bps;
+        }
+    }
+}
+
+static void deinterleave_any_c(uint8_t *const *dst, const uint8_t *src, int nb_channels,
+                               int nb_samples, int bps)
+{
+    for (int i = 0; i < nb_samples; i++) {
+        for (int ch = 0; ch < nb_channels; ch++) {
+            memcpy(dst[ch] + i * bps, src, bps);
+            src += bps;
+        }
+    }
+}
+
+// ===== SIMD 实现 =====
+// 每个函数返回已经处理的样本数，剩下的尾巴交给标量实现
+
+#if PCM_CONV_SSE2
+// 4x4 的32位转置，行列互换，正反方向通用
+static inline void transpose4x4_epi32(__m128i *r0, __m128i *r1, __m128i *r2, __m128i *r3)
+{
+    __m128i t0 = _mm_unpacklo_epi32(*r0, *r1);
+    __m128i t1 = _mm_unpacklo_epi32(*r2, *r3);
+    __m128i t2 = _mm_unpackhi_epi32(*r0, *r1);
+    __m128i t3 = _mm_unpackhi_epi32(*r2, *r3);
+    *r0 = _mm_unpacklo_epi64(t0, t1);
+    *r1 = _mm_unpackhi_epi64(t0, t1);
+    *r2 = _mm_unpacklo_epi64(t2, t3);
+    *r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+// 8x8 的16位转置
+static inline void transpose8x8_epi16(__m128i r[8])
+{
+    __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+    __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+    __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+    __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+    __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+    __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+    __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+    __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+    r[0] = _mm_unpacklo_epi64(b0, b4);
+    r[1] = _mm_unpackhi_epi64(b0, b4);
+    r[2] = _mm_unpacklo_epi64(b1, b5);
+    r[3] = _mm_unpackhi_epi64(b1, b5);
+    r[4] = _mm_unpacklo_epi64(b2, b6);
+    r[5] = _mm_unpackhi_epi64(b2, b6);
+    r[6] = _mm_unpacklo_epi64(b3, b7);
+    r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+static int interleave32_8ch_simd(uint32_t *dst, const uint8_t *const *src, int nb_samples)
+{
+    const uint32_t *s[8];
+    for (int ch = 0; ch < 8; ch++)
+        s[ch] = (const uint32_t *)src[ch];
+    int i = 0;
+    for (; i + 4 <= nb_samples; i += 4) {
+        __m128i c0 = _mm_loadu_si128((const __m128i *)(s[0] + i));
+        __m128i c1 = _mm_loadu_si128((const __m128i *)(s[1] + i));
+        __m128i c2 = _mm_loadu_si128((const __m128i *)(s[2] + i));
+        __m128i c3 = _mm_loadu_si128((const __m128i *)(s[3] + i));
+        __m128i c4 = _mm_loadu_si128((const __m128i *)(s[4] + i));
+        __m128i c5 = _mm_loadu_si128((const __m128i *)(s[5] + i));
+        __m128i c6 = _mm_loadu_si128((const __m128i *)(s[6] + i));
+        __m128i c7 = _mm_loadu_si128((const __m128i *)(s[7] + i));
+        transpose4x4_epi32(&c0, &c1, &c2, &c3);
+        transpose4x4_epi32(&c4, &c5, &c6, &c7);
+        __m128i *d = (__m128i *)(dst + i * 8);
+        _mm_storeu_si128(d + 0, c0);
+        _mm_storeu_si128(d + 1, c4);
+        _mm_storeu_si128(d + 2, c1);
+        _mm_storeu_si128(d + 3, c5);
+        _mm_storeu_si128(d + 4, c2);
+        _mm_storeu_si128(d + 5, c6);
+        _mm_storeu_si128(d + 6, c3);
+        _mm_storeu_si128(d + 7, c7);
+    }
+    return i;
+}
+
+static int deinterleave32_8ch_simd(uint8_t *const *dst, const uint32_t *src, int nb_samples)
+{
+    int i = 0;
+    for (; i + 4 <= nb_samples; i += 4) {
+        const __m128i *s = (const __m128i *)(src + i * 8);
+        __m128i c0 = _mm_loadu_si128(s + 0);
+        __m128i c4 = _mm_loadu_si128(s + 1);
+        __m128i c1 = _mm_loadu_si128(s + 2);
+        __m128i c5 = _mm_loadu_si128(s + 3);
+        __m128i c2 = _mm_loadu_si128(s + 4);
+        __m128i c6 = _mm_loadu_si128(s + 5);
+        __m128i c3 = _mm_loadu_si128(s + 6);
+        __m128i c7 = _mm_loadu_si128(s + 7);
+        transpose4x4_epi32(&c0, &c1, &c2, &c3);
+        transpose4x4_epi32(&c4, &c5, &c6, &c7);
+        _mm_storeu_si128((__m128i *)((uint32_t *)dst[0] + i), c0);
+        _mm_storeu_si128((__m128i *)((uint32_t *)dst[1] + i), c1);
+        _mm_storeu_si128((__m128i *)((uint32_t *)dst[2] + i), c2);
+        _mm_storeu_si128((__m128i *)((uint32_t *)dst[3] + i), c3);
+        _mm_storeu_si128((__m128i *)((uint32_t *)dst[4] + i), c4);
+        _mm_storeu_si128((__m128i *)((uint32_t *)dst[5] + i), c5);
+        _mm_storeu_si128((__m128i *)((uint32_t *)dst[6] + i), c6);
+        _mm_storeu_si128((__m128i *)((uint32_t *)dst[7] + i), c7);
+    }
+    return i;
+}
+
+static int interleave16_8ch_simd(uint16_t *dst, const uint8_t *const *src, int nb_samples)
+{
+    int i = 0;
+    __m128i r[8];
+    for (; i + 8 <= nb_samples; i += 8) {
+        for (int ch = 0; ch < 8; ch++)
+            r[ch] = _mm_loadu_si128((const __m128i *)((const uint16_t *)src[ch] + i));
+        transpose8x8_epi16(r);
+        for (int k = 0; k < 8; k++)
+            _mm_storeu_si128((__m128i *)(dst + (i + k) * 8), r[k]);
+    }
+    return i;
+}
+
+static int deinterleave16_8ch_simd(uint8_t *const *dst, const uint16_t *src, int nb_samples)
+{
+    int i = 0;
+    __m128i r[8];
+    for (; i + 8 <= nb_samples; i += 8) {
+        for (int k = 0; k < 8; k++)
+            r[k] = _mm_loadu_si128((const __m128i *)(src + (i + k) * 8));
+        transpose8x8_epi16(r);
+        for (int ch = 0; ch < 8; ch++)
+            _mm_storeu_si128((__m128i *)((uint16_t *)dst[ch] + i), r[ch]);
+    }
+    return i;
+}
+
+// 6声道：前4个声道做 4x4 转置，后2个声道两两交错成64位，再按样本拼接
+static int interleave32_6ch_simd(uint32_t *dst, const uint8_t *const *src, int nb_samples)
+{
+    const uint32_t *s[6];
+    for (int ch = 0; ch < 6; ch++)
+        s[ch] = (const uint32_t *)src[ch];
+    int i = 0;
+    for (; i + 4 <= nb_samples; i += 4) {
+        __m128i r0 = _mm_loadu_si128((const __m128i *)(s[0] + i));
+        __m128i r1 = _mm_loadu_si128((const __m128i *)(s[1] + i));
+        __m128i r2 = _mm_loadu_si128((const __m128i *)(s[2] + i));
+        __m128i r3 = _mm_loadu_si128((const __m128i *)(s[3] + i));
+        __m128i c4 = _mm_loadu_si128((const __m128i *)(s[4] + i));
+        __m128i c5 = _mm_loadu_si128((const __m128i *)(s[5] + i));
+        transpose4x4_epi32(&r0, &r1, &r2, &r3);
+        __m128i p01 = _mm_unpacklo_epi32(c4, c5);   // 样本0、1的声道4、5
+        __m128i p23 = _mm_unpackhi_epi32(c4, c5);
+        __m128i *d = (__m128i *)(dst + i * 6);
+        _mm_storeu_si128(d + 0, r0);
+        _mm_storeu_si128(d + 1, _mm_unpacklo_epi64(p01, r1));
+        _mm_storeu_si128(d + 2, _mm_unpackhi_epi64(r1, p01));
+        _mm_storeu_si128(d + 3, r2);
+        _mm_storeu_si128(d + 4, _mm_unpacklo_epi64(p23, r3));
+        _mm_storeu_si128(d + 5, _mm_unpackhi_epi64(r3, p23));
+    }
+    return i;
+}
+
+static int deinterleave32_6ch_simd(uint8_t *const *dst, const uint32_t *src, int nb_samples)
+{
+    int i = 0;
+    for (; i + 4 <= nb_samples; i += 4) {
+        const __m128i *s = (const __m128i *)(src + i * 6);
+        __m128d v1 = _mm_castsi128_pd(_mm_loadu_si128(s + 1));
+        __m128d v2 = _mm_castsi128_pd(_mm_loadu_si128(s + 2));
+        __m128d v4 = _mm_castsi128_pd(_mm_loadu_si128(s + 4));
+        __m128d v5 = _mm_castsi128_pd(_mm_loadu_si128(s + 5));
+        __m128i r0 = _mm_loadu_si128(s + 0);
+        __m128i r1 = _mm_castpd_si128(_mm_shuffle_pd(v1, v2, 1));     // v1 高64位 + v2 低64位
+        __m128i r2 = _mm_loadu_si128(s + 3);
+        __m128i r3 = _mm_castpd_si128(_mm_shuffle_pd(v4, v5, 1));
+        __m128i p01 = _mm_shuffle_epi32(_mm_castpd_si128(_mm_shuffle_pd(v1, v2, 2)), 0xD8);
+        __m128i p23 = _mm_shuffle_epi32(_mm_castpd_si128(_mm_shuffle_pd(v4, v5, 2)), 0xD8);
+        transpose4x4_epi32(&r0, &r1, &r2, &r3);
+        _mm_storeu_si128((__m128i *)((uint32_t *)dst[0] + i), r0);
+        _mm_storeu_si128((__m128i *)((uint32_t *)dst[1] + i), r1);
+        _mm_storeu_si128((__m128i *)((uint32_t *)dst[2] + i), r2);
+        _mm_storeu_si128((__m128i *)((uint32_t *)dst[3] + i), r3);
+        _mm_storeu_si128((__m128i *)((uint32_t *)dst[4] + i), _mm_unpacklo_epi64(p01, p23));
+        _mm_storeu_si128((__m128i *)((uint32_t *)dst[5] + i), _mm_unpackhi_epi64(p01, p23));
+    }
+    return i;
+}
+
+/**
+ * 6声道16位：补两个空声道做 8x8 转置，每个样本 12 字节，按顺序用 16 字节的写入，
+ * 多写的 4 字节被下一个样本覆盖。最后一次写入超出这一组，所以要求后面至少还有一个样本
+ */
+static int interleave16_6ch_simd(uint16_t *dst, const uint8_t *const *src, int nb_samples)
+{
+    int i = 0;
+    __m128i r[8];
+    for (; i + 9 <= nb_samples; i += 8) {
+        for (int ch = 0; ch < 6; ch++)
+            r[ch] = _mm_loadu_si128((const __m128i *)((const uint16_t *)src[ch] + i));
+        r[6] = r[7] = _mm_setzero_si128();
+        transpose8x8_epi16(r);
+        for (int k = 0; k < 8; k++)
+            _mm_storeu_si128((__m128i *)(dst + (i + k) * 6), r[k]);
+    }
+    return i;
+}
+
+// 每次读 16 字节，多读的 4 字节是下一个样本的前两个声道，转置后落在不用的第6、7行
+static int deinterleave16_6ch_simd(uint8_t *const *dst, const uint16_t *src, int nb_samples)
+{
+    int i = 0;
+    __m128i r[8];
+    for (; i + 9 <= nb_samples; i += 8) {
+        for (int k = 0; k < 8; k++)
+            r[k] = _mm_loadu_si128((const __m128i *)(src + (i + k) * 6));
+        transpose8x8_epi16(r);
+        for (int ch = 0; ch < 6; ch++)
+            _mm_storeu_si128((__m128i *)((uint16_t *)dst[ch] + i), r[ch]);
+    }
+    return i;
+}
+#endif // PCM_CONV_SSE2
+
+#if PCM_CONV_AVX2
+// 256位的 unpack 在每个128位通道内进行，需要再交换一次高低128位
+static int interleave32_2ch_simd(uint32_t *dst, const uint32_t *l, const uint32_t *r, int nb_samples)
+{
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(l + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(r + i));
+        __m256i lo = _mm256_unpacklo_epi32(a, b);
+        __m256i hi = _mm256_unpackhi_epi32(a, b);
+        _mm256_storeu_si256((__m256i *)(dst + i * 2), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst + i * 2 + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    return i;
+}
+
+static int interleave16_2ch_simd(uint16_t *dst, const uint16_t *l, const uint16_t *r, int nb_samples)
+{
+    int i = 0;
+    for (; i + 16 <= nb_samples; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(l + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(r + i));
+        __m256i lo = _mm256_unpacklo_epi16(a, b);
+        __m256i hi = _mm256_unpackhi_epi16(a, b);
+        _mm256_storeu_si256((__m256i *)(dst + i * 2), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst + i * 2 + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    return i;
+}
+
+// 先交换高低128位再在通道内 shuffle：LRLR... -> LLLL RRRR
+static int deinterleave32_2ch_simd(uint32_t *l, uint32_t *r, const uint32_t *src, int nb_samples)
+{
+    const __m256i perm = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        __m256i a = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)(src + i * 2)), perm);
+        __m256i b = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)(src + i * 2 + 8)), perm);
+        _mm256_storeu_si256((__m256i *)(l + i), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i *)(r + i), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    return i;
+}
+
+static int deinterleave16_2ch_simd(uint16_t *l, uint16_t *r, const uint16_t *src, int nb_samples)
+{
+    // 每个128位通道内把偶数位置(L)放到低64位，奇数位置(R)放到高64位
+    const __m256i shuf = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15,
+                                          0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+    int i = 0;
+    for (; i + 16 <= nb_samples; i += 16) {
+        __m256i a = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(src + i * 2)), shuf);
+        __m256i b = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(src + i * 2 + 16)), shuf);
+        // a: L0-3 R0-3 | L4-7 R4-7, b: L8-11 R8-11 | L12-15 R12-15
+        a = _mm256_permute4x64_epi64(a, 0xD8);  // L0-3 L4-7 | R0-3 R4-7
+        b = _mm256_permute4x64_epi64(b, 0xD8);
+        _mm256_storeu_si256((__m256i *)(l + i), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i *)(r + i), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    return i;
+}
+
+#elif PCM_CONV_SSE2
+static int interleave32_2ch_simd(uint32_t *dst, const uint32_t *l, const uint32_t *r, int nb_samples)
+{
+    int i = 0;
+    for (; i + 4 <= nb_samples; i += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(l + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(r + i));
+        _mm_storeu_si128((__m128i *)(dst + i * 2), _mm_unpacklo_epi32(a, b));
+        _mm_storeu_si128((__m128i *)(dst + i * 2 + 4), _mm_unpackhi_epi32(a, b));
+    }
+    return i;
+}
+
+static int interleave16_2ch_simd(uint16_t *dst, const uint16_t *l, const uint16_t *r, int nb_samples)
+{
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(l + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(r + i));
+        _mm_storeu_si128((__m128i *)(dst + i * 2), _mm_unpacklo_epi16(a, b));
+        _mm_storeu_si128((__m128i *)(dst + i * 2 + 8), _mm_unpackhi_epi16(a, b));
+    }
+    return i;
+}
+
+static int deinterleave32_2ch_simd(uint32_t *l, uint32_t *r, const uint32_t *src, int nb_samples)
+{
+    int i = 0;
+    for (; i + 4 <= nb_samples; i += 4) {
+        // L0 R0 L1 R1 | L2 R2 L3 R3 -> 先把每个寄存器排成 L L R R
+        __m128i a = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(src + i * 2)), 0xD8);
+        __m128i b = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(src + i * 2 + 4)), 0xD8);
+        _mm_storeu_si128((__m128i *)(l + i), _mm_unpacklo_epi64(a, b));
+        _mm_storeu_si128((__m128i *)(r + i), _mm_unpackhi_epi64(a, b));
+    }
+    return i;
+}
+
+static int deinterleave16_2ch_simd(uint16_t *l, uint16_t *r, const uint16_t *src, int nb_samples)
+{
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + i * 2));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i * 2 + 8));
+        // 左声道取低16位，右声道右移16位，再用有符号饱和打包(先移位到有符号范围内避免饱和)
+        __m128i la = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+        __m128i lb = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+        __m128i ra = _mm_srai_epi32(a, 16);
+        __m128i rb = _mm_srai_epi32(b, 16);
+        _mm_storeu_si128((__m128i *)(l + i), _mm_packs_epi32(la, lb));
+        _mm_storeu_si128((__m128i *)(r + i), _mm_packs_epi32(ra, rb));
+    }
+    return i;
+}
+
+#elif PCM_CONV_NEON
+static int interleave32_2ch_simd(uint32_t *dst, const uint32_t *l, const uint32_t *r, int nb_samples)
+{
+    int i = 0;
+    for (; i + 4 <= nb_samples; i += 4) {
+        uint32x4x2_t v;
+        v.val[0] = vld1q_u32(l + i);
+        v.val[1] = vld1q_u32(r + i);
+        vst2q_u32(dst + i * 2, v);
+    }
+    return i;
+}
+
+static int interleave16_2ch_simd(uint16_t *dst, const uint16_t *l, const uint16_t *r, int nb_samples)
+{
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        uint16x8x2_t v;
+        v.val[0] = vld1q_u16(l + i);
+        v.val[1] = vld1q_u16(r + i);
+        vst2q_u16(dst + i * 2, v);
+    }
+    return i;
+}
+
+static int deinterleave32_2ch_simd(uint32_t *l, uint32_t *r, const uint32_t *src, int nb_samples)
+{
+    int i = 0;
+    for (; i + 4 <= nb_samples; i += 4) {
+        uint32x4x2_t v = vld2q_u32(src + i * 2);
+        vst1q_u32(l + i, v.val[0]);
+        vst1q_u32(r + i, v.val[1]);
+    }
+    return i;
+}
+
+static int deinterleave16_2ch_simd(uint16_t *l, uint16_t *r, const uint16_t *src, int nb_samples)
+{
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        uint16x8x2_t v = vld2q_u16(src + i * 2);
+        vst1q_u16(l + i, v.val[0]);
+        vst1q_u16(r + i, v.val[1]);
+    }
+    return i;
+}
+
+// NEON 一次最多处理4个声道，8声道拆成两组4声道
+static int interleave32_8ch_simd(uint32_t *dst, const uint8_t *const *src, int nb_samples)
+{
+    const uint32_t *s[8];
+    for (int ch = 0; ch < 8; ch++)
+        s[ch] = (const uint32_t *)src[ch];
+    int i = 0;
+    for (; i + 4 <= nb_samples; i += 4) {
+        uint32x4x4_t lo, hi;
+        for (int ch = 0; ch < 4; ch++) {
+            lo.val[ch] = vld1q_u32(s[ch] + i);
+            hi.val[ch] = vld1q_u32(s[ch + 4] + i);
+        }
+        // vst4 输出 4 个样本 * 4 声道，再按样本把两组拼起来
+        uint32_t tmp_lo[16], tmp_hi[16];
+        vst4q_u32(tmp_lo, lo);
+        vst4q_u32(tmp_hi, hi);
+        for (int k = 0; k < 4; k++) {
+            vst1q_u32(dst + (i + k) * 8, vld1q_u32(tmp_lo + k * 4));
+            vst1q_u32(dst + (i + k) * 8 + 4, vld1q_u32(tmp_hi + k * 4));
+        }
+    }
+    return i;
+}
+
+static int deinterleave32_8ch_simd(uint8_t *const *dst, const uint32_t *src, int nb_samples)
+{
+    int i = 0;
+    for (; i + 4 <= nb_samples; i += 4) {
+        uint32_t tmp_lo[16], tmp_hi[16];
+        for (int k = 0; k < 4; k++) {
+            vst1q_u32(tmp_lo + k * 4, vld1q_u32(src + (i + k) * 8));
+            vst1q_u32(tmp_hi + k * 4, vld1q_u32(src + (i + k) * 8 + 4));
+        }
+        uint32x4x4_t lo = vld4q_u32(tmp_lo);
+        uint32x4x4_t hi = vld4q_u32(tmp_hi);
+        for (int ch = 0; ch < 4; ch++) {
+            vst1q_u32((uint32_t *)dst[ch] + i, lo.val[ch]);
+            vst1q_u32((uint32_t *)dst[ch + 4] + i, hi.val[ch]);
+        }
+    }
+    return i;
+}
+
+// 16位先把相邻两个声道 zip 成32位的一对，8声道就是4组32位的交错，直接用 vst4q_u32
+static int interleave16_8ch_simd(uint16_t *dst, const uint8_t *const *src, int nb_samples)
+{
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        uint32x4x4_t lo, hi;
+        for (int k = 0; k < 4; k++) {
+            uint16x8x2_t z = vzipq_u16(vld1q_u16((const uint16_t *)src[k * 2] + i),
+                                       vld1q_u16((const uint16_t *)src[k * 2 + 1] + i));
+            lo.val[k] = vreinterpretq_u32_u16(z.val[0]);  // 样本0~3
+            hi.val[k] = vreinterpretq_u32_u16(z.val[1]);  // 样本4~7
+        }
+        vst4q_u32((uint32_t *)(dst + i * 8), lo);
+        vst4q_u32((uint32_t *)(dst + i * 8 + 32), hi);
+    }
+    return i;
+}
+
+static int deinterleave16_8ch_simd(uint8_t *const *dst, const uint16_t *src, int nb_samples)
+{
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        uint32x4x4_t lo = vld4q_u32((const uint32_t *)(src + i * 8));
+        uint32x4x4_t hi = vld4q_u32((const uint32_t *)(src + i * 8 + 32));
+        for (int k = 0; k < 4; k++) {
+            uint16x8x2_t u = vuzpq_u16(vreinterpretq_u16_u32(lo.val[k]), vreinterpretq_u16_u32(hi.val[k]));
+            vst1q_u16((uint16_t *)dst[k * 2] + i, u.val[0]);
+            vst1q_u16((uint16_t *)dst[k * 2 + 1] + i, u.val[1]);
+        }
+    }
+    return i;
+}
+
+// 6声道：两两 zip 成 64 位的一对，每个样本是 3 对，按 64 位拼接
+static int interleave32_6ch_simd(uint32_t *dst, const uint8_t *const *src, int nb_samples)
+{
+    int i = 0;
+    for (; i + 4 <= nb_samples; i += 4) {
+        uint32x4x2_t z[3];
+        for (int k = 0; k < 3; k++)
+            z[k] = vzipq_u32(vld1q_u32((const uint32_t *)src[k * 2] + i),
+                             vld1q_u32((const uint32_t *)src[k * 2 + 1] + i));
+        uint32_t *d = dst + i * 6;
+        for (int h = 0; h < 2; h++, d += 12) {   // 每个 val 是两个样本
+            vst1q_u32(d, vcombine_u32(vget_low_u32(z[0].val[h]), vget_low_u32(z[1].val[h])));
+            vst1q_u32(d + 4, vcombine_u32(vget_low_u32(z[2].val[h]), vget_high_u32(z[0].val[h])));
+            vst1q_u32(d + 8, vcombine_u32(vget_high_u32(z[1].val[h]), vget_high_u32(z[2].val[h])));
+        }
+    }
+    return i;
+}
+
+static int deinterleave32_6ch_simd(uint8_t *const *dst, const uint32_t *src, int nb_samples)
+{
+    int i = 0;
+    for (; i + 4 <= nb_samples; i += 4) {
+        uint32x4_t p[2][3];     // 两个样本一组，每组3对声道
+        const uint32_t *s = src + i * 6;
+        for (int h = 0; h < 2; h++, s += 12) {
+            uint32x4_t q0 = vld1q_u32(s);
+            uint32x4_t q1 = vld1q_u32(s + 4);
+            uint32x4_t q2 = vld1q_u32(s + 8);
+            p[h][0] = vcombine_u32(vget_low_u32(q0), vget_high_u32(q1));
+            p[h][1] = vcombine_u32(vget_high_u32(q0), vget_low_u32(q2));
+            p[h][2] = vcombine_u32(vget_low_u32(q1), vget_high_u32(q2));
+        }
+        for (int k = 0; k < 3; k++) {
+            uint32x4x2_t u = vuzpq_u32(p[0][k], p[1][k]);
+            vst1q_u32((uint32_t *)dst[k * 2] + i, u.val[0]);
+            vst1q_u32((uint32_t *)dst[k * 2 + 1] + i, u.val[1]);
+        }
+    }
+    return i;
+}
+
+// 16位两两 zip 成32位的一对，6声道就是3组32位的交错，直接用 vst3q_u32
+static int interleave16_6ch_simd(uint16_t *dst, const uint8_t *const *src, int nb_samples)
+{
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        uint32x4x3_t lo, hi;
+        for (int k = 0; k < 3; k++) {
+            uint16x8x2_t z = vzipq_u16(vld1q_u16((const uint16_t *)src[k * 2] + i),
+                                       vld1q_u16((const uint16_t *)src[k * 2 + 1] + i));
+            lo.val[k] = vreinterpretq_u32_u16(z.val[0]);
+            hi.val[k] = vreinterpretq_u32_u16(z.val[1]);
+        }
+        vst3q_u32((uint32_t *)(dst + i * 6), lo);
+        vst3q_u32((uint32_t *)(dst + i * 6 + 24), hi);
+    }
+    return i;
+}
+
+static int deinterleave16_6ch_simd(uint8_t *const *dst, const uint16_t *src, int nb_samples)
+{
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        uint32x4x3_t lo = vld3q_u32((const uint32_t *)(src + i * 6));
+        uint32x4x3_t hi = vld3q_u32((const uint32_t *)(src + i * 6 + 24));
+        for (int k = 0; k < 3; k++) {
+            uint16x8x2_t u = vuzpq_u16(vreinterpretq_u16_u32(lo.val[k]), vreinterpretq_u16_u32(hi.val[k]));
+            vst1q_u16((uint16_t *)dst[k * 2] + i, u.val[0]);
+            vst1q_u16((uint16_t *)dst[k * 2 + 1] + i, u.val[1]);
+        }
+    }
+    return i;
+}
+#endif
+
+// ===== S16 交错 -> FLTP =====
+// 和 swresample 一样乘以 1/32768(不是除)，结果逐位一致
+
+#define S16_TO_FLT_SCALE (1.0f / (1 << 15))
+
+static void s16_to_fltp_c(float *const *dst, const int16_t *src, int nb_channels, int start,
+                          int nb_samples)
+{
+    for (int i = start; i < nb_samples; i++) {
+        for (int ch = 0; ch < nb_channels; ch++)
+            dst[ch][i] = src[i * nb_channels + ch] * S16_TO_FLT_SCALE;
+    }
+}
+
+#if PCM_CONV_AVX2
+static int s16_to_fltp_1ch_simd(float *dst, const int16_t *src, int nb_samples)
+{
+    const __m256 scale = _mm256_set1_ps(S16_TO_FLT_SCALE);
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    return i;
+}
+
+// 每个32位是一对 LR，移位取出 L、R 后顺序不变，不需要跨128位交换
+static int s16_to_fltp_2ch_simd(float *l, float *r, const int16_t *src, int nb_samples)
+{
+    const __m256 scale = _mm256_set1_ps(S16_TO_FLT_SCALE);
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i * 2));
+        __m256i vl = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+        __m256i vr = _mm256_srai_epi32(v, 16);
+        _mm256_storeu_ps(l + i, _mm256_mul_ps(_mm256_cvtepi32_ps(vl), scale));
+        _mm256_storeu_ps(r + i, _mm256_mul_ps(_mm256_cvtepi32_ps(vr), scale));
+    }
+    return i;
+}
+
+#elif PCM_CONV_SSE2
+static int s16_to_fltp_1ch_simd(float *dst, const int16_t *src, int nb_samples)
+{
+    const __m128 scale = _mm_set1_ps(S16_TO_FLT_SCALE);
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        // 16位放到32位的高半部分再算术右移，完成符号扩展
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    return i;
+}
+
+static int s16_to_fltp_2ch_simd(float *l, float *r, const int16_t *src, int nb_samples)
+{
+    const __m128 scale = _mm_set1_ps(S16_TO_FLT_SCALE);
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + i * 2));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i * 2 + 8));
+        __m128i la = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+        __m128i lb = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+        __m128i ra = _mm_srai_epi32(a, 16);
+        __m128i rb = _mm_srai_epi32(b, 16);
+        _mm_storeu_ps(l + i, _mm_mul_ps(_mm_cvtepi32_ps(la), scale));
+        _mm_storeu_ps(l + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(lb), scale));
+        _mm_storeu_ps(r + i, _mm_mul_ps(_mm_cvtepi32_ps(ra), scale));
+        _mm_storeu_ps(r + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(rb), scale));
+    }
+    return i;
+}
+
+#elif PCM_CONV_NEON
+static int s16_to_fltp_1ch_simd(float *dst, const int16_t *src, int nb_samples)
+{
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        int16x8_t v = vld1q_s16(src + i);
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), S16_TO_FLT_SCALE));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), S16_TO_FLT_SCALE));
+    }
+    return i;
+}
+
+static int s16_to_fltp_2ch_simd(float *l, float *r, const int16_t *src, int nb_samples)
+{
+    int i = 0;
+    for (; i + 8 <= nb_samples; i += 8) {
+        int16x8x2_t v = vld2q_s16(src + i * 2);
+        for (int ch = 0; ch < 2; ch++) {
+            float *dst = ch ? r : l;
+            vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v.val[ch]))), S16_TO_FLT_SCALE));
+            vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v.val[ch]))), S16_TO_FLT_SCALE));
+        }
+    }
+    return i;
+}
+#endif
+
+#if PCM_CONV_AVX2 || PCM_CONV_SSE2 || PCM_CONV_NEON
+#define PCM_CONV_HAVE_SIMD 1
+#else
+#define PCM_CONV_HAVE_SIMD 0
+#endif
+
+const char *pcm_conv_simd_name(void)
+{
+#if PCM_CONV_AVX2
+    return "avx2";
+#elif PCM_CONV_SSE2
+    return "sse2";
+#elif PCM_CONV_NEON
+    return "neon";
+#else
+    return "c";
+#endif
+}
+
+// ===== 按声道数分派 =====
+
+static void interleave16(uint16_t *dst, const uint8_t *const *src, int nb_channels, int nb_samples,
+                         int use_simd)
+{
+    int done = 0;
+    switch (nb_channels) {
+    case 1:
+        memcpy(dst, src[0], nb_samples * sizeof(uint16_t));
+        return;
+    case 2:
+#if PCM_CONV_HAVE_SIMD
+        if (use_simd)
+            done = interleave16_2ch_simd(dst, (const uint16_t *)src[0], (const uint16_t *)src[1],
+                                         nb_samples);
+#endif
+        interleave16_c(dst, src, 2, done, nb_samples);
+        return;
+    case 6:
+#if PCM_CONV_HAVE_SIMD
+        if (use_simd)
+            done = interleave16_6ch_simd(dst, src, nb_samples);
+#endif
+        interleave16_c(dst, src, 6, done, nb_samples);
+        return;
+    case 8:
+#if PCM_CONV_HAVE_SIMD
+        if (use_simd)
+            done = interleave16_8ch_simd(dst, src, nb_samples);
+#endif
+        interleave16_c(dst, src, 8, done, nb_samples);
+        return;
+    default:
+        interleave16_c(dst, src, nb_channels, 0, nb_samples);
+        return;
+    }
+}
+
+static void interleave32(uint32_t *dst, const uint8_t *const *src, int nb_channels, int nb_samples,
+                         int use_simd)
+{
+    int done = 0;
+    switch (nb_channels) {
+    case 1:
+        memcpy(dst, src[0], nb_samples * sizeof(uint32_t));
+        return;
+    case 2:
+#if PCM_CONV_HAVE_SIMD
+        if (use_simd)
+            done = interleave32_2ch_simd(dst, (const uint32_t *)src[0], (const uint32_t *)src[1],
+                                         nb_samples);
+#endif
+        interleave32_c(dst, src, 2, done, nb_samples);
+        return;
+    case 6:
+#if PCM_CONV_HAVE_SIMD
+        if (use_simd)
+            done = interleave32_6ch_simd(dst, src, nb_samples);
+#endif
+        interleave32_c(dst, src, 6, done, nb_samples);
+        return;
+    case 8:
+#if PCM_CONV_HAVE_SIMD
+        if (use_simd)
+            done = interleave32_8ch_simd(dst, src, nb_samples);
+#endif
+        interleave32_c(dst, src, 8, done, nb_samples);
+        return;
+    default:
+        interleave32_c(dst, src, nb_channels, 0, nb_samples);
+        return;
+    }
+}
+
+static void deinterleave16(uint8_t *const *dst, const uint16_t *src, int nb_channels,
+                           int nb_samples, int use_simd)
+{
+    int done = 0;
+    switch (nb_channels) {
+    case 1:
+        memcpy(dst[0], src, nb_samples * sizeof(uint16_t));
+        return;
+    case 2:
+#if PCM_CONV_HAVE_SIMD
+        if (use_simd)
+            done = deinterleave16_2ch_simd((uint16_t *)dst[0], (uint16_t *)dst[1], src, nb_samples);
+#endif
+        deinterleave16_c(dst, src, 2, done, nb_samples);
+        return;
+    case 6:
+#if PCM_CONV_HAVE_SIMD
+        if (use_simd)
+            done = deinterleave16_6ch_simd(dst, src, nb_samples);
+#endif
+        deinterleave16_c(dst, src, 6, done, nb_samples);
+        return;
+    case 8:
+#if PCM_CONV_HAVE_SIMD
+        if (use_simd)
+            done = deinterleave16_8ch_simd(dst, src, nb_samples);
+#endif
+        deinterleave16_c(dst, src, 8, done, nb_samples);
+        return;
+    default:
+        deinterleave16_c(dst, src, nb_channels, 0, nb_samples);
+        return;
+    }
+}
+
+static void deinterleave32(uint8_t *const *dst, const uint32_t *src, int nb_channels,
+                           int nb_samples, int use_simd)
+{
+    int done = 0;
+    switch (nb_channels) {
+    case 1:
+        memcpy(dst[0], src, nb_samples * sizeof(uint32_t));
+        return;
+    case 2:
+#if PCM_CONV_HAVE_SIMD
+        if (use_simd)
+            done = deinterleave32_2ch_simd((uint32_t *)dst[0], (uint32_t *)dst[1], src, nb_samples);
+#endif
+        deinterleave32_c(dst, src, 2, done, nb_samples);
+        return;
+    case 6:
+#if PCM_CONV_HAVE_SIMD
+        if (use_simd)
+            done = deinterleave32_6ch_simd(dst, src, nb_samples);
+#endif
+        deinterleave32_c(dst, src, 6, done, nb_samples);
+        return;
+    case 8:
+#if PCM_CONV_HAVE_SIMD
+        if (use_simd)
+            done = deinterleave32_8ch_simd(dst, src, nb_samples);
+#endif
+        deinterleave32_c(dst, src, 8, done, nb_samples);
+        return;
+    default:
+        deinterleave32_c(dst, src, nb_channels, 0, nb_samples);
+        return;
+    }
+}
+
+static int do_interleave(uint8_t *dst, const uint8_t *const *src, int nb_channels, int nb_samples,
+                         enum AVSampleFormat fmt, int use_simd)
+{
+    int bps = av_get_bytes_per_sample(fmt);
+    if (!dst || !src || nb_channels <= 0 || nb_samples < 0 || bps <= 0) {
+        return AVERROR(EINVAL);
+    }
+    if (bps == 2)
+        interleave16((uint16_t *)dst, src, nb_channels, nb_samples, use_simd);
+    else if (bps == 4)
+        interleave32((uint32_t *)dst, src, nb_channels, nb_samples, use_simd);
+    else
+        interleave_any_c(dst, src, nb_channels, nb_samples, bps);
+    return nb_channels * nb_samples * bps;
+}
+
+static int do_deinterleave(uint8_t *const *dst, const uint8_t *src, int nb_channels,
+                           int nb_samples, enum AVSampleFormat fmt, int use_simd)
+{
+    int bps = av_get_bytes_per_sample(fmt);
+    if (!dst || !src || nb_channels <= 0 || nb_samples < 0 || bps <= 0) {
+        return AVERROR(EINVAL);
+    }
+    if (bps == 2)
+        deinterleave16(dst, (const uint16_t *)src, nb_channels, nb_samples, use_simd);
+    else if (bps == 4)
+        deinterleave32(dst, (const uint32_t *)src, nb_channels, nb_samples, use_simd);
+    else
+        deinterleave_any_c(dst, src, nb_channels, nb_samples, bps);
+    return nb_channels * nb_samples * bps;
+}
+
+int pcm_interleave(uint8_t *dst, const uint8_t *const *src, int nb_channels, int nb_samples,
+                   enum AVSampleFormat fmt)
+{
+    return do_interleave(dst, src, nb_channels, nb_samples, fmt, 1);
+}
+
+int pcm_deinterleave(uint8_t *const *dst, const uint8_t *src, int nb_channels, int nb_samples,
+                     enum AVSampleFormat fmt)
+{
+    return do_deinterleave(dst, src, nb_channels, nb_samples, fmt, 1);
+}
+
+int pcm_interleave_c(uint8_t *dst, const uint8_t *const *src, int nb_channels, int nb_samples,
+                     enum AVSampleFormat fmt)
+{
+    return do_interleave(dst, src, nb_channels, nb_samples, fmt, 0);
+}
+
+int pcm_deinterleave_c(uint8_t *const *dst, const uint8_t *src, int nb_channels, int nb_samples,
+                       enum AVSampleFormat fmt)
+{
+    return do_deinterleave(dst, src, nb_channels, nb_samples, fmt, 0);
+}
+
+static int do_s16_to_fltp(float *const *dst, const int16_t *src, int nb_channels, int nb_samples,
+                          int use_simd)
+{
+    if (!dst || !src || nb_channels <= 0 || nb_samples < 0) {
+        return AVERROR(EINVAL);
+    }
+    int done = 0;
+#if PCM_CONV_HAVE_SIMD
+    if (use_simd && nb_channels == 1)
+        done = s16_to_fltp_1ch_simd(dst[0], src, nb_samples);
+    else if (use_simd && nb_channels == 2)
+        done = s16_to_fltp_2ch_simd(dst[0], dst[1], src, nb_samples);
+#else
+    (void)use_simd;
+#endif
+    s16_to_fltp_c(dst, src, nb_channels, done, nb_samples);
+    return nb_channels * nb_samples * (int)sizeof(int16_t);
+}
+
+int pcm_s16_to_fltp(float *const *dst, const int16_t *src, int nb_channels, int nb_samples)
+{
+    return do_s16_to_fltp(dst, src, nb_channels, nb_samples, 1);
+}
+
+int pcm_s16_to_fltp_c(float *const *dst, const int16_t *src, int nb_channels, int nb_samples)
+{
+    return do_s16_to_fltp(dst, src, nb_channels, nb_samples, 0);
+}
+
+int pcm_frame_to_interleaved(const AVFrame *frame, uint8_t **buf, unsigned int *buf_size)
+{
+    enum AVSampleFormat fmt = (enum AVSampleFormat)frame->format;
+    int bps = av_get_bytes_per_sample(fmt);
+    if (bps <= 0 || frame->channels <= 0) {
+        return AVERROR(EINVAL);
+    }
+    int size = frame->nb_samples * frame->channels * bps;
+    av_fast_malloc(buf, buf_size, size);
+    if (!*buf) {
+        return AVERROR(ENOMEM);
+    }
+    if (!av_sample_fmt_is_planar(fmt)) {
+        memcpy(*buf, frame->data[0], size);
+        return size;
+    }
+    // 声道数超过 AV_NUM_DATA_POINTERS 时平面数据在 extended_data 里
+    return pcm_interleave(*buf, (const uint8_t *const *)frame->extended_data, frame->channels,
+                          frame->nb_samples, fmt);
+}
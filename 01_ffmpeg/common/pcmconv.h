@@ -0,0 +1,92 @@
+#ifndef PCMCONV_H
+#define PCMCONV_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "libavutil/frame.h"
+#include "libavutil/samplefmt.h"
+
+/**
+* PCM 平面(planar) <-> 交错(packed) 转换：
+* (1) 支持 FLTP<->FLT、S16P<->S16、S32P<->S32，以及其他任意位宽的采样格式(标量实现);
+* (2) 1/2/6/8 声道有专门的实现，2/6/8 声道使用 SIMD(编译期选择 AVX2/SSE2/NEON)，1 声道直接拷贝，其余退化为标量;
+* (3) 转换只是按位搬运，不做数值转换，FLT 和 S32 共用 32 位的实现;
+* (4) 另外有 S16 交错 -> FLTP 的数值转换(乘 1/32768，和 swresample 的结果逐位一致)，
+*     1/2 声道使用 SIMD，用于采样率不变时代替 swr_convert 给 AAC 等编码器准备输入。
+*
+* 平面格式: LLLLLLRRRRRR (每个声道连续存储)
+* 交错格式: LRLRLRLRLRLR (各声道样本交替存储)
+*/
+
+/**
+ * @brief 平面 -> 交错
+ * @param dst 交错输出，大小 nb_channels * nb_samples * 每样本字节数
+ * @param src 每个声道一个指针
+ * @param nb_channels 声道数
+ * @param nb_samples 每个声道的样本数
+ * @param fmt 采样格式，平面或交错都可以，只用到每样本字节数
+ * @return 成功返回写入的字节数；失败返回负数
+ */
+int pcm_interleave(uint8_t *dst, const uint8_t *const *src, int nb_channels, int nb_samples,
+                   enum AVSampleFormat fmt);
+
+/**
+ * @brief 交错 -> 平面
+ * @param dst 每个声道一个指针
+ * @param src 交错输入
+ * @return 成功返回读取的字节数；失败返回负数
+ */
+int pcm_deinterleave(uint8_t *const *dst, const uint8_t *src, int nb_channels, int nb_samples,
+                     enum AVSampleFormat fmt);
+
+/**
+ * @brief 标量版本的平面 -> 交错，用于对比测试
+ */
+int pcm_interleave_c(uint8_t *dst, const uint8_t *const *src, int nb_channels, int nb_samples,
+                     enum AVSampleFormat fmt);
+
+/**
+ * @brief 标量版本的交错 -> 平面，用于对比测试
+ */
+int pcm_deinterleave_c(uint8_t *const *dst, const uint8_t *src, int nb_channels, int nb_samples,
+                       enum AVSampleFormat fmt);
+
+/**
+ * @brief S16 交错 -> FLTP，样本值除以 32768
+ * @param dst 每个声道一个 float 平面
+ * @param src S16 交错输入
+ * @param nb_channels 声道数
+ * @param nb_samples 每个声道的样本数
+ * @return 成功返回读取的字节数；失败返回负数
+ */
+int pcm_s16_to_fltp(float *const *dst, const int16_t *src, int nb_channels, int nb_samples);
+
+/**
+ * @brief 标量版本的 S16 交错 -> FLTP，用于对比测试
+ */
+int pcm_s16_to_fltp_c(float *const *dst, const int16_t *src, int nb_channels, int nb_samples);
+
+/**
+ * @brief 编译时选中的 SIMD 指令集名称: "avx2" "sse2" "neon" "c"
+ */
+const char *pcm_conv_simd_name(void);
+
+/**
+ * @brief 把一帧音频转换成交错格式，方便一次 fwrite 写完整帧
+ * @param frame 解码后的帧，平面格式会做交错转换，交错格式直接拷贝
+ * @param buf 输出缓存，容量不足时通过 av_fast_malloc 扩容，调用者用 av_freep 释放
+ * @param buf_size 输出缓存的容量
+ * @return 成功返回数据字节数；失败返回负数
+ */
+int pcm_frame_to_interleaved(const AVFrame *frame, uint8_t **buf, unsigned int *buf_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PCMCONV_H
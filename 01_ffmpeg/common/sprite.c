@@ -0,0 +1,181 @@
+#include "sprite.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libswscale/swscale.h"
+
+void sprite_cell_size(int src_w, int src_h, int shift, int *cell_w, int *cell_h)
+{
+    *cell_w = FFALIGN(AV_CEIL_RSHIFT(src_w, shift), 2);
+    *cell_h = FFALIGN(AV_CEIL_RSHIFT(src_h, shift), 2);
+}
+
+sprite_sheet_t *sprite_sheet_alloc(int cols, int rows, int cell_w, int cell_h)
+{
+    if (cols <= 0 || rows <= 0 || cell_w <= 0 || cell_h <= 0 || (cell_w & 1) || (cell_h & 1)) {
+        printf("invalid sprite sheet %dx%d cell %dx%d\n", cols, rows, cell_w, cell_h);
+        return NULL;
+    }
+    sprite_sheet_t *sheet = (sprite_sheet_t *)av_mallocz(sizeof(sprite_sheet_t));
+    if (!sheet) {
+        return NULL;
+    }
+    sheet->frame = av_frame_alloc();
+    if (!sheet->frame) {
+        av_freep(&sheet);
+        return NULL;
+    }
+    sheet->frame->format = AV_PIX_FMT_YUV420P;
+    sheet->frame->width = cols * cell_w;
+    sheet->frame->height = rows * cell_h;
+    if (av_frame_get_buffer(sheet->frame, 0) < 0) {
+        sprite_sheet_free(sheet);
+        return NULL;
+    }
+    sheet->cols = cols;
+    sheet->rows = rows;
+    sheet->cell_w = cell_w;
+    sheet->cell_h = cell_h;
+    sprite_sheet_reset(sheet);
+    return sheet;
+}
+
+void sprite_sheet_free(sprite_sheet_t *sheet)
+{
+    if (!sheet) {
+        return;
+    }
+    av_frame_free(&sheet->frame);
+    sws_freeContext(sheet->sws_ctx);
+    av_freep(&sheet);
+}
+
+void sprite_sheet_reset(sprite_sheet_t *sheet)
+{
+    AVFrame *f = sheet->frame;
+    // 黑色: Y=16 U=V=128
+    for (int y = 0; y < f->height; y++)
+        memset(f->data[0] + y * f->linesize[0], 16, f->width);
+    for (int y = 0; y < f->height / 2; y++) {
+        memset(f->data[1] + y * f->linesize[1], 128, f->width / 2);
+        memset(f->data[2] + y * f->linesize[2], 128, f->width / 2);
+    }
+    sheet->nb_cells = 0;
+}
+
+/**
+ * 盒式滤波缩小 2^shift 倍，dst 的每个像素是 src 中 f x f 块的平均值。
+ * 超出 src 右边/下边的部分取最后一列/行(dst 宽高向上取整时出现)
+ */
+static void box_downscale(uint8_t *dst, int dst_stride, int dw, int dh, const uint8_t *src,
+                          int src_stride, int sw, int sh, int shift)
+{
+    const int f = 1 << shift;
+    const int round = 1 << (2 * shift - 1);
+    const int full_w = FFMIN(sw >> shift, dw);  // 完全在 src 内的列，不需要判断边界
+    for (int y = 0; y < dh; y++) {
+        const uint8_t *r[4];
+        for (int k = 0; k < f; k++)
+            r[k] = src + (ptrdiff_t)FFMIN(y * f + k, sh - 1) * src_stride;
+        uint8_t *d = dst + (ptrdiff_t)y * dst_stride;
+        int x = 0;
+        if (shift == 1) {
+            for (; x < full_w; x++) {
+                const int i = 2 * x;
+                d[x] = (r[0][i] + r[0][i + 1] + r[1][i] + r[1][i + 1] + 2) >> 2;
+            }
+        } else {
+            for (; x < full_w; x++) {
+                const int i = 4 * x;
+                int sum = 0;
+                for (int k = 0; k < 4; k++)
+                    sum += r[k][i] + r[k][i + 1] + r[k][i + 2] + r[k][i + 3];
+                d[x] = (sum + 8) >> 4;
+            }
+        }
+        for (; x < dw; x++) {
+            int sum = 0;
+            for (int k = 0; k < f; k++)
+                for (int j = 0; j < f; j++)
+                    sum += r[k][FFMIN(x * f + j, sw - 1)];
+            d[x] = (sum + round) >> (2 * shift);
+        }
+    }
+}
+
+// 缩小倍数正好是 2x/4x 时返回 shift，否则返回0
+static int fast_shift(const sprite_sheet_t *sheet, const AVFrame *frame)
+{
+    if (frame->format != AV_PIX_FMT_YUV420P) {
+        return 0;
+    }
+    for (int shift = 1; shift <= 2; shift++) {
+        int w, h;
+        sprite_cell_size(frame->width, frame->height, shift, &w, &h);
+        if (w == sheet->cell_w && h == sheet->cell_h)
+            return shift;
+    }
+    return 0;
+}
+
+int sprite_sheet_add(sprite_sheet_t *sheet, const AVFrame *frame)
+{
+    if (sheet->nb_cells >= sheet->cols * sheet->rows) {
+        return 1;
+    }
+    // 格子左上角在拼图中的位置
+    const int cx = (sheet->nb_cells % sheet->cols) * sheet->cell_w;
+    const int cy = (sheet->nb_cells / sheet->cols) * sheet->cell_h;
+    AVFrame *f = sheet->frame;
+    uint8_t *dst[4] = {
+        f->data[0] + (ptrdiff_t)cy * f->linesize[0] + cx,
+        f->data[1] + (ptrdiff_t)(cy / 2) * f->linesize[1] + cx / 2,
+        f->data[2] + (ptrdiff_t)(cy / 2) * f->linesize[2] + cx / 2,
+        NULL
+    };
+
+    int64_t start = av_gettime_relative();
+    int shift = fast_shift(sheet, frame);
+    if (shift > 0) {
+        box_downscale(dst[0], f->linesize[0], sheet->cell_w, sheet->cell_h, frame->data[0],
+                      frame->linesize[0], frame->width, frame->height, shift);
+        for (int i = 1; i < 3; i++) {
+            box_downscale(dst[i], f->linesize[i], sheet->cell_w / 2, sheet->cell_h / 2,
+                          frame->data[i], frame->linesize[i], AV_CEIL_RSHIFT(frame->width, 1),
+                          AV_CEIL_RSHIFT(frame->height, 1), shift);
+        }
+        sheet->stats.nb_fast++;
+    } else {
+        sheet->sws_ctx = sws_getCachedContext(sheet->sws_ctx, frame->width, frame->height,
+                                              (enum AVPixelFormat)frame->format, sheet->cell_w,
+                                              sheet->cell_h, AV_PIX_FMT_YUV420P, SWS_FAST_BILINEAR,
+                                              NULL, NULL, NULL);
+        if (!sheet->sws_ctx) {
+            printf("sws_getCachedContext failed, pix fmt:%d %dx%d\n", frame->format, frame->width,
+                   frame->height);
+            return AVERROR(EINVAL);
+        }
+        sws_scale(sheet->sws_ctx, (const uint8_t *const *)frame->data, frame->linesize, 0,
+                  frame->height, dst, f->linesize);
+        sheet->stats.nb_sws++;
+    }
+    sheet->stats.scale_us += av_gettime_relative() - start;
+    sheet->stats.nb_thumbs++;
+    sheet->nb_cells++;
+    return sheet->nb_cells >= sheet->cols * sheet->rows;
+}
+
+void sprite_sheet_dump_stats(sprite_sheet_t *sheet, const char *name)
+{
+    if (!sheet) {
+        return;
+    }
+    const sprite_sheet_stats_t *s = &sheet->stats;
+    printf("[%s] sprite %dx%d cell:%dx%d thumbs:%lld fast:%lld sws:%lld scale:%.1fms (%.3fms/thumb)\n",
+           name ? name : "sprite", sheet->cols, sheet->rows, sheet->cell_w, sheet->cell_h,
+           (long long)s->nb_thumbs, (long long)s->nb_fast, (long long)s->nb_sws,
+           s->scale_us / 1000.0, s->nb_thumbs > 0 ? s->scale_us / 1000.0 / s->nb_thumbs : 0.0);
+}
@@ -0,0 +1,82 @@
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "libavutil/frame.h"
+
+struct SwsContext;
+
+/**
+* 缩略图拼图(sprite sheet)：
+* (1) cols x rows 个格子拼成一张 YUV420P 大图，在内存中组装，满了由调用者写出后 reset;
+* (2) 输入是 YUV420P 且缩小倍数正好是 2x/4x 时用盒式滤波(area)快速缩小，直接写到格子里;
+* (3) 其他情况(任意倍数、其他像素格式)退回 sws_scale(SWS_FAST_BILINEAR)。
+* 格子宽高必须是偶数，未填满的格子为黑色。
+*/
+
+typedef struct sprite_sheet_stats {
+    int64_t nb_thumbs;      // 放入的缩略图数
+    int64_t nb_fast;        // 走 2x/4x 快速路径的次数
+    int64_t nb_sws;         // 走 sws_scale 的次数
+    int64_t scale_us;       // 缩小耗时
+} sprite_sheet_stats_t;
+
+typedef struct sprite_sheet {
+    AVFrame *frame;         // 拼图，YUV420P
+    int cols;
+    int rows;
+    int cell_w;
+    int cell_h;
+    int nb_cells;           // 已经填充的格子数
+    struct SwsContext *sws_ctx;
+    sprite_sheet_stats_t stats;
+} sprite_sheet_t;
+
+/**
+ * @brief 计算缩小 2^shift 倍后格子的宽高(向上取整到偶数)，按这个大小分配的拼图可以走快速路径
+ * @param shift 1 为 2x，2 为 4x
+ */
+void sprite_cell_size(int src_w, int src_h, int shift, int *cell_w, int *cell_h);
+
+/**
+ * @brief 分配拼图
+ * @param cols 每行的格子数
+ * @param rows 行数
+ * @param cell_w 格子宽度，必须是偶数
+ * @param cell_h 格子高度，必须是偶数
+ * @return 失败返回NULL
+ */
+sprite_sheet_t *sprite_sheet_alloc(int cols, int rows, int cell_w, int cell_h);
+
+/**
+ * @brief 释放拼图
+ */
+void sprite_sheet_free(sprite_sheet_t *sheet);
+
+/**
+ * @brief 清空拼图(全部格子置黑)，写出一张后调用
+ */
+void sprite_sheet_reset(sprite_sheet_t *sheet);
+
+/**
+ * @brief 把一帧缩小后放到下一个格子
+ * @return 拼图满了返回1，未满返回0，失败返回负数
+ */
+int sprite_sheet_add(sprite_sheet_t *sheet, const AVFrame *frame);
+
+/**
+ * @brief 打印统计信息
+ */
+void sprite_sheet_dump_stats(sprite_sheet_t *sheet, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SPRITE_H
@@ -0,0 +1,339 @@
+#include "yuvwriter.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+
+#ifdef _WIN32
+#    include <io.h>
+#    include <windows.h>
+// Windows 没有 writev，段列表结构自己定义，写之前拼接到一块缓存
+struct iovec {
+    void *iov_base;
+    size_t iov_len;
+};
+#else
+#    include <unistd.h>
+#    include <sys/mman.h>
+#    include <sys/uio.h>
+#endif
+
+#include "libavutil/common.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/time.h"
+
+#ifndef O_BINARY
+#    define O_BINARY 0
+#endif
+
+#ifdef IOV_MAX
+#    define YUV_WRITER_IOV_MAX IOV_MAX
+#else
+#    define YUV_WRITER_IOV_MAX 1024
+#endif
+
+#define YUV_WRITER_MAP_CHUNK (64LL << 20)   // mmap 每次映射 64MB
+
+// 计算每个平面一行的实际字节数和行数
+static int get_planes(const AVFrame *frame, int row_bytes[4], int rows[4])
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((enum AVPixelFormat)frame->format);
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL))) {
+        printf("yuv writer unsupported pix fmt:%d\n", frame->format);
+        return AVERROR(EINVAL);
+    }
+    int ret = av_image_fill_linesizes(row_bytes, (enum AVPixelFormat)frame->format, frame->width);
+    if (ret < 0) {
+        return ret;
+    }
+    int nb_planes = av_pix_fmt_count_planes((enum AVPixelFormat)frame->format);
+    for (int i = 0; i < 4; i++) {
+        if (i >= nb_planes) {
+            row_bytes[i] = 0;
+            rows[i] = 0;
+        } else if (i == 1 || i == 2) {
+            rows[i] = AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h);   // 色度平面
+        } else {
+            rows[i] = frame->height;    // 亮度、alpha 平面
+        }
+    }
+    return nb_planes;
+}
+
+yuv_writer_t *yuv_writer_open(const char *path, int use_mmap)
+{
+    yuv_writer_t *w = (yuv_writer_t *)av_mallocz(sizeof(yuv_writer_t));
+    if (!w) {
+        return NULL;
+    }
+    // mmap 需要可读写打开
+    int flags = (use_mmap ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC | O_BINARY;
+    w->fd = open(path, flags, 0644);
+    if (w->fd < 0) {
+        printf("open %s failed:%s\n", path, strerror(errno));
+        av_freep(&w);
+        return NULL;
+    }
+    w->use_mmap = use_mmap;
+    return w;
+}
+
+// ===== writev 方式 =====
+
+static int ensure_iov(yuv_writer_t *w, int need)
+{
+    if (need <= w->iov_capacity) {
+        return 0;
+    }
+    struct iovec *iov = (struct iovec *)av_realloc_array(w->iov, need, sizeof(struct iovec));
+    if (!iov) {
+        return AVERROR(ENOMEM);
+    }
+    w->iov = iov;
+    w->iov_capacity = need;
+    return 0;
+}
+
+#ifdef _WIN32
+static int write_iov(yuv_writer_t *w, struct iovec *iov, int nb_iov, int64_t total)
+{
+    // 拼成一块再写，一帧仍然只有一次 write
+    av_fast_malloc(&w->gather_buf, &w->gather_size, total);
+    if (!w->gather_buf) {
+        return AVERROR(ENOMEM);
+    }
+    uint8_t *p = w->gather_buf;
+    for (int i = 0; i < nb_iov; i++) {
+        memcpy(p, iov[i].iov_base, iov[i].iov_len);
+        p += iov[i].iov_len;
+    }
+    int64_t done = 0;
+    while (done < total) {
+        int n = _write(w->fd, w->gather_buf + done, (unsigned int)FFMIN(total - done, INT_MAX));
+        w->stats.nb_syscalls++;
+        if (n <= 0) {
+            return AVERROR(errno);
+        }
+        done += n;
+    }
+    return 0;
+}
+#else
+static int write_iov(yuv_writer_t *w, struct iovec *iov, int nb_iov, int64_t total)
+{
+    (void)total;
+    while (nb_iov > 0) {
+        ssize_t n = writev(w->fd, iov, FFMIN(nb_iov, YUV_WRITER_IOV_MAX));
+        w->stats.nb_syscalls++;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return AVERROR(errno);
+        }
+        // 跳过已经写完的段，部分写入的段调整起始位置
+        while (n > 0) {
+            if ((size_t)n >= iov->iov_len) {
+                n -= iov->iov_len;
+                iov++;
+                nb_iov--;
+            } else {
+                iov->iov_base = (uint8_t *)iov->iov_base + n;
+                iov->iov_len -= n;
+                n = 0;
+            }
+        }
+    }
+    return 0;
+}
+#endif
+
+static int write_frame_iov(yuv_writer_t *w, const AVFrame *frame, const int row_bytes[4],
+                           const int rows[4], int nb_planes, int64_t total)
+{
+    int need = 0;
+    for (int i = 0; i < nb_planes; i++) {
+        need += frame->linesize[i] == row_bytes[i] ? 1 : rows[i];
+    }
+    int ret = ensure_iov(w, need);
+    if (ret < 0) {
+        return ret;
+    }
+    int nb_iov = 0;
+    for (int i = 0; i < nb_planes; i++) {
+        if (frame->linesize[i] == row_bytes[i]) {
+            // 平面没有行填充，整个平面一段
+            w->iov[nb_iov].iov_base = frame->data[i];
+            w->iov[nb_iov].iov_len = (size_t)row_bytes[i] * rows[i];
+            nb_iov++;
+        } else {
+            for (int j = 0; j < rows[i]; j++) {
+                w->iov[nb_iov].iov_base = frame->data[i] + (ptrdiff_t)j * frame->linesize[i];
+                w->iov[nb_iov].iov_len = row_bytes[i];
+                nb_iov++;
+            }
+        }
+    }
+    w->stats.nb_segments += nb_iov;
+    return write_iov(w, w->iov, nb_iov, total);
+}
+
+// ===== mmap 方式 =====
+
+static void unmap_window(yuv_writer_t *w)
+{
+    if (!w->map_base) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(w->map_base);
+    CloseHandle((HANDLE)w->map_handle);
+    w->map_handle = NULL;
+#else
+    munmap(w->map_base, w->map_size);
+#endif
+    w->map_base = NULL;
+    w->map_size = 0;
+}
+
+// 保证 [file_pos, file_pos + size) 在映射窗口内
+static int map_window(yuv_writer_t *w, int64_t size)
+{
+    if (w->map_base && w->file_pos + size <= w->map_offset + w->map_size) {
+        return 0;
+    }
+    unmap_window(w);
+
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    int64_t granularity = si.dwAllocationGranularity;
+#else
+    int64_t granularity = sysconf(_SC_PAGESIZE);
+#endif
+    int64_t offset = w->file_pos / granularity * granularity;
+    int64_t map_size = FFMAX(YUV_WRITER_MAP_CHUNK, w->file_pos + size - offset);
+    int64_t file_end = offset + map_size;
+
+#ifdef _WIN32
+    HANDLE fh = (HANDLE)_get_osfhandle(w->fd);
+    // 映射长度超过文件长度时 CreateFileMapping 会扩展文件
+    HANDLE mapping = CreateFileMappingA(fh, NULL, PAGE_READWRITE, (DWORD)(file_end >> 32),
+                                        (DWORD)(file_end & 0xFFFFFFFF), NULL);
+    if (!mapping) {
+        printf("CreateFileMapping failed:%lu\n", GetLastError());
+        return AVERROR(EIO);
+    }
+    void *base = MapViewOfFile(mapping, FILE_MAP_WRITE, (DWORD)(offset >> 32),
+                               (DWORD)(offset & 0xFFFFFFFF), (SIZE_T)map_size);
+    if (!base) {
+        printf("MapViewOfFile failed:%lu\n", GetLastError());
+        CloseHandle(mapping);
+        return AVERROR(EIO);
+    }
+    w->map_handle = mapping;
+#else
+    if (ftruncate(w->fd, file_end) < 0) {
+        printf("ftruncate failed:%s\n", strerror(errno));
+        return AVERROR(errno);
+    }
+    void *base = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, w->fd, offset);
+    if (base == MAP_FAILED) {
+        printf("mmap failed:%s\n", strerror(errno));
+        return AVERROR(errno);
+    }
+#endif
+    w->map_base = (uint8_t *)base;
+    w->map_offset = offset;
+    w->map_size = map_size;
+    w->stats.nb_syscalls++;
+    return 0;
+}
+
+static int write_frame_mmap(yuv_writer_t *w, const AVFrame *frame, const int row_bytes[4],
+                            const int rows[4], int nb_planes, int64_t total)
+{
+    int ret = map_window(w, total);
+    if (ret < 0) {
+        return ret;
+    }
+    uint8_t *dst = w->map_base + (w->file_pos - w->map_offset);
+    for (int i = 0; i < nb_planes; i++) {
+        if (frame->linesize[i] == row_bytes[i]) {
+            memcpy(dst, frame->data[i], (size_t)row_bytes[i] * rows[i]);
+            dst += (size_t)row_bytes[i] * rows[i];
+            w->stats.nb_segments++;
+        } else {
+            for (int j = 0; j < rows[i]; j++) {
+                memcpy(dst, frame->data[i] + (ptrdiff_t)j * frame->linesize[i], row_bytes[i]);
+                dst += row_bytes[i];
+            }
+            w->stats.nb_segments += rows[i];
+        }
+    }
+    return 0;
+}
+
+int yuv_writer_write_frame(yuv_writer_t *w, const AVFrame *frame)
+{
+    int row_bytes[4], rows[4];
+    int nb_planes = get_planes(frame, row_bytes, rows);
+    if (nb_planes < 0) {
+        return nb_planes;
+    }
+    int64_t total = 0;
+    for (int i = 0; i < nb_planes; i++) {
+        total += (int64_t)row_bytes[i] * rows[i];
+    }
+
+    int64_t start = av_gettime_relative();
+    int ret = w->use_mmap ? write_frame_mmap(w, frame, row_bytes, rows, nb_planes, total)
+                          : write_frame_iov(w, frame, row_bytes, rows, nb_planes, total);
+    w->stats.time_us += av_gettime_relative() - start;
+    if (ret < 0) {
+        char errbuf[128] = {0};
+        av_strerror(ret, errbuf, sizeof(errbuf) - 1);
+        printf("yuv writer write frame failed:%s\n", errbuf);
+        return ret;
+    }
+    w->file_pos += total;
+    w->stats.nb_frames++;
+    w->stats.nb_bytes += total;
+    return (int)total;
+}
+
+void yuv_writer_close(yuv_writer_t *w)
+{
+    if (!w) {
+        return;
+    }
+    if (w->use_mmap) {
+        unmap_window(w);
+        // 最后一个映射窗口可能超出实际写入的长度
+#ifdef _WIN32
+        _chsize_s(w->fd, w->file_pos);
+#else
+        if (ftruncate(w->fd, w->file_pos) < 0)
+            printf("ftruncate failed:%s\n", strerror(errno));
+#endif
+    }
+    close(w->fd);
+    av_freep(&w->iov);
+    av_freep(&w->gather_buf);
+    av_freep(&w);
+}
+
+void yuv_writer_dump_stats(yuv_writer_t *w, const char *name)
+{
+    if (!w) {
+        return;
+    }
+    const yuv_writer_stats_t *s = &w->stats;
+    printf("[%s] yuv writer(%s) frames:%lld bytes:%lld syscalls:%lld segments:%lld time:%.1fms"
+           " (%.1fMB/s)\n",
+           name ? name : "yuv_writer", w->use_mmap ? "mmap" : "writev", (long long)s->nb_frames,
+           (long long)s->nb_bytes, (long long)s->nb_syscalls, (long long)s->nb_segments,
+           s->time_us / 1000.0, s->time_us > 0 ? (double)s->nb_bytes / s->time_us : 0.0);
+}
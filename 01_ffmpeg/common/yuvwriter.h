@@ -0,0 +1,82 @@
+#ifndef YUVWRITER_H
+#define YUVWRITER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "libavutil/frame.h"
+#include "libavutil/pixfmt.h"
+
+/**
+* 原始视频帧写文件：
+* (1) 任意像素格式(YUV420P/NV12/10bit/4:2:2/4:4:4/RGB等)，每个平面的宽高由 av_pix_fmt_desc_get 计算;
+* (2) linesize 等于一行实际字节数时整个平面作为一段，否则每行一段，一帧的所有段用一次 writev 写入
+*     (超过 IOV_MAX 时分批; Windows 没有 writev，先拼到缓存再一次 write);
+* (3) 可选 mmap 方式：文件按块映射到内存，直接 memcpy 到映射区，省去一次内核拷贝。
+* 输出文件格式和 ffmpeg -f rawvideo 一致，不含任何对齐填充。
+* 不支持硬件帧和调色板格式。
+*/
+
+typedef struct yuv_writer_stats {
+    int64_t nb_frames;      // 写入的帧数
+    int64_t nb_bytes;       // 写入的字节数
+    int64_t nb_syscalls;    // write/writev 调用次数(mmap 方式为映射次数)
+    int64_t nb_segments;    // 写入的段数(整平面一段，否则每行一段)
+    int64_t time_us;        // 写入耗时
+} yuv_writer_stats_t;
+
+struct iovec;
+
+typedef struct yuv_writer {
+    int fd;
+    int use_mmap;
+
+    // writev 方式：每帧的段列表
+    struct iovec *iov;
+    int iov_capacity;
+    uint8_t *gather_buf;    // 没有 writev 的平台用来拼接一帧
+    unsigned int gather_size;
+
+    // mmap 方式：当前映射的窗口
+    uint8_t *map_base;      // 映射起始地址(按页/分配粒度对齐)
+    int64_t map_offset;     // 映射起始位置在文件中的偏移
+    int64_t map_size;       // 映射长度
+    int64_t file_pos;       // 下一帧写入的位置
+    void *map_handle;       // Windows 的文件映射句柄
+
+    yuv_writer_stats_t stats;
+} yuv_writer_t;
+
+/**
+ * @brief 打开输出文件
+ * @param path
+ * @param use_mmap 是否使用 mmap 方式写入
+ * @return 失败返回NULL
+ */
+yuv_writer_t *yuv_writer_open(const char *path, int use_mmap);
+
+/**
+ * @brief 写入一帧，按帧格式紧凑排列所有平面
+ * @return 成功返回写入的字节数；失败返回负数
+ */
+int yuv_writer_write_frame(yuv_writer_t *w, const AVFrame *frame);
+
+/**
+ * @brief 关闭文件，mmap 方式会把文件截断到实际写入的长度
+ */
+void yuv_writer_close(yuv_writer_t *w);
+
+/**
+ * @brief 打印统计信息
+ */
+void yuv_writer_dump_stats(yuv_writer_t *w, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YUVWRITER_H